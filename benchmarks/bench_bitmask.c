@@ -0,0 +1,95 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_utils.h"
+#include "utils/bitmask.h"
+
+#define ROUNDS 100
+#define SCAN_ROUNDS 10
+// an unspent address every HOLE_GAP addresses after the first run
+#define HOLE_GAP 100000
+
+static uint64_t bench_mask(bool compressed, uint64_t bits) {
+  char name[64];
+  char const* kind = compressed ? "compressed" : "dense";
+  bitmask_t* b = compressed ? bitmask_new_compressed() : bitmask_new();
+  uint64_t start = bench_now_ns();
+  bitmask_range_op(b, 0, bits, BITMASK_SET);
+  sprintf(name, "%s range_op set", kind);
+  bench_report(name, bench_now_ns() - start, 1);
+
+  // spent addresses are long runs with a few unspent holes, the only clear bits in the first run are at both ends
+  bitmask_op(b, 0, BITMASK_CLEAR);
+  bitmask_op(b, bits - 1, BITMASK_CLEAR);
+  for (uint64_t i = bits / 2; i < bits - 1; i += HOLE_GAP) {
+    bitmask_op(b, i, BITMASK_CLEAR);
+  }
+
+  uint64_t found = 0;
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    found += bitmask_find_next_clear(b, 1);
+  }
+  sprintf(name, "%s find_next_clear", kind);
+  bench_report(name, bench_now_ns() - start, ROUNDS);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    found += bitmask_find_prev_clear(b, bits / 2 - 1);
+  }
+  sprintf(name, "%s find_prev_clear", kind);
+  bench_report(name, bench_now_ns() - start, ROUNDS);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    found += bitmask_popcount(b);
+  }
+  sprintf(name, "%s popcount", kind);
+  bench_report(name, bench_now_ns() - start, ROUNDS);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    bitmask_t* n = bitmask_clone(b);
+    found += n->cap;
+    bitmask_free(n);
+  }
+  sprintf(name, "%s clone", kind);
+  bench_report(name, bench_now_ns() - start, ROUNDS);
+
+  // the same search a bit at a time
+  start = bench_now_ns();
+  for (int i = 0; i < SCAN_ROUNDS; i++) {
+    uint64_t j = 1;
+    while (bitmask_get(b, j)) {
+      j++;
+    }
+    found += j;
+  }
+  sprintf(name, "%s get scan", kind);
+  bench_report(name, bench_now_ns() - start, SCAN_ROUNDS);
+
+  byte_buf_t* buf = byte_buf_new();
+  start = bench_now_ns();
+  bitmask_serialize(b, buf);
+  sprintf(name, "%s serialize", kind);
+  bench_report(name, bench_now_ns() - start, 1);
+
+  printf("%s: %zu bytes in memory, %zu bytes serialized\n", kind, bitmask_memory(b), buf->len);
+  byte_buf_free(buf);
+  bitmask_free(b);
+  return found;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t bits = 10000000;
+  if (argc > 1) {
+    bits = strtoull(argv[1], NULL, 10);
+  }
+
+  uint64_t found = bench_mask(false, bits);
+  found += bench_mask(true, bits);
+
+  printf("%" PRIu64 " bits, checksum %" PRIu64 "\n", bits, found);
+  return 0;
+}
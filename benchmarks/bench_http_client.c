@@ -0,0 +1,158 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "bench_utils.h"
+#include "client/client_stats.h"
+#include "client/network/http.h"
+#include "client/network/http_socket.h"
+
+// a node answering every request with the same body, one connection at a time
+typedef struct {
+  int fd;
+  uint16_t port;
+  char* response;
+  size_t response_len;
+} bench_server_t;
+
+static void* server_fn(void* arg) {
+  bench_server_t* s = (bench_server_t*)arg;
+  int fd;
+  char buf[4096];
+  while ((fd = accept(s->fd, NULL, NULL)) >= 0) {
+    size_t len = 0;
+    ssize_t n;
+    while ((n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0)) > 0) {
+      len += n;
+      buf[len] = '\0';
+      char* end = strstr(buf, "\r\n\r\n");
+      if (end == NULL) {
+        continue;
+      }
+      // requests of the benchmark are GETs, they have no body
+      size_t head_len = end + 4 - buf;
+      memmove(buf, buf + head_len, len - head_len);
+      len -= head_len;
+      for (size_t sent = 0; sent < s->response_len; sent += n) {
+        if ((n = send(fd, s->response + sent, s->response_len - sent, MSG_NOSIGNAL)) <= 0) {
+          break;
+        }
+      }
+    }
+    close(fd);
+  }
+  return NULL;
+}
+
+static void server_start(bench_server_t* s, size_t body_len) {
+  s->response = malloc(body_len + 64);
+  int n = sprintf(s->response, "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n", body_len);
+  memset(s->response + n, 'a', body_len);
+  s->response_len = n + body_len;
+  s->fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t addr_len = sizeof(addr);
+  bind(s->fd, (struct sockaddr*)&addr, sizeof(addr));
+  listen(s->fd, 16);
+  getsockname(s->fd, (struct sockaddr*)&addr, &addr_len);
+  s->port = ntohs(addr.sin_port);
+}
+
+// the resident set in kB
+static long rss_kb() {
+  long kb = 0;
+  char line[128];
+  FILE* f = fopen("/proc/self/status", "r");
+  while (f && fgets(line, sizeof(line), f)) {
+    if (sscanf(line, "VmRSS: %ld", &kb) == 1) {
+      break;
+    }
+  }
+  if (f) {
+    fclose(f);
+  }
+  return kb;
+}
+
+static int cmp_u64(void const* a, void const* b) {
+  uint64_t x = *(uint64_t const*)a, y = *(uint64_t const*)b;
+  return x < y ? -1 : x > y;
+}
+
+static void run(char const* name, http_client_config_t const* conf, size_t requests, uint64_t* lat) {
+  byte_buf_t* response = byte_buf_new();
+  size_t failed = 0;
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < requests; i++) {
+    uint64_t t = bench_now_ns();
+    response->len = 0;
+    failed += http_client_get(conf, response) != 0;
+    lat[i] = bench_now_ns() - t;
+  }
+  bench_report(name, bench_now_ns() - start, requests);
+  qsort(lat, requests, sizeof(uint64_t), cmp_u64);
+  printf("%-40s p50 %8.1f us p99 %8.1f us, %zu failed\n", "", lat[requests / 2] / 1e3, lat[requests * 99 / 100] / 1e3,
+         failed);
+  byte_buf_free(response);
+}
+
+int main(int argc, char* argv[]) {
+  char const* backend = argc > 1 ? argv[1] : "default";
+  size_t requests = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000;
+  size_t body_len = argc > 3 ? strtoul(argv[3], NULL, 10) : 1024;
+  if (requests == 0 || (strcmp(backend, "default") != 0 && strcmp(backend, "socket") != 0)) {
+    printf("usage: %s [default|socket] [requests] [body_bytes]\n", argv[0]);
+    return -1;
+  }
+
+  bench_server_t server;
+  server_start(&server, body_len);
+  pthread_t tid;
+  pthread_create(&tid, NULL, server_fn, &server);
+  long rss_start = rss_kb();
+
+  http_client_init();
+  http_transport_t* socket_t = NULL;
+  http_transport_t const* t = http_default_transport();
+  if (strcmp(backend, "socket") == 0) {
+    t = socket_t = http_socket_new(NULL);
+  }
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u/info", server.port);
+  http_client_config_t conf = {.url = url, .transport = t};
+  printf("transport = %s, requests = %zu, body = %zu bytes\n", t->name, requests, body_len);
+
+  uint64_t* lat = malloc(sizeof(uint64_t) * requests);
+  run("keep-alive", &conf, requests, lat);
+
+  // every request opens a connection, curl keeps connections in its share even if pool handles expire
+  if (socket_t) {
+    http_socket_conf_t sock_conf;
+    http_socket_conf_default(&sock_conf);
+    sock_conf.pool_size = 0;
+    http_socket_set_conf(socket_t, &sock_conf);
+    run("new connection", &conf, requests, lat);
+  }
+
+  // where the time of the requests went
+  client_stats_print();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("rss %ld kB -> %ld kB, max rss %ld kB\n", rss_start, rss_kb(), usage.ru_maxrss);
+
+  free(lat);
+  http_socket_free(socket_t);
+  http_client_clean();
+  shutdown(server.fd, SHUT_RDWR);
+  close(server.fd);
+  pthread_join(tid, NULL);
+  free(server.response);
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_utils.h"
+#include "client/api/get_unspent_outputs.h"
+#include "client/ledger_sim.h"
+#include "wallet/wallet.h"
+
+// the simulated node is reached through its transport, the host name is never resolved
+#define BENCH_ENDPOINT "http://ledger.sim/"
+#define ROUNDS 5
+#define PAYMENTS 50
+
+int main(int argc, char* argv[]) {
+  uint64_t max_addr = 1000;
+  uint32_t latency_ms = 0;
+  if (argc > 1) {
+    max_addr = strtoull(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    latency_ms = (uint32_t)strtoul(argv[2], NULL, 10);
+  }
+
+  ledger_sim_conf_t conf;
+  ledger_sim_conf_default(&conf);
+  conf.latency_ms = latency_ms;
+  byte_t seed[TANGLE_SEED_BYTES] = {};
+  random_seed(seed);
+  printf("latency = %" PRIu32 " ms\n", latency_ms);
+
+  for (uint64_t last_addr = 10; last_addr <= max_addr; last_addr *= 10) {
+    printf("last_addr = %" PRIu64 "\n", last_addr);
+    ledger_sim_t* sim = ledger_sim_new(&conf);
+    byte_t addr[TANGLE_ADDRESS_BYTES];
+    for (uint64_t i = 0; i <= last_addr; i++) {
+      address_get(seed, i, ADDRESS_VER_ED25519, addr);
+      ledger_sim_fund(sim, addr, 1000);
+    }
+
+    tangle_client_conf_t endpoint = {.url = BENCH_ENDPOINT, .transport = ledger_sim_transport(sim)};
+    wallet_t* w = wallet_open(BENCH_ENDPOINT, 0, seed, last_addr, 0, last_addr);
+    wallet_set_transport(w, ledger_sim_transport(sim));
+    addr_list_t* addrs = wallet_addresses(w);
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+      unspent_outputs_t* unspent = unspent_outputs_init();
+      get_unspent_outputs(&endpoint, addrs, &unspent);
+      unspent_outputs_free(&unspent);
+    }
+    bench_report("get_unspent_outputs", bench_now_ns() - start, ROUNDS);
+
+    start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+      wallet_refresh(w, true);
+    }
+    bench_report("wallet_refresh (sharded)", bench_now_ns() - start, ROUNDS);
+
+    // each payment refreshes, signs, and submits
+    send_funds_op_t op = {.amount = 10};
+    address_get(seed, last_addr + 1000, ADDRESS_VER_ED25519, op.receiver);
+    start = bench_now_ns();
+    int sent = 0;
+    for (int i = 0; i < PAYMENTS; i++) {
+      memset(op.remainder, 0, sizeof(op.remainder));
+      sent += wallet_send_funds(w, &op) == 0;
+    }
+    bench_report("wallet_send_funds", bench_now_ns() - start, PAYMENTS);
+
+    ledger_sim_stats_t stats;
+    ledger_sim_stats(sim, &stats);
+    printf("sent %d, accepted %" PRIu64 ", rejected %" PRIu64 ", requests %" PRIu64 "\n", sent, stats.accepted,
+           stats.rejected, stats.requests);
+
+    addr_list_free(addrs);
+    wallet_free(w);
+    ledger_sim_free(sim);
+  }
+  return 0;
+}
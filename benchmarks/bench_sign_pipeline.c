@@ -0,0 +1,97 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_utils.h"
+#include "wallet/unsigned_tx.h"
+
+#define TXS 256
+#define SIGNERS 4
+#define MAX_THREADS 8
+
+static byte_t g_seed[TANGLE_SEED_BYTES];
+static byte_buf_t* g_unsigned[TXS];
+
+typedef struct {
+  size_t first;
+  size_t last;
+  uint64_t signed_txs;
+} sign_worker_t;
+
+// builds a serialized unsigned transaction, as it's handed over by the building stage.
+static byte_buf_t* build_unsigned(uint32_t ticket) {
+  wallet_utx_t* utx = utx_new();
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  utx->ticket = ticket;
+  for (uint64_t i = 0; i < SIGNERS; i++) {
+    address_get(g_seed, ticket * SIGNERS + i, ADDRESS_VER_ED25519, addr);
+    utx_add_signer(utx, addr, ticket * SIGNERS + i);
+    memcpy(output_id, addr, TANGLE_ADDRESS_BYTES);
+    tx_id_random(output_id + TANGLE_ADDRESS_BYTES);
+    tx_inputs_push(utx->tx.inputs, output_id);
+  }
+  tx_output_t out = {};
+  out.balances = balance_list_new();
+  balance_t bal = {};
+  bal.value = 1000;
+  balance_list_push(out.balances, &bal);
+  tx_outputs_push(utx->tx.outputs, &out);
+  balance_list_free(out.balances);
+
+  byte_buf_t* buf = byte_buf_new();
+  utx_serialize(utx, buf);
+  utx_free(utx);
+  return buf;
+}
+
+// the signing stage: decodes, signs, and encodes transactions.
+static void* sign_worker(void* arg) {
+  sign_worker_t* ctx = (sign_worker_t*)arg;
+  for (size_t i = ctx->first; i < ctx->last; i++) {
+    wallet_utx_t* utx = utx_deserialize(g_unsigned[i]->data, g_unsigned[i]->len);
+    if (utx && utx_sign(utx, g_seed) == 0) {
+      byte_buf_t* out = byte_buf_new();
+      if (utx_serialize(utx, out) == 0) {
+        ctx->signed_txs++;
+      }
+      byte_buf_free(out);
+    }
+    utx_free(utx);
+  }
+  return NULL;
+}
+
+int main() {
+  char name[64];
+  randombytes_buf(g_seed, TANGLE_SEED_BYTES);
+  for (uint32_t i = 0; i < TXS; i++) {
+    g_unsigned[i] = build_unsigned(i);
+  }
+
+  for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+    pthread_t tid[MAX_THREADS];
+    sign_worker_t workers[MAX_THREADS] = {};
+    uint64_t start = bench_now_ns();
+    for (size_t t = 0; t < threads; t++) {
+      workers[t].first = TXS * t / threads;
+      workers[t].last = TXS * (t + 1) / threads;
+      pthread_create(&tid[t], NULL, sign_worker, &workers[t]);
+    }
+    uint64_t signed_txs = 0;
+    for (size_t t = 0; t < threads; t++) {
+      pthread_join(tid[t], NULL);
+      signed_txs += workers[t].signed_txs;
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    sprintf(name, "sign %d inputs, %zu threads", SIGNERS, threads);
+    bench_report(name, elapsed, signed_txs);
+    printf("%" PRIu64 " txs, %.0f txs/s\n", signed_txs, signed_txs / (elapsed / 1e9));
+  }
+
+  for (size_t i = 0; i < TXS; i++) {
+    byte_buf_free(g_unsigned[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef __BENCH_UTILS_H__
+#define __BENCH_UTILS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Gets a monotonic timestamp in nanoseconds
+ *
+ * @return uint64_t
+ */
+static inline uint64_t bench_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Prints out a benchmark result
+ *
+ * @param[in] name The name of the case
+ * @param[in] elapsed_ns The elapsed time in nanoseconds
+ * @param[in] rounds The number of rounds
+ */
+static inline void bench_report(char const* name, uint64_t elapsed_ns, uint64_t rounds) {
+  printf("%-40s %12.3f ms total %12.3f us/round\n", name, elapsed_ns / 1e6, (elapsed_ns / 1e3) / (rounds ? rounds : 1));
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_utils.h"
+#include "core/utxo_store.h"
+
+#define OUTPUTS_PER_ADDR 8
+#define COLOR_COUNT 16
+#define ROUNDS 10
+
+// builds an unspent output table with the given number of outputs.
+static unspent_outputs_t* build_table(size_t outputs, byte_t colors[][BALANCE_COLOR_BYTES]) {
+  unspent_outputs_t* t = unspent_outputs_init();
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  size_t n = 0;
+
+  for (uint64_t i = 0; n < outputs; i++) {
+    output_ids_t* ids = output_ids_init();
+    for (int j = 0; j < OUTPUTS_PER_ADDR && n < outputs; j++, n++) {
+      inclusion_state_t st = {.solid = true, .confirmed = (n % 10) != 0, .rejected = (n % 97) == 0};
+      balance_ht_t* bals = balance_ht_init();
+      balance_ht_add(&bals, colors[n % COLOR_COUNT], (int64_t)(n % 1000) + 1);
+      randombytes_buf((void* const)tx_id, TX_ID_BYTES);
+      output_ids_add(&ids, tx_id, bals, &st);
+      balance_ht_free(&bals);
+    }
+    memcpy(addr, &i, sizeof(i));
+    unspent_outputs_add(&t, addr, i, ids);
+    if (i % 5 == 0) {
+      unspent_outputs_set_spent(&t, addr, true);
+    }
+    output_ids_free(&ids);
+  }
+  return t;
+}
+
+int main(int argc, char* argv[]) {
+  size_t outputs = 1000000;
+  if (argc > 1) {
+    outputs = strtoull(argv[1], NULL, 10);
+  }
+
+  byte_t colors[COLOR_COUNT][BALANCE_COLOR_BYTES] = {};
+  for (int i = 1; i < COLOR_COUNT; i++) {
+    balance_color_random(colors[i]);
+  }
+
+  printf("building %zu outputs...\n", outputs);
+  unspent_outputs_t* t = build_table(outputs, colors);
+  utxo_store_t* s = utxo_store_new();
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    utxo_store_load(s, &t);
+  }
+  bench_report("utxo_store_load", bench_now_ns() - start, ROUNDS);
+
+  uint64_t expected = 0, got = 0;
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    expected = unspent_outputs_balance(&t);
+  }
+  bench_report("unspent_outputs_balance (hash table)", bench_now_ns() - start, ROUNDS);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    got = utxo_store_balance(s, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT);
+  }
+  bench_report("utxo_store_balance (columnar)", bench_now_ns() - start, ROUNDS);
+  if (expected != got) {
+    printf("balance mismatch %" PRIu64 " != %" PRIu64 "\n", expected, got);
+    return -1;
+  }
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    expected = unspent_outputs_balance_with_color(&t, colors[3]);
+  }
+  bench_report("unspent_outputs_balance_with_color", bench_now_ns() - start, ROUNDS);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    got = utxo_store_balance_with_color(s, colors[3], INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT);
+  }
+  bench_report("utxo_store_balance_with_color", bench_now_ns() - start, ROUNDS);
+  if (expected != got) {
+    printf("color balance mismatch %" PRIu64 " != %" PRIu64 "\n", expected, got);
+    return -1;
+  }
+
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    got = utxo_store_spendable(s, colors[3]);
+  }
+  bench_report("utxo_store_spendable", bench_now_ns() - start, ROUNDS);
+
+  uint64_t sums[COLOR_COUNT] = {};
+  start = bench_now_ns();
+  for (int i = 0; i < ROUNDS; i++) {
+    utxo_store_balance_by_color(s, UTXO_SPENDABLE_REQUIRED, UTXO_SPENDABLE_FORBIDDEN, sums);
+  }
+  bench_report("utxo_store_balance_by_color", bench_now_ns() - start, ROUNDS);
+
+  utxo_store_free(s);
+  unspent_outputs_free(&t);
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench_utils.h"
+#include "wallet/wallet.h"
+
+// a closed local port, the initial refresh fails fast without leaving the host.
+#define BENCH_ENDPOINT "http://127.0.0.1:1/"
+#define ROUNDS 3
+
+// the previous startup path, addresses are derived for the table and again for the refresh request.
+static void derive_twice(byte_t const seed[], uint64_t last_addr) {
+  unspent_outputs_t* t = unspent_outputs_init();
+  address_t tmp_addr = {};
+  for (uint64_t i = 0; i <= last_addr; i++) {
+    address_get(seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
+    unspent_outputs_add(&t, tmp_addr.addr, i, NULL);
+  }
+  wallet_am_t* am = am_new(seed, last_addr, NULL);
+  addr_list_t* addrs = am_addresses(am);
+  addr_list_free(addrs);
+  am_free(am);
+  unspent_outputs_free(&t);
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t max_addr = 10000;
+  if (argc > 1) {
+    max_addr = strtoull(argv[1], NULL, 10);
+  }
+
+  byte_t seed[TANGLE_SEED_BYTES] = {};
+  random_seed(seed);
+
+  for (uint64_t last_addr = 10; last_addr <= max_addr; last_addr *= 10) {
+    printf("last_addr = %" PRIu64 "\n", last_addr);
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+      derive_twice(seed, last_addr);
+    }
+    bench_report("derive twice (sequential)", bench_now_ns() - start, ROUNDS);
+
+    address_t* addrs = malloc(sizeof(address_t) * (last_addr + 1));
+    wallet_am_t* am = am_new(seed, last_addr, NULL);
+    start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+      am_derive_addresses(am, 0, last_addr + 1, addrs);
+    }
+    bench_report("am_derive_addresses", bench_now_ns() - start, ROUNDS);
+    am_free(am);
+    free(addrs);
+
+    start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+      wallet_free(wallet_init(BENCH_ENDPOINT, 0, seed, last_addr, 0, last_addr));
+    }
+    bench_report("wallet_init", bench_now_ns() - start, ROUNDS);
+  }
+  return 0;
+}
@@ -3,31 +3,20 @@
 
 #include "client/api/get_funds.h"
 #include "client/api/json_utils.h"
+#include "client/api/json_writer.h"
 #include "client/network/http.h"
 #include "utils/iota_str.h"
 
 // 0 on success
 static int request_builder(byte_t const addr[], byte_buf_t *req) {
-  int ret = 0;
-  char addr_str[TANGLE_ADDRESS_BASE58_BUF];
-
-  cJSON *json_root = cJSON_CreateObject();
-  if (json_root == NULL) {
-    return -1;
-  }
-  address_2_base58(addr, addr_str);
-
-  cJSON_AddItemToObject(json_root, "address", cJSON_CreateString(addr_str));
-  char const *json_text = cJSON_PrintUnformatted(json_root);
-  if (json_text == NULL) {
-    ret = -1;
-  } else {
-    byte_buf_append(req, (byte_t *)json_text, strlen(json_text));
-    byte_buf2str(req);
-  }
-  cJSON_Delete(json_root);
-
-  return ret;
+  json_writer_t w;
+  // {"address":"..."}
+  json_writer_init(&w, req, 16 + JSON_WRITER_ADDRESS_SIZE);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "address");
+  json_writer_address(&w, addr);
+  json_writer_object_end(&w);
+  return json_writer_end(&w);
 }
 
 int get_funds(tangle_client_conf_t const *conf, byte_t const addr[], res_get_funds_t *res) {
@@ -54,6 +43,8 @@ int get_funds(tangle_client_conf_t const *conf, byte_t const addr[], res_get_fun
   if (conf->port) {
     http_conf.port = conf->port;
   }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
 
   http_req = byte_buf_new();
   http_res = byte_buf_new();
@@ -83,7 +74,7 @@ int get_funds(tangle_client_conf_t const *conf, byte_t const addr[], res_get_fun
   // printf("res: %s\n", http_res->data);
 
   // json deserialization
-  deser_get_funds((char const *const)http_res->data, res);
+  ret = deser_get_funds((char const *const)http_res->data, res);
 
 done:
   // cleanup command
@@ -94,6 +85,71 @@ done:
   return ret;
 }
 
+typedef struct {
+  get_funds_cb cb;
+  void *ctx;
+} get_funds_async_t;
+
+static void get_funds_done(int ret, byte_buf_t *http_res, void *ctx) {
+  get_funds_async_t *req = (get_funds_async_t *)ctx;
+  res_get_funds_t res = {};
+  if (ret == 0) {
+    byte_buf2str(http_res);
+    ret = deser_get_funds((char const *const)http_res->data, &res);
+  }
+  req->cb(ret, &res, req->ctx);
+  free(req);
+}
+
+int get_funds_async(http_loop_t *loop, tangle_client_conf_t const *conf, byte_t const addr[], get_funds_cb cb,
+                    void *ctx) {
+  int ret = 0;
+  char const *const cmd_faucet = "faucet";
+  iota_str_t *cmd = iota_str_new(conf->url);
+  byte_buf_t *http_req = byte_buf_new();
+  get_funds_async_t *req = malloc(sizeof(get_funds_async_t));
+  if (cmd == NULL || http_req == NULL || req == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  if (iota_str_append(cmd, cmd_faucet)) {
+    printf("[%s:%d]: string append failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  http_client_config_t http_conf = {0};
+  http_conf.url = cmd->buf;
+  if (conf->port) {
+    http_conf.port = conf->port;
+  }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
+
+  if (request_builder(addr, http_req) != 0) {
+    printf("[%s:%d]: build request failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  req->cb = cb;
+  req->ctx = ctx;
+  if (http_loop_post(loop, &http_conf, http_req, get_funds_done, req) == NULL) {
+    printf("[%s:%d]: http client post failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  req = NULL;
+
+done:
+  iota_str_destroy(cmd);
+  byte_buf_free(http_req);
+  free(req);
+  return ret;
+}
+
 int deser_get_funds(char const *const j_str, res_get_funds_t *res) {
   char const *const key_id = "id";
   int ret = 0;
@@ -106,7 +162,9 @@ int deser_get_funds(char const *const j_str, res_get_funds_t *res) {
   if (res_err) {
     // got an error response
     printf("[%s:%d] Error response: %s\n", __func__, __LINE__, res_err->msg);
-    return -1;
+    res_err_free(res_err);
+    ret = -1;
+    goto end;
   }
 
   // gets ID
@@ -6,6 +6,7 @@
 
 #include "client/api/response_error.h"
 #include "client/client_service.h"
+#include "client/network/http_async.h"
 #include "core/address.h"
 
 #define TANGLE_MGS_ID_BYTES 64
@@ -15,6 +16,15 @@ typedef struct {
   char msg_id[TANGLE_MGS_ID_BASE58_BUF];
 } res_get_funds_t;
 
+/**
+ * @brief Completes a faucet request
+ *
+ * @param[in] ret 0 on success
+ * @param[in] res The response, valid during the callback
+ * @param[in] ctx The context given with the request
+ */
+typedef void (*get_funds_cb)(int ret, res_get_funds_t *res, void *ctx);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,6 +40,19 @@ extern "C" {
  */
 int get_funds(tangle_client_conf_t const *conf, byte_t const addr[], res_get_funds_t *res);
 
+/**
+ * @brief Starts a faucet request on a loop
+ *
+ * @param[in] loop A http loop
+ * @param[in] conf A client instance
+ * @param[in] addr A destination address
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return int 0 on success, the callback is not invoked on failure
+ */
+int get_funds_async(http_loop_t *loop, tangle_client_conf_t const *conf, byte_t const addr[], get_funds_cb cb,
+                    void *ctx);
+
 /**
  * @brief Response deserialization
  *
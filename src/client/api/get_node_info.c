@@ -27,6 +27,8 @@ int get_node_info(tangle_client_conf_t const *conf, res_node_info_t *res) {
   if (conf->port) {
     http_conf.port = conf->port;
   }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
 
   byte_buf_t *http_res = byte_buf_new();
   if (http_res == NULL) {
@@ -44,7 +46,7 @@ int get_node_info(tangle_client_conf_t const *conf, res_node_info_t *res) {
   }
   byte_buf2str(http_res);
   // json deserialization
-  deser_node_info((char const *const)http_res->data, res);
+  ret = deser_node_info((char const *const)http_res->data, res);
 
 done:
   // cleanup command
@@ -54,6 +56,62 @@ done:
   return ret;
 }
 
+typedef struct {
+  get_node_info_cb cb;
+  void *ctx;
+} node_info_async_t;
+
+static void node_info_done(int ret, byte_buf_t *http_res, void *ctx) {
+  node_info_async_t *req = (node_info_async_t *)ctx;
+  res_node_info_t res = {};
+  if (ret == 0) {
+    byte_buf2str(http_res);
+    ret = deser_node_info((char const *const)http_res->data, &res);
+  }
+  req->cb(ret, &res, req->ctx);
+  free(req);
+}
+
+int get_node_info_async(http_loop_t *loop, tangle_client_conf_t const *conf, get_node_info_cb cb, void *ctx) {
+  int ret = 0;
+  char const *const cmd_info = "info";
+  iota_str_t *cmd = iota_str_new(conf->url);
+  node_info_async_t *req = malloc(sizeof(node_info_async_t));
+  if (cmd == NULL || req == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  if (iota_str_append(cmd, cmd_info)) {
+    printf("[%s:%d]: string append failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  http_client_config_t http_conf = {0};
+  http_conf.url = cmd->buf;
+  if (conf->port) {
+    http_conf.port = conf->port;
+  }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
+
+  req->cb = cb;
+  req->ctx = ctx;
+  if (http_loop_get(loop, &http_conf, node_info_done, req) == NULL) {
+    printf("[%s:%d]: http get failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  req = NULL;
+
+done:
+  iota_str_destroy(cmd);
+  free(req);
+  return ret;
+}
+
 int deser_node_info(char const *const j_str, res_node_info_t *res) {
   char const *const key_version = "version";
   char const *const key_synced = "synced";
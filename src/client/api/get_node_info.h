@@ -6,6 +6,7 @@
 
 #include "client/api/response_error.h"
 #include "client/client_service.h"
+#include "client/network/http_async.h"
 
 typedef struct {
   char version[32];
@@ -13,6 +14,15 @@ typedef struct {
   bool is_synced;
 } res_node_info_t;
 
+/**
+ * @brief Completes an info request
+ *
+ * @param[in] ret 0 on success
+ * @param[in] res The node info, valid during the callback
+ * @param[in] ctx The context given with the request
+ */
+typedef void (*get_node_info_cb)(int ret, res_node_info_t *res, void *ctx);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -26,6 +36,17 @@ extern "C" {
  */
 int get_node_info(tangle_client_conf_t const *conf, res_node_info_t *res);
 
+/**
+ * @brief Starts an info request on a loop
+ *
+ * @param[in] loop A http loop
+ * @param[in] conf The client endpoint configuration
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return int 0 on success, the callback is not invoked on failure
+ */
+int get_node_info_async(http_loop_t *loop, tangle_client_conf_t const *conf, get_node_info_cb cb, void *ctx);
+
 /**
  * @brief node info JSON deserialization
  *
@@ -3,194 +3,281 @@
 #include <stdlib.h>
 
 #include "client/api/get_unspent_outputs.h"
+#include "client/api/json_stream.h"
 #include "client/api/json_utils.h"
+#include "client/api/json_writer.h"
 #include "client/api/response_error.h"
 #include "client/network/http.h"
 #include "utarray.h"
 #include "utils/iota_str.h"
 
-static int deser_output_ids(cJSON *j_ids, output_ids_t **ids) {
-  char const key_id[] = "id";
-  char const key_balances[] = "balances";
-  char const key_value[] = "value";
-  char const key_color[] = "color";
-  char const key_st[] = "inclusion_state";
-  char const key_solid[] = "solid";
-  char const key_confirm[] = "confirmed";
-  char const key_reject[] = "rejected";
-  char const key_like[] = "liked";
-  char const key_conflict[] = "conflicting";
-  char const key_finalize[] = "finalized";
-  char const key_prefer[] = "preferred";
-
-  char color_str[BALANCE_COLOR_BASE58_BUF] = {};
-  char output_id_str[TX_OUTPUT_ID_BASE58_BUF] = {};
-  byte_t output_id[TX_OUTPUT_ID_BYTES] = {};
-
-  int ret = -1;
-  cJSON *ids_elm = NULL;
-
-  cJSON_ArrayForEach(ids_elm, j_ids) {
-    inclusion_state_t st = {};
-    // get id from JSON
-    json_get_string(ids_elm, key_id, output_id_str, sizeof(output_id_str));
-    // printf("id: %s\n", output_id_str);
-    tx_output_id_from_base58(output_id_str, strlen(output_id_str), output_id);
-
-    // get inclusion state
-    cJSON *j_state = cJSON_GetObjectItemCaseSensitive(ids_elm, key_st);
-    if (j_state) {
-      json_get_boolean(j_state, key_reject, &st.solid);
-      json_get_boolean(j_state, key_confirm, &st.confirmed);
-      json_get_boolean(j_state, key_reject, &st.rejected);
-      json_get_boolean(j_state, key_like, &st.liked);
-      json_get_boolean(j_state, key_conflict, &st.conflicting);
-      json_get_boolean(j_state, key_finalize, &st.finalized);
-      json_get_boolean(j_state, key_prefer, &st.preferred);
-    }
+// the containers of an unspent outputs response
+typedef enum {
+  UD_OTHER = 0,  // skipped
+  UD_ROOT,       // {"unspent_outputs": [...]}
+  UD_UNSPENT,    // [{"address": "...", "output_ids": [...]}]
+  UD_ADDR,       // {"address": "...", "output_ids": [...]}
+  UD_IDS,        // [{"id": "...", "balances": [...], "inclusion_state": {...}}]
+  UD_OUTPUT,     // {"id": "...", "balances": [...], "inclusion_state": {...}}
+  UD_BALANCES,   // [{"value": 1, "color": "..."}]
+  UD_BALANCE,    // {"value": 1, "color": "..."}
+  UD_STATE,      // {"confirmed": true, ...}
+} ud_level_t;
+
+struct unspent_decoder_s {
+  json_stream_t stream;
+  unspent_outputs_t **unspent;
+  ud_level_t levels[JSON_STREAM_MAX_DEPTH];
+  size_t depth;
+  char key[32];  // the last key, truncated
+  bool found;    // the unspent_outputs array is found
+  bool error;    // got an error response
+  size_t count;  // decoded addresses
+  // the current record
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  bool has_addr;
+  output_ids_t *ids;
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  balance_ht_t *balances;
+  inclusion_state_t st;
+  balance_t bal;
+};
+
+static bool ud_key_is(unspent_decoder_t *dec, char const key[]) { return strcmp(dec->key, key) == 0; }
+
+static void ud_clear_output(unspent_decoder_t *dec) {
+  balance_ht_free(&dec->balances);
+  memset(dec->output_id, 0, sizeof(dec->output_id));
+  memset(&dec->st, 0, sizeof(dec->st));
+}
 
-    balance_ht_t *balances = balance_ht_init();
-    // get balances
-    cJSON *j_balances = cJSON_GetObjectItemCaseSensitive(ids_elm, key_balances);
-    if (j_balances) {
-      if (!cJSON_IsArray(j_balances)) {
-        printf("[%s:%d] invalid JSON format, %s is not an array\n", __func__, __LINE__, key_balances);
-        goto end;
-      }
-      cJSON *bal_elm = NULL;
-      cJSON_ArrayForEach(bal_elm, j_balances) {
-        balance_t bal = {};
-        json_get_int64(bal_elm, key_value, &bal.value);
-        json_get_string(bal_elm, key_color, color_str, BALANCE_COLOR_BASE58_BUF);
-        if (strncmp("IOTA", color_str, 4) != 0) {
-          balance_color_from_base58(color_str, bal.color);
-        }
-        balance_ht_add(&balances, bal.color, bal.value);
-      }
-    }
-    output_ids_add(ids, output_id + TANGLE_ADDRESS_BYTES, balances, &st);
-    // clean up
-    balance_ht_free(&balances);
+static void ud_clear_record(unspent_decoder_t *dec) {
+  ud_clear_output(dec);
+  output_ids_free(&dec->ids);
+  dec->has_addr = false;
+}
+
+static int ud_on_begin(void *ctx, bool is_array) {
+  unspent_decoder_t *dec = (unspent_decoder_t *)ctx;
+  ud_level_t parent = dec->depth ? dec->levels[dec->depth - 1] : UD_OTHER;
+  ud_level_t level = UD_OTHER;
+  if (dec->depth == 0) {
+    level = is_array ? UD_OTHER : UD_ROOT;
+  } else if (parent == UD_ROOT && is_array && ud_key_is(dec, "unspent_outputs")) {
+    level = UD_UNSPENT;
+    dec->found = true;
+  } else if (parent == UD_UNSPENT && !is_array) {
+    level = UD_ADDR;
+    ud_clear_record(dec);
+  } else if (parent == UD_ADDR && is_array && ud_key_is(dec, "output_ids")) {
+    level = UD_IDS;
+  } else if (parent == UD_IDS && !is_array) {
+    level = UD_OUTPUT;
+    ud_clear_output(dec);
+  } else if (parent == UD_OUTPUT && is_array && ud_key_is(dec, "balances")) {
+    level = UD_BALANCES;
+  } else if (parent == UD_OUTPUT && !is_array && ud_key_is(dec, "inclusion_state")) {
+    level = UD_STATE;
+  } else if (parent == UD_BALANCES && !is_array) {
+    level = UD_BALANCE;
+    memset(&dec->bal, 0, sizeof(dec->bal));
   }
-  ret = 0;
-end:
-  return ret;
+  // the parser limits the depth
+  dec->levels[dec->depth++] = level;
+  dec->key[0] = '\0';
+  return 0;
 }
 
-// 0 on success
-static int request_builder(addr_list_t *addresses, byte_buf_t *req) {
+static int ud_on_end(void *ctx, bool is_array) {
+  unspent_decoder_t *dec = (unspent_decoder_t *)ctx;
   int ret = 0;
-  cJSON *json_root = cJSON_CreateObject();
-  if (json_root == NULL) {
-    printf("[%s:%d] OOM\n", __func__, __LINE__);
-    return -1;
+  switch (dec->levels[--dec->depth]) {
+    case UD_BALANCE:
+      ret = balance_ht_add(&dec->balances, dec->bal.color, dec->bal.value);
+      break;
+    case UD_OUTPUT:
+      ret = output_ids_add(&dec->ids, dec->output_id + TANGLE_ADDRESS_BYTES, dec->balances, &dec->st);
+      ud_clear_output(dec);
+      break;
+    case UD_ADDR:
+      if (dec->has_addr) {
+        // set the index to 0 and update it later
+        ret = unspent_outputs_add(dec->unspent, dec->addr, 0, dec->ids);
+        dec->count++;
+      }
+      ud_clear_record(dec);
+      break;
+    default:
+      break;
   }
+  return ret;
+}
 
-  cJSON *j_addrs = cJSON_CreateArray();
-  if (j_addrs == NULL) {
-    ret = -1;
-    printf("[%s:%d] OOM\n", __func__, __LINE__);
-    goto end;
+static int ud_on_key(void *ctx, char const key[], size_t len) {
+  unspent_decoder_t *dec = (unspent_decoder_t *)ctx;
+  // keys we are looking for are short, a longer key never matches
+  if (len >= sizeof(dec->key)) {
+    len = sizeof(dec->key) - 1;
   }
+  memcpy(dec->key, key, len);
+  dec->key[len] = '\0';
+  return 0;
+}
 
-  address_t *addr = NULL;
-  char base58_addr[TANGLE_ADDRESS_BASE58_BUF];
-  ADDR_LIST_FOREACH(addresses, addr) {
-    address_2_base58(addr->addr, base58_addr);
-    cJSON_AddItemToArray(j_addrs, cJSON_CreateString(base58_addr));
-  }
+// a needed value was longer than the parser keeps.
+static int ud_too_long(unspent_decoder_t *dec) {
+  printf("[%s:%d] value of %s is too long\n", __func__, __LINE__, dec->key);
+  return -1;
+}
 
-  cJSON_AddItemToObject(json_root, "addresses", j_addrs);
-  char *json_text = cJSON_PrintUnformatted(json_root);
-  if (json_text == NULL) {
-    ret = -1;
-  } else {
-    byte_buf_append(req, (byte_t *)json_text, strlen(json_text));
-    byte_buf2str(req);
-    free(json_text);
+static int ud_on_value(void *ctx, json_stream_value_t kind, char const str[], size_t len) {
+  unspent_decoder_t *dec = (unspent_decoder_t *)ctx;
+  bool flag = kind == JSON_STREAM_TRUE;
+  // long values come without a string, they are skipped unless they are needed
+  switch (dec->depth ? dec->levels[dec->depth - 1] : UD_OTHER) {
+    case UD_ROOT:
+      if (kind == JSON_STREAM_STRING && ud_key_is(dec, "error")) {
+        // got an error response
+        printf("[%s:%d] Error response: %s\n", __func__, __LINE__, str ? str : "(too long)");
+        dec->error = true;
+      }
+      break;
+    case UD_ADDR:
+      if (kind == JSON_STREAM_STRING && ud_key_is(dec, "address")) {
+        if (str == NULL) {
+          return ud_too_long(dec);
+        }
+        dec->has_addr = address_from_base58(str, dec->addr);
+      }
+      break;
+    case UD_OUTPUT:
+      if (kind == JSON_STREAM_STRING && ud_key_is(dec, "id")) {
+        if (str == NULL) {
+          return ud_too_long(dec);
+        }
+        tx_output_id_from_base58((char *)str, len, dec->output_id);
+      }
+      break;
+    case UD_BALANCE:
+      if (kind == JSON_STREAM_NUMBER && ud_key_is(dec, "value")) {
+        if (str == NULL) {
+          return ud_too_long(dec);
+        }
+        dec->bal.value = strtoll(str, NULL, 10);
+      } else if (kind == JSON_STREAM_STRING && ud_key_is(dec, "color")) {
+        if (str == NULL) {
+          return ud_too_long(dec);
+        }
+        if (strncmp("IOTA", str, 4) != 0) {
+          balance_color_from_base58((char *)str, dec->bal.color);
+        }
+      }
+      break;
+    case UD_STATE:
+      if (ud_key_is(dec, "solid")) {
+        dec->st.solid = flag;
+      } else if (ud_key_is(dec, "confirmed")) {
+        dec->st.confirmed = flag;
+      } else if (ud_key_is(dec, "rejected")) {
+        dec->st.rejected = flag;
+      } else if (ud_key_is(dec, "liked")) {
+        dec->st.liked = flag;
+      } else if (ud_key_is(dec, "conflicting")) {
+        dec->st.conflicting = flag;
+      } else if (ud_key_is(dec, "finalized")) {
+        dec->st.finalized = flag;
+      } else if (ud_key_is(dec, "preferred")) {
+        dec->st.preferred = flag;
+      }
+      break;
+    default:
+      break;
   }
+  return 0;
+}
 
-end:
-  cJSON_Delete(json_root);
-  return ret;
+static json_stream_cb_t const ud_callbacks = {
+    .on_begin = ud_on_begin, .on_end = ud_on_end, .on_key = ud_on_key, .on_value = ud_on_value};
+
+unspent_decoder_t *unspent_decoder_new(unspent_outputs_t **unspent) {
+  unspent_decoder_t *dec = malloc(sizeof(unspent_decoder_t));
+  if (dec == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(dec, 0, sizeof(unspent_decoder_t));
+  dec->unspent = unspent;
+  dec->ids = output_ids_init();
+  dec->balances = balance_ht_init();
+  json_stream_init(&dec->stream, &ud_callbacks, dec);
+  return dec;
 }
 
-int deser_unspent_outputs(char const *const j_str, unspent_outputs_t **unspent) {
-  char const key_unspent[] = "unspent_outputs";
-  char const key_addr[] = "address";
-  char const key_out_ids[] = "output_ids";
+int unspent_decoder_feed(unspent_decoder_t *dec, byte_t const data[], size_t len) {
+  return json_stream_feed(&dec->stream, data, len);
+}
 
-  int ret = -1;
-  cJSON *json_obj = cJSON_Parse(j_str);
-  if (json_obj == NULL) {
+int unspent_decoder_finish(unspent_decoder_t *dec) {
+  if (json_stream_end(&dec->stream) != 0) {
     printf("[%s:%d] invalid JSON object\n", __func__, __LINE__);
     return -1;
   }
-
-  res_err_t *res_err = deser_error(json_obj);
-  if (res_err) {
-    // got an error response
-    printf("[%s:%d] Error response: %s\n", __func__, __LINE__, res_err->msg);
-    ret = 0;
-    goto end;
+  if (dec->error) {
+    return 0;
   }
-
-  cJSON *j_unspent = cJSON_GetObjectItemCaseSensitive(json_obj, key_unspent);
-  if (j_unspent == NULL) {
-    printf("[%s:%d] invalid JSON format, %s not found in\n%s\n", __func__, __LINE__, key_unspent, j_str);
-    goto end;
+  if (!dec->found) {
+    printf("[%s:%d] invalid JSON format, unspent_outputs not found\n", __func__, __LINE__);
+    return -1;
   }
-
-  if (!cJSON_IsArray(j_unspent)) {
-    printf("[%s:%d] invalid JSON format, %s is not an array\n", __func__, __LINE__, key_unspent);
-    goto end;
+  if (dec->count == 0) {
+    printf("[%s:%d] invalid JSON format, unspent_outputs is empty\n", __func__, __LINE__);
+    return -1;
   }
+  return 0;
+}
 
-  if (cJSON_GetArraySize(j_unspent) == 0) {
-    printf("[%s:%d] invalid JSON format, %s is empty, %s\n", __func__, __LINE__, key_unspent, j_str);
-    goto end;
+void unspent_decoder_free(unspent_decoder_t *dec) {
+  if (dec) {
+    ud_clear_record(dec);
+    free(dec);
   }
+}
 
-  char addr_str[TANGLE_ADDRESS_BASE58_BUF] = {};
-  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
-
-  cJSON *unspent_elm = NULL;
-  cJSON_ArrayForEach(unspent_elm, j_unspent) {
-    // get address hash
-    json_get_string(unspent_elm, key_addr, addr_str, sizeof(addr_str));
-    // printf("addr: %s\n", addr_str);
-    address_from_base58(addr_str, addr);
-
-    // get output id objects
-    output_ids_t *ids = output_ids_init();
-    cJSON *j_ids = cJSON_GetObjectItemCaseSensitive(unspent_elm, key_out_ids);
-    if (j_ids) {
-      if (!cJSON_IsArray(j_ids)) {
-        printf("[%s:%d] invalid JSON format, %s is not an array\n", __func__, __LINE__, key_out_ids);
-        goto end;
-      }
-
-      ret = deser_output_ids(j_ids, &ids);
-      if (ret != 0) {
-        printf("[%s:%d] parsing output IDs failed\n", __func__, __LINE__);
-        if (ids != NULL) {
-          output_ids_free(&ids);
-        }
-        goto end;
-      }
-    }
+// adapts the decoder to a http write function
+static int ud_write(byte_t const data[], size_t len, void *ctx) {
+  return unspent_decoder_feed((unspent_decoder_t *)ctx, data, len);
+}
 
-    // set the index to 0 and update it later
-    unspent_outputs_add(unspent, addr, 0, ids);
-    // clean up
-    if (ids != NULL) {
-      output_ids_free(&ids);
-    }
+// builds a request of addresses in [first, first + count), 0 on success
+static int request_builder(addr_list_t *addresses, size_t first, size_t count, byte_buf_t *req) {
+  json_writer_t w;
+  // {"addresses":[...]}
+  json_writer_init(&w, req, 16 + count * JSON_WRITER_ADDRESS_SIZE);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "addresses");
+  json_writer_array_begin(&w);
+  for (size_t i = first; i < first + count; i++) {
+    json_writer_address(&w, addr_list_at(addresses, i)->addr);
   }
-  ret = 0;
+  json_writer_array_end(&w);
+  json_writer_object_end(&w);
+  if (json_writer_end(&w) != 0) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  return 0;
+}
 
-end:
-  cJSON_Delete(json_obj);
+int deser_unspent_outputs(char const *const j_str, unspent_outputs_t **unspent) {
+  unspent_decoder_t *dec = unspent_decoder_new(unspent);
+  if (dec == NULL) {
+    return -1;
+  }
+  int ret = unspent_decoder_feed(dec, (byte_t const *)j_str, strlen(j_str));
+  if (ret == 0) {
+    ret = unspent_decoder_finish(dec);
+  }
+  unspent_decoder_free(dec);
   return ret;
 }
 
@@ -198,7 +285,7 @@ int get_unspent_outputs(tangle_client_conf_t const *conf, addr_list_t *addrs, un
   int ret = 0;
   char const *cmd_unspent_outputs = "value/unspentOutputs";
   byte_buf_t *http_req = NULL;
-  byte_buf_t *http_res = NULL;
+  unspent_decoder_t *dec = NULL;
   // compose restful api command
   iota_str_t *cmd = iota_str_new(conf->url);
   if (cmd == NULL) {
@@ -218,17 +305,19 @@ int get_unspent_outputs(tangle_client_conf_t const *conf, addr_list_t *addrs, un
   if (conf->port) {
     http_conf.port = conf->port;
   }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
 
   http_req = byte_buf_new();
-  http_res = byte_buf_new();
-  if (http_res == NULL || http_req == NULL) {
+  dec = unspent_decoder_new(unspent);
+  if (dec == NULL || http_req == NULL) {
     printf("[%s:%d]: OOM\n", __func__, __LINE__);
     ret = -1;
     goto done;
   }
 
   // build request
-  if (request_builder(addrs, http_req) != 0) {
+  if (request_builder(addrs, 0, addr_list_len(addrs), http_req) != 0) {
     printf("[%s:%d]: build request failed\n", __func__, __LINE__);
     ret = -1;
     goto done;
@@ -236,23 +325,240 @@ int get_unspent_outputs(tangle_client_conf_t const *conf, addr_list_t *addrs, un
 
   // printf("req: %s\n", http_req->data);
 
-  // send request via http client
-  if (http_client_post(&http_conf, http_req, http_res) != 0) {
+  // the response is decoded as it arrives
+  if (http_client_post_stream(&http_conf, http_req, ud_write, dec) != 0) {
     printf("[%s:%d]: http client post failed\n", __func__, __LINE__);
     ret = -1;
     goto done;
   }
-  byte_buf2str(http_res);
+  ret = unspent_decoder_finish(dec);
+
+done:
+  // cleanup command
+  iota_str_destroy(cmd);
+  unspent_decoder_free(dec);
+  byte_buf_free(http_req);
+  return ret;
+}
 
-  // printf("[%s:%d] res: %s\n", __func__, __LINE__, http_res->data);
+typedef struct {
+  get_unspent_outputs_cb cb;
+  void *ctx;
+  unspent_outputs_t *unspent;
+  unspent_decoder_t *dec;
+} unspent_outputs_async_t;
 
-  // json deserialization
-  ret = deser_unspent_outputs((char const *const)http_res->data, unspent);
+static int unspent_outputs_write(byte_t const data[], size_t len, void *ctx) {
+  return unspent_decoder_feed(((unspent_outputs_async_t *)ctx)->dec, data, len);
+}
+
+static void unspent_outputs_done(int ret, byte_buf_t *http_res, void *ctx) {
+  unspent_outputs_async_t *req = (unspent_outputs_async_t *)ctx;
+  if (ret == 0) {
+    ret = unspent_decoder_finish(req->dec);
+  }
+  unspent_decoder_free(req->dec);
+  req->cb(ret, req->unspent, req->ctx);
+  free(req);
+}
+
+int get_unspent_outputs_async(http_loop_t *loop, tangle_client_conf_t const *conf, addr_list_t *addrs,
+                              get_unspent_outputs_cb cb, void *ctx) {
+  int ret = 0;
+  char const *cmd_unspent_outputs = "value/unspentOutputs";
+  iota_str_t *cmd = iota_str_new(conf->url);
+  byte_buf_t *http_req = byte_buf_new();
+  unspent_outputs_async_t *req = malloc(sizeof(unspent_outputs_async_t));
+  if (req) {
+    req->unspent = unspent_outputs_init();
+    req->dec = unspent_decoder_new(&req->unspent);
+  }
+  if (cmd == NULL || http_req == NULL || req == NULL || req->dec == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  if (iota_str_append(cmd, cmd_unspent_outputs)) {
+    printf("[%s:%d]: string append failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  http_client_config_t http_conf = {0};
+  http_conf.url = cmd->buf;
+  if (conf->port) {
+    http_conf.port = conf->port;
+  }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
+
+  if (request_builder(addrs, 0, addr_list_len(addrs), http_req) != 0) {
+    printf("[%s:%d]: build request failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  req->cb = cb;
+  req->ctx = ctx;
+  if (http_loop_post_stream(loop, &http_conf, http_req, unspent_outputs_write, unspent_outputs_done, req) == NULL) {
+    printf("[%s:%d]: http client post failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  req = NULL;
 
 done:
-  // cleanup command
   iota_str_destroy(cmd);
-  byte_buf_free(http_res);
   byte_buf_free(http_req);
+  if (req) {
+    unspent_decoder_free(req->dec);
+    free(req);
+  }
   return ret;
 }
+
+// the state of a sharded request
+typedef struct {
+  http_loop_t *loop;
+  http_client_config_t http_conf;
+  addr_list_t *addrs;
+  size_t next;        // the first address of the next chunk
+  size_t chunk_size;  // addresses per request
+  unspent_outputs_t **unspent;
+  int ret;
+} unspent_shards_t;
+
+// a chunk in flight
+typedef struct {
+  unspent_shards_t *shards;
+  size_t first;
+  size_t count;
+  unspent_decoder_t *dec;  // decodes into the merged table
+} unspent_chunk_t;
+
+static int shard_write(byte_t const data[], size_t len, void *ctx) {
+  return unspent_decoder_feed(((unspent_chunk_t *)ctx)->dec, data, len);
+}
+
+static int shard_send_next(unspent_shards_t *shards);
+
+static void shard_done(int ret, byte_buf_t *http_res, void *ctx) {
+  unspent_chunk_t *chunk = (unspent_chunk_t *)ctx;
+  unspent_shards_t *shards = chunk->shards;
+  // keeps the pipe full, responses are decoded as they arrive
+  if (shards->ret == 0 && shard_send_next(shards) != 0) {
+    shards->ret = -1;
+  }
+
+  if (ret == 0) {
+    ret = unspent_decoder_finish(chunk->dec);
+  }
+  if (ret == 0) {
+    // the response has no address indexes, take them from the request
+    for (size_t i = chunk->first; i < chunk->first + chunk->count; i++) {
+      address_t *addr = addr_list_at(shards->addrs, i);
+      unspent_outputs_t *elm = unspent_outputs_find(shards->unspent, addr->addr);
+      if (elm) {
+        elm->addr_index = addr->index;
+      }
+    }
+  } else {
+    printf("[%s:%d]: chunk of %zu addresses failed\n", __func__, __LINE__, chunk->count);
+    shards->ret = -1;
+  }
+  unspent_decoder_free(chunk->dec);
+  free(chunk);
+}
+
+static int shard_send_next(unspent_shards_t *shards) {
+  size_t len = addr_list_len(shards->addrs);
+  if (shards->next >= len) {
+    return 0;
+  }
+
+  int ret = 0;
+  byte_buf_t *http_req = byte_buf_new();
+  unspent_chunk_t *chunk = malloc(sizeof(unspent_chunk_t));
+  if (chunk) {
+    chunk->dec = unspent_decoder_new(shards->unspent);
+  }
+  if (http_req == NULL || chunk == NULL || chunk->dec == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  chunk->shards = shards;
+  chunk->first = shards->next;
+  chunk->count = len - shards->next < shards->chunk_size ? len - shards->next : shards->chunk_size;
+
+  if (request_builder(shards->addrs, chunk->first, chunk->count, http_req) != 0) {
+    printf("[%s:%d]: build request failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  if (http_loop_post_stream(shards->loop, &shards->http_conf, http_req, shard_write, shard_done, chunk) == NULL) {
+    printf("[%s:%d]: http client post failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  shards->next += chunk->count;
+  chunk = NULL;
+
+done:
+  byte_buf_free(http_req);
+  if (chunk) {
+    unspent_decoder_free(chunk->dec);
+    free(chunk);
+  }
+  return ret;
+}
+
+int get_unspent_outputs_sharded(tangle_client_conf_t const *conf, addr_list_t *addrs, size_t chunk_size,
+                                size_t max_inflight, unspent_outputs_t **unspent) {
+  if (chunk_size == 0 || max_inflight == 0) {
+    printf("[%s:%d]: invalid shard size\n", __func__, __LINE__);
+    return -1;
+  }
+
+  char const *cmd_unspent_outputs = "value/unspentOutputs";
+  unspent_shards_t shards = {};
+  iota_str_t *cmd = iota_str_new(conf->url);
+  if (cmd == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  if (iota_str_append(cmd, cmd_unspent_outputs)) {
+    printf("[%s:%d]: string append failed\n", __func__, __LINE__);
+    shards.ret = -1;
+    goto done;
+  }
+
+  if ((shards.loop = http_loop_new()) == NULL) {
+    // no non-blocking client on this platform
+    iota_str_destroy(cmd);
+    return get_unspent_outputs(conf, addrs, unspent);
+  }
+  shards.http_conf.url = cmd->buf;
+  if (conf->port) {
+    shards.http_conf.port = conf->port;
+  }
+  shards.http_conf.compress = conf->compress;
+  shards.http_conf.transport = conf->transport;
+  shards.addrs = addrs;
+  shards.chunk_size = chunk_size;
+  shards.unspent = unspent;
+
+  for (size_t i = 0; i < max_inflight && shards.ret == 0; i++) {
+    shards.ret = shard_send_next(&shards);
+  }
+  if (http_loop_run(shards.loop, 0) != 0) {
+    shards.ret = -1;
+  }
+
+done:
+  http_loop_free(shards.loop);
+  iota_str_destroy(cmd);
+  return shards.ret;
+}
@@ -4,9 +4,26 @@
 #include <stdbool.h>
 
 #include "client/client_service.h"
+#include "client/network/http_async.h"
 #include "core/transaction.h"
 #include "core/unspent_outputs.h"
 
+// the default number of addresses per request of get_unspent_outputs_sharded()
+#define UNSPENT_OUTPUTS_CHUNK_SIZE 128
+// the default number of concurrent requests of get_unspent_outputs_sharded()
+#define UNSPENT_OUTPUTS_MAX_INFLIGHT 8
+
+typedef struct unspent_decoder_s unspent_decoder_t;
+
+/**
+ * @brief Completes an unspent outputs request
+ *
+ * @param[in] ret 0 on success
+ * @param[in] unspent An unspent outputs table, owned by the callback and freed by unspent_outputs_free()
+ * @param[in] ctx The context given with the request
+ */
+typedef void (*get_unspent_outputs_cb)(int ret, unspent_outputs_t *unspent, void *ctx);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,6 +38,71 @@ extern "C" {
  */
 int get_unspent_outputs(tangle_client_conf_t const *conf, addr_list_t *addrs, unspent_outputs_t **unspent);
 
+/**
+ * @brief Starts an unspent outputs request on a loop
+ *
+ * @param[in] loop A http loop
+ * @param[in] conf The client endpoint configuration
+ * @param[in] addrs A list of addresses
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return int 0 on success, the callback is not invoked on failure
+ */
+int get_unspent_outputs_async(http_loop_t *loop, tangle_client_conf_t const *conf, addr_list_t *addrs,
+                              get_unspent_outputs_cb cb, void *ctx);
+
+/**
+ * @brief The unspent output API for large address lists
+ *
+ * Addresses are split into chunks that are sent concurrently. Each response is parsed while other chunks are in
+ * flight, and merged into one table with the address indexes of the list.
+ *
+ * @param[in] conf The client endpoint configuration
+ * @param[in] addrs A list of addresses
+ * @param[in] chunk_size The number of addresses per request
+ * @param[in] max_inflight The number of concurrent requests
+ * @param[out] unspent An unspent outputs table
+ * @return int 0 on success, -1 if any chunk failed
+ */
+int get_unspent_outputs_sharded(tangle_client_conf_t const *conf, addr_list_t *addrs, size_t chunk_size,
+                                size_t max_inflight, unspent_outputs_t **unspent);
+
+/**
+ * @brief Creates a decoder of unspent outputs responses
+ *
+ * The response is parsed as it arrives, each address is added to the table once its object is complete. The memory
+ * of the decoder is bounded by one address and its outputs.
+ *
+ * @param[in] unspent The table receiving decoded addresses, address indexes are set to 0
+ * @return unspent_decoder_t* NULL on failed
+ */
+unspent_decoder_t *unspent_decoder_new(unspent_outputs_t **unspent);
+
+/**
+ * @brief Decodes a chunk of a response
+ *
+ * @param[in] dec A decoder
+ * @param[in] data A chunk of the response body
+ * @param[in] len The length of data
+ * @return int 0 on success
+ */
+int unspent_decoder_feed(unspent_decoder_t *dec, byte_t const data[], size_t len);
+
+/**
+ * @brief Ends the response
+ *
+ * @param[in] dec A decoder
+ * @return int 0 on success, -1 on an incomplete or invalid response
+ */
+int unspent_decoder_finish(unspent_decoder_t *dec);
+
+/**
+ * @brief Frees a decoder
+ *
+ * @param[in] dec A decoder
+ */
+void unspent_decoder_free(unspent_decoder_t *dec);
+
 /**
  * @brief Unspent output deserialization
  *
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "client/api/json_stream.h"
+
+enum {
+  ST_VALUE = 0,    // expects a value
+  ST_KEY,          // expects a key
+  ST_COLON,        // expects a colon after a key
+  ST_AFTER_VALUE,  // expects a comma or a closing bracket
+  ST_STRING,
+  ST_STRING_KEY,
+  ST_ESCAPE,
+  ST_ESCAPE_KEY,
+  ST_UNICODE,
+  ST_UNICODE_KEY,
+  ST_NUMBER,
+  ST_LITERAL,
+  ST_DONE,
+  ST_ERROR,
+};
+
+static bool is_space(byte_t c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+static int hex_value(byte_t c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool tok_push(json_stream_t* s, char c) {
+  if (s->tok_len >= JSON_STREAM_MAX_TOKEN) {
+    // a long string or number is skipped, keys and literals are short
+    if (s->state == ST_STRING || s->state == ST_NUMBER) {
+      s->tok_skipped++;
+      return true;
+    }
+    printf("[%s:%d] token is too long\n", __func__, __LINE__);
+    return false;
+  }
+  s->tok[s->tok_len++] = c;
+  return true;
+}
+
+// appends a code point as UTF-8
+static bool tok_push_unicode(json_stream_t* s, uint32_t cp) {
+  if (cp < 0x80) {
+    return tok_push(s, (char)cp);
+  } else if (cp < 0x800) {
+    return tok_push(s, (char)(0xC0 | (cp >> 6))) && tok_push(s, (char)(0x80 | (cp & 0x3F)));
+  }
+  return tok_push(s, (char)(0xE0 | (cp >> 12))) && tok_push(s, (char)(0x80 | ((cp >> 6) & 0x3F))) &&
+         tok_push(s, (char)(0x80 | (cp & 0x3F)));
+}
+
+// a value is complete, the document ends with the top level value
+static void value_done(json_stream_t* s) {
+  s->state = s->depth == 0 ? ST_DONE : ST_AFTER_VALUE;
+  s->first = false;
+}
+
+static int emit_value(json_stream_t* s, json_stream_value_t kind) {
+  s->tok[s->tok_len] = '\0';
+  char const* str = s->tok_skipped ? NULL : s->tok;
+  int ret = s->cb->on_value ? s->cb->on_value(s->ctx, kind, str, s->tok_len + s->tok_skipped) : 0;
+  s->tok_len = 0;
+  s->tok_skipped = 0;
+  value_done(s);
+  return ret == 0 ? 0 : -1;
+}
+
+static int emit_literal(json_stream_t* s) {
+  s->tok[s->tok_len] = '\0';
+  if (strcmp(s->tok, "true") == 0) {
+    return emit_value(s, JSON_STREAM_TRUE);
+  } else if (strcmp(s->tok, "false") == 0) {
+    return emit_value(s, JSON_STREAM_FALSE);
+  } else if (strcmp(s->tok, "null") == 0) {
+    return emit_value(s, JSON_STREAM_NULL);
+  }
+  printf("[%s:%d] invalid literal %s\n", __func__, __LINE__, s->tok);
+  return -1;
+}
+
+static int open_container(json_stream_t* s, char c) {
+  if (s->depth >= JSON_STREAM_MAX_DEPTH) {
+    printf("[%s:%d] nesting is too deep\n", __func__, __LINE__);
+    return -1;
+  }
+  s->stack[s->depth++] = c;
+  s->state = c == '{' ? ST_KEY : ST_VALUE;
+  s->first = true;
+  return s->cb->on_begin && s->cb->on_begin(s->ctx, c == '[') != 0 ? -1 : 0;
+}
+
+static int close_container(json_stream_t* s, char c) {
+  char open = c == '}' ? '{' : '[';
+  if (s->depth == 0 || s->stack[s->depth - 1] != open) {
+    printf("[%s:%d] unbalanced %c\n", __func__, __LINE__, c);
+    return -1;
+  }
+  s->depth--;
+  value_done(s);
+  return s->cb->on_end && s->cb->on_end(s->ctx, c == ']') != 0 ? -1 : 0;
+}
+
+// parses a character, returns 1 if the character has to be parsed again in the new state.
+static int parse_char(json_stream_t* s, byte_t c) {
+  switch (s->state) {
+    case ST_VALUE:
+      if (is_space(c)) {
+        return 0;
+      } else if (c == '{' || c == '[') {
+        return open_container(s, c);
+      } else if (c == ']' && s->first) {
+        return close_container(s, c);
+      } else if (c == '"') {
+        s->state = ST_STRING;
+        return 0;
+      } else if (c == '-' || (c >= '0' && c <= '9')) {
+        s->state = ST_NUMBER;
+        return tok_push(s, c) ? 0 : -1;
+      } else if (c >= 'a' && c <= 'z') {
+        s->state = ST_LITERAL;
+        return tok_push(s, c) ? 0 : -1;
+      }
+      break;
+    case ST_KEY:
+      if (is_space(c)) {
+        return 0;
+      } else if (c == '"') {
+        s->state = ST_STRING_KEY;
+        return 0;
+      } else if (c == '}' && s->first) {
+        return close_container(s, c);
+      }
+      break;
+    case ST_COLON:
+      if (is_space(c)) {
+        return 0;
+      } else if (c == ':') {
+        s->state = ST_VALUE;
+        return 0;
+      }
+      break;
+    case ST_AFTER_VALUE:
+      if (is_space(c)) {
+        return 0;
+      } else if (c == ',') {
+        s->state = s->stack[s->depth - 1] == '{' ? ST_KEY : ST_VALUE;
+        return 0;
+      } else if (c == '}' || c == ']') {
+        return close_container(s, c);
+      }
+      break;
+    case ST_STRING:
+    case ST_STRING_KEY:
+      if (c == '"') {
+        if (s->state == ST_STRING) {
+          return emit_value(s, JSON_STREAM_STRING);
+        }
+        s->tok[s->tok_len] = '\0';
+        int ret = s->cb->on_key ? s->cb->on_key(s->ctx, s->tok, s->tok_len) : 0;
+        s->tok_len = 0;
+        s->state = ST_COLON;
+        return ret == 0 ? 0 : -1;
+      } else if (c == '\\') {
+        s->state = s->state == ST_STRING ? ST_ESCAPE : ST_ESCAPE_KEY;
+        return 0;
+      } else if (c >= 0x20) {
+        return tok_push(s, c) ? 0 : -1;
+      }
+      break;
+    case ST_ESCAPE:
+    case ST_ESCAPE_KEY: {
+      bool key = s->state == ST_ESCAPE_KEY;
+      char const* from = "\"\\/bfnrt";
+      char const* to = "\"\\/\b\f\n\r\t";
+      char const* p = c ? strchr(from, c) : NULL;
+      if (p) {
+        s->state = key ? ST_STRING_KEY : ST_STRING;
+        return tok_push(s, to[p - from]) ? 0 : -1;
+      } else if (c == 'u') {
+        s->state = key ? ST_UNICODE_KEY : ST_UNICODE;
+        s->uni = 0;
+        s->uni_len = 0;
+        return 0;
+      }
+      break;
+    }
+    case ST_UNICODE:
+    case ST_UNICODE_KEY: {
+      int v = hex_value(c);
+      if (v < 0) {
+        break;
+      }
+      s->uni = (s->uni << 4) | (uint32_t)v;
+      if (++s->uni_len == 4) {
+        s->state = s->state == ST_UNICODE ? ST_STRING : ST_STRING_KEY;
+        return tok_push_unicode(s, s->uni) ? 0 : -1;
+      }
+      return 0;
+    }
+    case ST_NUMBER:
+      if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+        return tok_push(s, c) ? 0 : -1;
+      }
+      return emit_value(s, JSON_STREAM_NUMBER) == 0 ? 1 : -1;
+    case ST_LITERAL:
+      if (c >= 'a' && c <= 'z') {
+        return tok_push(s, c) ? 0 : -1;
+      }
+      return emit_literal(s) == 0 ? 1 : -1;
+    case ST_DONE:
+      if (is_space(c)) {
+        return 0;
+      }
+      break;
+    default:
+      break;
+  }
+  printf("[%s:%d] unexpected character 0x%02X\n", __func__, __LINE__, c);
+  return -1;
+}
+
+void json_stream_init(json_stream_t* s, json_stream_cb_t const* cb, void* ctx) {
+  memset(s, 0, sizeof(json_stream_t));
+  s->cb = cb;
+  s->ctx = ctx;
+  s->state = ST_VALUE;
+}
+
+int json_stream_feed(json_stream_t* s, byte_t const data[], size_t len) {
+  for (size_t i = 0; i < len && s->state != ST_ERROR; i++) {
+    int ret = 0;
+    while ((ret = parse_char(s, data[i])) == 1) {
+    }
+    if (ret != 0) {
+      s->state = ST_ERROR;
+    }
+  }
+  return s->state == ST_ERROR ? -1 : 0;
+}
+
+int json_stream_end(json_stream_t* s) {
+  // a top level number or literal has no delimiter
+  if (s->depth == 0 && (s->state == ST_NUMBER || s->state == ST_LITERAL)) {
+    int ret = s->state == ST_NUMBER ? emit_value(s, JSON_STREAM_NUMBER) : emit_literal(s);
+    if (ret != 0) {
+      s->state = ST_ERROR;
+    }
+  }
+  return s->state == ST_DONE ? 0 : -1;
+}
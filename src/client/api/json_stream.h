@@ -0,0 +1,92 @@
+#ifndef __CLIENT_API_JSON_STREAM_H__
+#define __CLIENT_API_JSON_STREAM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core/types.h"
+
+/**
+ * @brief A push JSON parser
+ *
+ * Data is fed in chunks of any size, for example from a http write callback, and events are emitted as soon as a
+ * token is complete. Only the current token and the nesting of containers are kept, the memory doesn't grow with the
+ * document.
+ *
+ * Strings and numbers longer than JSON_STREAM_MAX_TOKEN are not buffered, on_value gets a NULL string and their full
+ * length, the callback fails if it needs the value. Longer keys are an error.
+ *
+ */
+
+// the maximum nesting of objects and arrays
+#define JSON_STREAM_MAX_DEPTH 32
+// the maximum length of a key or of a value handed to callbacks
+#define JSON_STREAM_MAX_TOKEN 256
+
+typedef enum {
+  JSON_STREAM_STRING = 0,
+  JSON_STREAM_NUMBER,
+  JSON_STREAM_TRUE,
+  JSON_STREAM_FALSE,
+  JSON_STREAM_NULL,
+} json_stream_value_t;
+
+// the callbacks return 0 to continue, otherwise parsing stops with an error
+typedef struct {
+  int (*on_begin)(void* ctx, bool is_array);
+  int (*on_end)(void* ctx, bool is_array);
+  int (*on_key)(void* ctx, char const key[], size_t len);
+  int (*on_value)(void* ctx, json_stream_value_t kind, char const str[], size_t len);
+} json_stream_cb_t;
+
+typedef struct {
+  json_stream_cb_t const* cb;
+  void* ctx;
+  int state;
+  bool first;                            // right after an opening bracket, a closing bracket is allowed
+  size_t depth;                          // the nesting of containers
+  char stack[JSON_STREAM_MAX_DEPTH];     // '{' or '['
+  char tok[JSON_STREAM_MAX_TOKEN + 1];  // the current token, null terminated for callbacks
+  size_t tok_len;
+  size_t tok_skipped;  // the bytes of a long value beyond the token, the value is skipped
+  uint32_t uni;        // a \u escape sequence
+  int uni_len;
+} json_stream_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a parser
+ *
+ * @param[out] s A parser
+ * @param[in] cb The event callbacks
+ * @param[in] ctx The context of callbacks
+ */
+void json_stream_init(json_stream_t* s, json_stream_cb_t const* cb, void* ctx);
+
+/**
+ * @brief Parses a chunk of data
+ *
+ * @param[in] s A parser
+ * @param[in] data A chunk of a JSON document
+ * @param[in] len The length of data
+ * @return int 0 on success, -1 on invalid JSON or an aborted callback
+ */
+int json_stream_feed(json_stream_t* s, byte_t const data[], size_t len);
+
+/**
+ * @brief Ends the document
+ *
+ * @param[in] s A parser
+ * @return int 0 if a complete JSON value was parsed
+ */
+int json_stream_end(json_stream_t* s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "client/api/json_writer.h"
+
+// makes room for len more bytes, the capacity doubles so small writes don't reallocate each time
+static int grow(json_writer_t* w, size_t len) {
+  if (w->error) {
+    return -1;
+  }
+  size_t needed = w->buf->len + len;
+  if (needed > w->buf->cap) {
+    size_t cap = w->buf->cap * 2;
+    if (byte_buf_reserve(w->buf, cap > needed ? cap : needed) == false) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      w->error = true;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int put(json_writer_t* w, char const data[], size_t len) {
+  if (grow(w, len) != 0) {
+    return -1;
+  }
+  memcpy(w->buf->data + w->buf->len, data, len);
+  w->buf->len += len;
+  return 0;
+}
+
+static int put_char(json_writer_t* w, char c) { return put(w, &c, 1); }
+
+// separates an element from the previous one
+static int element(json_writer_t* w) {
+  int ret = w->comma ? put_char(w, ',') : 0;
+  w->comma = true;
+  return ret;
+}
+
+static int put_string(json_writer_t* w, char const str[]) {
+  char const* hex = "0123456789abcdef";
+  char const* from = "\"\\\b\f\n\r\t";
+  char const* to = "\"\\bfnrt";
+  if (put_char(w, '"') != 0) {
+    return -1;
+  }
+  for (char const* p = str; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    char const* e = strchr(from, c);
+    if (e) {
+      char esc[2] = {'\\', to[e - from]};
+      put(w, esc, 2);
+    } else if (c < 0x20) {
+      char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+      put(w, esc, 6);
+    } else {
+      put_char(w, c);
+    }
+  }
+  return put_char(w, '"');
+}
+
+int json_writer_init(json_writer_t* w, byte_buf_t* buf, size_t size) {
+  w->buf = buf;
+  w->comma = false;
+  w->error = false;
+  // the null terminator
+  return grow(w, size + 1);
+}
+
+int json_writer_object_begin(json_writer_t* w) {
+  element(w);
+  w->comma = false;
+  return put_char(w, '{');
+}
+
+int json_writer_object_end(json_writer_t* w) {
+  w->comma = true;
+  return put_char(w, '}');
+}
+
+int json_writer_array_begin(json_writer_t* w) {
+  element(w);
+  w->comma = false;
+  return put_char(w, '[');
+}
+
+int json_writer_array_end(json_writer_t* w) {
+  w->comma = true;
+  return put_char(w, ']');
+}
+
+int json_writer_key(json_writer_t* w, char const key[]) {
+  element(w);
+  put_string(w, key);
+  w->comma = false;
+  return put_char(w, ':');
+}
+
+int json_writer_string(json_writer_t* w, char const str[]) {
+  element(w);
+  return put_string(w, str);
+}
+
+int json_writer_uint64(json_writer_t* w, uint64_t num) {
+  char str[24];
+  element(w);
+  return put(w, str, snprintf(str, sizeof(str), "%" PRIu64, num));
+}
+
+int json_writer_bool(json_writer_t* w, bool value) {
+  element(w);
+  return value ? put(w, "true", 4) : put(w, "false", 5);
+}
+
+int json_writer_address(json_writer_t* w, byte_t const addr[]) {
+  if (grow(w, JSON_WRITER_ADDRESS_SIZE) != 0) {
+    return -1;
+  }
+  element(w);
+  put_char(w, '"');
+  // encodes into the reserved space
+  char* str = (char*)w->buf->data + w->buf->len;
+  if (!address_2_base58(addr, str)) {
+    printf("[%s:%d] base58 encoding failed\n", __func__, __LINE__);
+    w->error = true;
+    return -1;
+  }
+  w->buf->len += strlen(str);
+  return put_char(w, '"');
+}
+
+int json_writer_end(json_writer_t* w) { return put_char(w, '\0'); }
@@ -0,0 +1,133 @@
+#ifndef __CLIENT_API_JSON_WRITER_H__
+#define __CLIENT_API_JSON_WRITER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "core/address.h"
+#include "core/types.h"
+#include "utils/byte_buffer.h"
+
+/**
+ * @brief A JSON writer
+ *
+ * Tokens are appended to a byte buffer as they are written, no document tree is built. Commas between elements are
+ * inserted by the writer. Errors are sticky, a request is built with a sequence of calls and checked once by
+ * json_writer_end().
+ *
+ */
+
+// the reserved size of a base58 address value, quotes and a comma included
+#define JSON_WRITER_ADDRESS_SIZE (TANGLE_ADDRESS_BASE58_BUF + 3)
+
+typedef struct {
+  byte_buf_t* buf;
+  bool comma;  // the next element needs a comma
+  bool error;
+} json_writer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a writer
+ *
+ * @param[out] w A writer
+ * @param[in] buf The buffer receiving the document
+ * @param[in] size The expected size of the document, the buffer is allocated once if it's large enough
+ * @return int 0 on success
+ */
+int json_writer_init(json_writer_t* w, byte_buf_t* buf, size_t size);
+
+/**
+ * @brief Begins an object
+ *
+ * @param[in] w A writer
+ * @return int 0 on success
+ */
+int json_writer_object_begin(json_writer_t* w);
+
+/**
+ * @brief Ends an object
+ *
+ * @param[in] w A writer
+ * @return int 0 on success
+ */
+int json_writer_object_end(json_writer_t* w);
+
+/**
+ * @brief Begins an array
+ *
+ * @param[in] w A writer
+ * @return int 0 on success
+ */
+int json_writer_array_begin(json_writer_t* w);
+
+/**
+ * @brief Ends an array
+ *
+ * @param[in] w A writer
+ * @return int 0 on success
+ */
+int json_writer_array_end(json_writer_t* w);
+
+/**
+ * @brief Writes the key of an object member
+ *
+ * @param[in] w A writer
+ * @param[in] key A key
+ * @return int 0 on success
+ */
+int json_writer_key(json_writer_t* w, char const key[]);
+
+/**
+ * @brief Writes a string value, quotes and control characters are escaped
+ *
+ * @param[in] w A writer
+ * @param[in] str A string
+ * @return int 0 on success
+ */
+int json_writer_string(json_writer_t* w, char const str[]);
+
+/**
+ * @brief Writes an unsigned integer value
+ *
+ * @param[in] w A writer
+ * @param[in] num A number
+ * @return int 0 on success
+ */
+int json_writer_uint64(json_writer_t* w, uint64_t num);
+
+/**
+ * @brief Writes a boolean value
+ *
+ * @param[in] w A writer
+ * @param[in] value A boolean
+ * @return int 0 on success
+ */
+int json_writer_bool(json_writer_t* w, bool value);
+
+/**
+ * @brief Writes an address as a base58 string, encoded in place
+ *
+ * @param[in] w A writer
+ * @param[in] addr An address in bytes
+ * @return int 0 on success
+ */
+int json_writer_address(json_writer_t* w, byte_t const addr[]);
+
+/**
+ * @brief Ends the document, the buffer is null terminated
+ *
+ * @param[in] w A writer
+ * @return int 0 if every call succeeded
+ */
+int json_writer_end(json_writer_t* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
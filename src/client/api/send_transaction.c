@@ -1,32 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "client/api/json_utils.h"
+#include "client/api/json_writer.h"
 #include "client/api/send_transaction.h"
 #include "client/network/http.h"
 #include "utils/iota_str.h"
 
 // 0 on success
 static int request_builder(byte_t const tx_bytes[], byte_buf_t *req) {
-  int ret = 0;
-
-  cJSON *json_root = cJSON_CreateObject();
-  if (json_root == NULL) {
-    return -1;
-  }
-
-  cJSON_AddItemToObject(json_root, "txn_bytes", cJSON_CreateString((const char *)tx_bytes));
-  char *json_text = cJSON_PrintUnformatted(json_root);
-  if (json_text == NULL) {
-    ret = -1;
-  } else {
-    byte_buf_append(req, (byte_t *)json_text, strlen(json_text));
-    byte_buf2str(req);
-    free(json_text);
-  }
-  cJSON_Delete(json_root);
-
-  return ret;
+  json_writer_t w;
+  // {"txn_bytes":"..."}
+  json_writer_init(&w, req, 16 + strlen((char const *)tx_bytes));
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "txn_bytes");
+  json_writer_string(&w, (char const *)tx_bytes);
+  json_writer_object_end(&w);
+  return json_writer_end(&w);
 }
 
 int send_tx_bytes(tangle_client_conf_t const *conf, byte_t const tx_bytes[], res_send_tx_t *res) {
@@ -53,6 +44,8 @@ int send_tx_bytes(tangle_client_conf_t const *conf, byte_t const tx_bytes[], res
   if (conf->port) {
     http_conf.port = conf->port;
   }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
 
   http_req = byte_buf_new();
   http_res = byte_buf_new();
@@ -83,7 +76,7 @@ int send_tx_bytes(tangle_client_conf_t const *conf, byte_t const tx_bytes[], res
   // printf("[%s:%d] res: %s\n", __func__, __LINE__, http_res->data);
 
   // json deserialization
-  deser_send_tx((char const *const)http_res->data, res);
+  ret = deser_send_tx((char const *const)http_res->data, res);
 
 done:
   // cleanup command
@@ -94,6 +87,71 @@ done:
   return ret;
 }
 
+typedef struct {
+  send_tx_cb cb;
+  void *ctx;
+} send_tx_async_t;
+
+static void send_tx_done(int ret, byte_buf_t *http_res, void *ctx) {
+  send_tx_async_t *req = (send_tx_async_t *)ctx;
+  res_send_tx_t res = {};
+  if (ret == 0) {
+    byte_buf2str(http_res);
+    ret = deser_send_tx((char const *const)http_res->data, &res);
+  }
+  req->cb(ret, &res, req->ctx);
+  free(req);
+}
+
+int send_tx_bytes_async(http_loop_t *loop, tangle_client_conf_t const *conf, byte_t const tx_bytes[], send_tx_cb cb,
+                        void *ctx) {
+  int ret = 0;
+  char const *const cmd_send_tx = "value/sendTransaction";
+  iota_str_t *cmd = iota_str_new(conf->url);
+  byte_buf_t *http_req = byte_buf_new();
+  send_tx_async_t *req = malloc(sizeof(send_tx_async_t));
+  if (cmd == NULL || http_req == NULL || req == NULL) {
+    printf("[%s:%d]: OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  if (iota_str_append(cmd, cmd_send_tx)) {
+    printf("[%s:%d]: string append failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  http_client_config_t http_conf = {0};
+  http_conf.url = cmd->buf;
+  if (conf->port) {
+    http_conf.port = conf->port;
+  }
+  http_conf.compress = conf->compress;
+  http_conf.transport = conf->transport;
+
+  if (request_builder(tx_bytes, http_req) != 0) {
+    printf("[%s:%d]: build request failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+
+  req->cb = cb;
+  req->ctx = ctx;
+  if (http_loop_post(loop, &http_conf, http_req, send_tx_done, req) == NULL) {
+    printf("[%s:%d]: http client post failed\n", __func__, __LINE__);
+    ret = -1;
+    goto done;
+  }
+  req = NULL;
+
+done:
+  iota_str_destroy(cmd);
+  byte_buf_free(http_req);
+  free(req);
+  return ret;
+}
+
 int deser_send_tx(char const *const j_str, res_send_tx_t *res) {
   char const *const key_id = "transaction_id";
   int ret = 0;
@@ -106,7 +164,9 @@ int deser_send_tx(char const *const j_str, res_send_tx_t *res) {
   if (res_err) {
     // got an error response
     printf("[%s:%d] Error response: %s\n", __func__, __LINE__, res_err->msg);
-    return -1;
+    res_err_free(res_err);
+    ret = -1;
+    goto end;
   }
 
   // gets ID
@@ -3,6 +3,7 @@
 
 #include "client/api/response_error.h"
 #include "client/client_service.h"
+#include "client/network/http_async.h"
 #include "core/message.h"
 #include "core/transaction.h"
 
@@ -10,6 +11,15 @@ typedef struct {
   char msg_id[TANGLE_MSG_ID_BASE58_BUF];
 } res_send_tx_t;
 
+/**
+ * @brief Completes a transaction submission
+ *
+ * @param[in] ret 0 on success
+ * @param[in] res The response, valid during the callback
+ * @param[in] ctx The context given with the request
+ */
+typedef void (*send_tx_cb)(int ret, res_send_tx_t *res, void *ctx);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +34,19 @@ extern "C" {
  */
 int send_tx_bytes(tangle_client_conf_t const *conf, byte_t const tx_bytes[], res_send_tx_t *res);
 
+/**
+ * @brief Starts a transaction submission on a loop
+ *
+ * @param[in] loop A http loop
+ * @param[in] conf A client instance
+ * @param[in] tx_bytes A transaction in bytes
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return int 0 on success, the callback is not invoked on failure
+ */
+int send_tx_bytes_async(http_loop_t *loop, tangle_client_conf_t const *conf, byte_t const tx_bytes[], send_tx_cb cb,
+                        void *ctx);
+
 /**
  * @brief Response deserialization
  *
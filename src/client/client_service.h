@@ -1,12 +1,15 @@
 #ifndef __CLIENT_SERVICE_H__
 #define __CLIENT_SERVICE_H__
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
 typedef struct {
   char url[256];
   uint16_t port;
+  bool compress;                            // asks nodes for gzip or deflate encoded responses
+  struct http_transport_s const* transport;  // the http transport, NULL for the default one
 } tangle_client_conf_t;
 
 #ifdef __cplusplus
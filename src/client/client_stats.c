@@ -0,0 +1,196 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "client/client_stats.h"
+#include "uthash.h"
+#include "utils/metrics.h"
+
+typedef struct {
+  client_endpoint_stats_t s;
+  UT_hash_handle hh;
+} stats_entry_t;
+
+static struct {
+  pthread_mutex_t lock;
+  bool disabled;
+  stats_entry_t* table;
+} g_stats = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static char const* const g_phase_names[CLIENT_PHASE_COUNT] = {"lookup", "connect", "tls", "server", "transfer", "total"};
+
+// the scheme, host, and port of a url
+static void endpoint_of(char const* url, char endpoint[]) {
+  endpoint[0] = '\0';
+  if (url == NULL) {
+    return;
+  }
+  char const* host = strstr(url, "://");
+  host = host ? host + 3 : url;
+  size_t len = (size_t)(host - url) + strcspn(host, "/?#");
+  len = len < CLIENT_STATS_ENDPOINT_LEN ? len : CLIENT_STATS_ENDPOINT_LEN - 1;
+  memcpy(endpoint, url, len);
+  endpoint[len] = '\0';
+}
+
+// the time between two steps of a request, transports without a step report it as the previous one
+static uint64_t phase_us(uint64_t end, uint64_t start) { return end > start ? end - start : 0; }
+
+static size_t hist_bucket(uint64_t us) {
+  size_t i = 0;
+  while (us > 0 && i < CLIENT_STATS_BUCKETS - 1) {
+    us >>= 1;
+    i++;
+  }
+  return i;
+}
+
+static void hist_add(client_hist_t* hist, uint64_t us) {
+  hist->count++;
+  hist->sum_us += us;
+  hist->max_us = us > hist->max_us ? us : hist->max_us;
+  hist->buckets[hist_bucket(us)]++;
+}
+
+void client_stats_enable(bool enable) {
+  pthread_mutex_lock(&g_stats.lock);
+  g_stats.disabled = !enable;
+  pthread_mutex_unlock(&g_stats.lock);
+}
+
+void client_stats_record(char const* url, int ret, http_req_stats_t const* stats) {
+  char endpoint[CLIENT_STATS_ENDPOINT_LEN];
+  endpoint_of(url, endpoint);
+  // the metrics registry is kept whether recording is enabled or not
+  metric_observe_label(&g_metric_http_duration, endpoint, stats->total_us);
+  if (ret != 0) {
+    metric_add_label(&g_metric_http_errors, endpoint, 1);
+  }
+  stats_entry_t* e = NULL;
+  pthread_mutex_lock(&g_stats.lock);
+  if (g_stats.disabled) {
+    pthread_mutex_unlock(&g_stats.lock);
+    return;
+  }
+  HASH_FIND_STR(g_stats.table, endpoint, e);
+  if (e == NULL) {
+    if ((e = calloc(1, sizeof(stats_entry_t))) == NULL) {
+      pthread_mutex_unlock(&g_stats.lock);
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return;
+    }
+    strcpy(e->s.endpoint, endpoint);
+    HASH_ADD_STR(g_stats.table, s.endpoint, e);
+  }
+
+  client_endpoint_stats_t* s = &e->s;
+  s->requests++;
+  s->sent_bytes += stats->sent_bytes;
+  s->received_bytes += stats->wire_bytes;
+  hist_add(&s->phases[CLIENT_PHASE_TOTAL], stats->total_us);
+  if (ret != 0) {
+    s->errors++;
+  } else {
+    if (!stats->reused) {
+      s->connections++;
+      hist_add(&s->phases[CLIENT_PHASE_LOOKUP], stats->lookup_us);
+      hist_add(&s->phases[CLIENT_PHASE_CONNECT], phase_us(stats->connect_us, stats->lookup_us));
+      if (strncasecmp(endpoint, "https://", 8) == 0) {
+        hist_add(&s->phases[CLIENT_PHASE_TLS], phase_us(stats->tls_us, stats->connect_us));
+      }
+    }
+    hist_add(&s->phases[CLIENT_PHASE_SERVER], phase_us(stats->first_byte_us, stats->tls_us));
+    hist_add(&s->phases[CLIENT_PHASE_TRANSFER], phase_us(stats->total_us, stats->first_byte_us));
+  }
+  pthread_mutex_unlock(&g_stats.lock);
+}
+
+int client_stats_get(char const* url, client_endpoint_stats_t* stats) {
+  char endpoint[CLIENT_STATS_ENDPOINT_LEN];
+  endpoint_of(url, endpoint);
+  stats_entry_t* e = NULL;
+  pthread_mutex_lock(&g_stats.lock);
+  HASH_FIND_STR(g_stats.table, endpoint, e);
+  if (e) {
+    *stats = e->s;
+  }
+  pthread_mutex_unlock(&g_stats.lock);
+  return e ? 0 : -1;
+}
+
+size_t client_stats_count() {
+  pthread_mutex_lock(&g_stats.lock);
+  size_t count = HASH_COUNT(g_stats.table);
+  pthread_mutex_unlock(&g_stats.lock);
+  return count;
+}
+
+size_t client_stats_list(client_endpoint_stats_t stats[], size_t max) {
+  size_t n = 0;
+  stats_entry_t *e, *tmp;
+  pthread_mutex_lock(&g_stats.lock);
+  HASH_ITER(hh, g_stats.table, e, tmp) {
+    if (n == max) {
+      break;
+    }
+    stats[n++] = e->s;
+  }
+  pthread_mutex_unlock(&g_stats.lock);
+  return n;
+}
+
+void client_stats_reset() {
+  stats_entry_t *e, *tmp;
+  pthread_mutex_lock(&g_stats.lock);
+  HASH_ITER(hh, g_stats.table, e, tmp) {
+    HASH_DEL(g_stats.table, e);
+    free(e);
+  }
+  pthread_mutex_unlock(&g_stats.lock);
+}
+
+void client_stats_print() {
+  stats_entry_t *e, *tmp;
+  pthread_mutex_lock(&g_stats.lock);
+  HASH_ITER(hh, g_stats.table, e, tmp) {
+    client_endpoint_stats_t const* s = &e->s;
+    printf("%s: requests %" PRIu64 ", errors %" PRIu64 ", connections %" PRIu64 ", sent %" PRIu64
+           " B, received %" PRIu64 " B\n",
+           s->endpoint, s->requests, s->errors, s->connections, s->sent_bytes, s->received_bytes);
+    for (int p = 0; p < CLIENT_PHASE_COUNT; p++) {
+      client_hist_t const* h = &s->phases[p];
+      if (h->count == 0) {
+        continue;
+      }
+      printf("  %-8s count %8" PRIu64 " avg %10" PRIu64 " p50 %10" PRIu64 " p90 %10" PRIu64 " p99 %10" PRIu64
+             " max %10" PRIu64 " us\n",
+             g_phase_names[p], h->count, h->sum_us / h->count, client_hist_percentile(h, 50),
+             client_hist_percentile(h, 90), client_hist_percentile(h, 99), h->max_us);
+    }
+  }
+  pthread_mutex_unlock(&g_stats.lock);
+}
+
+char const* client_phase_name(client_phase_t phase) {
+  return phase < CLIENT_PHASE_COUNT ? g_phase_names[phase] : "unknown";
+}
+
+uint64_t client_hist_percentile(client_hist_t const* hist, double percentile) {
+  if (hist->count == 0) {
+    return 0;
+  }
+  // the rank of the sample, from 1 to count
+  uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hist->count + 0.999999);
+  rank = rank < 1 ? 1 : rank > hist->count ? hist->count : rank;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < CLIENT_STATS_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= rank) {
+      uint64_t upper = i == 0 ? 0 : (uint64_t)1 << i;
+      return i == CLIENT_STATS_BUCKETS - 1 || upper > hist->max_us ? hist->max_us : upper;
+    }
+  }
+  return hist->max_us;
+}
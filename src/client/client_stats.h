@@ -0,0 +1,133 @@
+#ifndef __CLIENT_CLIENT_STATS_H__
+#define __CLIENT_CLIENT_STATS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "client/network/http.h"
+
+/**
+ * @brief Network statistics per endpoint
+ *
+ * Every request of the http client is recorded under its endpoint, the scheme, host, and port of its url. The time of
+ * a request is split into phases with a histogram each: name lookup, connect, TLS handshake, the server until the
+ * first response byte, and the transfer of the response. Lookup, connect, and TLS are only recorded for requests
+ * opening a connection, TLS only for https endpoints. Failed requests are counted and recorded in the total only.
+ * The total and the failures also go to the metrics registry, see utils/metrics.h.
+ *
+ * Recording is enabled by default, it takes a lock and a hash lookup per request.
+ *
+ */
+
+// the maximum length of an endpoint
+#define CLIENT_STATS_ENDPOINT_LEN 128
+// bucket 0 counts durations under 1 us, bucket i from 2^(i-1) up to 2^i us, the last one all from about 16.8 s on.
+#define CLIENT_STATS_BUCKETS 26
+
+typedef enum {
+  CLIENT_PHASE_LOOKUP = 0,  // the name lookup
+  CLIENT_PHASE_CONNECT,     // the TCP connect
+  CLIENT_PHASE_TLS,         // the TLS handshake
+  CLIENT_PHASE_SERVER,      // from the sent request to the first response byte
+  CLIENT_PHASE_TRANSFER,    // from the first to the last response byte
+  CLIENT_PHASE_TOTAL,       // the whole request
+  CLIENT_PHASE_COUNT
+} client_phase_t;
+
+typedef struct {
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t max_us;
+  uint64_t buckets[CLIENT_STATS_BUCKETS];
+} client_hist_t;
+
+typedef struct {
+  char endpoint[CLIENT_STATS_ENDPOINT_LEN];
+  uint64_t requests;        // completed requests
+  uint64_t errors;          // failed requests
+  uint64_t connections;     // requests opening a connection
+  uint64_t sent_bytes;      // request bodies sent
+  uint64_t received_bytes;  // response bodies received, as they were on the wire
+  client_hist_t phases[CLIENT_PHASE_COUNT];
+} client_endpoint_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Enables or disables recording, the statistics are kept
+ *
+ * @param[in] enable true to record requests
+ */
+void client_stats_enable(bool enable);
+
+/**
+ * @brief Records a request, it's called by the http client after every request
+ *
+ * @param[in] url The url of the request
+ * @param[in] ret The result of the request, 0 on success
+ * @param[in] stats The transfer and timing of the request
+ */
+void client_stats_record(char const* url, int ret, http_req_stats_t const* stats);
+
+/**
+ * @brief Gets the statistics of an endpoint
+ *
+ * @param[in] url The endpoint or any url of it
+ * @param[out] stats The statistics
+ * @return int 0 on success, -1 if nothing was recorded for the endpoint
+ */
+int client_stats_get(char const* url, client_endpoint_stats_t* stats);
+
+/**
+ * @brief Gets the number of endpoints
+ *
+ * @return size_t
+ */
+size_t client_stats_count();
+
+/**
+ * @brief Gets the statistics of all endpoints
+ *
+ * @param[out] stats An array of endpoint statistics
+ * @param[in] max The length of the array
+ * @return size_t The number of endpoints written
+ */
+size_t client_stats_list(client_endpoint_stats_t stats[], size_t max);
+
+/**
+ * @brief Clears the statistics of all endpoints
+ *
+ */
+void client_stats_reset();
+
+/**
+ * @brief Prints out the statistics of all endpoints with the percentiles of every phase
+ *
+ */
+void client_stats_print();
+
+/**
+ * @brief Gets the name of a phase
+ *
+ * @param[in] phase A phase
+ * @return char const*
+ */
+char const* client_phase_name(client_phase_t phase);
+
+/**
+ * @brief Gets a percentile of a histogram, the upper bound of the bucket it falls in
+ *
+ * @param[in] hist A histogram
+ * @param[in] percentile The percentile, from 0 to 100
+ * @return uint64_t The duration in microseconds, at most the maximum recorded, 0 if the histogram is empty
+ */
+uint64_t client_hist_percentile(client_hist_t const* hist, double percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "client/api/get_node_info.h"
+#include "client/api/get_unspent_outputs.h"
+#include "client/endpoint_pool.h"
+#include "client/network/http_async.h"
+
+// a health check of a node
+typedef struct {
+  endpoint_pool_t* pool;
+  int index;
+  uint64_t start_us;
+} node_check_t;
+
+// a hedged read, the first successful answer wins
+typedef struct {
+  endpoint_pool_t* pool;
+  http_loop_t* loop;
+  bool done;                  // later answers are dropped
+  bool hedged;                // a duplicate was sent while the first request was pending
+  unspent_outputs_t* result;  // the answer of the winner
+  int winner;
+} hedge_race_t;
+
+typedef struct {
+  hedge_race_t* race;
+  int index;
+  uint64_t start_us;
+} hedge_try_t;
+
+// ranks a node, lower is better: synced nodes, then reachable nodes, then the others
+static int node_tier(endpoint_t const* n) {
+  if (n->failures >= ENDPOINT_MAX_FAILURES) {
+    return 2;
+  }
+  return n->synced ? 0 : 1;
+}
+
+// the best node other than exclude, the caller holds the lock
+static int pool_best(endpoint_pool_t* pool, int exclude) {
+  int best = -1;
+  for (int i = 0; i < (int)pool->count; i++) {
+    if (i == exclude) {
+      continue;
+    }
+    endpoint_t const* n = &pool->nodes[i];
+    if (best < 0) {
+      best = i;
+      continue;
+    }
+    endpoint_t const* b = &pool->nodes[best];
+    int tier = node_tier(n), best_tier = node_tier(b);
+    if (tier < best_tier || (tier == best_tier && n->ewma_us < b->ewma_us)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+static int cmp_u32(void const* a, void const* b) {
+  uint32_t x = *(uint32_t const*)a, y = *(uint32_t const*)b;
+  return x < y ? -1 : x > y;
+}
+
+endpoint_pool_t* endpoint_pool_new() {
+  endpoint_pool_t* pool = malloc(sizeof(endpoint_pool_t));
+  if (pool == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(pool, 0, sizeof(endpoint_pool_t));
+  pthread_mutex_init(&pool->lock, NULL);
+  return pool;
+}
+
+void endpoint_pool_free(endpoint_pool_t* pool) {
+  if (pool) {
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+  }
+}
+
+int endpoint_pool_add(endpoint_pool_t* pool, char const url[], uint16_t port) {
+  if (pool == NULL || url == NULL || strlen(url) >= sizeof(pool->nodes[0].conf.url)) {
+    printf("[%s:%d] invalid parameters\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&pool->lock);
+  if (pool->count == ENDPOINT_POOL_MAX) {
+    pthread_mutex_unlock(&pool->lock);
+    printf("[%s:%d] the pool is full\n", __func__, __LINE__);
+    return -1;
+  }
+  endpoint_t* n = &pool->nodes[pool->count++];
+  memset(n, 0, sizeof(endpoint_t));
+  strcpy(n->conf.url, url);
+  n->conf.port = port;
+  n->conf.compress = pool->compress;
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+void endpoint_pool_report(endpoint_pool_t* pool, int index, int ret, uint64_t latency_us) {
+  pthread_mutex_lock(&pool->lock);
+  if (index >= 0 && index < (int)pool->count) {
+    endpoint_t* n = &pool->nodes[index];
+    n->requests++;
+    if (ret == 0) {
+      n->failures = 0;
+      n->samples[n->sample_count++ % ENDPOINT_LATENCY_SAMPLES] = latency_us > UINT32_MAX ? UINT32_MAX : latency_us;
+      if (n->sample_count == 1) {
+        n->ewma_us = latency_us;
+      } else {
+        n->ewma_us = n->ewma_us - (n->ewma_us >> ENDPOINT_EWMA_SHIFT) + (latency_us >> ENDPOINT_EWMA_SHIFT);
+      }
+    } else {
+      n->errors++;
+      n->failures++;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+static void check_done(int ret, res_node_info_t* res, void* ctx) {
+  node_check_t* c = (node_check_t*)ctx;
+  uint64_t latency = endpoint_now_us() - c->start_us;
+  pthread_mutex_lock(&c->pool->lock);
+  c->pool->nodes[c->index].synced = ret == 0 && res->is_synced;
+  pthread_mutex_unlock(&c->pool->lock);
+  endpoint_pool_report(c->pool, c->index, ret, latency);
+}
+
+int endpoint_pool_check(endpoint_pool_t* pool) {
+  tangle_client_conf_t confs[ENDPOINT_POOL_MAX];
+  node_check_t checks[ENDPOINT_POOL_MAX];
+
+  pthread_mutex_lock(&pool->lock);
+  size_t count = pool->count;
+  for (size_t i = 0; i < count; i++) {
+    confs[i] = pool->nodes[i].conf;
+  }
+  pool->last_check_ms = endpoint_now_us() / 1000;
+  pthread_mutex_unlock(&pool->lock);
+
+  http_loop_t* loop = http_loop_new();
+  for (size_t i = 0; i < count; i++) {
+    checks[i] = (node_check_t){.pool = pool, .index = (int)i, .start_us = endpoint_now_us()};
+    if (loop == NULL) {
+      // no multi interface, nodes are checked one after another
+      res_node_info_t res = {};
+      check_done(get_node_info(&confs[i], &res), &res, &checks[i]);
+    } else if (get_node_info_async(loop, &confs[i], check_done, &checks[i]) != 0) {
+      check_done(-1, NULL, &checks[i]);
+    }
+  }
+  if (loop) {
+    http_loop_run(loop, 0);
+    http_loop_free(loop);
+  }
+
+  int synced = 0;
+  pthread_mutex_lock(&pool->lock);
+  for (size_t i = 0; i < count; i++) {
+    synced += pool->nodes[i].synced ? 1 : 0;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return synced;
+}
+
+int endpoint_pool_pick(endpoint_pool_t* pool, tangle_client_conf_t* conf) {
+  pthread_mutex_lock(&pool->lock);
+  bool stale = pool->count > 0 && (pool->last_check_ms == 0 ||
+                                   endpoint_now_us() / 1000 - pool->last_check_ms >= ENDPOINT_CHECK_INTERVAL_MS);
+  pthread_mutex_unlock(&pool->lock);
+  if (stale) {
+    endpoint_pool_check(pool);
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  int best = pool_best(pool, -1);
+  if (best >= 0 && conf) {
+    *conf = pool->nodes[best].conf;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return best;
+}
+
+int endpoint_pool_set_hedge(endpoint_pool_t* pool, uint8_t percentile, uint32_t min_ms) {
+  if (percentile > 99) {
+    printf("[%s:%d] invalid percentile %u\n", __func__, __LINE__, percentile);
+    return -1;
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->hedge_percentile = percentile;
+  pool->hedge_min_ms = min_ms;
+  pthread_mutex_unlock(&pool->lock);
+  return 0;
+}
+
+void endpoint_pool_set_compress(endpoint_pool_t* pool, bool enable) {
+  pthread_mutex_lock(&pool->lock);
+  pool->compress = enable;
+  for (size_t i = 0; i < pool->count; i++) {
+    pool->nodes[i].conf.compress = enable;
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+uint32_t endpoint_pool_hedge_delay(endpoint_pool_t* pool, int index) {
+  uint32_t samples[ENDPOINT_LATENCY_SAMPLES];
+  pthread_mutex_lock(&pool->lock);
+  endpoint_t const* n = &pool->nodes[index];
+  size_t count = n->sample_count < ENDPOINT_LATENCY_SAMPLES ? n->sample_count : ENDPOINT_LATENCY_SAMPLES;
+  memcpy(samples, n->samples, sizeof(uint32_t) * count);
+  uint8_t percentile = pool->hedge_percentile;
+  uint32_t delay = pool->hedge_min_ms;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (count > 0) {
+    qsort(samples, count, sizeof(uint32_t), cmp_u32);
+    uint32_t ms = (samples[(count - 1) * percentile / 100] + 999) / 1000;
+    delay = ms > delay ? ms : delay;
+  }
+  return delay;
+}
+
+int endpoint_pool_status(endpoint_pool_t* pool, int index, endpoint_t* node) {
+  int ret = -1;
+  pthread_mutex_lock(&pool->lock);
+  if (index >= 0 && index < (int)pool->count) {
+    *node = pool->nodes[index];
+    ret = 0;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return ret;
+}
+
+static void hedge_done(int ret, unspent_outputs_t* unspent, void* ctx) {
+  hedge_try_t* t = (hedge_try_t*)ctx;
+  hedge_race_t* race = t->race;
+  if (race->done) {
+    // the race is decided, or cancelled
+    unspent_outputs_free(&unspent);
+    return;
+  }
+  endpoint_pool_report(race->pool, t->index, ret, endpoint_now_us() - t->start_us);
+  if (ret == 0) {
+    race->done = true;
+    race->result = unspent;
+    race->winner = t->index;
+  } else {
+    unspent_outputs_free(&unspent);
+  }
+  // gives the caller a chance to send the next request
+  http_loop_stop(race->loop);
+}
+
+static int hedge_start(hedge_race_t* race, hedge_try_t* t, int index, addr_list_t* addrs) {
+  tangle_client_conf_t conf;
+  pthread_mutex_lock(&race->pool->lock);
+  conf = race->pool->nodes[index].conf;
+  pthread_mutex_unlock(&race->pool->lock);
+  *t = (hedge_try_t){.race = race, .index = index, .start_us = endpoint_now_us()};
+  return get_unspent_outputs_async(race->loop, &conf, addrs, hedge_done, t);
+}
+
+int endpoint_pool_get_unspent_outputs(endpoint_pool_t* pool, addr_list_t* addrs, unspent_outputs_t** unspent) {
+  if (*unspent != NULL) {
+    printf("[%s:%d] the table is not empty\n", __func__, __LINE__);
+    return -1;
+  }
+  tangle_client_conf_t conf;
+  int first = endpoint_pool_pick(pool, &conf);
+  if (first < 0) {
+    printf("[%s:%d] no endpoint\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&pool->lock);
+  int second = pool_best(pool, first);
+  bool hedging = pool->hedge_percentile > 0;
+  pthread_mutex_unlock(&pool->lock);
+
+  hedge_race_t race = {.pool = pool, .winner = -1};
+  if ((race.loop = http_loop_new()) == NULL) {
+    // no multi interface, a blocking request to the best node
+    uint64_t start = endpoint_now_us();
+    int ret = get_unspent_outputs(&conf, addrs, unspent);
+    endpoint_pool_report(pool, first, ret, endpoint_now_us() - start);
+    return ret;
+  }
+
+  hedge_try_t tries[2];
+  bool second_sent = false;
+  // a failed start falls over to the second node
+  hedge_start(&race, &tries[0], first, addrs);
+  // waits for the first node up to the hedge delay, then for any answer
+  uint32_t wait = 0;
+  if (hedging && second >= 0) {
+    wait = endpoint_pool_hedge_delay(pool, first);
+    wait = wait ? wait : 1;
+  }
+  while (!race.done) {
+    int pending = http_loop_run(race.loop, wait);
+    wait = 0;
+    if (pending < 0 || race.done) {
+      break;
+    }
+    if (second >= 0 && !second_sent) {
+      // a hedge if the first request is pending, a failover otherwise
+      race.hedged = pending > 0;
+      if (race.hedged) {
+        pthread_mutex_lock(&pool->lock);
+        pool->nodes[second].hedges++;
+        pthread_mutex_unlock(&pool->lock);
+      }
+      second_sent = hedge_start(&race, &tries[1], second, addrs) == 0;
+      if (second_sent) {
+        continue;
+      }
+    }
+    if (pending == 0) {
+      break;
+    }
+  }
+  // losers are cancelled
+  race.done = true;
+  http_loop_free(race.loop);
+
+  if (race.result == NULL) {
+    printf("[%s:%d] no endpoint answered\n", __func__, __LINE__);
+    return -1;
+  }
+  if (race.hedged) {
+    pthread_mutex_lock(&pool->lock);
+    pool->nodes[race.winner].wins++;
+    pthread_mutex_unlock(&pool->lock);
+  }
+  *unspent = race.result;
+  return 0;
+}
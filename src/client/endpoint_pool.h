@@ -0,0 +1,177 @@
+#ifndef __CLIENT_ENDPOINT_POOL_H__
+#define __CLIENT_ENDPOINT_POOL_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "client/client_service.h"
+#include "core/address.h"
+#include "core/unspent_outputs.h"
+
+/**
+ * @brief A pool of nodes
+ *
+ * Each request is routed to the node with the lowest latency among the synced ones. The latency is an exponentially
+ * weighted moving average of the last requests, the sync state comes from the info API. A node that fails
+ * ENDPOINT_MAX_FAILURES requests in a row is skipped until a health check succeeds.
+ *
+ * Reads can be hedged: if the first node doesn't answer within a percentile of its recent latencies, the same request
+ * is sent to the second best node and the first answer wins.
+ *
+ */
+
+// the maximum number of nodes in a pool
+#define ENDPOINT_POOL_MAX 16
+// the latency samples kept per node for percentiles
+#define ENDPOINT_LATENCY_SAMPLES 64
+// the weight of a new sample in the moving average, 1/8
+#define ENDPOINT_EWMA_SHIFT 3
+// consecutive failures before a node is skipped
+#define ENDPOINT_MAX_FAILURES 3
+// the interval of health checks made when picking a node
+#define ENDPOINT_CHECK_INTERVAL_MS 30000
+
+typedef struct {
+  tangle_client_conf_t conf;
+  bool synced;                                 // the sync state of the last health check
+  uint32_t failures;                           // consecutive failed requests
+  uint64_t ewma_us;                            // the moving average of latencies, 0 without samples
+  uint32_t samples[ENDPOINT_LATENCY_SAMPLES];  // the latest latencies in microseconds, a ring buffer
+  size_t sample_count;
+  uint64_t requests;  // the number of requests sent to the node
+  uint64_t errors;    // the number of failed requests
+  uint64_t hedges;    // the number of hedged requests sent to the node
+  uint64_t wins;      // the number of hedged races won
+} endpoint_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  endpoint_t nodes[ENDPOINT_POOL_MAX];
+  size_t count;
+  uint64_t last_check_ms;    // the time of the last health check
+  uint8_t hedge_percentile;  // the percentile of latencies hedged reads wait for, 0 disables hedging
+  uint32_t hedge_min_ms;     // the minimum delay of hedged requests
+  bool compress;             // asks nodes for compressed responses
+} endpoint_pool_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gets a monotonic time for request latencies
+ *
+ * @return uint64_t microseconds
+ */
+static uint64_t endpoint_now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Creates an endpoint pool
+ *
+ * @return endpoint_pool_t* NULL on failed
+ */
+endpoint_pool_t* endpoint_pool_new();
+
+/**
+ * @brief Frees an endpoint pool
+ *
+ * @param[in] pool An endpoint pool
+ */
+void endpoint_pool_free(endpoint_pool_t* pool);
+
+/**
+ * @brief Adds a node to the pool
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] url The URL of the node
+ * @param[in] port The port number, 0 for default port
+ * @return int 0 on success
+ */
+int endpoint_pool_add(endpoint_pool_t* pool, char const url[], uint16_t port);
+
+/**
+ * @brief Checks the health of all nodes with the info API, requests are sent concurrently
+ *
+ * @param[in] pool An endpoint pool
+ * @return int The number of synced nodes, -1 on failed
+ */
+int endpoint_pool_check(endpoint_pool_t* pool);
+
+/**
+ * @brief Picks the best node for a request, stale health checks are renewed first
+ *
+ * @param[in] pool An endpoint pool
+ * @param[out] conf The configuration of the node
+ * @return int The index of the node, -1 if the pool is empty
+ */
+int endpoint_pool_pick(endpoint_pool_t* pool, tangle_client_conf_t* conf);
+
+/**
+ * @brief Reports the result of a request to a node
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] index The index of the node
+ * @param[in] ret The result of the request, 0 on success
+ * @param[in] latency_us The latency of the request in microseconds
+ */
+void endpoint_pool_report(endpoint_pool_t* pool, int index, int ret, uint64_t latency_us);
+
+/**
+ * @brief Sets hedging of reads
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] percentile The percentile of recent latencies to wait for, from 1 to 99, 0 disables hedging
+ * @param[in] min_ms The minimum delay before hedging
+ * @return int 0 on success
+ */
+int endpoint_pool_set_hedge(endpoint_pool_t* pool, uint8_t percentile, uint32_t min_ms);
+
+/**
+ * @brief Asks all nodes of the pool for compressed responses
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] enable True to offer gzip and deflate encodings
+ */
+void endpoint_pool_set_compress(endpoint_pool_t* pool, bool enable);
+
+/**
+ * @brief Gets the delay of a hedged request to a node
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] index The index of the node
+ * @return uint32_t milliseconds
+ */
+uint32_t endpoint_pool_hedge_delay(endpoint_pool_t* pool, int index);
+
+/**
+ * @brief Gets a copy of a node's state
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] index The index of the node
+ * @param[out] node The state of the node
+ * @return int 0 on success
+ */
+int endpoint_pool_status(endpoint_pool_t* pool, int index, endpoint_t* node);
+
+/**
+ * @brief Gets unspent outputs from the best node, the read is hedged if enabled
+ *
+ * @param[in] pool An endpoint pool
+ * @param[in] addrs An address list
+ * @param[out] unspent An empty table receiving the unspent outputs of the first answer
+ * @return int 0 on success
+ */
+int endpoint_pool_get_unspent_outputs(endpoint_pool_t* pool, addr_list_t* addrs, unspent_outputs_t** unspent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,677 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cJSON.h"
+#include "client/api/json_writer.h"
+#include "client/ledger_sim.h"
+#include "client/network/http_inproc.h"
+#include "core/transaction.h"
+#include "utils/base64.h"
+#include "uthash.h"
+
+// the size of a signature in transaction bytes: version, public key, and signature
+#define SIM_SIGNATURE_BYTES (1 + ED_PUBLIC_KEY_BYTES + ED_SIGNATURE_BYTES)
+
+// an unspent output
+typedef struct {
+  byte_t tx_id[TX_ID_BYTES];  // key
+  balance_ht_t* balances;
+  int64_t confirm_at_ms;  // the time the output is confirmed
+  UT_hash_handle hh;
+} sim_output_t;
+
+// the unspent outputs of an address
+typedef struct {
+  byte_t addr[TANGLE_ADDRESS_BYTES];  // key
+  sim_output_t* outputs;
+  UT_hash_handle hh;
+} sim_addr_t;
+
+struct ledger_sim_s {
+  pthread_mutex_t lock;
+  ledger_sim_conf_t conf;
+  ledger_sim_stats_t stats;
+  sim_addr_t* addrs;
+  uint32_t rand;        // the state of the random generator
+  uint64_t mint_count;  // the number of minted outputs, it makes their transaction IDs unique
+  http_transport_t* transport;
+};
+
+static int64_t sim_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// xorshift32, the state is never 0
+static uint32_t sim_rand(ledger_sim_t* sim) {
+  uint32_t x = sim->rand;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return sim->rand = x;
+}
+
+static bool sim_chance(ledger_sim_t* sim, uint8_t percent) { return percent && sim_rand(sim) % 100 < percent; }
+
+// checks if the path of a request ends with an API
+static bool sim_path_is(char const* path, char const* api) {
+  size_t path_len = strlen(path), api_len = strlen(api);
+  return path_len > api_len && strcmp(path + path_len - api_len, api) == 0 && path[path_len - api_len - 1] == '/';
+}
+
+static sim_output_t* sim_output_find(ledger_sim_t* sim, byte_t const output_id[], sim_addr_t** addr) {
+  sim_addr_t* a = NULL;
+  sim_output_t* o = NULL;
+  HASH_FIND(hh, sim->addrs, output_id, TANGLE_ADDRESS_BYTES, a);
+  if (a) {
+    HASH_FIND(hh, a->outputs, output_id + TANGLE_ADDRESS_BYTES, TX_ID_BYTES, o);
+  }
+  if (addr) {
+    *addr = a;
+  }
+  return o;
+}
+
+// adds an output, the balances are taken over
+static int sim_output_add(ledger_sim_t* sim, byte_t const addr[], byte_t const tx_id[], balance_ht_t* balances,
+                          int64_t confirm_at_ms) {
+  sim_addr_t* a = NULL;
+  HASH_FIND(hh, sim->addrs, addr, TANGLE_ADDRESS_BYTES, a);
+  if (a == NULL) {
+    if ((a = malloc(sizeof(sim_addr_t))) == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    memcpy(a->addr, addr, TANGLE_ADDRESS_BYTES);
+    a->outputs = NULL;
+    HASH_ADD(hh, sim->addrs, addr, TANGLE_ADDRESS_BYTES, a);
+  }
+  sim_output_t* o = malloc(sizeof(sim_output_t));
+  if (o == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  memcpy(o->tx_id, tx_id, TX_ID_BYTES);
+  o->balances = balances;
+  o->confirm_at_ms = confirm_at_ms;
+  HASH_ADD(hh, a->outputs, tx_id, TX_ID_BYTES, o);
+  sim->stats.outputs++;
+  return 0;
+}
+
+static void sim_output_remove(ledger_sim_t* sim, sim_addr_t* a, sim_output_t* o) {
+  HASH_DEL(a->outputs, o);
+  balance_ht_free(&o->balances);
+  free(o);
+  sim->stats.outputs--;
+  if (a->outputs == NULL) {
+    HASH_DEL(sim->addrs, a);
+    free(a);
+  }
+}
+
+// adds an output of IOTA tokens created out of thin air, by the faucet or for a test
+static int sim_mint(ledger_sim_t* sim, byte_t const addr[], uint64_t amount, int64_t confirm_at_ms, byte_t tx_id[]) {
+  byte_t iota[BALANCE_COLOR_BYTES] = {};
+  balance_ht_t* balances = balance_ht_init();
+  if (amount == 0 || amount > INT64_MAX || balance_ht_add(&balances, iota, (int64_t)amount) != 0) {
+    balance_ht_free(&balances);
+    return -1;
+  }
+  uint64_t count = ++sim->mint_count;
+  crypto_generichash(tx_id, TX_ID_BYTES, (byte_t const*)&count, sizeof(count), NULL, 0);
+  if (sim_output_add(sim, addr, tx_id, balances, confirm_at_ms) != 0) {
+    balance_ht_free(&balances);
+    return -1;
+  }
+  return 0;
+}
+
+// ends a response, the null terminator is not part of the body
+static int sim_end(json_writer_t* w) {
+  if (json_writer_end(w) != 0) {
+    return -1;
+  }
+  w->buf->len--;
+  return 0;
+}
+
+// {"error":"..."}
+static int sim_error(ledger_sim_t* sim, byte_buf_t* response, char const msg[]) {
+  json_writer_t w;
+  sim->stats.errors++;
+  json_writer_init(&w, response, 0);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "error");
+  json_writer_string(&w, msg);
+  json_writer_object_end(&w);
+  return sim_end(&w);
+}
+
+// {"version":"...","identityID":"...","synced":true}
+static int sim_info(ledger_sim_t* sim, byte_buf_t* response) {
+  json_writer_t w;
+  json_writer_init(&w, response, 0);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "version");
+  json_writer_string(&w, "v0.3.0-sim");
+  json_writer_key(&w, "identityID");
+  json_writer_string(&w, "LedgerSim");
+  json_writer_key(&w, "synced");
+  json_writer_bool(&w, sim->conf.synced);
+  json_writer_object_end(&w);
+  return sim_end(&w);
+}
+
+// {"address":"..."} -> {"id":"..."}
+static int sim_faucet(ledger_sim_t* sim, cJSON* req, byte_buf_t* response) {
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  cJSON* j_addr = cJSON_GetObjectItemCaseSensitive(req, "address");
+  if (!cJSON_IsString(j_addr) || !address_from_base58(j_addr->valuestring, addr)) {
+    return sim_error(sim, response, "invalid address");
+  }
+
+  byte_t tx_id[TX_ID_BYTES];
+  int64_t confirm_at = sim->conf.confirm_ms ? sim_now_ms() + sim->conf.confirm_ms : 0;
+  if (sim_mint(sim, addr, sim->conf.faucet_amount, confirm_at, tx_id) != 0) {
+    return sim_error(sim, response, "faucet failed");
+  }
+  sim->stats.faucet++;
+
+  char id_str[TX_ID_BASE58_BUF];
+  tx_id_2_base58(tx_id, id_str);
+  json_writer_t w;
+  json_writer_init(&w, response, 0);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "id");
+  json_writer_string(&w, id_str);
+  json_writer_object_end(&w);
+  return sim_end(&w);
+}
+
+static void sim_write_output(json_writer_t* w, byte_t const addr[], sim_output_t const* o, int64_t now) {
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  char id_str[TX_OUTPUT_ID_BASE58_BUF];
+  char color_str[BALANCE_COLOR_BASE58_BUF];
+  bool confirmed = o->confirm_at_ms <= now;
+
+  tx_output_id((byte_t*)addr, (byte_t*)o->tx_id, output_id);
+  tx_output_id_2_base58(output_id, id_str);
+  json_writer_object_begin(w);
+  json_writer_key(w, "id");
+  json_writer_string(w, id_str);
+  json_writer_key(w, "balances");
+  json_writer_array_begin(w);
+  balance_ht_t *bal, *bal_tmp;
+  HASH_ITER(hh, o->balances, bal, bal_tmp) {
+    json_writer_object_begin(w);
+    json_writer_key(w, "value");
+    json_writer_uint64(w, (uint64_t)bal->value);
+    json_writer_key(w, "color");
+    if (empty_byte_array(bal->color, BALANCE_COLOR_BYTES)) {
+      json_writer_string(w, "IOTA");
+    } else {
+      balance_color_2_base58(bal->color, color_str);
+      json_writer_string(w, color_str);
+    }
+    json_writer_object_end(w);
+  }
+  json_writer_array_end(w);
+  json_writer_key(w, "inclusion_state");
+  json_writer_object_begin(w);
+  json_writer_key(w, "solid");
+  json_writer_bool(w, true);
+  json_writer_key(w, "confirmed");
+  json_writer_bool(w, confirmed);
+  json_writer_key(w, "liked");
+  json_writer_bool(w, true);
+  json_writer_key(w, "finalized");
+  json_writer_bool(w, confirmed);
+  json_writer_key(w, "preferred");
+  json_writer_bool(w, true);
+  json_writer_object_end(w);
+  json_writer_object_end(w);
+}
+
+// {"addresses":["..."]} -> {"unspent_outputs":[{"address":"...","output_ids":[...]}]}
+static int sim_unspent_outputs(ledger_sim_t* sim, cJSON* req, byte_buf_t* response) {
+  cJSON* j_addrs = cJSON_GetObjectItemCaseSensitive(req, "addresses");
+  if (!cJSON_IsArray(j_addrs)) {
+    return sim_error(sim, response, "invalid addresses");
+  }
+  int count = cJSON_GetArraySize(j_addrs);
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  for (int i = 0; i < count; i++) {
+    cJSON* j_addr = cJSON_GetArrayItem(j_addrs, i);
+    if (!cJSON_IsString(j_addr) || !address_from_base58(j_addr->valuestring, addr)) {
+      return sim_error(sim, response, "invalid address");
+    }
+  }
+
+  int64_t now = sim_now_ms();
+  json_writer_t w;
+  json_writer_init(&w, response, 32 + count * (JSON_WRITER_ADDRESS_SIZE + 32));
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "unspent_outputs");
+  json_writer_array_begin(&w);
+  for (int i = 0; i < count; i++) {
+    char const* addr_str = cJSON_GetArrayItem(j_addrs, i)->valuestring;
+    address_from_base58(addr_str, addr);
+    json_writer_object_begin(&w);
+    json_writer_key(&w, "address");
+    json_writer_string(&w, addr_str);
+    json_writer_key(&w, "output_ids");
+    json_writer_array_begin(&w);
+    sim_addr_t* a = NULL;
+    HASH_FIND(hh, sim->addrs, addr, TANGLE_ADDRESS_BYTES, a);
+    if (a) {
+      sim_output_t *o, *o_tmp;
+      HASH_ITER(hh, a->outputs, o, o_tmp) { sim_write_output(&w, addr, o, now); }
+    }
+    json_writer_array_end(&w);
+    json_writer_object_end(&w);
+  }
+  json_writer_array_end(&w);
+  json_writer_object_end(&w);
+  return sim_end(&w);
+}
+
+// a transaction in bytes, the layout of tx_2_base64()
+typedef struct {
+  byte_t const* inputs;  // output IDs
+  uint32_t input_count;
+  byte_t const* outputs;  // address, balance count, and balances of each output
+  uint32_t output_count;
+  size_t essence_len;
+  ed_signature_t* signatures;  // verified signatures by address
+} sim_tx_t;
+
+static bool sim_read_u32(byte_t const** p, byte_t const* end, uint32_t* v) {
+  if (end - *p < (ptrdiff_t)sizeof(uint32_t)) {
+    return false;
+  }
+  memcpy(v, *p, sizeof(uint32_t));
+  *p += sizeof(uint32_t);
+  return true;
+}
+
+static bool sim_skip(byte_t const** p, byte_t const* end, uint64_t len) {
+  if ((uint64_t)(end - *p) < len) {
+    return false;
+  }
+  *p += len;
+  return true;
+}
+
+// parses a transaction and verifies its signatures, returns an error message on failure
+static char const* sim_tx_parse(byte_t const tx[], size_t len, sim_tx_t* t) {
+  byte_t const* p = tx;
+  byte_t const* end = tx + len;
+  uint32_t n = 0;
+
+  if (!sim_read_u32(&p, end, &t->input_count) || t->input_count == 0) {
+    return "no inputs";
+  }
+  t->inputs = p;
+  if (!sim_skip(&p, end, (uint64_t)t->input_count * TX_OUTPUT_ID_BYTES)) {
+    return "truncated inputs";
+  }
+  if (!sim_read_u32(&p, end, &t->output_count) || t->output_count == 0) {
+    return "no outputs";
+  }
+  t->outputs = p;
+  for (uint32_t i = 0; i < t->output_count; i++) {
+    if (!sim_skip(&p, end, TANGLE_ADDRESS_BYTES) || !sim_read_u32(&p, end, &n) || n == 0 ||
+        !sim_skip(&p, end, (uint64_t)n * (sizeof(int64_t) + BALANCE_COLOR_BYTES))) {
+      return "invalid outputs";
+    }
+  }
+  // the payload
+  if (!sim_read_u32(&p, end, &n) || !sim_skip(&p, end, n)) {
+    return "invalid payload";
+  }
+  t->essence_len = p - tx;
+
+  // signatures until a zero byte
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  while (p < end && *p != 0) {
+    if (*p != ADDRESS_VER_ED25519 || end - p < SIM_SIGNATURE_BYTES) {
+      return "invalid signature";
+    }
+    byte_t* pub = (byte_t*)p + 1;
+    byte_t* sig = pub + ED_PUBLIC_KEY_BYTES;
+    if (!sign_verify_signature(sig, tx, t->essence_len, pub)) {
+      return "invalid signature";
+    }
+    // the address of the public key
+    addr[0] = ADDRESS_VER_ED25519;
+    crypto_generichash(addr + 1, TANGLE_ADDRESS_BYTES - 1, pub, ED_PUBLIC_KEY_BYTES, NULL, 0);
+    if (ed_signatures_find(&t->signatures, addr) == NULL && ed_signatures_add(&t->signatures, addr, pub, sig) != 0) {
+      return "invalid signature";
+    }
+    p += SIM_SIGNATURE_BYTES;
+  }
+  if (p + 1 != end) {
+    return "invalid signatures";
+  }
+  return NULL;
+}
+
+// adds balances in transaction bytes to the sums by color
+static int sim_sum_add(balance_ht_t** sums, byte_t const color[], int64_t value) {
+  balance_ht_t* sum = balance_ht_find(sums, color);
+  if (sum == NULL) {
+    return balance_ht_add(sums, color, value);
+  }
+  if (value > INT64_MAX - sum->value) {
+    return -1;
+  }
+  sum->value += value;
+  return 0;
+}
+
+// checks the inputs and outputs of a parsed transaction against the ledger, returns an error message on failure
+static char const* sim_tx_check(ledger_sim_t* sim, sim_tx_t const* t) {
+  char const* err = NULL;
+  balance_ht_t* in_sums = balance_ht_init();
+  balance_ht_t* out_sums = balance_ht_init();
+
+  for (uint32_t i = 0; i < t->input_count && err == NULL; i++) {
+    byte_t const* input = t->inputs + (size_t)i * TX_OUTPUT_ID_BYTES;
+    sim_output_t* o = sim_output_find(sim, input, NULL);
+    if (o == NULL) {
+      err = "input not found or spent";
+    } else if (ed_signatures_find((ed_signature_t**)&t->signatures, input) == NULL) {
+      err = "input not signed";
+    }
+    for (uint32_t j = 0; j < i && err == NULL; j++) {
+      if (memcmp(input, t->inputs + (size_t)j * TX_OUTPUT_ID_BYTES, TX_OUTPUT_ID_BYTES) == 0) {
+        err = "duplicate input";
+      }
+    }
+    balance_ht_t *bal, *bal_tmp;
+    if (err == NULL) {
+      HASH_ITER(hh, o->balances, bal, bal_tmp) {
+        if (sim_sum_add(&in_sums, bal->color, bal->value) != 0) {
+          err = "invalid input balance";
+        }
+      }
+    }
+  }
+
+  byte_t const* p = t->outputs;
+  for (uint32_t i = 0; i < t->output_count && err == NULL; i++) {
+    byte_t const* addr = p;
+    for (byte_t const* q = t->outputs; q < addr && err == NULL;) {
+      uint32_t n = 0;
+      if (memcmp(q, addr, TANGLE_ADDRESS_BYTES) == 0) {
+        err = "duplicate output address";
+      }
+      memcpy(&n, q + TANGLE_ADDRESS_BYTES, sizeof(n));
+      q += TANGLE_ADDRESS_BYTES + sizeof(n) + (size_t)n * (sizeof(int64_t) + BALANCE_COLOR_BYTES);
+    }
+    uint32_t n = 0;
+    memcpy(&n, p + TANGLE_ADDRESS_BYTES, sizeof(n));
+    p += TANGLE_ADDRESS_BYTES + sizeof(n);
+    for (uint32_t j = 0; j < n && err == NULL; j++) {
+      int64_t value = 0;
+      memcpy(&value, p, sizeof(value));
+      if (value <= 0 || sim_sum_add(&out_sums, p + sizeof(value), value) != 0) {
+        err = "invalid output balance";
+      }
+      p += sizeof(value) + BALANCE_COLOR_BYTES;
+    }
+  }
+
+  // outputs spend exactly the inputs, color by color
+  if (err == NULL) {
+    balance_ht_t *bal, *bal_tmp;
+    if (balance_ht_count(&in_sums) != balance_ht_count(&out_sums)) {
+      err = "unbalanced transaction";
+    }
+    HASH_ITER(hh, in_sums, bal, bal_tmp) {
+      balance_ht_t* out = balance_ht_find(&out_sums, bal->color);
+      if (out == NULL || out->value != bal->value) {
+        err = "unbalanced transaction";
+      }
+    }
+  }
+  balance_ht_free(&in_sums);
+  balance_ht_free(&out_sums);
+  return err;
+}
+
+// spends the inputs of a checked transaction and adds its outputs
+static int sim_tx_apply(ledger_sim_t* sim, sim_tx_t const* t, byte_t const tx_id[]) {
+  for (uint32_t i = 0; i < t->input_count; i++) {
+    sim_addr_t* a = NULL;
+    sim_output_t* o = sim_output_find(sim, t->inputs + (size_t)i * TX_OUTPUT_ID_BYTES, &a);
+    sim_output_remove(sim, a, o);
+  }
+
+  int64_t confirm_at = sim->conf.confirm_ms ? sim_now_ms() + sim->conf.confirm_ms : 0;
+  byte_t const* p = t->outputs;
+  for (uint32_t i = 0; i < t->output_count; i++) {
+    byte_t const* addr = p;
+    uint32_t n = 0;
+    memcpy(&n, p + TANGLE_ADDRESS_BYTES, sizeof(n));
+    p += TANGLE_ADDRESS_BYTES + sizeof(n);
+    balance_ht_t* balances = balance_ht_init();
+    for (uint32_t j = 0; j < n; j++) {
+      int64_t value = 0;
+      memcpy(&value, p, sizeof(value));
+      sim_sum_add(&balances, p + sizeof(value), value);
+      p += sizeof(value) + BALANCE_COLOR_BYTES;
+    }
+    if (sim_output_add(sim, addr, tx_id, balances, confirm_at) != 0) {
+      balance_ht_free(&balances);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// {"txn_bytes":"..."} -> {"transaction_id":"..."}
+static int sim_send_tx(ledger_sim_t* sim, cJSON* req, byte_buf_t* response) {
+  cJSON* j_tx = cJSON_GetObjectItemCaseSensitive(req, "txn_bytes");
+  if (!cJSON_IsString(j_tx)) {
+    return sim_error(sim, response, "invalid txn_bytes");
+  }
+  size_t b64_len = strlen(j_tx->valuestring);
+  size_t tx_len = 0;
+  byte_t* tx = malloc(b64_len / 4 * 3 + 3);
+  if (tx == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  if (base64_decode(tx, b64_len / 4 * 3 + 3, &tx_len, (unsigned char const*)j_tx->valuestring, b64_len) != 0) {
+    free(tx);
+    sim->stats.rejected++;
+    return sim_error(sim, response, "invalid base64");
+  }
+
+  int ret = 0;
+  sim_tx_t t = {};
+  char const* err = sim_tx_parse(tx, tx_len, &t);
+  if (err == NULL) {
+    err = sim_tx_check(sim, &t);
+  }
+  if (err) {
+    sim->stats.rejected++;
+    ret = sim_error(sim, response, err);
+    goto done;
+  }
+
+  byte_t tx_id[TX_ID_BYTES];
+  char id_str[TX_ID_BASE58_BUF];
+  crypto_generichash(tx_id, TX_ID_BYTES, tx, tx_len, NULL, 0);
+  if (sim_tx_apply(sim, &t, tx_id) != 0) {
+    ret = -1;
+    goto done;
+  }
+  sim->stats.accepted++;
+  tx_id_2_base58(tx_id, id_str);
+  json_writer_t w;
+  json_writer_init(&w, response, 0);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "transaction_id");
+  json_writer_string(&w, id_str);
+  json_writer_object_end(&w);
+  ret = sim_end(&w);
+
+done:
+  ed_signatures_destory(&t.signatures);
+  free(tx);
+  return ret;
+}
+
+static int sim_handler(void* ctx, char const* method, char const* path, byte_t const body[], size_t len,
+                       byte_buf_t* response) {
+  ledger_sim_t* sim = (ledger_sim_t*)ctx;
+
+  // faults are drawn under the lock, the latency is spent outside of it
+  pthread_mutex_lock(&sim->lock);
+  sim->stats.requests++;
+  uint32_t delay_ms = sim->conf.latency_ms;
+  if (sim->conf.jitter_ms) {
+    delay_ms += sim_rand(sim) % (sim->conf.jitter_ms + 1);
+  }
+  bool fail = sim_chance(sim, sim->conf.fail_percent);
+  bool error = !fail && sim_chance(sim, sim->conf.error_percent);
+  if (fail) {
+    sim->stats.failures++;
+  }
+  pthread_mutex_unlock(&sim->lock);
+  if (delay_ms) {
+    usleep(delay_ms * 1000);
+  }
+  if (fail) {
+    return -1;
+  }
+
+  // the body is not null terminated
+  cJSON* req = NULL;
+  if (body) {
+    char* str = malloc(len + 1);
+    if (str == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    memcpy(str, body, len);
+    str[len] = '\0';
+    req = cJSON_Parse(str);
+    free(str);
+  }
+
+  int ret = 0;
+  pthread_mutex_lock(&sim->lock);
+  if (error) {
+    ret = sim_error(sim, response, "injected error");
+  } else if (sim_path_is(path, "info")) {
+    ret = sim_info(sim, response);
+  } else if (req == NULL) {
+    ret = sim_error(sim, response, body ? "invalid JSON" : "not found");
+  } else if (sim_path_is(path, "faucet")) {
+    ret = sim_faucet(sim, req, response);
+  } else if (sim_path_is(path, "value/unspentOutputs")) {
+    ret = sim_unspent_outputs(sim, req, response);
+  } else if (sim_path_is(path, "value/sendTransaction")) {
+    ret = sim_send_tx(sim, req, response);
+  } else {
+    ret = sim_error(sim, response, "not found");
+  }
+  pthread_mutex_unlock(&sim->lock);
+  cJSON_Delete(req);
+  return ret;
+}
+
+void ledger_sim_conf_default(ledger_sim_conf_t* conf) {
+  memset(conf, 0, sizeof(ledger_sim_conf_t));
+  conf->faucet_amount = LEDGER_SIM_FAUCET_AMOUNT;
+  conf->synced = true;
+  conf->seed = 1;
+}
+
+static void sim_set_conf(ledger_sim_t* sim, ledger_sim_conf_t const* conf) {
+  sim->conf = *conf;
+  sim->conf.error_percent = conf->error_percent > 100 ? 100 : conf->error_percent;
+  sim->conf.fail_percent = conf->fail_percent > 100 ? 100 : conf->fail_percent;
+  sim->rand = conf->seed ? conf->seed : 1;
+}
+
+ledger_sim_t* ledger_sim_new(ledger_sim_conf_t const* conf) {
+  ledger_sim_t* sim = malloc(sizeof(ledger_sim_t));
+  if (sim == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(sim, 0, sizeof(ledger_sim_t));
+  if ((sim->transport = http_inproc_new(sim_handler, sim)) == NULL) {
+    free(sim);
+    return NULL;
+  }
+  ledger_sim_conf_t def;
+  if (conf == NULL) {
+    ledger_sim_conf_default(&def);
+    conf = &def;
+  }
+  sim_set_conf(sim, conf);
+  pthread_mutex_init(&sim->lock, NULL);
+  return sim;
+}
+
+void ledger_sim_free(ledger_sim_t* sim) {
+  if (sim) {
+    sim_addr_t *a, *a_tmp;
+    HASH_ITER(hh, sim->addrs, a, a_tmp) {
+      sim_output_t *o, *o_tmp;
+      HASH_ITER(hh, a->outputs, o, o_tmp) { sim_output_remove(sim, a, o); }
+    }
+    http_inproc_free(sim->transport);
+    pthread_mutex_destroy(&sim->lock);
+    free(sim);
+  }
+}
+
+http_transport_t const* ledger_sim_transport(ledger_sim_t* sim) { return sim->transport; }
+
+void ledger_sim_set_conf(ledger_sim_t* sim, ledger_sim_conf_t const* conf) {
+  pthread_mutex_lock(&sim->lock);
+  sim_set_conf(sim, conf);
+  pthread_mutex_unlock(&sim->lock);
+}
+
+int ledger_sim_fund(ledger_sim_t* sim, byte_t const addr[], uint64_t amount) {
+  byte_t tx_id[TX_ID_BYTES];
+  pthread_mutex_lock(&sim->lock);
+  int ret = sim_mint(sim, addr, amount, 0, tx_id);
+  pthread_mutex_unlock(&sim->lock);
+  return ret;
+}
+
+uint64_t ledger_sim_balance(ledger_sim_t* sim, byte_t const addr[], byte_t const color[]) {
+  byte_t iota[BALANCE_COLOR_BYTES] = {};
+  uint64_t sum = 0;
+  pthread_mutex_lock(&sim->lock);
+  sim_addr_t* a = NULL;
+  HASH_FIND(hh, sim->addrs, addr, TANGLE_ADDRESS_BYTES, a);
+  if (a) {
+    sim_output_t *o, *o_tmp;
+    HASH_ITER(hh, a->outputs, o, o_tmp) {
+      balance_ht_t* bal = balance_ht_find(&o->balances, color ? color : iota);
+      sum += bal ? (uint64_t)bal->value : 0;
+    }
+  }
+  pthread_mutex_unlock(&sim->lock);
+  return sum;
+}
+
+void ledger_sim_stats(ledger_sim_t* sim, ledger_sim_stats_t* stats) {
+  pthread_mutex_lock(&sim->lock);
+  *stats = sim->stats;
+  pthread_mutex_unlock(&sim->lock);
+}
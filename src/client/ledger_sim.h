@@ -0,0 +1,125 @@
+#ifndef __CLIENT_LEDGER_SIM_H__
+#define __CLIENT_LEDGER_SIM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "client/network/http.h"
+#include "core/address.h"
+
+/**
+ * @brief An in-process GoShimmer node
+ *
+ * The simulator keeps a UTXO ledger in memory and answers the info, faucet, value/unspentOutputs, and
+ * value/sendTransaction APIs through an in-process transport, client APIs and wallets use it like a real node by
+ * setting the transport of their configuration. Submitted transactions are checked like a node does: inputs must be
+ * unspent, each input needs a valid signature of its address, and outputs must balance inputs by color. Accepted
+ * transactions spend their inputs at once, new outputs are confirmed after the confirmation delay.
+ *
+ * Latency, errors, and confirmations are configurable to run load and regression benchmarks without a network. The
+ * latency is spent in the thread making the request, outside of the ledger lock.
+ *
+ */
+
+// the tokens sent by the faucet by default
+#define LEDGER_SIM_FAUCET_AMOUNT 1337
+
+typedef struct {
+  uint32_t latency_ms;     // the delay of every request
+  uint32_t jitter_ms;      // a random delay added to the latency
+  uint8_t error_percent;   // the share of requests answered with an error response, from 0 to 100
+  uint8_t fail_percent;    // the share of requests failing in the transport, from 0 to 100
+  uint32_t confirm_ms;     // the delay until new outputs are confirmed, 0 confirms at once
+  uint64_t faucet_amount;  // the tokens sent by the faucet
+  bool synced;             // the sync state reported by the info API
+  uint32_t seed;           // the seed of injected delays and errors, runs with the same seed are repeatable
+} ledger_sim_conf_t;
+
+typedef struct {
+  uint64_t requests;  // all requests
+  uint64_t errors;    // requests answered with an error, injected or not
+  uint64_t failures;  // injected transport failures
+  uint64_t faucet;    // faucet requests served
+  uint64_t accepted;  // transactions applied to the ledger
+  uint64_t rejected;  // invalid transactions
+  uint64_t outputs;   // unspent outputs in the ledger
+} ledger_sim_stats_t;
+
+typedef struct ledger_sim_s ledger_sim_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gets the default configuration, a synced node without latency or errors
+ *
+ * @param[out] conf A configuration
+ */
+void ledger_sim_conf_default(ledger_sim_conf_t* conf);
+
+/**
+ * @brief Creates a simulated node with an empty ledger
+ *
+ * @param[in] conf A configuration, NULL for the default one
+ * @return ledger_sim_t* NULL on failed
+ */
+ledger_sim_t* ledger_sim_new(ledger_sim_conf_t const* conf);
+
+/**
+ * @brief Frees a simulated node
+ *
+ * @param[in] sim A simulated node
+ */
+void ledger_sim_free(ledger_sim_t* sim);
+
+/**
+ * @brief Gets the transport serving requests of the simulated node
+ *
+ * @param[in] sim A simulated node
+ * @return http_transport_t const* A transport valid until the node is freed
+ */
+http_transport_t const* ledger_sim_transport(ledger_sim_t* sim);
+
+/**
+ * @brief Changes the configuration, it applies to the next requests
+ *
+ * @param[in] sim A simulated node
+ * @param[in] conf A configuration
+ */
+void ledger_sim_set_conf(ledger_sim_t* sim, ledger_sim_conf_t const* conf);
+
+/**
+ * @brief Adds a confirmed output of IOTA tokens, for example a genesis output
+ *
+ * @param[in] sim A simulated node
+ * @param[in] addr The address owning the output
+ * @param[in] amount The amount of tokens
+ * @return int 0 on success
+ */
+int ledger_sim_fund(ledger_sim_t* sim, byte_t const addr[], uint64_t amount);
+
+/**
+ * @brief Gets the unspent balance of an address, unconfirmed outputs included
+ *
+ * @param[in] sim A simulated node
+ * @param[in] addr An address
+ * @param[in] color A color, NULL for IOTA tokens
+ * @return uint64_t
+ */
+uint64_t ledger_sim_balance(ledger_sim_t* sim, byte_t const addr[], byte_t const color[]);
+
+/**
+ * @brief Gets the counters of the simulated node
+ *
+ * @param[in] sim A simulated node
+ * @param[out] stats The counters
+ */
+void ledger_sim_stats(ledger_sim_t* sim, ledger_sim_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
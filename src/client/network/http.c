@@ -0,0 +1,43 @@
+#include <stdio.h>
+
+#include "client/client_stats.h"
+#include "client/network/http.h"
+
+// collects the response body in a buffer
+static int buf_write_fn(byte_t const data[], size_t len, void* ctx) {
+  if (byte_buf_append((byte_buf_t*)ctx, data, len) == false) {
+    // OOM or NULL data, the transfer is aborted
+    printf("[%s:%d] append data failed\n", __func__, __LINE__);
+    return -1;
+  }
+  return 0;
+}
+
+// performs a request on the transport of the configuration, its timing is recorded for the endpoint
+static int perform(http_client_config_t const* const config, byte_buf_t const* const request, http_write_fn write_fn,
+                   void* ctx) {
+  http_transport_t const* t = config->transport ? config->transport : http_default_transport();
+  http_req_stats_t stats = {};
+  http_client_config_t conf = *config;
+  conf.stats = &stats;
+  int ret = t->perform(t, &conf, request, write_fn, ctx);
+  client_stats_record(config->url, ret, &stats);
+  if (config->stats) {
+    *config->stats = stats;
+  }
+  return ret;
+}
+
+int http_client_post(http_client_config_t const* const config, byte_buf_t const* const request,
+                     byte_buf_t* const response) {
+  return perform(config, request, buf_write_fn, response);
+}
+
+int http_client_post_stream(http_client_config_t const* const config, byte_buf_t const* const request,
+                            http_write_fn write_fn, void* ctx) {
+  return perform(config, request, write_fn, ctx);
+}
+
+int http_client_get(http_client_config_t const* const config, byte_buf_t* const response) {
+  return perform(config, NULL, buf_write_fn, response);
+}
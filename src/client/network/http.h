@@ -7,10 +7,30 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "utils/byte_buffer.h"
 
+// the encodings offered to servers when compression is enabled
+#define HTTP_ACCEPT_ENCODING "gzip, deflate"
+
+// the transfer of a request. Times are microseconds from the start of the request, like curl reports them, each one at
+// least the previous one. Steps a request doesn't take, like the name lookup on a kept connection, take no time.
+typedef struct {
+  uint64_t wire_bytes;     // the response body as received, compressed if the server encoded it
+  uint64_t body_bytes;     // the decoded response body handed to the consumer
+  uint64_t sent_bytes;     // the request body sent
+  bool reused;             // sent over a kept connection, without lookup, connect, or TLS handshake
+  uint64_t lookup_us;      // the host name is resolved
+  uint64_t connect_us;     // the connection is established
+  uint64_t tls_us;         // the TLS handshake is done
+  uint64_t first_byte_us;  // the first byte of the response is received
+  uint64_t total_us;       // the request is complete
+} http_req_stats_t;
+
+typedef struct http_transport_s http_transport_t;
+
 typedef struct {
   char* url;
   char* host;
@@ -20,8 +40,57 @@ typedef struct {
   char* password;
   char const* cert_pem;
   int port;
+  bool compress;            // offers HTTP_ACCEPT_ENCODING, the response is decoded as it arrives
+  http_req_stats_t* stats;  // receives the transfer and the timing of the request, optional
+  http_transport_t const* transport;  // NULL for the default transport
 } http_client_config_t;
 
+// the default number of pooled connections
+#define HTTP_POOL_DEFAULT_SIZE 8
+// the default time a pooled connection is kept open without use
+#define HTTP_POOL_DEFAULT_IDLE_MS 30000
+
+/**
+ * @brief Receives a part of the response body
+ *
+ * @param[in] data The received data
+ * @param[in] len The length of data
+ * @param[in] ctx The context given with the request
+ * @return int 0 to continue, otherwise the transfer is aborted
+ */
+typedef int (*http_write_fn)(byte_t const data[], size_t len, void* ctx);
+
+/**
+ * @brief A way of performing requests
+ *
+ * The default transport is libcurl, the esp http client on ESP32, or the socket transport in SHIMMER_HTTP_SOCKET builds.
+ * Other transports are chosen per request by the configuration, for example an in-process transport without sockets.
+ *
+ */
+struct http_transport_s {
+  char const* name;
+  /**
+   * @brief Performs a request
+   *
+   * @param[in] t The transport
+   * @param[in] config The http configuration
+   * @param[in] request The request body of a POST, NULL for a GET
+   * @param[in] write_fn The function receiving the response body
+   * @param[in] ctx The context of write_fn
+   * @return int 0 on success
+   */
+  int (*perform)(http_transport_t const* t, http_client_config_t const* config, byte_buf_t const* request,
+                 http_write_fn write_fn, void* ctx);
+  void* ctx;  // the state of the transport
+};
+
+typedef struct {
+  size_t idle;     // handles waiting in the pool
+  size_t busy;     // handles checked out by requests
+  size_t created;  // handles created since init
+  size_t reused;   // requests served by a pooled handle
+} http_pool_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -38,6 +107,33 @@ void http_client_init();
  */
 void http_client_clean();
 
+/**
+ * @brief Configures the connection pool
+ *
+ * Requests check out a pooled handle and keep its connection, DNS and TLS session caches alive for the next request.
+ * When all handles are busy, requests wait for one to be checked in. Handles unused for longer than the idle timeout
+ * are closed.
+ *
+ * @param[in] size The maximum number of handles, at least 1
+ * @param[in] idle_ms The idle timeout in milliseconds
+ * @return int 0 on success
+ */
+int http_client_pool_config(size_t size, uint32_t idle_ms);
+
+/**
+ * @brief Gets the connection pool counters
+ *
+ * @param[out] stats The counters
+ */
+void http_client_pool_stats(http_pool_stats_t* stats);
+
+/**
+ * @brief Gets the default transport of the platform
+ *
+ * @return http_transport_t const*
+ */
+http_transport_t const* http_default_transport();
+
 /**
  * @brief Performs http POST
  *
@@ -50,7 +146,16 @@ int http_client_post(http_client_config_t const* const config, byte_buf_t const*
                      byte_buf_t* const response);
 
 /**
+ * @brief Performs http POST and hands the response body over as it arrives
+ *
+ * @param[in] config The http configuration
+ * @param[in] request The request of body
+ * @param[in] write_fn The function receiving the response body
+ * @param[in] ctx The context of write_fn
+ * @return int 0 on success
  */
+int http_client_post_stream(http_client_config_t const* const config, byte_buf_t const* const request,
+                            http_write_fn write_fn, void* ctx);
 
 /**
  * @brief Performs http GET
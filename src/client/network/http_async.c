@@ -0,0 +1,870 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "client/client_stats.h"
+#include "client/network/http_async.h"
+#include "uthash.h"
+
+// curl's multi interface drives requests where it's available. The esp http client and the socket transport have
+// none, requests of ESP32 and SHIMMER_HTTP_SOCKET builds are performed by worker threads of the loop.
+#if !defined(__XTENSA__) && !defined(HTTP_SOCKET_DEFAULT)
+#define HTTP_LOOP_CURL
+#include <curl/curl.h>
+#include <poll.h>
+
+#include "client/network/http_curl.h"
+#else
+#include <pthread.h>
+#endif
+
+// the longest poll() when curl has no timeout set
+#define HTTP_LOOP_MAX_WAIT_MS 100
+
+#ifndef HTTP_LOOP_CURL
+// how often an external event loop checks for requests finished by workers
+#define HTTP_LOOP_WORKER_POLL_MS 10
+// the most worker threads of a loop, they are started as requests are queued
+#define HTTP_LOOP_WORKERS 4
+// how much of a response body a worker receives before the loop takes it over
+#define HTTP_LOOP_CHUNK_BYTES (16 * 1024)
+
+// a first in, first out list of requests
+typedef struct {
+  struct http_req_s* head;
+  struct http_req_s* tail;
+  size_t len;
+} http_req_list_t;
+
+// the requests of workers, the workers and abandoned requests may outlive the loop
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t ready_cond;  // a request has data or is finished
+  pthread_cond_t work_cond;   // a request is queued or the loop is freed
+  pthread_cond_t space_cond;  // the loop took received data over
+  size_t refs;                // the loop and its workers
+  size_t workers;
+  size_t idle;                // workers waiting for a request
+  bool closed;                // the loop is freed, workers exit
+  http_req_list_t queued;     // requests no worker has taken yet
+  http_req_list_t ready;      // requests with data or finished, the loop hasn't taken yet
+} http_work_queue_t;
+#endif
+
+struct http_req_s {
+  http_req_t* self;  // the key of the pending table
+#ifdef HTTP_LOOP_CURL
+  CURL* curl;  // NULL if the request is deferred to another transport
+  struct curl_slist* headers;
+#endif
+  http_transport_t const* transport;  // the transport of a deferred request
+  http_client_config_t config;        // the configuration of a deferred request, the url is a copy
+  byte_buf_t* request;                // the request body of a deferred POST
+  byte_buf_t* response;
+  http_write_fn write_fn;  // receives the response body instead of the buffer if set
+  http_req_stats_t* stats;  // receives the transfer when the request completes
+  http_req_stats_t timing;  // the transfer and timing of the request, recorded for its endpoint
+  uint64_t body_bytes;      // the decoded body delivered so far
+  http_done_cb cb;
+  void* ctx;
+#ifndef HTTP_LOOP_CURL
+  bool threaded;            // handed over to the workers
+  bool abandoned;           // cancelled while a worker performs it, the worker frees it
+  bool stopped;             // the write function failed, the worker aborts the transfer
+  bool listed;              // in the ready list
+  bool finished;            // the worker is done
+  int ret;                  // the result of the worker
+  byte_buf_t* received;     // the body received by the worker, not handed over yet
+  byte_buf_t* spare;        // the body the loop hands over, swapped with received
+  http_work_queue_t* queue;
+  struct http_req_s* next;  // the next request of the queued or the ready list
+#endif
+  UT_hash_handle hh;
+};
+
+#ifdef HTTP_LOOP_CURL
+// a socket curl wants watched
+typedef struct {
+  int fd;
+  int events;
+  UT_hash_handle hh;
+} http_watch_t;
+#endif
+
+struct http_loop_s {
+  http_req_t* reqs;        // pending requests
+  http_watch_fn watch_fn;  // the watch function of an external event loop
+  void* watch_ctx;
+#ifdef HTTP_LOOP_CURL
+  CURLM* multi;
+  http_watch_t* watches;  // watched sockets
+  int64_t deadline_ms;    // when curl wants a timeout action, -1 if no timeout is set
+  struct pollfd* pfds;    // poll() set of http_loop_run()
+  size_t pfds_cap;
+#endif
+  bool stopped;     // http_loop_run() returns early
+  size_t deferred;  // pending requests of other transports
+#ifndef HTTP_LOOP_CURL
+  size_t running;            // requests handed over to workers
+  http_work_queue_t* queue;  // requests of workers
+#endif
+};
+
+static int64_t loop_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#ifdef HTTP_LOOP_CURL
+static int cb_socket_fn(CURL* easy, curl_socket_t s, int what, void* userp, void* socketp) {
+  http_loop_t* loop = (http_loop_t*)userp;
+  int fd = (int)s;
+  int events = 0;
+  if (what == CURL_POLL_IN || what == CURL_POLL_INOUT) {
+    events |= HTTP_EV_IN;
+  }
+  if (what == CURL_POLL_OUT || what == CURL_POLL_INOUT) {
+    events |= HTTP_EV_OUT;
+  }
+
+  http_watch_t* w = NULL;
+  HASH_FIND_INT(loop->watches, &fd, w);
+  if (events == 0) {
+    if (w) {
+      HASH_DEL(loop->watches, w);
+      free(w);
+    }
+  } else {
+    if (w == NULL) {
+      if ((w = malloc(sizeof(http_watch_t))) == NULL) {
+        printf("[%s:%d] OOM\n", __func__, __LINE__);
+        return -1;
+      }
+      w->fd = fd;
+      HASH_ADD_INT(loop->watches, fd, w);
+    }
+    w->events = events;
+  }
+  if (loop->watch_fn) {
+    loop->watch_fn(fd, events, loop->watch_ctx);
+  }
+  return 0;
+}
+
+static int cb_timer_fn(CURLM* multi, long timeout_ms, void* userp) {
+  http_loop_t* loop = (http_loop_t*)userp;
+  loop->deadline_ms = timeout_ms < 0 ? -1 : loop_now_ms() + timeout_ms;
+  return 0;
+}
+#endif
+
+// hands a part of the response body over, returns 0 to continue
+static int req_write(byte_t const data[], size_t len, void* ctx) {
+  http_req_t* req = (http_req_t*)ctx;
+  req->body_bytes += len;
+  if (req->write_fn) {
+    return req->write_fn(data, len, req->ctx);
+  }
+  if (byte_buf_append(req->response, data, len) == false) {
+    printf("[%s:%d] append data failed\n", __func__, __LINE__);
+    return -1;
+  }
+  return 0;
+}
+
+#ifdef HTTP_LOOP_CURL
+static size_t cb_write_fn(void* data, size_t size, size_t nmemb, void* userp) {
+  size_t realsize = size * nmemb;
+  // a short count aborts the transfer
+  return req_write((byte_t const*)data, realsize, userp) == 0 ? realsize : 0;
+}
+#endif
+
+static void req_free(http_req_t* req) {
+#ifdef HTTP_LOOP_CURL
+  if (req->curl) {
+    curl_easy_cleanup(req->curl);
+  }
+  curl_slist_free_all(req->headers);
+#endif
+  byte_buf_free(req->response);
+  byte_buf_free(req->request);
+#ifndef HTTP_LOOP_CURL
+  byte_buf_free(req->received);
+  byte_buf_free(req->spare);
+#endif
+  free(req->config.url);
+  free(req);
+}
+
+// detaches a request from the loop
+static void loop_detach(http_loop_t* loop, http_req_t* req) {
+  HASH_DEL(loop->reqs, req);
+#ifdef HTTP_LOOP_CURL
+  if (req->curl) {
+    curl_multi_remove_handle(loop->multi, req->curl);
+    return;
+  }
+#else
+  if (req->threaded) {
+    loop->running--;
+    return;
+  }
+#endif
+  loop->deferred--;
+}
+
+// completes a detached request, cancelled requests are not recorded
+static void req_done(http_req_t* req, int ret, bool cancelled) {
+  // deferred transports write the timing themselves
+  char const* url = req->config.url;
+#ifdef HTTP_LOOP_CURL
+  if (req->curl) {
+    http_curl_stats(req->curl, req->body_bytes, &req->timing);
+    curl_easy_getinfo(req->curl, CURLINFO_EFFECTIVE_URL, (char**)&url);
+  }
+#endif
+  if (!cancelled) {
+    client_stats_record(url, ret, &req->timing);
+  }
+  if (req->stats) {
+    *req->stats = req->timing;
+  }
+  if (req->cb) {
+    req->cb(ret, req->response, req->ctx);
+  }
+  req_free(req);
+}
+
+#ifdef HTTP_LOOP_CURL
+// invokes callbacks of completed requests
+static void loop_check_done(http_loop_t* loop) {
+  CURLMsg* msg = NULL;
+  int left = 0;
+  while ((msg = curl_multi_info_read(loop->multi, &left)) != NULL) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    http_req_t* req = NULL;
+    CURLcode res = msg->data.result;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+    // detach before the callback, it may start new requests
+    loop_detach(loop, req);
+    if (res != CURLE_OK) {
+      printf("[%s:%d] request failed: %s\n", __func__, __LINE__, curl_easy_strerror(res));
+    }
+    req_done(req, res == CURLE_OK ? 0 : -1, false);
+  }
+}
+#endif
+
+#ifndef HTTP_LOOP_CURL
+static void list_push(http_req_list_t* l, http_req_t* req) {
+  req->next = NULL;
+  if (l->tail) {
+    l->tail->next = req;
+  } else {
+    l->head = req;
+  }
+  l->tail = req;
+  l->len++;
+}
+
+static http_req_t* list_pop(http_req_list_t* l) {
+  http_req_t* req = l->head;
+  if (req) {
+    l->head = req->next;
+    l->tail = l->head ? l->tail : NULL;
+    l->len--;
+  }
+  return req;
+}
+
+static bool list_remove(http_req_list_t* l, http_req_t* req) {
+  http_req_t* prev = NULL;
+  for (http_req_t* r = l->head; r; prev = r, r = r->next) {
+    if (r == req) {
+      if (prev) {
+        prev->next = r->next;
+      } else {
+        l->head = r->next;
+      }
+      l->tail = l->tail == r ? prev : l->tail;
+      l->len--;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void queue_unref(http_work_queue_t* q) {
+  pthread_mutex_lock(&q->lock);
+  bool last = --q->refs == 0;
+  pthread_mutex_unlock(&q->lock);
+  if (last) {
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->ready_cond);
+    pthread_cond_destroy(&q->work_cond);
+    pthread_cond_destroy(&q->space_cond);
+    free(q);
+  }
+}
+
+// puts a request in the ready list, the lock is held
+static void queue_ready(http_work_queue_t* q, http_req_t* req) {
+  if (!req->listed) {
+    req->listed = true;
+    list_push(&q->ready, req);
+    pthread_cond_signal(&q->ready_cond);
+  }
+}
+
+// takes a request from the workers, or leaves it to its worker which frees it
+static bool queue_take(http_work_queue_t* q, http_req_t* req) {
+  pthread_mutex_lock(&q->lock);
+  bool taken = list_remove(&q->queued, req) || req->finished;
+  if (req->listed) {
+    list_remove(&q->ready, req);
+    req->listed = false;
+  }
+  if (!taken) {
+    req->abandoned = true;
+    pthread_cond_broadcast(&q->space_cond);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return taken;
+}
+
+// waits up to a timeout for a ready request
+static void queue_wait(http_work_queue_t* q, long timeout_ms) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+  pthread_mutex_lock(&q->lock);
+  if (q->ready.head == NULL) {
+    pthread_cond_timedwait(&q->ready_cond, &q->lock, &deadline);
+  }
+  pthread_mutex_unlock(&q->lock);
+}
+
+// receives a part of the body on the worker, it waits while the loop hasn't taken the previous parts over
+static int worker_write(byte_t const data[], size_t len, void* ctx) {
+  http_req_t* req = (http_req_t*)ctx;
+  http_work_queue_t* q = req->queue;
+  pthread_mutex_lock(&q->lock);
+  while (!req->abandoned && !req->stopped && req->received->len > 0 &&
+         req->received->len + len > HTTP_LOOP_CHUNK_BYTES) {
+    pthread_cond_wait(&q->space_cond, &q->lock);
+  }
+  int ret = -1;
+  if (req->abandoned || req->stopped) {
+    // aborts the transfer
+  } else if (byte_buf_append(req->received, data, len) == false) {
+    printf("[%s:%d] append data failed\n", __func__, __LINE__);
+  } else {
+    queue_ready(q, req);
+    ret = 0;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ret;
+}
+
+// performs queued requests on the blocking transport until the loop is freed
+static void* worker_fn(void* arg) {
+  http_work_queue_t* q = (http_work_queue_t*)arg;
+  pthread_mutex_lock(&q->lock);
+  for (;;) {
+    while (q->queued.head == NULL && !q->closed) {
+      q->idle++;
+      pthread_cond_wait(&q->work_cond, &q->lock);
+      q->idle--;
+    }
+    http_req_t* req = list_pop(&q->queued);
+    if (req == NULL) {
+      break;
+    }
+    pthread_mutex_unlock(&q->lock);
+    int ret = req->transport->perform(req->transport, &req->config, req->request, worker_write, req);
+
+    pthread_mutex_lock(&q->lock);
+    if (req->abandoned) {
+      req_free(req);
+      continue;
+    }
+    req->ret = ret == 0 ? 0 : -1;
+    req->finished = true;
+    queue_ready(q, req);
+  }
+  q->workers--;
+  pthread_mutex_unlock(&q->lock);
+  queue_unref(q);
+  return NULL;
+}
+
+// hands a deferred request over to the workers, it stays deferred if no worker can be started
+static http_req_t* loop_spawn(http_loop_t* loop, http_req_t* req) {
+  http_work_queue_t* q = loop->queue;
+  if ((req->received = byte_buf_new()) == NULL || (req->spare = byte_buf_new()) == NULL) {
+    return req;
+  }
+  req->queue = q;
+  pthread_mutex_lock(&q->lock);
+  list_push(&q->queued, req);
+  if (q->queued.len > q->idle && q->workers < HTTP_LOOP_WORKERS) {
+    pthread_t tid;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&tid, &attr, worker_fn, q) == 0) {
+      q->workers++;
+      q->refs++;
+    }
+    pthread_attr_destroy(&attr);
+  }
+  // a worker may take the request right away, its flags are set under the lock
+  req->threaded = q->workers > 0;
+  if (req->threaded) {
+    pthread_cond_signal(&q->work_cond);
+  } else {
+    list_remove(&q->queued, req);
+  }
+  pthread_mutex_unlock(&q->lock);
+  if (!req->threaded) {
+    printf("[%s:%d] start worker failed, the request is performed by the loop\n", __func__, __LINE__);
+    return req;
+  }
+  loop->deferred--;
+  loop->running++;
+  return req;
+}
+
+// hands the data of ready requests over and completes the finished ones
+static void loop_collect(http_loop_t* loop) {
+  http_work_queue_t* q = loop->queue;
+  // one at a time, a callback may cancel others
+  for (;;) {
+    pthread_mutex_lock(&q->lock);
+    http_req_t* req = list_pop(&q->ready);
+    bool finished = false;
+    byte_buf_t* data = NULL;
+    if (req) {
+      req->listed = false;
+      finished = req->finished;
+      data = req->received;
+      req->received = req->spare;
+      req->spare = data;
+      pthread_cond_broadcast(&q->space_cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    if (req == NULL) {
+      break;
+    }
+
+    if (data->len > 0 && !req->stopped && req_write(data->data, data->len, req) != 0) {
+      pthread_mutex_lock(&q->lock);
+      req->stopped = true;
+      pthread_cond_broadcast(&q->space_cond);
+      pthread_mutex_unlock(&q->lock);
+    }
+    data->len = 0;
+    if (finished) {
+      loop_detach(loop, req);
+      req_done(req, req->stopped ? -1 : req->ret, false);
+    }
+  }
+}
+#endif
+
+// cancels a pending request, its callback is invoked with an error
+static void loop_cancel(http_loop_t* loop, http_req_t* req) {
+  loop_detach(loop, req);
+#ifndef HTTP_LOOP_CURL
+  if (req->threaded && !queue_take(loop->queue, req)) {
+    // its worker is still running and frees it, the timing isn't known yet
+    if (req->cb) {
+      req->cb(-1, req->response, req->ctx);
+    }
+    return;
+  }
+#endif
+  req_done(req, -1, true);
+}
+
+http_loop_t* http_loop_new() {
+  http_loop_t* loop = malloc(sizeof(http_loop_t));
+  if (loop == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(loop, 0, sizeof(http_loop_t));
+#ifdef HTTP_LOOP_CURL
+  loop->deadline_ms = -1;
+  if ((loop->multi = curl_multi_init()) == NULL) {
+    printf("[%s:%d] curl_multi_init failed\n", __func__, __LINE__);
+    free(loop);
+    return NULL;
+  }
+  curl_multi_setopt(loop->multi, CURLMOPT_SOCKETFUNCTION, cb_socket_fn);
+  curl_multi_setopt(loop->multi, CURLMOPT_SOCKETDATA, loop);
+  curl_multi_setopt(loop->multi, CURLMOPT_TIMERFUNCTION, cb_timer_fn);
+  curl_multi_setopt(loop->multi, CURLMOPT_TIMERDATA, loop);
+#else
+  if ((loop->queue = malloc(sizeof(http_work_queue_t))) == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(loop);
+    return NULL;
+  }
+  memset(loop->queue, 0, sizeof(http_work_queue_t));
+  pthread_mutex_init(&loop->queue->lock, NULL);
+  pthread_cond_init(&loop->queue->ready_cond, NULL);
+  pthread_cond_init(&loop->queue->work_cond, NULL);
+  pthread_cond_init(&loop->queue->space_cond, NULL);
+  loop->queue->refs = 1;
+#endif
+  return loop;
+}
+
+void http_loop_free(http_loop_t* loop) {
+  if (loop) {
+    http_req_t *req, *tmp;
+    HASH_ITER(hh, loop->reqs, req, tmp) { loop_cancel(loop, req); }
+#ifdef HTTP_LOOP_CURL
+    curl_multi_cleanup(loop->multi);
+    http_watch_t *w, *w_tmp;
+    HASH_ITER(hh, loop->watches, w, w_tmp) {
+      HASH_DEL(loop->watches, w);
+      free(w);
+    }
+    free(loop->pfds);
+#else
+    pthread_mutex_lock(&loop->queue->lock);
+    loop->queue->closed = true;
+    pthread_cond_broadcast(&loop->queue->work_cond);
+    pthread_mutex_unlock(&loop->queue->lock);
+    queue_unref(loop->queue);
+#endif
+    free(loop);
+  }
+}
+
+void http_loop_set_watch(http_loop_t* loop, http_watch_fn fn, void* ctx) {
+  loop->watch_fn = fn;
+  loop->watch_ctx = ctx;
+#ifdef HTTP_LOOP_CURL
+  if (fn) {
+    // catch up with sockets already open
+    http_watch_t *w, *tmp;
+    HASH_ITER(hh, loop->watches, w, tmp) { fn(w->fd, w->events, ctx); }
+  }
+#endif
+}
+
+// queues a request of another transport, it's performed by the next timeout action
+static http_req_t* loop_defer(http_loop_t* loop, http_req_t* req, http_client_config_t const* const config,
+                              byte_buf_t const* const request) {
+  req->transport = config->transport ? config->transport : http_default_transport();
+  // only the url is kept, other strings of the configuration may not outlive the call
+  req->config.port = config->port;
+  req->config.compress = config->compress;
+  req->config.stats = &req->timing;
+  req->config.transport = req->transport;
+  if (config->url && (req->config.url = strdup(config->url)) == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    goto err;
+  }
+  if (request) {
+    if ((req->request = byte_buf_new_with_data((byte_t*)request->data, request->len)) == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      goto err;
+    }
+  }
+  HASH_ADD_PTR(loop->reqs, self, req);
+  loop->deferred++;
+  return req;
+
+err:
+  req_free(req);
+  return NULL;
+}
+
+// a request performed by the loop itself, not by curl or a worker
+static bool req_is_deferred(http_req_t const* req) {
+#ifdef HTTP_LOOP_CURL
+  return req->curl == NULL;
+#else
+  return !req->threaded;
+#endif
+}
+
+// performs the deferred requests queued before the call, callbacks may queue new ones
+static void loop_run_deferred(http_loop_t* loop) {
+  size_t n = loop->deferred;
+  while (n-- > 0) {
+    http_req_t *req, *tmp, *found = NULL;
+    HASH_ITER(hh, loop->reqs, req, tmp) {
+      if (req_is_deferred(req)) {
+        found = req;
+        break;
+      }
+    }
+    if (found == NULL) {
+      break;
+    }
+    loop_detach(loop, found);
+    int ret = found->transport->perform(found->transport, &found->config, found->request, req_write, found);
+    req_done(found, ret == 0 ? 0 : -1, false);
+  }
+}
+
+static http_req_t* loop_start(http_loop_t* loop, http_client_config_t const* const config,
+                              byte_buf_t const* const request, http_write_fn write_fn, http_done_cb cb, void* ctx) {
+  http_req_t* req = malloc(sizeof(http_req_t));
+  if (req == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(req, 0, sizeof(http_req_t));
+  req->self = req;
+  req->write_fn = write_fn;
+  req->stats = config->stats;
+  req->cb = cb;
+  req->ctx = ctx;
+  req->response = byte_buf_new();
+  if (req->response == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(req);
+    return NULL;
+  }
+#ifndef HTTP_LOOP_CURL
+  // the default transport is blocking, workers overlap its requests like the multi interface of curl does
+  if (config->transport == NULL || config->transport == http_default_transport()) {
+    req = loop_defer(loop, req, config, request);
+    return req ? loop_spawn(loop, req) : NULL;
+  }
+  return loop_defer(loop, req, config, request);
+#else
+  // other transports have no multi interface, their requests are blocking and run by the loop one at a time
+  if (config->transport && config->transport != http_default_transport()) {
+    return loop_defer(loop, req, config, request);
+  }
+
+  CURLSH* share = http_curl_share();
+  req->curl = curl_easy_init();
+  req->headers = curl_slist_append(NULL, "Content-Type: application/json");
+  if (share == NULL || req->curl == NULL || req->headers == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    goto err;
+  }
+
+  // connections, DNS and TLS sessions are shared with the blocking requests and the other loops
+  curl_easy_setopt(req->curl, CURLOPT_SHARE, share);
+  curl_easy_setopt(req->curl, CURLOPT_URL, config->url);
+  curl_easy_setopt(req->curl, CURLOPT_HTTPHEADER, req->headers);
+  if (request) {
+    curl_easy_setopt(req->curl, CURLOPT_CUSTOMREQUEST, "POST");
+    // request bodies are null terminated by byte_buf2str()
+    size_t len = request->len;
+    if (len > 0 && request->data[len - 1] == '\0') {
+      len--;
+    }
+    curl_easy_setopt(req->curl, CURLOPT_POSTFIELDSIZE, (long)len);
+    curl_easy_setopt(req->curl, CURLOPT_COPYPOSTFIELDS, request->data);
+  } else {
+    curl_easy_setopt(req->curl, CURLOPT_CUSTOMREQUEST, "GET");
+  }
+  curl_easy_setopt(req->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  if (config->compress) {
+    curl_easy_setopt(req->curl, CURLOPT_ACCEPT_ENCODING, HTTP_ACCEPT_ENCODING);
+  }
+  curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, cb_write_fn);
+  curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, (void*)req);
+  curl_easy_setopt(req->curl, CURLOPT_PRIVATE, (void*)req);
+
+  if (curl_multi_add_handle(loop->multi, req->curl) != CURLM_OK) {
+    printf("[%s:%d] curl_multi_add_handle failed\n", __func__, __LINE__);
+    goto err;
+  }
+  HASH_ADD_PTR(loop->reqs, self, req);
+  return req;
+
+err:
+  if (req->curl) {
+    curl_easy_cleanup(req->curl);
+  }
+  curl_slist_free_all(req->headers);
+  byte_buf_free(req->response);
+  free(req);
+  return NULL;
+#endif
+}
+
+http_req_t* http_loop_get(http_loop_t* loop, http_client_config_t const* const config, http_done_cb cb, void* ctx) {
+  return loop_start(loop, config, NULL, NULL, cb, ctx);
+}
+
+http_req_t* http_loop_post(http_loop_t* loop, http_client_config_t const* const config, byte_buf_t const* const request,
+                           http_done_cb cb, void* ctx) {
+  return loop_start(loop, config, request, NULL, cb, ctx);
+}
+
+http_req_t* http_loop_post_stream(http_loop_t* loop, http_client_config_t const* const config,
+                                  byte_buf_t const* const request, http_write_fn write_fn, http_done_cb cb, void* ctx) {
+  return loop_start(loop, config, request, write_fn, cb, ctx);
+}
+
+void http_loop_cancel(http_loop_t* loop, http_req_t* req) {
+  http_req_t* found = NULL;
+  HASH_FIND_PTR(loop->reqs, &req, found);
+  if (found) {
+    loop_cancel(loop, found);
+  }
+}
+
+size_t http_loop_pending(http_loop_t const* loop) { return HASH_COUNT(loop->reqs); }
+
+long http_loop_timeout(http_loop_t const* loop) {
+  if (loop->deferred > 0) {
+    return 0;
+  }
+#ifdef HTTP_LOOP_CURL
+  if (loop->deadline_ms < 0) {
+    return -1;
+  }
+  int64_t now = loop_now_ms();
+  return loop->deadline_ms > now ? (long)(loop->deadline_ms - now) : 0;
+#else
+  if (loop->running == 0) {
+    return -1;
+  }
+  pthread_mutex_lock(&loop->queue->lock);
+  bool ready = loop->queue->ready.head != NULL;
+  pthread_mutex_unlock(&loop->queue->lock);
+  return ready ? 0 : HTTP_LOOP_WORKER_POLL_MS;
+#endif
+}
+
+#ifndef HTTP_LOOP_CURL
+// requests of workers have no sockets to watch
+int http_loop_socket_action(http_loop_t* loop, int fd, int events) {
+  printf("[%s:%d] no socket is watched\n", __func__, __LINE__);
+  return -1;
+}
+
+int http_loop_timeout_action(http_loop_t* loop) {
+  loop_run_deferred(loop);
+  loop_collect(loop);
+  return 0;
+}
+
+int http_loop_run(http_loop_t* loop, uint32_t timeout_ms) {
+  int64_t end = timeout_ms ? loop_now_ms() + timeout_ms : -1;
+  loop->stopped = false;
+  while (http_loop_pending(loop) > 0 && !loop->stopped) {
+    int64_t now = loop_now_ms();
+    if (end >= 0 && now >= end) {
+      break;
+    }
+    http_loop_timeout_action(loop);
+    if (loop->deferred == 0 && loop->running > 0 && !loop->stopped) {
+      long wait = HTTP_LOOP_MAX_WAIT_MS;
+      if (end >= 0 && end - now < wait) {
+        wait = (long)(end - now);
+      }
+      queue_wait(loop->queue, wait);
+    }
+  }
+  return (int)http_loop_pending(loop);
+}
+#else
+int http_loop_socket_action(http_loop_t* loop, int fd, int events) {
+  int ev = 0, running = 0;
+  ev |= (events & HTTP_EV_IN) ? CURL_CSELECT_IN : 0;
+  ev |= (events & HTTP_EV_OUT) ? CURL_CSELECT_OUT : 0;
+  ev |= (events & HTTP_EV_ERR) ? CURL_CSELECT_ERR : 0;
+  CURLMcode rc = curl_multi_socket_action(loop->multi, (curl_socket_t)fd, ev, &running);
+  loop_check_done(loop);
+  if (rc != CURLM_OK) {
+    printf("[%s:%d] %s\n", __func__, __LINE__, curl_multi_strerror(rc));
+    return -1;
+  }
+  return 0;
+}
+
+int http_loop_timeout_action(http_loop_t* loop) {
+  int running = 0;
+  loop_run_deferred(loop);
+  // curl sets a new timeout if it needs one
+  loop->deadline_ms = -1;
+  CURLMcode rc = curl_multi_socket_action(loop->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+  loop_check_done(loop);
+  if (rc != CURLM_OK) {
+    printf("[%s:%d] %s\n", __func__, __LINE__, curl_multi_strerror(rc));
+    return -1;
+  }
+  return 0;
+}
+
+int http_loop_run(http_loop_t* loop, uint32_t timeout_ms) {
+  int64_t end = timeout_ms ? loop_now_ms() + timeout_ms : -1;
+  loop->stopped = false;
+  while (http_loop_pending(loop) > 0 && !loop->stopped) {
+    int64_t now = loop_now_ms();
+    if (end >= 0 && now >= end) {
+      break;
+    }
+
+    size_t n = HASH_COUNT(loop->watches);
+    if (n > loop->pfds_cap) {
+      struct pollfd* pfds = realloc(loop->pfds, sizeof(struct pollfd) * n);
+      if (pfds == NULL) {
+        printf("[%s:%d] OOM\n", __func__, __LINE__);
+        return -1;
+      }
+      loop->pfds = pfds;
+      loop->pfds_cap = n;
+    }
+    size_t i = 0;
+    http_watch_t *w, *tmp;
+    HASH_ITER(hh, loop->watches, w, tmp) {
+      loop->pfds[i].fd = w->fd;
+      loop->pfds[i].events = ((w->events & HTTP_EV_IN) ? POLLIN : 0) | ((w->events & HTTP_EV_OUT) ? POLLOUT : 0);
+      loop->pfds[i].revents = 0;
+      i++;
+    }
+
+    long wait = http_loop_timeout(loop);
+    if (wait < 0 || wait > HTTP_LOOP_MAX_WAIT_MS) {
+      wait = HTTP_LOOP_MAX_WAIT_MS;
+    }
+    if (end >= 0 && end - now < wait) {
+      wait = (long)(end - now);
+    }
+    int ready = poll(loop->pfds, n, (int)wait);
+    if (ready < 0) {
+      printf("[%s:%d] poll failed\n", __func__, __LINE__);
+      return -1;
+    }
+    for (i = 0; ready > 0 && i < n; i++) {
+      short re = loop->pfds[i].revents;
+      if (re) {
+        int events = ((re & POLLIN) ? HTTP_EV_IN : 0) | ((re & POLLOUT) ? HTTP_EV_OUT : 0) |
+                     ((re & (POLLERR | POLLHUP | POLLNVAL)) ? HTTP_EV_ERR : 0);
+        http_loop_socket_action(loop, loop->pfds[i].fd, events);
+        ready--;
+      }
+    }
+    if (http_loop_timeout(loop) == 0) {
+      http_loop_timeout_action(loop);
+    }
+  }
+  return (int)http_loop_pending(loop);
+}
+#endif
+
+void http_loop_stop(http_loop_t* loop) { loop->stopped = true; }
@@ -0,0 +1,185 @@
+#ifndef __CLIENT_NETWORK_HTTP_ASYNC_H__
+#define __CLIENT_NETWORK_HTTP_ASYNC_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "client/network/http.h"
+#include "utils/byte_buffer.h"
+
+/**
+ * @brief Non-blocking http requests
+ *
+ * A loop drives any number of requests on one thread. Requests complete through callbacks, which are invoked from
+ * the thread driving the loop. The loop is either driven by http_loop_run(), or plugged into an existing event loop:
+ * the watch function tells which sockets to poll, http_loop_timeout() tells how long to wait at most, and
+ * http_loop_socket_action() and http_loop_timeout_action() hand the events back to the loop.
+ *
+ * Builds without libcurl have no sockets to watch: up to 4 workers of the loop perform the pending requests with the
+ * blocking transport, and hand the responses over in parts when the loop runs its timeout action.
+ * http_loop_timeout() returns 0 while a part is waiting, and 10 milliseconds while requests are pending otherwise.
+ *
+ * A loop is not thread-safe, all calls must come from the thread driving it. The stats of a configuration are written
+ * when the request completes, they must outlive the request.
+ *
+ */
+
+// the socket is readable, or should be polled for reading
+#define HTTP_EV_IN 0x1
+// the socket is writable, or should be polled for writing
+#define HTTP_EV_OUT 0x2
+// the socket has an error
+#define HTTP_EV_ERR 0x4
+
+typedef struct http_loop_s http_loop_t;
+typedef struct http_req_s http_req_t;
+
+/**
+ * @brief Completes a request
+ *
+ * @param[in] ret 0 on success, -1 on failed or cancelled
+ * @param[in] response The response data, owned by the loop and freed after the callback returns
+ * @param[in] ctx The context given with the request
+ */
+typedef void (*http_done_cb)(int ret, byte_buf_t* response, void* ctx);
+
+/**
+ * @brief Changes the events watched on a socket
+ *
+ * @param[in] fd The socket
+ * @param[in] events HTTP_EV_IN and HTTP_EV_OUT, 0 to stop watching the socket
+ * @param[in] ctx The context given to http_loop_set_watch()
+ */
+typedef void (*http_watch_fn)(int fd, int events, void* ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates a loop
+ *
+ * @return http_loop_t* NULL on failed
+ */
+http_loop_t* http_loop_new();
+
+/**
+ * @brief Frees a loop, pending requests are cancelled
+ *
+ * @param[in] loop A loop
+ */
+void http_loop_free(http_loop_t* loop);
+
+/**
+ * @brief Sets a function watching sockets for an external event loop
+ *
+ * @param[in] loop A loop
+ * @param[in] fn The watch function, NULL to unset
+ * @param[in] ctx The context of the watch function
+ */
+void http_loop_set_watch(http_loop_t* loop, http_watch_fn fn, void* ctx);
+
+/**
+ * @brief Starts a http GET
+ *
+ * @param[in] loop A loop
+ * @param[in] config The http configuration
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return http_req_t* NULL on failed, the callback is not invoked then
+ */
+http_req_t* http_loop_get(http_loop_t* loop, http_client_config_t const* const config, http_done_cb cb, void* ctx);
+
+/**
+ * @brief Starts a http POST, the request body is copied
+ *
+ * @param[in] loop A loop
+ * @param[in] config The http configuration
+ * @param[in] request The request of body
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of the callback
+ * @return http_req_t* NULL on failed, the callback is not invoked then
+ */
+http_req_t* http_loop_post(http_loop_t* loop, http_client_config_t const* const config, byte_buf_t const* const request,
+                           http_done_cb cb, void* ctx);
+
+/**
+ * @brief Starts a http POST that hands the response body over as it arrives
+ *
+ * The response given to the callback is empty. write_fn is invoked by the thread driving the loop, like the callback.
+ *
+ * @param[in] loop A loop
+ * @param[in] config The http configuration
+ * @param[in] request The request of body
+ * @param[in] write_fn The function receiving the response body
+ * @param[in] cb The completion callback
+ * @param[in] ctx The context of write_fn and the callback
+ * @return http_req_t* NULL on failed, the callback is not invoked then
+ */
+http_req_t* http_loop_post_stream(http_loop_t* loop, http_client_config_t const* const config,
+                                  byte_buf_t const* const request, http_write_fn write_fn, http_done_cb cb, void* ctx);
+
+/**
+ * @brief Cancels a pending request, its callback is invoked with an error
+ *
+ * @param[in] loop A loop
+ * @param[in] req A pending request
+ */
+void http_loop_cancel(http_loop_t* loop, http_req_t* req);
+
+/**
+ * @brief Gets the number of pending requests
+ *
+ * @param[in] loop A loop
+ * @return size_t
+ */
+size_t http_loop_pending(http_loop_t const* loop);
+
+/**
+ * @brief Gets the time until the loop needs http_loop_timeout_action()
+ *
+ * @param[in] loop A loop
+ * @return long milliseconds, 0 if it's due, -1 if no timeout is set
+ */
+long http_loop_timeout(http_loop_t const* loop);
+
+/**
+ * @brief Handles events on a socket, completed requests invoke their callbacks
+ *
+ * @param[in] loop A loop
+ * @param[in] fd The socket
+ * @param[in] events HTTP_EV_IN, HTTP_EV_OUT, and HTTP_EV_ERR
+ * @return int 0 on success
+ */
+int http_loop_socket_action(http_loop_t* loop, int fd, int events);
+
+/**
+ * @brief Handles an expired timeout, completed requests invoke their callbacks
+ *
+ * @param[in] loop A loop
+ * @return int 0 on success
+ */
+int http_loop_timeout_action(http_loop_t* loop);
+
+/**
+ * @brief Drives the loop with poll() until all requests are completed
+ *
+ * @param[in] loop A loop
+ * @param[in] timeout_ms The maximum time to run, 0 for no limit
+ * @return int the number of requests still pending, -1 on failed
+ */
+int http_loop_run(http_loop_t* loop, uint32_t timeout_ms);
+
+/**
+ * @brief Makes http_loop_run() return once the current iteration is done, for example from a callback
+ *
+ * @param[in] loop A loop
+ */
+void http_loop_stop(http_loop_t* loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
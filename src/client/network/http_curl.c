@@ -1,71 +1,274 @@
-#ifndef __XTENSA__  // workaround: srcFilter is not working in PlatformIO
+#if !defined(__XTENSA__) && !defined(HTTP_SOCKET_DEFAULT)  // not built on ESP32 or without libcurl
 #include <curl/curl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
 
-#include "client/network/http.h"
+#include "client/network/http_curl.h"
 
-void http_client_clean() { curl_global_cleanup(); }
+// a pooled easy handle
+typedef struct {
+  CURL* curl;
+  uint64_t last_used_ms;
+} http_conn_t;
 
-void http_client_init() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+// easy handles share DNS, TLS sessions and connections, idle handles are kept as a stack so the most recently used
+// connection, which is the most likely to be alive, goes first.
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+  CURLSH* share;
+  http_conn_t* idle;
+  size_t idle_len;
+  size_t size;
+  uint32_t idle_ms;
+  http_pool_stats_t stats;
+} http_pool_t;
 
-static size_t cb_write_fn(void* data, size_t size, size_t nmemb, void* userp) {
-  size_t realsize = size * nmemb;
-  byte_buf_t* mem = (byte_buf_t*)userp;
+static http_pool_t g_pool = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                             .cond = PTHREAD_COND_INITIALIZER,
+                             .size = HTTP_POOL_DEFAULT_SIZE,
+                             .idle_ms = HTTP_POOL_DEFAULT_IDLE_MS};
 
-  if (byte_buf_append(mem, data, realsize) == false) {
-    // OOM or NULL data
-    printf("append data failed\n");
-  }
-  return realsize;
+static uint64_t http_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-int http_client_post(http_client_config_t const* const config, byte_buf_t const* const request,
-                     byte_buf_t* const response) {
-  int ret = 0;
-  CURL* curl = curl_easy_init();
-  struct curl_slist* headers = NULL;
-  if (curl) {
-    curl_easy_setopt(curl, CURLOPT_URL, config->url);
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->data);
+static void share_lock_fn(CURL* handle, curl_lock_data data, curl_lock_access access, void* userp) {
+  pthread_mutex_lock(&g_pool.share_locks[data]);
+}
 
-    /* send all data to this function  */
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, cb_write_fn);
+static void share_unlock_fn(CURL* handle, curl_lock_data data, void* userp) {
+  pthread_mutex_unlock(&g_pool.share_locks[data]);
+}
 
-    /* we pass our 'chunk' struct to the callback function */
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)response);
+// creates the share and the idle stack, the pool lock must be held.
+static int pool_open() {
+  if (g_pool.share) {
+    return 0;
+  }
+  g_pool.idle = malloc(sizeof(http_conn_t) * g_pool.size);
+  g_pool.share = curl_share_init();
+  if (g_pool.idle == NULL || g_pool.share == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(g_pool.idle);
+    g_pool.idle = NULL;
+    if (g_pool.share) {
+      curl_share_cleanup(g_pool.share);
+      g_pool.share = NULL;
+    }
+    return -1;
+  }
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+    pthread_mutex_init(&g_pool.share_locks[i], NULL);
+  }
+  curl_share_setopt(g_pool.share, CURLSHOPT_LOCKFUNC, share_lock_fn);
+  curl_share_setopt(g_pool.share, CURLSHOPT_UNLOCKFUNC, share_unlock_fn);
+  curl_share_setopt(g_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(g_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(g_pool.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+  g_pool.idle_len = 0;
+  memset(&g_pool.stats, 0, sizeof(http_pool_stats_t));
+  return 0;
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    /* Check for errors */
-    if (res != CURLE_OK) {
-      printf("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-      ret = -1;
+// closes idle handles from the bottom of the stack, the pool lock must be held.
+static void pool_close_idle(size_t keep) {
+  size_t drop = g_pool.idle_len > keep ? g_pool.idle_len - keep : 0;
+  for (size_t i = 0; i < drop; i++) {
+    curl_easy_cleanup(g_pool.idle[i].curl);
+  }
+  memmove(g_pool.idle, g_pool.idle + drop, sizeof(http_conn_t) * (g_pool.idle_len - drop));
+  g_pool.idle_len -= drop;
+}
+
+// closes handles unused for longer than the idle timeout, the pool lock must be held.
+static void pool_expire(uint64_t now) {
+  size_t expired = 0;
+  while (expired < g_pool.idle_len && now - g_pool.idle[expired].last_used_ms >= g_pool.idle_ms) {
+    expired++;
+  }
+  pool_close_idle(g_pool.idle_len - expired);
+}
+
+// takes an idle handle or creates one, waits if all handles are busy.
+static CURL* pool_checkout() {
+  CURL* curl = NULL;
+  pthread_mutex_lock(&g_pool.lock);
+  if (pool_open() != 0) {
+    pthread_mutex_unlock(&g_pool.lock);
+    return NULL;
+  }
+  pool_expire(http_now_ms());
+  while (g_pool.idle_len == 0 && g_pool.stats.busy >= g_pool.size) {
+    pthread_cond_wait(&g_pool.cond, &g_pool.lock);
+  }
+  if (g_pool.idle_len > 0) {
+    curl = g_pool.idle[--g_pool.idle_len].curl;
+    g_pool.stats.reused++;
+  } else {
+    curl = curl_easy_init();
+    if (curl == NULL) {
+      printf("[%s:%d] curl_easy_init failed\n", __func__, __LINE__);
+      pthread_mutex_unlock(&g_pool.lock);
+      return NULL;
     }
-    /* always cleanup */
+    g_pool.stats.created++;
+  }
+  g_pool.stats.busy++;
+  g_pool.stats.idle = g_pool.idle_len;
+  CURLSH* share = g_pool.share;
+  long max_age = (long)((g_pool.idle_ms + 999) / 1000);
+  pthread_mutex_unlock(&g_pool.lock);
+
+  // options are reset, connections and caches are kept
+  curl_easy_reset(curl);
+  curl_easy_setopt(curl, CURLOPT_SHARE, share);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, max_age);
+  return curl;
+}
+
+// returns a handle to the pool, closes it if the pool was shrunk meanwhile.
+static void pool_checkin(CURL* curl) {
+  pthread_mutex_lock(&g_pool.lock);
+  g_pool.stats.busy--;
+  if (g_pool.idle_len + g_pool.stats.busy < g_pool.size) {
+    g_pool.idle[g_pool.idle_len].curl = curl;
+    g_pool.idle[g_pool.idle_len].last_used_ms = http_now_ms();
+    g_pool.idle_len++;
+  } else {
     curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-    return ret;
   }
-  return -1;
+  g_pool.stats.idle = g_pool.idle_len;
+  pthread_cond_signal(&g_pool.cond);
+  pthread_mutex_unlock(&g_pool.lock);
+}
+
+CURLSH* http_curl_share() {
+  pthread_mutex_lock(&g_pool.lock);
+  CURLSH* share = pool_open() == 0 ? g_pool.share : NULL;
+  pthread_mutex_unlock(&g_pool.lock);
+  return share;
+}
+
+void http_client_clean() {
+  pthread_mutex_lock(&g_pool.lock);
+  if (g_pool.share) {
+    pool_close_idle(0);
+    curl_share_cleanup(g_pool.share);
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+      pthread_mutex_destroy(&g_pool.share_locks[i]);
+    }
+    free(g_pool.idle);
+    g_pool.idle = NULL;
+    g_pool.share = NULL;
+  }
+  pthread_mutex_unlock(&g_pool.lock);
+  curl_global_cleanup();
+}
+
+void http_client_init() { curl_global_init(CURL_GLOBAL_DEFAULT); }
+
+int http_client_pool_config(size_t size, uint32_t idle_ms) {
+  if (size == 0) {
+    printf("[%s:%d] invalid pool size\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&g_pool.lock);
+  if (g_pool.share) {
+    // busy handles beyond the new size are closed on checkin
+    pool_close_idle(size);
+    http_conn_t* idle = realloc(g_pool.idle, sizeof(http_conn_t) * size);
+    if (idle == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      pthread_mutex_unlock(&g_pool.lock);
+      return -1;
+    }
+    g_pool.idle = idle;
+    g_pool.stats.idle = g_pool.idle_len;
+  }
+  g_pool.size = size;
+  g_pool.idle_ms = idle_ms;
+  pthread_cond_broadcast(&g_pool.cond);
+  pthread_mutex_unlock(&g_pool.lock);
+  return 0;
+}
+
+void http_client_pool_stats(http_pool_stats_t* stats) {
+  pthread_mutex_lock(&g_pool.lock);
+  *stats = g_pool.stats;
+  pthread_mutex_unlock(&g_pool.lock);
 }
 
-int http_client_get(http_client_config_t const* const config, byte_buf_t* const response) {
+static uint64_t stats_time(CURL* curl, CURLINFO info, uint64_t prev) {
+  curl_off_t us = 0;
+  curl_easy_getinfo(curl, info, &us);
+  return (uint64_t)us > prev ? (uint64_t)us : prev;
+}
+
+void http_curl_stats(CURL* curl, uint64_t body_bytes, http_req_stats_t* stats) {
+  curl_off_t wire = 0, sent = 0;
+  long connects = 0;
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &wire);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &sent);
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+  stats->wire_bytes = (uint64_t)wire;
+  stats->body_bytes = body_bytes;
+  stats->sent_bytes = (uint64_t)sent;
+  stats->reused = connects == 0;
+  // curl reports 0 for steps it didn't take, like the TLS handshake of plain connections
+  stats->lookup_us = stats_time(curl, CURLINFO_NAMELOOKUP_TIME_T, 0);
+  stats->connect_us = stats_time(curl, CURLINFO_CONNECT_TIME_T, stats->lookup_us);
+  stats->tls_us = stats_time(curl, CURLINFO_APPCONNECT_TIME_T, stats->connect_us);
+  stats->first_byte_us = stats_time(curl, CURLINFO_STARTTRANSFER_TIME_T, stats->tls_us);
+  stats->total_us = stats_time(curl, CURLINFO_TOTAL_TIME_T, stats->first_byte_us);
+}
+
+// the target of a response, the decoded body is counted as it's delivered
+typedef struct {
+  http_write_fn fn;
+  void* ctx;
+  uint64_t body_bytes;
+} http_stream_t;
+
+static size_t cb_stream_fn(void* data, size_t size, size_t nmemb, void* userp) {
+  size_t realsize = size * nmemb;
+  http_stream_t* stream = (http_stream_t*)userp;
+  stream->body_bytes += realsize;
+  // a short count aborts the transfer
+  return stream->fn((byte_t const*)data, realsize, stream->ctx) == 0 ? realsize : 0;
+}
+
+// performs a GET, or a POST if a request body is given
+static int curl_perform(http_transport_t const* t, http_client_config_t const* const config,
+                        byte_buf_t const* const request, http_write_fn write_fn, void* ctx) {
   int ret = 0;
-  CURL* curl = curl_easy_init();
+  CURL* curl = pool_checkout();
   struct curl_slist* headers = NULL;
+  http_stream_t stream = {.fn = write_fn, .ctx = ctx};
   if (curl) {
     curl_easy_setopt(curl, CURLOPT_URL, config->url);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
-
     headers = curl_slist_append(headers, "Content-Type: application/json");
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    if (request) {
+      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "POST");
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->data);
+    } else {
+      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "GET");
+    }
+    if (config->compress) {
+      // curl decodes the body before it's handed to the write function
+      curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, HTTP_ACCEPT_ENCODING);
+    }
 
     /* send all data to this function  */
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, cb_write_fn);
-
-    /* we pass our 'chunk' struct to the callback function */
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)response);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, cb_stream_fn);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
 
     CURLcode res = curl_easy_perform(curl);
     /* Check for errors */
@@ -73,12 +276,18 @@ int http_client_get(http_client_config_t const* const config, byte_buf_t* const
       printf("curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
       ret = -1;
     }
-
-    /* always cleanup */
-    curl_easy_cleanup(curl);
+    if (config->stats) {
+      http_curl_stats(curl, stream.body_bytes, config->stats);
+    }
+    /* keep the connection for the next request */
+    pool_checkin(curl);
     curl_slist_free_all(headers);
     return ret;
   }
   return -1;
 }
-#endif
\ No newline at end of file
+
+static http_transport_t const g_curl_transport = {.name = "curl", .perform = curl_perform, .ctx = NULL};
+
+http_transport_t const* http_default_transport() { return &g_curl_transport; }
+#endif
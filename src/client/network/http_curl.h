@@ -0,0 +1,35 @@
+#ifndef __CLIENT_NETWORK_HTTP_CURL_H__
+#define __CLIENT_NETWORK_HTTP_CURL_H__
+
+#include <curl/curl.h>
+
+#include "client/network/http.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gets the transfer and the timing of a completed curl request
+ *
+ * @param[in] curl The easy handle of the request
+ * @param[in] body_bytes The decoded body handed to the consumer
+ * @param[out] stats The transfer and timing
+ */
+void http_curl_stats(CURL* curl, uint64_t body_bytes, http_req_stats_t* stats);
+
+/**
+ * @brief Gets the share of the connection pool
+ *
+ * Easy handles created outside of the pool join its DNS, TLS session and connection caches with CURLOPT_SHARE. The
+ * share is valid until http_client_clean().
+ *
+ * @return CURLSH* NULL on failed
+ */
+CURLSH* http_curl_share();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
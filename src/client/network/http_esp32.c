@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "esp_event.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_system.h"
 #include "esp_tls.h"
@@ -97,45 +98,63 @@ static void init_config(esp_http_client_config_t* esp, http_client_config_t cons
   esp->event_handler = http_event_handler;
 }
 
+// the esp http client doesn't decode compressed bodies, compression is not offered and bodies are sent as they are.
+// It doesn't time the steps of a request either, the response counts as received at the end.
+static void report_stats(http_client_config_t const* const config, size_t sent, size_t len, int64_t start_us) {
+  if (config->stats) {
+    memset(config->stats, 0, sizeof(http_req_stats_t));
+    config->stats->wire_bytes = len;
+    config->stats->body_bytes = len;
+    config->stats->sent_bytes = sent;
+    config->stats->total_us = (uint64_t)(esp_timer_get_time() - start_us);
+    config->stats->first_byte_us = config->stats->total_us;
+  }
+}
+
 void http_client_init() {}
 
 void http_client_clean() {}
 
-int http_client_post(http_client_config_t const* const config, byte_buf_t const* const request,
-                     byte_buf_t* const response) {
-  int ret = 0;
-  esp_http_client_config_t esp_client_conf = {0};
-  init_config(&esp_client_conf, config);
-  esp_client_conf.user_data = (void*)response;
+// the esp http client has no shared connection cache, every request opens its own connection.
+int http_client_pool_config(size_t size, uint32_t idle_ms) { return size > 0 ? 0 : -1; }
 
-  esp_http_client_handle_t client = esp_http_client_init(&esp_client_conf);
-  esp_http_client_set_method(client, HTTP_METHOD_POST);
-  esp_http_client_set_header(client, "Content-Type", "application/json");
-  esp_http_client_set_post_field(client, (char const*)request->data, request->len);
+void http_client_pool_stats(http_pool_stats_t* stats) { memset(stats, 0, sizeof(http_pool_stats_t)); }
 
-  esp_err_t err = esp_http_client_perform(client);
-  if (err != ESP_OK) {
-    ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
-    ret = -1;
-  }
-  esp_http_client_cleanup(client);
-  return ret;
-}
-
-int http_client_get(http_client_config_t const* const config, byte_buf_t* const response) {
+// the esp http client buffers the response, it's handed over at once.
+static int esp_perform(http_transport_t const* t, http_client_config_t const* const config,
+                       byte_buf_t const* const request, http_write_fn write_fn, void* ctx) {
   int ret = 0;
+  byte_buf_t* response = byte_buf_new();
+  if (response == NULL) {
+    return -1;
+  }
   esp_http_client_config_t esp_client_conf = {0};
   init_config(&esp_client_conf, config);
   esp_client_conf.user_data = (void*)response;
 
+  int64_t start_us = esp_timer_get_time();
   esp_http_client_handle_t client = esp_http_client_init(&esp_client_conf);
+  if (request) {
+    esp_http_client_set_method(client, HTTP_METHOD_POST);
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    esp_http_client_set_post_field(client, (char const*)request->data, request->len);
+  }
 
   esp_err_t err = esp_http_client_perform(client);
   if (err != ESP_OK) {
-    ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+    ESP_LOGE(TAG, "HTTP %s request failed: %s", request ? "POST" : "GET", esp_err_to_name(err));
     ret = -1;
   }
-
+  report_stats(config, request ? request->len : 0, response->len, start_us);
   esp_http_client_cleanup(client);
+
+  if (ret == 0 && response->len > 0) {
+    ret = write_fn(response->data, response->len, ctx) == 0 ? 0 : -1;
+  }
+  byte_buf_free(response);
   return ret;
 }
+
+static http_transport_t const g_esp32_transport = {.name = "esp32", .perform = esp_perform, .ctx = NULL};
+
+http_transport_t const* http_default_transport() { return &g_esp32_transport; }
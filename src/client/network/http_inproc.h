@@ -0,0 +1,56 @@
+#ifndef __CLIENT_NETWORK_HTTP_INPROC_H__
+#define __CLIENT_NETWORK_HTTP_INPROC_H__
+
+#include <stdlib.h>
+
+#include "client/network/http.h"
+#include "utils/byte_buffer.h"
+
+/**
+ * @brief An in-process http transport
+ *
+ * Requests are handed to a handler function in the calling thread, no socket is opened. It serves tests, benchmarks,
+ * and simulated nodes through the same client APIs as a real node. The handler must be thread-safe if requests are
+ * made from several threads.
+ *
+ */
+
+/**
+ * @brief Handles a request
+ *
+ * @param[in] ctx The context given to http_inproc_new()
+ * @param[in] method "GET" or "POST"
+ * @param[in] path The path of the url, "/" if the url has none
+ * @param[in] body The request body, NULL for a GET
+ * @param[in] len The length of the request body
+ * @param[out] response The response body
+ * @return int 0 on success, otherwise the request fails
+ */
+typedef int (*http_handler_fn)(void* ctx, char const* method, char const* path, byte_t const body[], size_t len,
+                               byte_buf_t* response);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates an in-process transport
+ *
+ * @param[in] handler The request handler
+ * @param[in] ctx The context of the handler
+ * @return http_transport_t* NULL on failed
+ */
+http_transport_t* http_inproc_new(http_handler_fn handler, void* ctx);
+
+/**
+ * @brief Frees an in-process transport
+ *
+ * @param[in] t An in-process transport
+ */
+void http_inproc_free(http_transport_t* t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
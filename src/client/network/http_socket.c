@@ -0,0 +1,762 @@
+#ifndef __XTENSA__  // workaround: srcFilter is not working in PlatformIO
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "client/network/http_socket.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+#define SOCK_HOST_LEN 256
+#define SOCK_PORT_LEN 8
+
+// a parsed url
+typedef struct {
+  bool https;
+  char host[SOCK_HOST_LEN];  // the name to resolve, IPv6 literals without brackets
+  char port[SOCK_PORT_LEN];
+  bool default_port;
+  char const* target;  // the path and query, points into the url
+  int target_len;
+} sock_url_t;
+
+// a connection and its buffer, bytes from pos to len are received but not consumed yet
+typedef struct {
+  int fd;
+  http_tls_t const* tls_ops;
+  void* tls;  // the TLS session of https connections
+  char host[SOCK_HOST_LEN];
+  char port[SOCK_PORT_LEN];
+  bool https;
+  uint64_t first_byte_us;  // when the first byte of the current response was received, 0 before
+  bool peer_closed;        // the last read ended with the end or a reset of the connection
+  uint64_t last_used_ms;
+  byte_t* buf;
+  size_t cap;
+  size_t pos;
+  size_t len;
+} sock_conn_t;
+
+// idle connections are kept as a stack, the most recently used connection goes first.
+typedef struct {
+  pthread_mutex_t lock;
+  http_socket_conf_t conf;
+  sock_conn_t** idle;
+  size_t idle_len;
+  size_t idle_cap;
+  http_pool_stats_t stats;
+} sock_client_t;
+
+// the framing of a response body
+typedef struct {
+  int status;
+  bool keep_alive;
+  bool chunked;
+  bool has_length;
+  uint64_t length;
+} sock_resp_t;
+
+static uint64_t sock_now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t sock_now_ms() { return sock_now_us() / 1000; }
+
+static int sock_parse_url(char const* url, sock_url_t* u) {
+  memset(u, 0, sizeof(sock_url_t));
+  if (url == NULL) {
+    printf("[%s:%d] invalid url\n", __func__, __LINE__);
+    return -1;
+  }
+  char const* p = url;
+  if (strncasecmp(p, "https://", 8) == 0) {
+    u->https = true;
+    p += 8;
+  } else if (strncasecmp(p, "http://", 7) == 0) {
+    p += 7;
+  } else {
+    printf("[%s:%d] unsupported url: %s\n", __func__, __LINE__, url);
+    return -1;
+  }
+  char const* authority_end = p + strcspn(p, "/?#");
+  char const* host = p;
+  char const* host_end = NULL;
+  char const* port = NULL;
+  if (*host == '[') {
+    host++;
+    host_end = memchr(host, ']', authority_end - host);
+    if (host_end == NULL) {
+      printf("[%s:%d] invalid url: %s\n", __func__, __LINE__, url);
+      return -1;
+    }
+    port = host_end + 1 < authority_end && host_end[1] == ':' ? host_end + 2 : NULL;
+  } else {
+    port = memchr(host, ':', authority_end - host);
+    host_end = port ? port++ : authority_end;
+  }
+  size_t host_len = host_end - host;
+  size_t port_len = port ? (size_t)(authority_end - port) : 0;
+  if (host_len == 0 || host_len >= sizeof(u->host) || port_len >= sizeof(u->port)) {
+    printf("[%s:%d] invalid url: %s\n", __func__, __LINE__, url);
+    return -1;
+  }
+  memcpy(u->host, host, host_len);
+  u->default_port = port_len == 0;
+  if (port_len > 0) {
+    memcpy(u->port, port, port_len);
+  } else {
+    strcpy(u->port, u->https ? "443" : "80");
+  }
+  // the fragment is not sent
+  u->target = authority_end;
+  u->target_len = (int)strcspn(authority_end, "#");
+  return 0;
+}
+
+static void conn_close(sock_conn_t* conn) {
+  if (conn->tls) {
+    conn->tls_ops->close(conn->tls);
+  }
+  if (conn->fd >= 0) {
+    close(conn->fd);
+  }
+  free(conn->buf);
+  free(conn);
+}
+
+static ssize_t conn_read(sock_conn_t* conn, byte_t buf[], size_t len) {
+  if (conn->tls) {
+    return conn->tls_ops->read(conn->tls, buf, len);
+  }
+  ssize_t n = 0;
+  do {
+    n = recv(conn->fd, buf, len, 0);
+  } while (n < 0 && errno == EINTR);
+  return n;
+}
+
+static int conn_write(sock_conn_t* conn, byte_t const data[], size_t len) {
+  while (len > 0) {
+    ssize_t n = 0;
+    if (conn->tls) {
+      n = conn->tls_ops->write(conn->tls, data, len);
+    } else {
+      do {
+        n = send(conn->fd, data, len, MSG_NOSIGNAL);
+      } while (n < 0 && errno == EINTR);
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+// receives more bytes, consumed bytes are dropped to make room. Returns the received length, 0 on the end of the
+// connection, or -1 on errors.
+static ssize_t conn_fill(sock_conn_t* conn) {
+  if (conn->pos == conn->len) {
+    conn->pos = conn->len = 0;
+  } else if (conn->len == conn->cap && conn->pos > 0) {
+    memmove(conn->buf, conn->buf + conn->pos, conn->len - conn->pos);
+    conn->len -= conn->pos;
+    conn->pos = 0;
+  }
+  if (conn->len == conn->cap) {
+    printf("[%s:%d] response line exceeds %zu bytes\n", __func__, __LINE__, conn->cap);
+    return -1;
+  }
+  errno = 0;
+  ssize_t n = conn_read(conn, conn->buf + conn->len, conn->cap - conn->len);
+  // a receive timeout is not a closed connection, the request may have been processed
+  conn->peer_closed = n == 0 || (n < 0 && errno == ECONNRESET);
+  if (n > 0) {
+    conn->len += (size_t)n;
+    conn->first_byte_us = conn->first_byte_us ? conn->first_byte_us : sock_now_us();
+  }
+  return n;
+}
+
+// consumes a line, the line ending is not included in the length. The line is valid until the next read.
+static char* conn_line(sock_conn_t* conn, size_t* line_len) {
+  size_t scanned = 0;
+  for (;;) {
+    byte_t* lf = memchr(conn->buf + conn->pos + scanned, '\n', conn->len - conn->pos - scanned);
+    if (lf) {
+      char* line = (char*)conn->buf + conn->pos;
+      *line_len = (size_t)(lf - (conn->buf + conn->pos));
+      conn->pos += *line_len + 1;
+      if (*line_len > 0 && line[*line_len - 1] == '\r') {
+        (*line_len)--;
+      }
+      return line;
+    }
+    scanned = conn->len - conn->pos;
+    if (conn_fill(conn) <= 0) {
+      return NULL;
+    }
+  }
+}
+
+// hands n bytes of the body to the write function, straight from the buffer
+static int conn_deliver(sock_conn_t* conn, uint64_t n, http_write_fn write_fn, void* ctx, uint64_t* body_bytes) {
+  while (n > 0) {
+    if (conn->pos == conn->len && conn_fill(conn) <= 0) {
+      printf("[%s:%d] response body is incomplete\n", __func__, __LINE__);
+      return -1;
+    }
+    size_t avail = conn->len - conn->pos;
+    size_t part = avail < n ? avail : (size_t)n;
+    if (write_fn(conn->buf + conn->pos, part, ctx) != 0) {
+      printf("[%s:%d] aborted by the write function\n", __func__, __LINE__);
+      return -1;
+    }
+    conn->pos += part;
+    n -= part;
+    *body_bytes += part;
+  }
+  return 0;
+}
+
+// connects with a timeout, the socket is blocking again afterwards
+static int sock_connect_addr(int fd, struct addrinfo const* ai, uint32_t timeout_ms) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  int ret = connect(fd, ai->ai_addr, ai->ai_addrlen);
+  if (ret != 0 && errno == EINPROGRESS) {
+    struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+    int n = 0;
+    do {
+      n = poll(&pfd, 1, timeout_ms ? (int)timeout_ms : -1);
+    } while (n < 0 && errno == EINTR);
+    int err = 0;
+    socklen_t err_len = sizeof(err);
+    ret = n == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0 && err == 0 ? 0 : -1;
+  }
+  fcntl(fd, F_SETFL, flags);
+  return ret;
+}
+
+static int sock_connect(sock_url_t const* u, uint32_t timeout_ms, uint64_t* lookup_us) {
+  struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+  struct addrinfo* res = NULL;
+  int err = getaddrinfo(u->host, u->port, &hints, &res);
+  *lookup_us = sock_now_us();
+  if (err != 0) {
+    printf("[%s:%d] %s: %s\n", __func__, __LINE__, u->host, gai_strerror(err));
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* ai = res; ai && fd < 0; ai = ai->ai_next) {
+    if ((fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) < 0) {
+      continue;
+    }
+    if (sock_connect_addr(fd, ai, timeout_ms) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    printf("[%s:%d] connect to %s:%s failed\n", __func__, __LINE__, u->host, u->port);
+    return -1;
+  }
+
+  // requests are written at once, there is nothing to coalesce
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  struct timeval tv = {.tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+// opens a connection, the time of each step since start_us goes to timing
+static sock_conn_t* conn_open(sock_url_t const* u, http_socket_conf_t const* conf, char const* cert_pem,
+                              uint64_t start_us, http_req_stats_t* timing) {
+  if (u->https && conf->tls == NULL) {
+    printf("[%s:%d] https needs a TLS hook\n", __func__, __LINE__);
+    return NULL;
+  }
+  sock_conn_t* conn = calloc(1, sizeof(sock_conn_t));
+  byte_t* buf = malloc(conf->buf_size);
+  if (conn == NULL || buf == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(conn);
+    free(buf);
+    return NULL;
+  }
+  conn->buf = buf;
+  conn->cap = conf->buf_size;
+  conn->https = u->https;
+  strcpy(conn->host, u->host);
+  strcpy(conn->port, u->port);
+  uint64_t lookup_us = 0;
+  conn->fd = sock_connect(u, conf->timeout_ms, &lookup_us);
+  timing->lookup_us = lookup_us - start_us;
+  timing->connect_us = sock_now_us() - start_us;
+  timing->tls_us = timing->connect_us;
+  if (conn->fd < 0) {
+    conn_close(conn);
+    return NULL;
+  }
+  if (u->https) {
+    conn->tls_ops = conf->tls;
+    if ((conn->tls = conf->tls->connect(conf->tls->ctx, conn->fd, u->host, cert_pem)) == NULL) {
+      printf("[%s:%d] TLS handshake with %s failed\n", __func__, __LINE__, u->host);
+      conn_close(conn);
+      return NULL;
+    }
+    timing->tls_us = sock_now_us() - start_us;
+  }
+  return conn;
+}
+
+// closes idle connections from the bottom of the stack, the lock must be held.
+static void pool_close_idle(sock_client_t* c, size_t keep) {
+  size_t drop = c->idle_len > keep ? c->idle_len - keep : 0;
+  if (drop == 0) {
+    return;
+  }
+  for (size_t i = 0; i < drop; i++) {
+    conn_close(c->idle[i]);
+  }
+  memmove(c->idle, c->idle + drop, sizeof(sock_conn_t*) * (c->idle_len - drop));
+  c->idle_len -= drop;
+  c->stats.idle = c->idle_len;
+}
+
+// takes the most recent idle connection to the server, NULL if there is none
+static sock_conn_t* pool_checkout(sock_client_t* c, sock_url_t const* u, http_socket_conf_t* conf) {
+  sock_conn_t* conn = NULL;
+  pthread_mutex_lock(&c->lock);
+  *conf = c->conf;
+  uint64_t now = sock_now_ms();
+  size_t expired = 0;
+  while (expired < c->idle_len && now - c->idle[expired]->last_used_ms >= c->conf.idle_ms) {
+    expired++;
+  }
+  pool_close_idle(c, c->idle_len - expired);
+  for (size_t i = c->idle_len; i-- > 0;) {
+    sock_conn_t* elm = c->idle[i];
+    if (elm->https == u->https && strcmp(elm->host, u->host) == 0 && strcmp(elm->port, u->port) == 0) {
+      memmove(c->idle + i, c->idle + i + 1, sizeof(sock_conn_t*) * (c->idle_len - i - 1));
+      c->idle_len--;
+      c->stats.idle = c->idle_len;
+      c->stats.busy++;
+      c->stats.reused++;
+      conn = elm;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&c->lock);
+  return conn;
+}
+
+// keeps a connection for the next requests or closes it
+static void pool_checkin(sock_client_t* c, sock_conn_t* conn, bool keep) {
+  pthread_mutex_lock(&c->lock);
+  c->stats.busy--;
+  if (keep && c->idle_len < c->conf.pool_size) {
+    if (c->idle_len == c->idle_cap) {
+      sock_conn_t** idle = realloc(c->idle, sizeof(sock_conn_t*) * c->conf.pool_size);
+      if (idle) {
+        c->idle = idle;
+        c->idle_cap = c->conf.pool_size;
+      }
+    }
+    if (c->idle_len < c->idle_cap) {
+      conn->last_used_ms = sock_now_ms();
+      c->idle[c->idle_len++] = conn;
+      conn = NULL;
+    }
+  }
+  c->stats.idle = c->idle_len;
+  pthread_mutex_unlock(&c->lock);
+  if (conn) {
+    conn_close(conn);
+  }
+}
+
+// writes the request through the connection buffer, small bodies go out with the head in a single write
+static int sock_send_request(sock_conn_t* conn, sock_url_t const* u, byte_t const body[], size_t len) {
+  bool ipv6 = strchr(u->host, ':') != NULL;
+  bool root = u->target_len == 0 || u->target[0] == '?';
+  int n = snprintf((char*)conn->buf, conn->cap,
+                   "%s %s%.*s HTTP/1.1\r\nHost: %s%s%s%s%s\r\nAccept: */*\r\nContent-Type: application/json\r\n",
+                   body ? "POST" : "GET", root ? "/" : "", u->target_len, u->target, ipv6 ? "[" : "", u->host,
+                   ipv6 ? "]" : "", u->default_port ? "" : ":", u->default_port ? "" : u->port);
+  if (n > 0 && (size_t)n < conn->cap) {
+    n += snprintf((char*)conn->buf + n, conn->cap - n, body ? "Content-Length: %zu\r\n\r\n" : "\r\n", len);
+  }
+  if (n < 0 || (size_t)n >= conn->cap) {
+    printf("[%s:%d] request head exceeds %zu bytes\n", __func__, __LINE__, conn->cap);
+    return -1;
+  }
+  size_t head_len = (size_t)n;
+  if (body && len <= conn->cap - head_len) {
+    memcpy(conn->buf + head_len, body, len);
+    head_len += len;
+    body = NULL;
+  }
+  int ret = conn_write(conn, conn->buf, head_len);
+  if (ret == 0 && body) {
+    ret = conn_write(conn, body, len);
+  }
+  conn->pos = conn->len = 0;
+  return ret;
+}
+
+static bool header_is(char const* line, size_t line_len, char const* name, char const** value, size_t* value_len) {
+  size_t name_len = strlen(name);
+  if (line_len <= name_len || line[name_len] != ':' || strncasecmp(line, name, name_len) != 0) {
+    return false;
+  }
+  char const* v = line + name_len + 1;
+  char const* end = line + line_len;
+  while (v < end && (*v == ' ' || *v == '\t')) {
+    v++;
+  }
+  while (end > v && (end[-1] == ' ' || end[-1] == '\t')) {
+    end--;
+  }
+  *value = v;
+  *value_len = (size_t)(end - v);
+  return true;
+}
+
+// parses a number of base 10 or 16 which fills the whole string, signs and overflows are rejected
+static int parse_uint(char const* s, size_t len, int base, uint64_t* value) {
+  uint64_t v = 0;
+  if (len == 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < len; i++) {
+    int d = -1;
+    if (s[i] >= '0' && s[i] <= '9') {
+      d = s[i] - '0';
+    } else if (base == 16 && s[i] >= 'a' && s[i] <= 'f') {
+      d = s[i] - 'a' + 10;
+    } else if (base == 16 && s[i] >= 'A' && s[i] <= 'F') {
+      d = s[i] - 'A' + 10;
+    }
+    if (d < 0 || v > (UINT64_MAX - (uint64_t)d) / (uint64_t)base) {
+      return -1;
+    }
+    v = v * (uint64_t)base + (uint64_t)d;
+  }
+  *value = v;
+  return 0;
+}
+
+// parses "HTTP/1.x NNN" followed by the end of the line or a reason phrase
+static int parse_status_line(char const* line, size_t line_len, int* minor, int* status) {
+  uint64_t code = 0;
+  if (line_len < 12 || strncmp(line, "HTTP/1.", 7) != 0 || line[7] < '0' || line[7] > '9' || line[8] != ' ' ||
+      parse_uint(line + 9, 3, 10, &code) != 0 || (line_len > 12 && line[12] != ' ')) {
+    return -1;
+  }
+  *minor = line[7] - '0';
+  *status = (int)code;
+  return 0;
+}
+
+// reads the status line and headers, informational responses are skipped
+static int sock_read_head(sock_conn_t* conn, sock_resp_t* resp) {
+  size_t line_len = 0;
+  char* line = NULL;
+  do {
+    memset(resp, 0, sizeof(sock_resp_t));
+    if ((line = conn_line(conn, &line_len)) == NULL) {
+      return -1;
+    }
+    int minor = 0;
+    if (parse_status_line(line, line_len, &minor, &resp->status) != 0) {
+      printf("[%s:%d] invalid status line\n", __func__, __LINE__);
+      return -1;
+    }
+    resp->keep_alive = minor >= 1;
+    while ((line = conn_line(conn, &line_len)) != NULL && line_len > 0) {
+      char const* v = NULL;
+      size_t v_len = 0;
+      if (header_is(line, line_len, "Content-Length", &v, &v_len)) {
+        if (parse_uint(v, v_len, 10, &resp->length) != 0) {
+          printf("[%s:%d] invalid content length\n", __func__, __LINE__);
+          return -1;
+        }
+        resp->has_length = true;
+      } else if (header_is(line, line_len, "Transfer-Encoding", &v, &v_len)) {
+        // chunked is the last encoding if it's applied
+        resp->chunked = v_len >= 7 && strncasecmp(v + v_len - 7, "chunked", 7) == 0;
+      } else if (header_is(line, line_len, "Connection", &v, &v_len)) {
+        if (v_len == 5 && strncasecmp(v, "close", 5) == 0) {
+          resp->keep_alive = false;
+        } else if (v_len == 10 && strncasecmp(v, "keep-alive", 10) == 0) {
+          resp->keep_alive = true;
+        }
+      }
+    }
+    if (line == NULL) {
+      return -1;
+    }
+  } while (resp->status >= 100 && resp->status < 200);
+  return 0;
+}
+
+static int sock_read_chunked(sock_conn_t* conn, http_write_fn write_fn, void* ctx, uint64_t* body_bytes) {
+  size_t line_len = 0;
+  char* line = NULL;
+  for (;;) {
+    if ((line = conn_line(conn, &line_len)) == NULL) {
+      return -1;
+    }
+    // the size is followed by the line ending or by chunk extensions
+    size_t digits = 0;
+    while (digits < line_len && line[digits] != ';' && line[digits] != ' ' && line[digits] != '\t') {
+      digits++;
+    }
+    uint64_t size = 0;
+    if (parse_uint(line, digits, 16, &size) != 0) {
+      printf("[%s:%d] invalid chunk size\n", __func__, __LINE__);
+      return -1;
+    }
+    if (size == 0) {
+      break;
+    }
+    if (conn_deliver(conn, size, write_fn, ctx, body_bytes) != 0) {
+      return -1;
+    }
+    if ((line = conn_line(conn, &line_len)) == NULL || line_len != 0) {
+      printf("[%s:%d] invalid chunk end\n", __func__, __LINE__);
+      return -1;
+    }
+  }
+  // trailers end with an empty line
+  while ((line = conn_line(conn, &line_len)) != NULL && line_len > 0) {
+  }
+  return line ? 0 : -1;
+}
+
+// reads the response and decides whether the connection can be kept
+static int sock_read_response(sock_conn_t* conn, http_write_fn write_fn, void* ctx, uint64_t* body_bytes,
+                              bool* keep) {
+  sock_resp_t resp;
+  *keep = false;
+  if (sock_read_head(conn, &resp) != 0) {
+    return -1;
+  }
+  int ret = 0;
+  if (resp.status == 204 || resp.status == 304) {
+    // no body
+  } else if (resp.chunked) {
+    ret = sock_read_chunked(conn, write_fn, ctx, body_bytes);
+  } else if (resp.has_length) {
+    ret = conn_deliver(conn, resp.length, write_fn, ctx, body_bytes);
+  } else {
+    // the body ends with the connection
+    resp.keep_alive = false;
+    ssize_t n = 0;
+    while (ret == 0 && (conn->pos < conn->len || (n = conn_fill(conn)) > 0)) {
+      ret = conn_deliver(conn, conn->len - conn->pos, write_fn, ctx, body_bytes);
+    }
+    ret = ret == 0 && n == 0 ? 0 : -1;
+  }
+  // requests are not pipelined, anything left over breaks the framing of the next response
+  *keep = ret == 0 && resp.keep_alive && conn->pos == conn->len;
+  return ret;
+}
+
+static int sock_perform(http_transport_t const* t, http_client_config_t const* config, byte_buf_t const* request,
+                        http_write_fn write_fn, void* ctx) {
+  sock_client_t* c = (sock_client_t*)t->ctx;
+  sock_url_t u;
+  if (sock_parse_url(config->url, &u) != 0) {
+    return -1;
+  }
+  byte_t const* body = NULL;
+  size_t len = 0;
+  if (request) {
+    body = request->data ? request->data : (byte_t const*)"";
+    len = request->len;
+    // request bodies are null terminated strings
+    if (len > 0 && body[len - 1] == '\0') {
+      len--;
+    }
+  }
+
+  int ret = -1;
+  uint64_t body_bytes = 0;
+  uint64_t start_us = sock_now_us();
+  http_req_stats_t timing = {.sent_bytes = len};
+  for (int attempt = 0; attempt < 2; attempt++) {
+    http_socket_conf_t conf;
+    sock_conn_t* conn = pool_checkout(c, &u, &conf);
+    timing.reused = conn != NULL;
+    if (conn == NULL) {
+      if ((conn = conn_open(&u, &conf, config->cert_pem, start_us, &timing)) == NULL) {
+        break;
+      }
+      pthread_mutex_lock(&c->lock);
+      c->stats.created++;
+      c->stats.busy++;
+      pthread_mutex_unlock(&c->lock);
+    }
+    conn->first_byte_us = 0;
+    conn->peer_closed = false;
+    bool keep = false;
+    bool sent = (ret = sock_send_request(conn, &u, body, len)) == 0;
+    if (sent) {
+      ret = sock_read_response(conn, write_fn, ctx, &body_bytes, &keep);
+    }
+    uint64_t first_byte_us = conn->first_byte_us;
+    bool peer_closed = conn->peer_closed;
+    pool_checkin(c, conn, keep);
+    timing.first_byte_us = first_byte_us ? first_byte_us - start_us : 0;
+    // the server may have closed a pooled connection meanwhile, the request is sent again on a new one. Requests
+    // without an answer for other reasons, like a receive timeout, may have been processed and are not repeated.
+    if (ret == 0 || !timing.reused || first_byte_us || (sent && !peer_closed)) {
+      break;
+    }
+  }
+  if (config->stats) {
+    timing.wire_bytes = body_bytes;
+    timing.body_bytes = body_bytes;
+    timing.total_us = sock_now_us() - start_us;
+    // steps which weren't taken end where the previous one did
+    timing.first_byte_us = timing.first_byte_us > timing.tls_us ? timing.first_byte_us : timing.tls_us;
+    *config->stats = timing;
+  }
+  return ret;
+}
+
+static int client_set_conf(sock_client_t* c, http_socket_conf_t const* conf) {
+  if (conf->buf_size < HTTP_SOCKET_MIN_BUF_SIZE) {
+    printf("[%s:%d] buffer size must be at least %d\n", __func__, __LINE__, HTTP_SOCKET_MIN_BUF_SIZE);
+    return -1;
+  }
+  pthread_mutex_lock(&c->lock);
+  c->conf = *conf;
+  pool_close_idle(c, conf->pool_size);
+  pthread_mutex_unlock(&c->lock);
+  return 0;
+}
+
+static void client_close(sock_client_t* c) {
+  pthread_mutex_lock(&c->lock);
+  pool_close_idle(c, 0);
+  free(c->idle);
+  c->idle = NULL;
+  c->idle_cap = 0;
+  pthread_mutex_unlock(&c->lock);
+}
+
+void http_socket_conf_default(http_socket_conf_t* conf) {
+  conf->pool_size = HTTP_POOL_DEFAULT_SIZE;
+  conf->idle_ms = HTTP_POOL_DEFAULT_IDLE_MS;
+  conf->timeout_ms = HTTP_SOCKET_DEFAULT_TIMEOUT_MS;
+  conf->buf_size = HTTP_SOCKET_DEFAULT_BUF_SIZE;
+  conf->tls = NULL;
+}
+
+http_transport_t* http_socket_new(http_socket_conf_t const* conf) {
+  http_socket_conf_t def;
+  if (conf == NULL) {
+    http_socket_conf_default(&def);
+    conf = &def;
+  }
+  if (conf->buf_size < HTTP_SOCKET_MIN_BUF_SIZE) {
+    printf("[%s:%d] buffer size must be at least %d\n", __func__, __LINE__, HTTP_SOCKET_MIN_BUF_SIZE);
+    return NULL;
+  }
+  http_transport_t* t = malloc(sizeof(http_transport_t) + sizeof(sock_client_t));
+  if (t == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  sock_client_t* c = (sock_client_t*)(t + 1);
+  memset(c, 0, sizeof(sock_client_t));
+  pthread_mutex_init(&c->lock, NULL);
+  c->conf = *conf;
+  t->name = "socket";
+  t->perform = sock_perform;
+  t->ctx = c;
+  return t;
+}
+
+void http_socket_free(http_transport_t* t) {
+  if (t) {
+    sock_client_t* c = (sock_client_t*)t->ctx;
+    client_close(c);
+    pthread_mutex_destroy(&c->lock);
+    free(t);
+  }
+}
+
+int http_socket_set_conf(http_transport_t const* t, http_socket_conf_t const* conf) {
+  if (t == NULL || t->perform != sock_perform || conf == NULL) {
+    printf("[%s:%d] not a socket transport\n", __func__, __LINE__);
+    return -1;
+  }
+  return client_set_conf((sock_client_t*)t->ctx, conf);
+}
+
+void http_socket_stats(http_transport_t const* t, http_pool_stats_t* stats) {
+  sock_client_t* c = (sock_client_t*)t->ctx;
+  pthread_mutex_lock(&c->lock);
+  *stats = c->stats;
+  pthread_mutex_unlock(&c->lock);
+}
+
+#ifdef HTTP_SOCKET_DEFAULT
+// the default transport of builds without libcurl
+static sock_client_t g_client = {.lock = PTHREAD_MUTEX_INITIALIZER,
+                                 .conf = {.pool_size = HTTP_POOL_DEFAULT_SIZE,
+                                          .idle_ms = HTTP_POOL_DEFAULT_IDLE_MS,
+                                          .timeout_ms = HTTP_SOCKET_DEFAULT_TIMEOUT_MS,
+                                          .buf_size = HTTP_SOCKET_DEFAULT_BUF_SIZE}};
+
+static http_transport_t const g_socket_transport = {.name = "socket", .perform = sock_perform, .ctx = &g_client};
+
+void http_client_init() {}
+
+void http_client_clean() { client_close(&g_client); }
+
+int http_client_pool_config(size_t size, uint32_t idle_ms) {
+  if (size == 0) {
+    printf("[%s:%d] invalid pool size\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&g_client.lock);
+  http_socket_conf_t conf = g_client.conf;
+  pthread_mutex_unlock(&g_client.lock);
+  conf.pool_size = size;
+  conf.idle_ms = idle_ms;
+  return client_set_conf(&g_client, &conf);
+}
+
+void http_client_pool_stats(http_pool_stats_t* stats) { http_socket_stats(&g_socket_transport, stats); }
+
+http_transport_t const* http_default_transport() { return &g_socket_transport; }
+#endif
+#endif
@@ -0,0 +1,114 @@
+#ifndef __CLIENT_NETWORK_HTTP_SOCKET_H__
+#define __CLIENT_NETWORK_HTTP_SOCKET_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include "client/network/http.h"
+
+/**
+ * @brief A minimal HTTP/1.1 transport on plain sockets
+ *
+ * It serves builds without libcurl. Connections are kept alive in a pool, responses are delimited by their length,
+ * chunked encoding, or the end of the connection. The response body is handed to the write function straight from the
+ * receive buffer of the connection, it isn't copied or collected. Compression is not offered, the compress option of a
+ * configuration is ignored.
+ *
+ * https urls need a TLS hook, the transport has no TLS library of its own.
+ *
+ * Building with SHIMMER_HTTP_SOCKET makes it the default transport instead of curl, the http_client_pool_* functions
+ * configure it then.
+ *
+ */
+
+// the default connect, send, and receive timeout
+#define HTTP_SOCKET_DEFAULT_TIMEOUT_MS 30000
+// the default receive buffer of a connection, the status line and headers of a response must fit in it
+#define HTTP_SOCKET_DEFAULT_BUF_SIZE 8192
+// requests are written through the buffer of the connection, the request line and headers must fit in it
+#define HTTP_SOCKET_MIN_BUF_SIZE 512
+
+/**
+ * @brief A TLS implementation wrapping connected sockets
+ *
+ * read and write follow recv() and send(): they return the number of bytes transferred, 0 if the peer closed the
+ * session on read, or -1 on errors.
+ *
+ */
+typedef struct {
+  /**
+   * @brief Starts a TLS session on a connected socket
+   *
+   * @param[in] ctx The context of the hook
+   * @param[in] fd A connected socket, it's closed by the transport after close()
+   * @param[in] host The server name to verify
+   * @param[in] cert_pem The CA certificate of the configuration, NULL for the default ones
+   * @return void* A session, NULL on failed
+   */
+  void* (*connect)(void* ctx, int fd, char const* host, char const* cert_pem);
+  ssize_t (*read)(void* session, byte_t buf[], size_t len);
+  ssize_t (*write)(void* session, byte_t const buf[], size_t len);
+  void (*close)(void* session);
+  void* ctx;
+} http_tls_t;
+
+typedef struct {
+  size_t pool_size;       // idle connections kept for the next requests, 0 closes connections after each request
+  uint32_t idle_ms;       // idle connections unused for longer are closed
+  uint32_t timeout_ms;    // the connect, send, and receive timeout, 0 waits without a limit
+  size_t buf_size;        // the buffer of a connection, at least HTTP_SOCKET_MIN_BUF_SIZE
+  http_tls_t const* tls;  // the TLS hook of https urls, NULL if https is not supported
+} http_socket_conf_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gets the default configuration
+ *
+ * @param[out] conf A configuration
+ */
+void http_socket_conf_default(http_socket_conf_t* conf);
+
+/**
+ * @brief Creates a socket transport
+ *
+ * @param[in] conf A configuration, NULL for the default one
+ * @return http_transport_t* NULL on failed
+ */
+http_transport_t* http_socket_new(http_socket_conf_t const* conf);
+
+/**
+ * @brief Closes the connections and frees a socket transport
+ *
+ * @param[in] t A socket transport
+ */
+void http_socket_free(http_transport_t* t);
+
+/**
+ * @brief Changes the configuration, idle connections beyond the new pool size are closed
+ *
+ * @param[in] t A socket transport, the default transport of SHIMMER_HTTP_SOCKET builds included
+ * @param[in] conf A configuration
+ * @return int 0 on success, -1 if t is not a socket transport or conf is invalid
+ */
+int http_socket_set_conf(http_transport_t const* t, http_socket_conf_t const* conf);
+
+/**
+ * @brief Gets the connection counters
+ *
+ * idle and busy count connections, created counts opened connections, reused counts requests served by a pooled
+ * connection.
+ *
+ * @param[in] t A socket transport
+ * @param[out] stats The counters
+ */
+void http_socket_stats(http_transport_t const* t, http_pool_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
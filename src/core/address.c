@@ -6,6 +6,7 @@
 #include "libbase58.h"
 
 #include "core/address.h"
+#include "utils/metrics.h"
 
 static UT_icd const addr_list_icd = {sizeof(address_t), NULL, NULL, NULL};
 
@@ -15,6 +16,7 @@ static void address_from_ed25519(byte_t const seed[], uint64_t index, byte_t add
   byte_t pub_key[ED_PUBLIC_KEY_BYTES];
   byte_t priv_key[ED_PRIVATE_KEY_BYTES];
   address_ed25519_keypair(seed, index, pub_key, priv_key);
+  metric_add(&g_metric_address_derivations, 1);
 
   // digest: blake2b the public key
   byte_t digest[digest_len];
@@ -136,12 +138,15 @@ void sign_signature(byte_t const seed[], uint64_t index, byte_t const data[], ui
 
   // crypto_sign(signature, &sign_len, data, data_len, priv_key);
   crypto_sign_detached(signature, &sign_len, data, data_len, priv_key);
+  metric_add(&g_metric_signatures_created, 1);
 }
 
 bool sign_verify_signature(byte_t signature[], byte_t const data[], size_t data_len, byte_t pub_key[]) {
+  metric_add(&g_metric_signatures_verified, 1);
   if (crypto_sign_verify_detached(signature, data, data_len, pub_key) == 0) {
     return true;
   }
+  metric_add(&g_metric_signature_failures, 1);
   return false;
 }
 
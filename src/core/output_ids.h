@@ -17,6 +17,17 @@ typedef struct {
   bool preferred;
 } inclusion_state_t;
 
+// bit flags of a packed inclusion state, one byte per output.
+#define INCLUSION_SOLID (1 << 0)
+#define INCLUSION_CONFIRMED (1 << 1)
+#define INCLUSION_REJECTED (1 << 2)
+#define INCLUSION_LIKED (1 << 3)
+#define INCLUSION_CONFLICTING (1 << 4)
+#define INCLUSION_FINALIZED (1 << 5)
+#define INCLUSION_PREFERRED (1 << 6)
+
+typedef uint8_t inclusion_bits_t;
+
 /**
  * @brief Output IDs object
  *
@@ -41,6 +52,35 @@ extern "C" {
  */
 static output_ids_t *output_ids_init() { return NULL; }
 
+/**
+ * @brief Packs an inclusion state into bit flags
+ *
+ * @param[in] st An inclusion state object
+ * @return inclusion_bits_t The packed state
+ */
+static inline inclusion_bits_t inclusion_state_pack(inclusion_state_t const *st) {
+  return (st->solid ? INCLUSION_SOLID : 0) | (st->confirmed ? INCLUSION_CONFIRMED : 0) |
+         (st->rejected ? INCLUSION_REJECTED : 0) | (st->liked ? INCLUSION_LIKED : 0) |
+         (st->conflicting ? INCLUSION_CONFLICTING : 0) | (st->finalized ? INCLUSION_FINALIZED : 0) |
+         (st->preferred ? INCLUSION_PREFERRED : 0);
+}
+
+/**
+ * @brief Unpacks bit flags to an inclusion state
+ *
+ * @param[in] bits The packed state
+ * @param[out] st An inclusion state object
+ */
+static inline void inclusion_state_unpack(inclusion_bits_t bits, inclusion_state_t *st) {
+  st->solid = bits & INCLUSION_SOLID;
+  st->confirmed = bits & INCLUSION_CONFIRMED;
+  st->rejected = bits & INCLUSION_REJECTED;
+  st->liked = bits & INCLUSION_LIKED;
+  st->conflicting = bits & INCLUSION_CONFLICTING;
+  st->finalized = bits & INCLUSION_FINALIZED;
+  st->preferred = bits & INCLUSION_PREFERRED;
+}
+
 /**
  * @brief Adds an element to the table
  *
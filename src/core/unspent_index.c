@@ -0,0 +1,129 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/unspent_index.h"
+#include "utils/allocator.h"
+
+static unspent_tx_ref_t *tx_ref_find(unspent_index_t *idx, byte_t const tx_id[]) {
+  unspent_tx_ref_t *ref = NULL;
+  HASH_FIND(hh, idx->by_tx, tx_id, TX_ID_BYTES, ref);
+  return ref;
+}
+
+static int tx_ref_add(unspent_index_t *idx, byte_t const addr[], byte_t const tx_id[]) {
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  memcpy(output_id, addr, TANGLE_ADDRESS_BYTES);
+  memcpy(output_id + TANGLE_ADDRESS_BYTES, tx_id, TX_ID_BYTES);
+
+  unspent_tx_ref_t *ref = tx_ref_find(idx, tx_id);
+  if (ref == NULL) {
+    ref = malloc(sizeof(unspent_tx_ref_t));
+    if (ref == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    memcpy(ref->tx_id, tx_id, TX_ID_BYTES);
+    ref->outputs = tx_inputs_new();
+    HASH_ADD(hh, idx->by_tx, tx_id, TX_ID_BYTES, ref);
+  }
+  tx_inputs_push(ref->outputs, output_id);
+  return 0;
+}
+
+static void tx_ref_del(unspent_index_t *idx, unspent_tx_ref_t *ref) {
+  HASH_DEL(idx->by_tx, ref);
+  tx_inputs_free(ref->outputs);
+  free(ref);
+}
+
+static void tx_ref_remove(unspent_index_t *idx, byte_t const addr[], byte_t const tx_id[]) {
+  unspent_tx_ref_t *ref = tx_ref_find(idx, tx_id);
+  if (ref == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < tx_inputs_len(ref->outputs); i++) {
+    if (memcmp(tx_inputs_at(ref->outputs, i), addr, TANGLE_ADDRESS_BYTES) == 0) {
+      utarray_erase(ref->outputs, i, 1);
+      break;
+    }
+  }
+
+  if (tx_inputs_len(ref->outputs) == 0) {
+    tx_ref_del(idx, ref);
+  }
+}
+
+unspent_index_t *unspent_index_new() {
+  unspent_index_t *idx = malloc(sizeof(unspent_index_t));
+  if (idx == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  idx->by_addr_index = NULL;
+  idx->by_tx = NULL;
+  return idx;
+}
+
+static void unspent_index_clear(unspent_index_t *idx) {
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh_index, idx->by_addr_index, elm, tmp) { HASH_DELETE(hh_index, idx->by_addr_index, elm); }
+
+  unspent_tx_ref_t *ref, *ref_tmp;
+  HASH_ITER(hh, idx->by_tx, ref, ref_tmp) { tx_ref_del(idx, ref); }
+}
+
+void unspent_index_free(unspent_index_t *idx) {
+  if (idx) {
+    unspent_index_clear(idx);
+    free(idx);
+  }
+}
+
+int unspent_index_add(unspent_index_t *idx, unspent_outputs_t *elm) {
+  if (unspent_index_find_by_addr_index(idx, elm->addr_index) == NULL) {
+    HASH_ADD(hh_index, idx->by_addr_index, addr_index, sizeof(elm->addr_index), elm);
+  } else {
+    printf("[%s:%d] address index %" PRIu64 " exists in index\n", __func__, __LINE__, elm->addr_index);
+  }
+
+  output_ids_t *id, *id_tmp;
+  HASH_ITER(hh, elm->ids, id, id_tmp) {
+    if (tx_ref_add(idx, elm->addr, id->id) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void unspent_index_remove(unspent_index_t *idx, unspent_outputs_t *elm) {
+  if (unspent_index_find_by_addr_index(idx, elm->addr_index) == elm) {
+    HASH_DELETE(hh_index, idx->by_addr_index, elm);
+  }
+
+  output_ids_t *id, *id_tmp;
+  HASH_ITER(hh, elm->ids, id, id_tmp) { tx_ref_remove(idx, elm->addr, id->id); }
+}
+
+int unspent_index_rebuild(unspent_index_t *idx, unspent_outputs_t **t) {
+  unspent_index_clear(idx);
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    if (unspent_index_add(idx, elm) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+unspent_outputs_t *unspent_index_find_by_addr_index(unspent_index_t *idx, uint64_t addr_index) {
+  unspent_outputs_t *elm = NULL;
+  HASH_FIND(hh_index, idx->by_addr_index, &addr_index, sizeof(addr_index), elm);
+  return elm;
+}
+
+tx_inputs_t *unspent_index_find_by_tx(unspent_index_t *idx, byte_t const tx_id[]) {
+  unspent_tx_ref_t *ref = tx_ref_find(idx, tx_id);
+  return ref ? ref->outputs : NULL;
+}
@@ -0,0 +1,97 @@
+#ifndef __CORE_UNSPENT_INDEX_H__
+#define __CORE_UNSPENT_INDEX_H__
+
+#include <stdint.h>
+
+#include "core/transaction.h"
+#include "core/unspent_outputs.h"
+#include "uthash.h"
+
+/**
+ * @brief Secondary indices of an unspent output table
+ *
+ * The primary table is keyed by address. The indices map an address index to its entry and a transaction id to the
+ * output ids created by that transaction. Entries are not owned by the index, they must be removed from the index
+ * before removing them from the primary table.
+ *
+ */
+
+// transaction id to output ids
+typedef struct {
+  byte_t tx_id[TX_ID_BYTES];
+  tx_inputs_t *outputs;  // a list of output ids(address + tx id)
+  UT_hash_handle hh;
+} unspent_tx_ref_t;
+
+typedef struct {
+  unspent_outputs_t *by_addr_index;  // uses the hh_index handler of the primary table entries
+  unspent_tx_ref_t *by_tx;
+} unspent_index_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty index
+ *
+ * @return unspent_index_t* NULL on failed
+ */
+unspent_index_t *unspent_index_new();
+
+/**
+ * @brief Frees an index, entries of the primary table are untouched.
+ *
+ * @param[in] idx An index object
+ */
+void unspent_index_free(unspent_index_t *idx);
+
+/**
+ * @brief Adds an entry of the primary table to the indices
+ *
+ * @param[in] idx An index object
+ * @param[in] elm An entry of the primary table
+ * @return int 0 on success
+ */
+int unspent_index_add(unspent_index_t *idx, unspent_outputs_t *elm);
+
+/**
+ * @brief Removes an entry from the indices
+ *
+ * @param[in] idx An index object
+ * @param[in] elm An entry of the primary table
+ */
+void unspent_index_remove(unspent_index_t *idx, unspent_outputs_t *elm);
+
+/**
+ * @brief Drops and rebuilds the indices from the primary table
+ *
+ * @param[in] idx An index object
+ * @param[in] t The primary table
+ * @return int 0 on success
+ */
+int unspent_index_rebuild(unspent_index_t *idx, unspent_outputs_t **t);
+
+/**
+ * @brief Finds an entry by the address index
+ *
+ * @param[in] idx An index object
+ * @param[in] addr_index The index of an address
+ * @return unspent_outputs_t* NULL if not found
+ */
+unspent_outputs_t *unspent_index_find_by_addr_index(unspent_index_t *idx, uint64_t addr_index);
+
+/**
+ * @brief Finds output ids created by a transaction
+ *
+ * @param[in] idx An index object
+ * @param[in] tx_id A transaction id
+ * @return tx_inputs_t* A list of output ids, NULL if not found
+ */
+tx_inputs_t *unspent_index_find_by_tx(unspent_index_t *idx, byte_t const tx_id[]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
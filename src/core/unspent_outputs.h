@@ -14,6 +14,7 @@ typedef struct {
   bool spent;
   output_ids_t *ids;
   UT_hash_handle hh;
+  UT_hash_handle hh_index;  // handler of the address index table, see unspent_index_t
 } unspent_outputs_t;
 
 #ifdef __cplusplus
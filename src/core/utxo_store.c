@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "core/utxo_store.h"
+#include "utils/allocator.h"
+
+#define UTXO_STORE_MIN_CAP 64
+
+// grows an array to the new capacity, returns false on failed.
+static bool grow_array(void **arr, size_t elm_size, size_t new_cap) {
+  void *n = realloc(*arr, elm_size * new_cap);
+  if (n == NULL) {
+    return false;
+  }
+  *arr = n;
+  return true;
+}
+
+static size_t next_cap(size_t cap, size_t needed) {
+  size_t n = cap ? cap : UTXO_STORE_MIN_CAP;
+  while (n < needed) {
+    n *= 2;
+  }
+  return n;
+}
+
+static int reserve_rows(utxo_store_t *s, size_t needed) {
+  if (needed <= s->cap) {
+    return 0;
+  }
+  size_t cap = next_cap(s->cap, needed);
+  if (!grow_array((void **)&s->value, sizeof(s->value[0]), cap) ||
+      !grow_array((void **)&s->color, sizeof(s->color[0]), cap) ||
+      !grow_array((void **)&s->state, sizeof(s->state[0]), cap) ||
+      !grow_array((void **)&s->slot, sizeof(s->slot[0]), cap) ||
+      !grow_array((void **)&s->tx_id, sizeof(s->tx_id[0]), cap)) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  s->cap = cap;
+  return 0;
+}
+
+utxo_store_t *utxo_store_new() {
+  utxo_store_t *s = malloc(sizeof(utxo_store_t));
+  if (s == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(s, 0, sizeof(utxo_store_t));
+  return s;
+}
+
+static void free_color_idx(utxo_store_t *s) {
+  utxo_color_t *elm, *tmp;
+  HASH_ITER(hh, s->color_idx, elm, tmp) {
+    HASH_DEL(s->color_idx, elm);
+    free(elm);
+  }
+}
+
+void utxo_store_free(utxo_store_t *s) {
+  if (s) {
+    free_color_idx(s);
+    free(s->value);
+    free(s->color);
+    free(s->state);
+    free(s->slot);
+    free(s->tx_id);
+    free(s->colors);
+    free(s->slot_addr);
+    free(s->slot_index);
+    free(s);
+  }
+}
+
+void utxo_store_clear(utxo_store_t *s) {
+  free_color_idx(s);
+  s->len = 0;
+  s->color_len = 0;
+  s->slot_len = 0;
+}
+
+bool utxo_store_color_id(utxo_store_t *s, byte_t const color[], uint32_t *id) {
+  utxo_color_t *elm = NULL;
+  HASH_FIND(hh, s->color_idx, color, BALANCE_COLOR_BYTES, elm);
+  if (elm) {
+    *id = elm->id;
+    return true;
+  }
+  return false;
+}
+
+int utxo_store_intern_color(utxo_store_t *s, byte_t const color[], uint32_t *id) {
+  if (utxo_store_color_id(s, color, id)) {
+    return 0;
+  }
+
+  if (s->color_len == s->color_cap) {
+    size_t cap = next_cap(s->color_cap, s->color_len + 1);
+    if (!grow_array((void **)&s->colors, sizeof(s->colors[0]), cap)) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    s->color_cap = cap;
+  }
+
+  utxo_color_t *elm = malloc(sizeof(utxo_color_t));
+  if (elm == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  memcpy(elm->color, color, BALANCE_COLOR_BYTES);
+  elm->id = (uint32_t)s->color_len;
+  HASH_ADD(hh, s->color_idx, color, BALANCE_COLOR_BYTES, elm);
+
+  memcpy(s->colors[s->color_len], color, BALANCE_COLOR_BYTES);
+  s->color_len++;
+  *id = elm->id;
+  return 0;
+}
+
+int utxo_store_add_slot(utxo_store_t *s, byte_t const addr[], uint64_t addr_index, uint32_t *slot) {
+  if (s->slot_len == s->slot_cap) {
+    size_t cap = next_cap(s->slot_cap, s->slot_len + 1);
+    if (!grow_array((void **)&s->slot_addr, sizeof(s->slot_addr[0]), cap) ||
+        !grow_array((void **)&s->slot_index, sizeof(s->slot_index[0]), cap)) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    s->slot_cap = cap;
+  }
+  memcpy(s->slot_addr[s->slot_len], addr, TANGLE_ADDRESS_BYTES);
+  s->slot_index[s->slot_len] = addr_index;
+  *slot = (uint32_t)s->slot_len;
+  s->slot_len++;
+  return 0;
+}
+
+int utxo_store_add(utxo_store_t *s, uint32_t slot, byte_t const tx_id[], byte_t const color[], int64_t value,
+                   inclusion_bits_t state) {
+  uint32_t color_id = 0;
+  if (utxo_store_intern_color(s, color, &color_id) != 0) {
+    return -1;
+  }
+
+  if (reserve_rows(s, s->len + 1) != 0) {
+    return -1;
+  }
+
+  s->value[s->len] = value;
+  s->color[s->len] = color_id;
+  s->state[s->len] = state;
+  s->slot[s->len] = slot;
+  memcpy(s->tx_id[s->len], tx_id, TX_ID_BYTES);
+  s->len++;
+  return 0;
+}
+
+int utxo_store_load(utxo_store_t *s, unspent_outputs_t **t) {
+  utxo_store_clear(s);
+
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    uint32_t slot = 0;
+    if (utxo_store_add_slot(s, elm->addr, elm->addr_index, &slot) != 0) {
+      return -1;
+    }
+
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) {
+      inclusion_bits_t state = inclusion_state_pack(&id->st) | (elm->spent ? UTXO_LOCAL_SPENT : 0);
+      // reserves rows for all balances of this output
+      if (reserve_rows(s, s->len + balance_ht_count(&id->balances)) != 0) {
+        return -1;
+      }
+      balance_ht_t *bal, *bal_tmp;
+      HASH_ITER(hh, id->balances, bal, bal_tmp) {
+        if (utxo_store_add(s, slot, id->id, bal->color, bal->value, state) != 0) {
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+uint64_t utxo_store_balance(utxo_store_t const *s, inclusion_bits_t required, inclusion_bits_t forbidden) {
+  inclusion_bits_t const mask = required | forbidden;
+  int64_t const *value = s->value;
+  inclusion_bits_t const *state = s->state;
+  uint64_t sum = 0;
+  // branch-free, the compiler is able to vectorize it.
+  for (size_t i = 0; i < s->len; i++) {
+    uint64_t hit = (state[i] & mask) == required;
+    sum += (uint64_t)value[i] & (0 - hit);
+  }
+  return sum;
+}
+
+uint64_t utxo_store_balance_with_color(utxo_store_t *s, byte_t const color[], inclusion_bits_t required,
+                                       inclusion_bits_t forbidden) {
+  uint32_t id = 0;
+  if (!utxo_store_color_id(s, color, &id)) {
+    return 0;
+  }
+
+  inclusion_bits_t const mask = required | forbidden;
+  int64_t const *value = s->value;
+  inclusion_bits_t const *state = s->state;
+  uint32_t const *colors = s->color;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < s->len; i++) {
+    uint64_t hit = ((state[i] & mask) == required) & (colors[i] == id);
+    sum += (uint64_t)value[i] & (0 - hit);
+  }
+  return sum;
+}
+
+void utxo_store_balance_by_color(utxo_store_t const *s, inclusion_bits_t required, inclusion_bits_t forbidden,
+                                 uint64_t sums[]) {
+  inclusion_bits_t const mask = required | forbidden;
+  memset(sums, 0, sizeof(uint64_t) * s->color_len);
+  for (size_t i = 0; i < s->len; i++) {
+    uint64_t hit = (s->state[i] & mask) == required;
+    sums[s->color[i]] += (uint64_t)s->value[i] & (0 - hit);
+  }
+}
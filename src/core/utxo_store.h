@@ -0,0 +1,192 @@
+#ifndef __CORE_UTXO_STORE_H__
+#define __CORE_UTXO_STORE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/balance.h"
+#include "core/unspent_outputs.h"
+#include "uthash.h"
+
+/**
+ * @brief A columnar store of unspent outputs
+ *
+ * Each row is one colored balance of an output. Rows are kept in parallel arrays, so aggregations such as balance by
+ * state or by color are tight loops over contiguous memory instead of walking the nested hash tables.
+ *
+ */
+
+// the address is marked as spent locally, it's not an inclusion state from the node.
+#define UTXO_LOCAL_SPENT (1 << 7)
+
+// the state of a spendable output, confirmed and not rejected, conflicting or spent.
+#define UTXO_SPENDABLE_REQUIRED (INCLUSION_CONFIRMED)
+#define UTXO_SPENDABLE_FORBIDDEN (INCLUSION_REJECTED | INCLUSION_CONFLICTING | UTXO_LOCAL_SPENT)
+
+// interned color table
+typedef struct {
+  byte_t color[BALANCE_COLOR_BYTES];
+  uint32_t id;
+  UT_hash_handle hh;
+} utxo_color_t;
+
+typedef struct {
+  // rows
+  size_t len;
+  size_t cap;
+  int64_t *value;               /**< balance value */
+  uint32_t *color;              /**< interned color id */
+  inclusion_bits_t *state;      /**< packed inclusion state and local flags */
+  uint32_t *slot;               /**< address slot */
+  byte_t (*tx_id)[TX_ID_BYTES]; /**< transaction id, cold column */
+  // interned colors
+  size_t color_len;
+  size_t color_cap;
+  byte_t (*colors)[BALANCE_COLOR_BYTES];
+  utxo_color_t *color_idx;
+  // address slots
+  size_t slot_len;
+  size_t slot_cap;
+  byte_t (*slot_addr)[TANGLE_ADDRESS_BYTES];
+  uint64_t *slot_index;
+} utxo_store_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty store
+ *
+ * @return utxo_store_t* NULL on failed
+ */
+utxo_store_t *utxo_store_new();
+
+/**
+ * @brief Frees a store
+ *
+ * @param[in] s A store object
+ */
+void utxo_store_free(utxo_store_t *s);
+
+/**
+ * @brief Removes all rows, slots, and colors, the allocated capacity is kept.
+ *
+ * @param[in] s A store object
+ */
+void utxo_store_clear(utxo_store_t *s);
+
+/**
+ * @brief Interns a color and returns its id
+ *
+ * @param[in] s A store object
+ * @param[in] color A color
+ * @param[out] id The color id
+ * @return int 0 on success
+ */
+int utxo_store_intern_color(utxo_store_t *s, byte_t const color[], uint32_t *id);
+
+/**
+ * @brief Finds the id of an interned color
+ *
+ * @param[in] s A store object
+ * @param[in] color A color
+ * @param[out] id The color id
+ * @return true Found
+ * @return false The color is not in the store
+ */
+bool utxo_store_color_id(utxo_store_t *s, byte_t const color[], uint32_t *id);
+
+/**
+ * @brief Adds an address slot
+ *
+ * @param[in] s A store object
+ * @param[in] addr An address
+ * @param[in] addr_index The index of the address
+ * @param[out] slot The slot of the address
+ * @return int 0 on success
+ */
+int utxo_store_add_slot(utxo_store_t *s, byte_t const addr[], uint64_t addr_index, uint32_t *slot);
+
+/**
+ * @brief Appends a row to the store
+ *
+ * @param[in] s A store object
+ * @param[in] slot The address slot
+ * @param[in] tx_id The transaction id of the output
+ * @param[in] color The color of the balance
+ * @param[in] value The value of the balance
+ * @param[in] state The packed state
+ * @return int 0 on success
+ */
+int utxo_store_add(utxo_store_t *s, uint32_t slot, byte_t const tx_id[], byte_t const color[], int64_t value,
+                   inclusion_bits_t state);
+
+/**
+ * @brief Rebuilds the store from an unspent output table
+ *
+ * Outputs of locally spent addresses are flagged with UTXO_LOCAL_SPENT.
+ *
+ * @param[in] s A store object
+ * @param[in] t An unspent output hash table
+ * @return int 0 on success
+ */
+int utxo_store_load(utxo_store_t *s, unspent_outputs_t **t);
+
+/**
+ * @brief Sums values of rows where all required bits are set and no forbidden bit is set
+ *
+ * @param[in] s A store object
+ * @param[in] required The required state bits
+ * @param[in] forbidden The forbidden state bits
+ * @return uint64_t The sum of balances
+ */
+uint64_t utxo_store_balance(utxo_store_t const *s, inclusion_bits_t required, inclusion_bits_t forbidden);
+
+/**
+ * @brief Sums values of a color where all required bits are set and no forbidden bit is set
+ *
+ * @param[in] s A store object
+ * @param[in] color A specific color
+ * @param[in] required The required state bits
+ * @param[in] forbidden The forbidden state bits
+ * @return uint64_t The sum of balances
+ */
+uint64_t utxo_store_balance_with_color(utxo_store_t *s, byte_t const color[], inclusion_bits_t required,
+                                       inclusion_bits_t forbidden);
+
+/**
+ * @brief Sums values per color in one pass
+ *
+ * @param[in] s A store object
+ * @param[in] required The required state bits
+ * @param[in] forbidden The forbidden state bits
+ * @param[out] sums An array of `color_len` elements, indexed by color id
+ */
+void utxo_store_balance_by_color(utxo_store_t const *s, inclusion_bits_t required, inclusion_bits_t forbidden,
+                                 uint64_t sums[]);
+
+/**
+ * @brief Gets the spendable balance of a color, confirmed and not rejected, conflicting or locally spent
+ *
+ * @param[in] s A store object
+ * @param[in] color A specific color
+ * @return uint64_t The spendable balance
+ */
+static inline uint64_t utxo_store_spendable(utxo_store_t *s, byte_t const color[]) {
+  return utxo_store_balance_with_color(s, color, UTXO_SPENDABLE_REQUIRED, UTXO_SPENDABLE_FORBIDDEN);
+}
+
+/**
+ * @brief Gets the number of rows
+ *
+ * @param[in] s A store object
+ * @return size_t
+ */
+static inline size_t utxo_store_len(utxo_store_t const *s) { return s->len; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,56 @@
 
 #include "utils/allocator.h"
 #include "utils/bitmask.h"
+#include "utils/roaring.h"
+
+#define WORD_INDEX(i) ((i) / BITMASK_WORD_BITS)
+#define BIT_INDEX(i) ((i) % BITMASK_WORD_BITS)
+
+// grows the capacity geometrically to hold the given number of words, new words are clear.
+static int bitmask_reserve(bitmask_t* mask, uint64_t words) {
+  if (words <= mask->cap) {
+    return 0;
+  }
+
+  uint64_t cap = mask->cap ? mask->cap : 1;
+  while (cap < words) {
+    cap *= 2;
+  }
+  uint64_t* n = realloc(mask->words, cap * sizeof(uint64_t));
+  if (!n) {
+    // realloc failed
+    return -1;
+  }
+  // clean bits in new allocated words
+  memset(n + mask->cap, 0, (cap - mask->cap) * sizeof(uint64_t));
+  mask->words = n;
+  mask->cap = cap;
+  return 0;
+}
+
+static void bitmask_word_op(uint64_t* word, uint64_t bits, bitmask_op_t op) {
+  switch (op) {
+    case BITMASK_CLEAR:
+      *word &= ~bits;
+      break;
+    case BITMASK_SET:
+      *word |= bits;
+      break;
+    case BITMASK_TOGGLE:
+      *word ^= bits;
+      break;
+    default:
+      break;
+  }
+}
+
+// bits from the given bit index to the end of the word
+static uint64_t bits_from(uint64_t bit) { return ~UINT64_C(0) << bit; }
+
+// bits from the start of the word to the given bit index, inclusive
+static uint64_t bits_to(uint64_t bit) {
+  return bit == BITMASK_WORD_BITS - 1 ? ~UINT64_C(0) : (UINT64_C(1) << (bit + 1)) - 1;
+}
 
 bitmask_t* bitmask_new() {
   bitmask_t* b = malloc(sizeof(bitmask_t));
@@ -14,93 +64,319 @@ bitmask_t* bitmask_new() {
 
   /* Note: In esp-idf `calloc` is equivalent to `heap_caps_calloc`
   that we use `malloc` and `memset` instead of `calloc`. */
-  // b->byte = calloc(0, 1);
-  b->byte = malloc(1);
-  if (!b->byte) {
-    printf("[%s:%d] calloc failed\n", __func__, __LINE__);
+  b->words = malloc(sizeof(uint64_t));
+  if (!b->words) {
+    printf("[%s:%d] malloc failed\n", __func__, __LINE__);
     free(b);
     return NULL;
   }
-  memset(b->byte, 0, sizeof(byte_t));
+  memset(b->words, 0, sizeof(uint64_t));
   b->cap = 1;
+  b->roaring = NULL;
+  return b;
+}
+
+bitmask_t* bitmask_new_compressed() {
+  bitmask_t* b = malloc(sizeof(bitmask_t));
+  if (!b) {
+    printf("[%s:%d] malloc failed\n", __func__, __LINE__);
+    return NULL;
+  }
+  b->words = NULL;
+  b->cap = 0;
+  b->roaring = roaring_new();
+  if (!b->roaring) {
+    free(b);
+    return NULL;
+  }
   return b;
 }
 
 void bitmask_free(bitmask_t* b) {
   if (b) {
-    if (b->byte) {
-      free(b->byte);
+    if (b->words) {
+      free(b->words);
     }
+    roaring_free(b->roaring);
     free(b);
   }
 }
 
 int bitmask_op(bitmask_t* mask, uint64_t index, bitmask_op_t op) {
-  uint64_t byte_index = index / 8;
-  uint8_t bit_index = index % 8;
-
-  if (byte_index + 1 > mask->cap) {
-    // extand capacity
-    byte_t* n = NULL;
-    n = realloc(mask->byte, byte_index + 1);
-    if (!n) {
-      // realloc failed
+  if (mask->roaring) {
+    return roaring_range_op(mask->roaring, index, 1, op);
+  }
+
+  uint64_t word_index = WORD_INDEX(index);
+  if (word_index >= mask->cap) {
+    if (op == BITMASK_CLEAR) {
+      // bits out of capacity are clear
+      return 0;
+    }
+    if (bitmask_reserve(mask, word_index + 1) != 0) {
       return -1;
     }
-    // clean bits in new allocated bytes
-    memset(n + mask->cap, 0, (byte_index + 1) - mask->cap);
-    mask->byte = n;
-    mask->cap = byte_index + 1;
   }
 
-  switch (op) {
-    case BITMASK_CLEAR:
-      mask->byte[byte_index] &= ~(1 << bit_index);
-      break;
-    case BITMASK_SET:
-      mask->byte[byte_index] |= (1 << bit_index);
-      break;
-    case BITMASK_TOGGLE:
-      mask->byte[byte_index] ^= (1 << bit_index);
-      break;
-    default:
-      break;
+  bitmask_word_op(&mask->words[word_index], UINT64_C(1) << BIT_INDEX(index), op);
+  return 0;
+}
+
+int bitmask_range_op(bitmask_t* mask, uint64_t start, uint64_t count, bitmask_op_t op) {
+  if (count == 0) {
+    return 0;
+  }
+  if (count > UINT64_MAX - start) {
+    printf("[%s:%d] out of range\n", __func__, __LINE__);
+    return -1;
+  }
+  if (mask->roaring) {
+    return roaring_range_op(mask->roaring, start, count, op);
+  }
+
+  uint64_t last = start + count - 1;
+  if (op == BITMASK_CLEAR) {
+    // bits out of capacity are clear
+    if (WORD_INDEX(start) >= mask->cap) {
+      return 0;
+    }
+    if (WORD_INDEX(last) >= mask->cap) {
+      last = mask->cap * BITMASK_WORD_BITS - 1;
+    }
+  } else if (bitmask_reserve(mask, WORD_INDEX(last) + 1) != 0) {
+    return -1;
   }
+
+  uint64_t first_word = WORD_INDEX(start);
+  uint64_t last_word = WORD_INDEX(last);
+  if (first_word == last_word) {
+    bitmask_word_op(&mask->words[first_word], bits_from(BIT_INDEX(start)) & bits_to(BIT_INDEX(last)), op);
+    return 0;
+  }
+
+  bitmask_word_op(&mask->words[first_word], bits_from(BIT_INDEX(start)), op);
+  for (uint64_t w = first_word + 1; w < last_word; w++) {
+    bitmask_word_op(&mask->words[w], ~UINT64_C(0), op);
+  }
+  bitmask_word_op(&mask->words[last_word], bits_to(BIT_INDEX(last)), op);
   return 0;
 }
 
-bool bitmask_get(bitmask_t* mask, uint64_t index) {
-  uint64_t byte_index = index / 8;
-  uint8_t bit_index = index % 8;
-  if (byte_index > mask->cap) {
-    printf("Err[%s:%d] out of range\n", __func__, __LINE__);
+bool bitmask_get(bitmask_t const* mask, uint64_t index) {
+  if (mask->roaring) {
+    return roaring_get(mask->roaring, index);
+  }
+  uint64_t word_index = WORD_INDEX(index);
+  if (word_index >= mask->cap) {
     return false;
   }
-  return mask->byte[byte_index] & (1 << bit_index);
+  return (mask->words[word_index] >> BIT_INDEX(index)) & 1;
+}
+
+uint64_t bitmask_find_next_set(bitmask_t const* mask, uint64_t from) {
+  if (mask->roaring) {
+    return roaring_find_next_set(mask->roaring, from);
+  }
+  uint64_t w = WORD_INDEX(from);
+  if (w >= mask->cap) {
+    return BITMASK_NONE;
+  }
+
+  uint64_t word = mask->words[w] & bits_from(BIT_INDEX(from));
+  for (;;) {
+    if (word) {
+      return w * BITMASK_WORD_BITS + (uint64_t)__builtin_ctzll(word);
+    }
+    if (++w >= mask->cap) {
+      return BITMASK_NONE;
+    }
+    word = mask->words[w];
+  }
 }
 
-bitmask_t* bitmask_clone(bitmask_t* b) {
-  bitmask_t* n = malloc(sizeof(bitmask_t));
+uint64_t bitmask_find_next_clear(bitmask_t const* mask, uint64_t from) {
+  if (mask->roaring) {
+    return roaring_find_next_clear(mask->roaring, from);
+  }
+  uint64_t w = WORD_INDEX(from);
+  if (w >= mask->cap) {
+    return from;
+  }
+
+  uint64_t word = ~mask->words[w] & bits_from(BIT_INDEX(from));
+  for (;;) {
+    if (word) {
+      return w * BITMASK_WORD_BITS + (uint64_t)__builtin_ctzll(word);
+    }
+    if (++w >= mask->cap) {
+      // the first bit out of capacity
+      return w * BITMASK_WORD_BITS;
+    }
+    word = ~mask->words[w];
+  }
+}
+
+uint64_t bitmask_find_prev_clear(bitmask_t const* mask, uint64_t from) {
+  if (mask->roaring) {
+    return roaring_find_prev_clear(mask->roaring, from);
+  }
+  uint64_t w = WORD_INDEX(from);
+  if (w >= mask->cap) {
+    return from;
+  }
+
+  uint64_t word = ~mask->words[w] & bits_to(BIT_INDEX(from));
+  for (;;) {
+    if (word) {
+      return w * BITMASK_WORD_BITS + (BITMASK_WORD_BITS - 1) - (uint64_t)__builtin_clzll(word);
+    }
+    if (w-- == 0) {
+      return BITMASK_NONE;
+    }
+    word = ~mask->words[w];
+  }
+}
+
+uint64_t bitmask_popcount_range(bitmask_t const* mask, uint64_t start, uint64_t count) {
+  if (mask->roaring) {
+    return roaring_popcount_range(mask->roaring, start, count);
+  }
+  uint64_t cap_bits = mask->cap * BITMASK_WORD_BITS;
+  if (count == 0 || start >= cap_bits) {
+    return 0;
+  }
+  uint64_t last = count > cap_bits - start ? cap_bits - 1 : start + count - 1;
+
+  uint64_t first_word = WORD_INDEX(start);
+  uint64_t last_word = WORD_INDEX(last);
+  if (first_word == last_word) {
+    return __builtin_popcountll(mask->words[first_word] & bits_from(BIT_INDEX(start)) & bits_to(BIT_INDEX(last)));
+  }
+
+  uint64_t n = __builtin_popcountll(mask->words[first_word] & bits_from(BIT_INDEX(start)));
+  for (uint64_t w = first_word + 1; w < last_word; w++) {
+    n += __builtin_popcountll(mask->words[w]);
+  }
+  n += __builtin_popcountll(mask->words[last_word] & bits_to(BIT_INDEX(last)));
+  return n;
+}
+
+bitmask_t* bitmask_clone(bitmask_t const* b) { return bitmask_convert(b, b->roaring != NULL); }
+
+bitmask_t* bitmask_convert(bitmask_t const* b, bool compressed) {
+  bitmask_t* n = compressed ? bitmask_new_compressed() : bitmask_new();
   if (!n) {
     return NULL;
   }
 
-  n->byte = malloc(b->cap);
-  if (!n->byte) {
-    free(n);
+  if (!b->roaring && !compressed) {
+    if (bitmask_reserve(n, b->cap) != 0) {
+      bitmask_free(n);
+      return NULL;
+    }
+    memcpy(n->words, b->words, b->cap * sizeof(uint64_t));
+    return n;
+  }
+
+  if (b->roaring && compressed) {
+    roaring_free(n->roaring);
+    if ((n->roaring = roaring_clone(b->roaring)) == NULL) {
+      bitmask_free(n);
+      return NULL;
+    }
+    return n;
+  }
+
+  uint64_t* chunk = malloc(ROARING_BITMAP_WORDS * sizeof(uint64_t));
+  if (!chunk) {
+    printf("[%s:%d] malloc failed\n", __func__, __LINE__);
+    bitmask_free(n);
+    return NULL;
+  }
+  int ret = 0;
+  if (compressed) {
+    // dense to compressed, a chunk at a time
+    for (uint64_t w = 0; ret == 0 && w < b->cap; w += ROARING_BITMAP_WORDS) {
+      uint64_t len = b->cap - w < ROARING_BITMAP_WORDS ? b->cap - w : ROARING_BITMAP_WORDS;
+      memset(chunk, 0, ROARING_BITMAP_WORDS * sizeof(uint64_t));
+      memcpy(chunk, b->words + w, len * sizeof(uint64_t));
+      ret = roaring_set_chunk(n->roaring, w / ROARING_BITMAP_WORDS, chunk);
+    }
+  } else {
+    // compressed to dense, the capacity covers the last chunk
+    roaring_t const* r = b->roaring;
+    if (r->n > 0) {
+      ret = bitmask_reserve(n, (r->containers[r->n - 1].key + 1) * ROARING_BITMAP_WORDS);
+    }
+    for (uint32_t i = 0; ret == 0 && i < r->n; i++) {
+      roaring_chunk_words(r, i, n->words + r->containers[i].key * ROARING_BITMAP_WORDS);
+    }
+  }
+  free(chunk);
+  if (ret != 0) {
+    bitmask_free(n);
     return NULL;
   }
-  n->cap = b->cap;
-  memcpy(n->byte, b->byte, n->cap);
   return n;
 }
 
+size_t bitmask_memory(bitmask_t const* b) {
+  if (b->roaring) {
+    return sizeof(bitmask_t) + roaring_memory(b->roaring);
+  }
+  return sizeof(bitmask_t) + b->cap * sizeof(uint64_t);
+}
+
+int bitmask_serialize(bitmask_t const* b, byte_buf_t* buf) {
+  if (b->roaring) {
+    return roaring_serialize(b->roaring, buf);
+  }
+  bitmask_t* n = bitmask_convert(b, true);
+  if (!n) {
+    return -1;
+  }
+  int ret = roaring_serialize(n->roaring, buf);
+  bitmask_free(n);
+  return ret;
+}
+
+bitmask_t* bitmask_deserialize(byte_t const data[], size_t len) {
+  roaring_t* r = roaring_deserialize(data, len);
+  if (!r) {
+    return NULL;
+  }
+  bitmask_t* b = malloc(sizeof(bitmask_t));
+  if (!b) {
+    printf("[%s:%d] malloc failed\n", __func__, __LINE__);
+    roaring_free(r);
+    return NULL;
+  }
+  b->words = NULL;
+  b->cap = 0;
+  b->roaring = r;
+  return b;
+}
+
 void bitmask_show(bitmask_t* b) {
-  printf("bitmask capacity = %" PRIu64 "\n", b->cap);
+  if (b->roaring) {
+    roaring_t const* r = b->roaring;
+    static char const* const kinds[] = {"array", "bitmap", "run"};
+    printf("compressed bitmask %" PRIu32 " chunks, %" PRIu64 " set, %zu bytes\n", r->n, bitmask_popcount(b),
+           bitmask_memory(b));
+    for (uint32_t i = 0; i < r->n; i++) {
+      printf("chunk %" PRIu64 ": %s %" PRIu32 "\n", r->containers[i].key, kinds[r->containers[i].kind],
+             r->containers[i].n);
+    }
+    return;
+  }
+
+  printf("bitmask capacity = %" PRIu64 " bits, %" PRIu64 " set\n", b->cap * BITMASK_WORD_BITS, bitmask_popcount(b));
   for (uint64_t i = 0; i < b->cap; i++) {
-    for (int j = 0; j < 8; j++) {
-      int mask = 1 << j;
-      printf("%s ", b->byte[i] & mask ? "1" : "0");
+    for (int j = 0; j < BITMASK_WORD_BITS; j++) {
+      printf("%s", (b->words[i] >> j) & 1 ? "1" : "0");
+      if (j % 8 == 7) {
+        printf(" ");
+      }
     }
     printf("| ");
   }
@@ -5,16 +5,27 @@
 #include <stdint.h>
 
 #include "core/types.h"
+#include "utils/byte_buffer.h"
+
+// the number of bits in a word
+#define BITMASK_WORD_BITS 64
+// returned by find operations if there is no such bit
+#define BITMASK_NONE UINT64_MAX
+
+struct roaring_s;
 
 /**
  * @brief Bitmask object
  *
- * It automatically increases the capacity with the bit index
+ * A dense bitmask stores bits in 64-bit words. It automatically increases the capacity with the bit index, bits out
+ * of capacity are clear. A compressed bitmask stores chunks of bits in array, bitmap, or run containers, it's for
+ * large and sparse or long-run bitmasks.
  *
  */
 typedef struct {
-  byte_t* byte;
-  uint64_t cap;
+  uint64_t* words;
+  uint64_t cap;               // the capacity in words
+  struct roaring_s* roaring;  // not NULL if it's compressed
 } bitmask_t;
 
 /**
@@ -23,17 +34,81 @@ typedef struct {
  */
 typedef enum { BITMASK_CLEAR = 0, BITMASK_SET, BITMASK_TOGGLE } bitmask_op_t;
 
+/**
+ * @brief Iterates set bits in [start, end)
+ *
+ */
+#define BITMASK_FOREACH_SET(mask, i, start, end) \
+  for (i = bitmask_find_next_set(mask, start); i < (end); i = bitmask_find_next_set(mask, i + 1))
+
+/**
+ * @brief Iterates clear bits in [start, end)
+ *
+ */
+#define BITMASK_FOREACH_CLEAR(mask, i, start, end) \
+  for (i = bitmask_find_next_clear(mask, start); i < (end); i = bitmask_find_next_clear(mask, i + 1))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Creates a bitmask with the capacity of 8 bits.
+ * @brief Creates a bitmask with the capacity of 64 bits.
  *
  * @return bitmask_t* Success, a pointer to the bit mask. NULL on failed.
  */
 bitmask_t* bitmask_new();
 
+/**
+ * @brief Creates an empty compressed bitmask
+ *
+ * @return bitmask_t* Success, a pointer to the bit mask. NULL on failed.
+ */
+bitmask_t* bitmask_new_compressed();
+
+/**
+ * @brief Copies a bitmask to a new object in the given representation
+ *
+ * @param[in] b A bitmask will be copied
+ * @param[in] compressed true for a compressed bitmask, false for a dense bitmask
+ * @return bitmask_t* A copied bitmask, NULL on failed
+ */
+bitmask_t* bitmask_convert(bitmask_t const* b, bool compressed);
+
+/**
+ * @brief Checks if a bitmask is compressed
+ *
+ * @param[in] b A bitmask object
+ * @return bool
+ */
+static bool bitmask_is_compressed(bitmask_t const* b) { return b->roaring != NULL; }
+
+/**
+ * @brief Gets the allocated bytes of a bitmask
+ *
+ * @param[in] b A bitmask object
+ * @return size_t
+ */
+size_t bitmask_memory(bitmask_t const* b);
+
+/**
+ * @brief Appends a bitmask to a buffer, both representations use the compressed format.
+ *
+ * @param[in] b A bitmask object
+ * @param[out] buf A byte buffer
+ * @return int 0 on success
+ */
+int bitmask_serialize(bitmask_t const* b, byte_buf_t* buf);
+
+/**
+ * @brief Creates a compressed bitmask from serialized data
+ *
+ * @param[in] data The serialized data
+ * @param[in] len The length of data
+ * @return bitmask_t* NULL on invalid data
+ */
+bitmask_t* bitmask_deserialize(byte_t const data[], size_t len);
+
 /**
  * @brief bit operation
  *
@@ -45,16 +120,70 @@ bitmask_t* bitmask_new();
 int bitmask_op(bitmask_t* mask, uint64_t index, bitmask_op_t op);
 
 /**
- * @brief Gets the value of the given index
+ * @brief bit operation on a range of bits, a word at a time
  *
- * Need to make sure the index is not out of capacity
+ * @param[in] mask A bit mask object
+ * @param[in] start The index of the first bit
+ * @param[in] count The number of bits
+ * @param[in] op Bit operation
+ * @return int 0 on success, -1 on failed
+ */
+int bitmask_range_op(bitmask_t* mask, uint64_t start, uint64_t count, bitmask_op_t op);
+
+/**
+ * @brief Gets the value of the given index
  *
  * @param[in] mask A bitmask object
  * @param[in] index A given index
  * @return true bit value is 1
- * @return false bit value is 0, or out of range
+ * @return false bit value is 0, or out of capacity
+ */
+bool bitmask_get(bitmask_t const* mask, uint64_t index);
+
+/**
+ * @brief Finds the first set bit at or after the given index
+ *
+ * @param[in] mask A bitmask object
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit, BITMASK_NONE if not found
+ */
+uint64_t bitmask_find_next_set(bitmask_t const* mask, uint64_t from);
+
+/**
+ * @brief Finds the first clear bit at or after the given index
+ *
+ * @param[in] mask A bitmask object
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit, bits out of capacity are clear
  */
-bool bitmask_get(bitmask_t* mask, uint64_t index);
+uint64_t bitmask_find_next_clear(bitmask_t const* mask, uint64_t from);
+
+/**
+ * @brief Finds the last clear bit at or before the given index
+ *
+ * @param[in] mask A bitmask object
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit, BITMASK_NONE if not found
+ */
+uint64_t bitmask_find_prev_clear(bitmask_t const* mask, uint64_t from);
+
+/**
+ * @brief Counts set bits in a range
+ *
+ * @param[in] mask A bitmask object
+ * @param[in] start The index of the first bit
+ * @param[in] count The number of bits
+ * @return uint64_t The number of set bits
+ */
+uint64_t bitmask_popcount_range(bitmask_t const* mask, uint64_t start, uint64_t count);
+
+/**
+ * @brief Counts all set bits
+ *
+ * @param[in] mask A bitmask object
+ * @return uint64_t The number of set bits
+ */
+static uint64_t bitmask_popcount(bitmask_t const* mask) { return bitmask_popcount_range(mask, 0, UINT64_MAX); }
 
 /**
  * @brief Copy a bitmask to a new object.
@@ -62,7 +191,7 @@ bool bitmask_get(bitmask_t* mask, uint64_t index);
  * @param b A bitmask will be copied
  * @return bitmask_t* A copied bitmask
  */
-bitmask_t* bitmask_clone(bitmask_t* b);
+bitmask_t* bitmask_clone(bitmask_t const* b);
 
 /**
  * @brief Release a bitmask object
@@ -82,4 +211,4 @@ void bitmask_show(bitmask_t* b);
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
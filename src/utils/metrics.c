@@ -0,0 +1,311 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "uthash.h"
+#include "utils/allocator.h"
+#include "utils/metrics.h"
+
+// durations from 1 ms to 30 s in microseconds
+static uint64_t const g_duration_bounds[] = {1000,   2500,   5000,    10000,   25000,   50000,   100000,
+                                             250000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000};
+// counts from 1 to 256
+static uint64_t const g_count_bounds[] = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+
+#define BOUNDS(b) .bounds = b, .bounds_len = sizeof(b) / sizeof(b[0])
+
+// the metrics of the library, they are linked in the order they are rendered
+metric_t g_metric_http_errors = {.name = "goshimmer_client_http_errors_total",
+                                 .help = "Failed http requests by endpoint.",
+                                 .type = METRIC_COUNTER,
+                                 .label = "endpoint"};
+metric_t g_metric_http_duration = {.name = "goshimmer_client_http_request_duration_seconds",
+                                   .help = "The duration of http requests by endpoint.",
+                                   .type = METRIC_HISTOGRAM,
+                                   .label = "endpoint",
+                                   BOUNDS(g_duration_bounds),
+                                   .scale = 1e-6,
+                                   .next = &g_metric_http_errors};
+metric_t g_metric_selection_inputs = {.name = "goshimmer_client_selection_inputs",
+                                      .help = "The inputs of built transactions.",
+                                      .type = METRIC_HISTOGRAM,
+                                      BOUNDS(g_count_bounds),
+                                      .next = &g_metric_http_duration};
+metric_t g_metric_refresh_duration = {.name = "goshimmer_client_refresh_duration_seconds",
+                                      .help = "The duration of wallet refreshes.",
+                                      .type = METRIC_HISTOGRAM,
+                                      BOUNDS(g_duration_bounds),
+                                      .scale = 1e-6,
+                                      .next = &g_metric_selection_inputs};
+metric_t g_metric_utxo_outputs = {.name = "goshimmer_client_utxo_outputs",
+                                  .help = "The unspent outputs of the last wallet snapshot.",
+                                  .type = METRIC_GAUGE,
+                                  .next = &g_metric_refresh_duration};
+metric_t g_metric_signature_failures = {.name = "goshimmer_client_signature_failures_total",
+                                        .help = "Signatures failing verification.",
+                                        .type = METRIC_COUNTER,
+                                        .next = &g_metric_utxo_outputs};
+metric_t g_metric_signatures_verified = {.name = "goshimmer_client_signatures_verified_total",
+                                         .help = "Verified signatures.",
+                                         .type = METRIC_COUNTER,
+                                         .next = &g_metric_signature_failures};
+metric_t g_metric_signatures_created = {.name = "goshimmer_client_signatures_created_total",
+                                        .help = "Created signatures.",
+                                        .type = METRIC_COUNTER,
+                                        .next = &g_metric_signatures_verified};
+metric_t g_metric_address_derivations = {.name = "goshimmer_client_address_derivations_total",
+                                         .help = "Addresses derived from a seed.",
+                                         .type = METRIC_COUNTER,
+                                         .next = &g_metric_signatures_created};
+
+struct metric_series_s {
+  char label[METRICS_LABEL_LEN];
+  metric_values_t values;
+  UT_hash_handle hh;
+};
+
+static struct {
+  pthread_mutex_t lock;
+  metric_t* head;
+} g_metrics = {.lock = PTHREAD_MUTEX_INITIALIZER, .head = &g_metric_address_derivations};
+
+static char const* const g_type_names[] = {"counter", "gauge", "histogram"};
+
+static void values_add(metric_values_t* v, int64_t n) { __atomic_fetch_add(&v->value, n, __ATOMIC_RELAXED); }
+
+static void values_observe(metric_t const* m, metric_values_t* v, uint64_t value) {
+  size_t i = 0;
+  while (i < m->bounds_len && value > m->bounds[i]) {
+    i++;
+  }
+  __atomic_fetch_add(&v->buckets[i], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&v->sum, value, __ATOMIC_RELAXED);
+}
+
+static void values_load(metric_values_t const* v, metric_values_t* out) {
+  out->value = __atomic_load_n(&v->value, __ATOMIC_RELAXED);
+  out->sum = __atomic_load_n(&v->sum, __ATOMIC_RELAXED);
+  for (size_t i = 0; i <= METRICS_MAX_BOUNDS; i++) {
+    out->buckets[i] = __atomic_load_n(&v->buckets[i], __ATOMIC_RELAXED);
+  }
+}
+
+// clears values that other threads may update at the same time
+static void values_clear(metric_values_t* v) {
+  __atomic_store_n(&v->value, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&v->sum, 0, __ATOMIC_RELAXED);
+  for (size_t i = 0; i <= METRICS_MAX_BOUNDS; i++) {
+    __atomic_store_n(&v->buckets[i], 0, __ATOMIC_RELAXED);
+  }
+}
+
+// the series of a label value, the caller holds the registry lock
+static metric_series_t* series_get(metric_t* m, char const* label) {
+  metric_series_t* s = NULL;
+  label = label ? label : "";
+  if (strcmp(label, METRICS_LABEL_OTHER) == 0) {
+    printf("[%s:%d] label value %s is reserved\n", __func__, __LINE__, METRICS_LABEL_OTHER);
+    return NULL;
+  }
+  HASH_FIND_STR(m->series, label, s);
+  if (s == NULL && HASH_COUNT(m->series) >= METRICS_MAX_SERIES) {
+    label = METRICS_LABEL_OTHER;
+    HASH_FIND_STR(m->series, label, s);
+  }
+  if (s == NULL) {
+    if ((s = calloc(1, sizeof(metric_series_t))) == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return NULL;
+    }
+    snprintf(s->label, sizeof(s->label), "%s", label);
+    HASH_ADD_STR(m->series, label, s);
+  }
+  return s;
+}
+
+static void series_free(metric_t* m) {
+  metric_series_t *s, *tmp;
+  HASH_ITER(hh, m->series, s, tmp) {
+    HASH_DEL(m->series, s);
+    free(s);
+  }
+}
+
+int metrics_register(metric_t* m) {
+  if (m == NULL || m->name == NULL || m->type > METRIC_HISTOGRAM ||
+      (m->type == METRIC_HISTOGRAM && (m->bounds == NULL || m->bounds_len == 0 || m->bounds_len > METRICS_MAX_BOUNDS))) {
+    printf("[%s:%d] invalid metric\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&g_metrics.lock);
+  metric_t* last = NULL;
+  for (metric_t* e = g_metrics.head; e; e = e->next) {
+    if (e == m || strcmp(e->name, m->name) == 0) {
+      pthread_mutex_unlock(&g_metrics.lock);
+      printf("[%s:%d] %s is registered\n", __func__, __LINE__, m->name);
+      return -1;
+    }
+    last = e;
+  }
+  m->next = NULL;
+  m->series = NULL;
+  if (last) {
+    last->next = m;
+  } else {
+    g_metrics.head = m;
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+  return 0;
+}
+
+void metrics_unregister(metric_t* m) {
+  pthread_mutex_lock(&g_metrics.lock);
+  for (metric_t** e = &g_metrics.head; *e; e = &(*e)->next) {
+    if (*e == m) {
+      *e = m->next;
+      series_free(m);
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+}
+
+void metric_add(metric_t* m, int64_t n) { values_add(&m->values, n); }
+
+void metric_set(metric_t* m, int64_t value) { __atomic_store_n(&m->values.value, value, __ATOMIC_RELAXED); }
+
+void metric_observe(metric_t* m, uint64_t value) { values_observe(m, &m->values, value); }
+
+void metric_add_label(metric_t* m, char const* label, int64_t n) {
+  pthread_mutex_lock(&g_metrics.lock);
+  metric_series_t* s = series_get(m, label);
+  if (s) {
+    values_add(&s->values, n);
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+}
+
+void metric_observe_label(metric_t* m, char const* label, uint64_t value) {
+  pthread_mutex_lock(&g_metrics.lock);
+  metric_series_t* s = series_get(m, label);
+  if (s) {
+    values_observe(m, &s->values, value);
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+}
+
+int metric_get(metric_t* m, char const* label, metric_values_t* values) {
+  if (label == NULL) {
+    values_load(&m->values, values);
+    return 0;
+  }
+  metric_series_t* s = NULL;
+  pthread_mutex_lock(&g_metrics.lock);
+  HASH_FIND_STR(m->series, label, s);
+  if (s) {
+    values_load(&s->values, values);
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+  return s ? 0 : -1;
+}
+
+// appends formatted text, the buffer grows at least twofold to keep appends cheap
+static int out_printf(byte_buf_t* out, char const* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+  size_t needed = out->len + (size_t)n + 1;
+  if (needed > out->cap && !byte_buf_reserve(out, needed > out->cap * 2 ? needed : out->cap * 2)) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  va_start(ap, fmt);
+  vsnprintf((char*)out->data + out->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  out->len += (size_t)n;
+  return 0;
+}
+
+// the label pair of a series with backslashes, quotes, and line breaks escaped, an empty string without label
+static void label_pair(metric_t const* m, char const* value, char pair[], size_t size) {
+  size_t n = 0;
+  pair[0] = '\0';
+  if (m->label == NULL) {
+    return;
+  }
+  n = (size_t)snprintf(pair, size, "%s=\"", m->label);
+  for (char const* c = value; *c && n + 4 < size; c++) {
+    if (*c == '\\' || *c == '"' || *c == '\n') {
+      pair[n++] = '\\';
+    }
+    pair[n++] = *c == '\n' ? 'n' : *c;
+  }
+  pair[n++] = '"';
+  pair[n] = '\0';
+}
+
+static int render_series(byte_buf_t* out, metric_t const* m, char const* pair, metric_values_t const* v) {
+  if (m->type != METRIC_HISTOGRAM) {
+    return out_printf(out, "%s%s%s%s %" PRId64 "\n", m->name, *pair ? "{" : "", pair, *pair ? "}" : "", v->value);
+  }
+  // buckets are cumulative, the count is the last one
+  uint64_t count = 0;
+  char const* sep = *pair ? "," : "";
+  for (size_t i = 0; i <= m->bounds_len; i++) {
+    count += v->buckets[i];
+    int ret = i < m->bounds_len
+                  ? out_printf(out, "%s_bucket{%s%sle=\"%.9g\"} %" PRIu64 "\n", m->name, pair, sep,
+                               m->scale ? (double)m->bounds[i] * m->scale : (double)m->bounds[i], count)
+                  : out_printf(out, "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n", m->name, pair, sep, count);
+    if (ret != 0) {
+      return -1;
+    }
+  }
+  int ret = m->scale ? out_printf(out, "%s_sum%s%s%s %.9g\n", m->name, *pair ? "{" : "", pair, *pair ? "}" : "",
+                                  (double)v->sum * m->scale)
+                     : out_printf(out, "%s_sum%s%s%s %" PRIu64 "\n", m->name, *pair ? "{" : "", pair,
+                                  *pair ? "}" : "", v->sum);
+  return ret == 0 ? out_printf(out, "%s_count%s%s%s %" PRIu64 "\n", m->name, *pair ? "{" : "", pair,
+                               *pair ? "}" : "", count)
+                  : -1;
+}
+
+int metrics_render(byte_buf_t* out) {
+  int ret = 0;
+  char pair[2 * METRICS_LABEL_LEN + 64];
+  metric_values_t v;
+  pthread_mutex_lock(&g_metrics.lock);
+  for (metric_t* m = g_metrics.head; m && ret == 0; m = m->next) {
+    ret = out_printf(out, "# HELP %s %s\n# TYPE %s %s\n", m->name, m->help ? m->help : "", m->name,
+                     g_type_names[m->type]);
+    if (m->label == NULL) {
+      values_load(&m->values, &v);
+      ret = ret == 0 ? render_series(out, m, "", &v) : -1;
+      continue;
+    }
+    metric_series_t *s, *tmp;
+    HASH_ITER(hh, m->series, s, tmp) {
+      if (ret != 0) {
+        break;
+      }
+      label_pair(m, s->label, pair, sizeof(pair));
+      values_load(&s->values, &v);
+      ret = render_series(out, m, pair, &v);
+    }
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+  return ret;
+}
+
+void metrics_reset() {
+  pthread_mutex_lock(&g_metrics.lock);
+  for (metric_t* m = g_metrics.head; m; m = m->next) {
+    // series are only updated under the lock, single series are not
+    values_clear(&m->values);
+    series_free(m);
+  }
+  pthread_mutex_unlock(&g_metrics.lock);
+}
@@ -0,0 +1,159 @@
+#ifndef __UTILS_METRICS_H__
+#define __UTILS_METRICS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils/byte_buffer.h"
+
+// the maximum number of histogram bounds
+#define METRICS_MAX_BOUNDS 16
+// the maximum number of series of a labeled metric, further label values are counted under METRICS_LABEL_OTHER
+#define METRICS_MAX_SERIES 64
+// reserved, callers can't update a series of this label value
+#define METRICS_LABEL_OTHER "__other__"
+// the maximum length of a label value
+#define METRICS_LABEL_LEN 128
+
+/**
+ * @brief Metrics registry
+ *
+ * Counters, gauges, and fixed-bucket histograms of the library, rendered in the Prometheus text format. A metric is a
+ * single series updated with atomic operations, or a family of series keyed by the value of a label. Series of a
+ * family are looked up and updated under the registry lock, they are for less frequent events like http requests.
+ *
+ * Metrics of the library are registered from the start, applications can register their own.
+ *
+ */
+
+typedef enum { METRIC_COUNTER = 0, METRIC_GAUGE, METRIC_HISTOGRAM } metric_type_t;
+
+// the values of a series
+typedef struct {
+  int64_t value;                              // counters and gauges
+  uint64_t sum;                               // the sum of histogram observations
+  uint64_t buckets[METRICS_MAX_BOUNDS + 1];  // observations per bucket, the last one above all bounds
+} metric_values_t;
+
+typedef struct metric_series_s metric_series_t;
+
+typedef struct metric_s {
+  char const* name;
+  char const* help;
+  metric_type_t type;
+  char const* label;        // the label of a family of series, NULL for a single series
+  uint64_t const* bounds;   // the ascending upper bounds of histogram buckets, in the unit of observations
+  size_t bounds_len;        // up to METRICS_MAX_BOUNDS
+  double scale;             // renders histograms in base units, like 1e-6 for microseconds as seconds, 0 keeps them
+  metric_values_t values;   // the single series
+  metric_series_t* series;  // the series of a family
+  struct metric_s* next;    // the next registered metric
+} metric_t;
+
+// address derivations from a seed
+extern metric_t g_metric_address_derivations;
+extern metric_t g_metric_signatures_created;
+extern metric_t g_metric_signatures_verified;
+extern metric_t g_metric_signature_failures;
+// the outputs of the last published wallet snapshot
+extern metric_t g_metric_utxo_outputs;
+// the duration of wallet refreshes in microseconds
+extern metric_t g_metric_refresh_duration;
+// the inputs of built transactions
+extern metric_t g_metric_selection_inputs;
+// the duration of http requests in microseconds by endpoint
+extern metric_t g_metric_http_duration;
+// failed http requests by endpoint
+extern metric_t g_metric_http_errors;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Registers a metric, it must stay valid until it's unregistered
+ *
+ * @param[in] m A metric with a unique name, histograms need bounds
+ * @return int 0 on success, -1 if the metric is invalid or the name is taken
+ */
+int metrics_register(metric_t* m);
+
+/**
+ * @brief Unregisters a metric and frees its series
+ *
+ * @param[in] m A registered metric
+ */
+void metrics_unregister(metric_t* m);
+
+/**
+ * @brief Adds to a counter or a gauge
+ *
+ * @param[in] m A metric
+ * @param[in] n The amount, counters only go up
+ */
+void metric_add(metric_t* m, int64_t n);
+
+/**
+ * @brief Sets a gauge
+ *
+ * @param[in] m A metric
+ * @param[in] value The value
+ */
+void metric_set(metric_t* m, int64_t value);
+
+/**
+ * @brief Records an observation in a histogram
+ *
+ * @param[in] m A metric
+ * @param[in] value The value, in the unit of the bounds
+ */
+void metric_observe(metric_t* m, uint64_t value);
+
+/**
+ * @brief Adds to a counter or a gauge of a family
+ *
+ * @param[in] m A labeled metric
+ * @param[in] label The label value of the series, other than METRICS_LABEL_OTHER
+ * @param[in] n The amount
+ */
+void metric_add_label(metric_t* m, char const* label, int64_t n);
+
+/**
+ * @brief Records an observation in a histogram of a family
+ *
+ * @param[in] m A labeled metric
+ * @param[in] label The label value of the series, other than METRICS_LABEL_OTHER
+ * @param[in] value The value, in the unit of the bounds
+ */
+void metric_observe_label(metric_t* m, char const* label, uint64_t value);
+
+/**
+ * @brief Gets the values of a series
+ *
+ * @param[in] m A metric
+ * @param[in] label The label value of the series, NULL for a metric without label
+ * @param[out] values The values
+ * @return int 0 on success, -1 if there is no such series
+ */
+int metric_get(metric_t* m, char const* label, metric_values_t* values);
+
+/**
+ * @brief Renders all registered metrics in the Prometheus text format
+ *
+ * @param[out] out The text is appended to the buffer, it's not null terminated
+ * @return int 0 on success, -1 on OOM
+ */
+int metrics_render(byte_buf_t* out);
+
+/**
+ * @brief Clears the values of all registered metrics and removes the series of families
+ *
+ */
+void metrics_reset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,789 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "utils/allocator.h"
+#include "utils/roaring.h"
+
+#define CHUNK_KEY(i) ((i) >> 16)
+#define CHUNK_LOW(i) ((uint32_t)((i)&0xFFFF))
+#define BITMAP_BYTES (ROARING_BITMAP_WORDS * sizeof(uint64_t))
+
+static char const roaring_magic[4] = {'G', 'S', 'R', 'B'};
+
+// ========= bitmap words of a chunk =========
+
+static void words_range_op(uint64_t words[], uint32_t lo, uint32_t hi, bitmask_op_t op) {
+  for (uint32_t w = lo / 64; w <= hi / 64; w++) {
+    uint32_t first = (w == lo / 64) ? lo % 64 : 0;
+    uint32_t last = (w == hi / 64) ? hi % 64 : 63;
+    uint64_t bits = (~UINT64_C(0) << first) & (last == 63 ? ~UINT64_C(0) : (UINT64_C(1) << (last + 1)) - 1);
+    switch (op) {
+      case BITMASK_CLEAR:
+        words[w] &= ~bits;
+        break;
+      case BITMASK_SET:
+        words[w] |= bits;
+        break;
+      case BITMASK_TOGGLE:
+        words[w] ^= bits;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// finds the next set (or clear) bit at or after the given bit, ROARING_CHUNK_BITS if not found.
+static uint32_t words_next(uint64_t const words[], uint32_t from, bool set) {
+  if (from >= ROARING_CHUNK_BITS) {
+    return ROARING_CHUNK_BITS;
+  }
+  uint32_t w = from / 64;
+  uint64_t word = (set ? words[w] : ~words[w]) & (~UINT64_C(0) << (from % 64));
+  for (;;) {
+    if (word) {
+      return w * 64 + (uint32_t)__builtin_ctzll(word);
+    }
+    if (++w >= ROARING_BITMAP_WORDS) {
+      return ROARING_CHUNK_BITS;
+    }
+    word = set ? words[w] : ~words[w];
+  }
+}
+
+// finds the last clear bit at or before the given bit, -1 if not found.
+static int32_t words_prev_clear(uint64_t const words[], uint32_t from) {
+  uint32_t w = from / 64;
+  uint32_t bit = from % 64;
+  uint64_t word = ~words[w] & (bit == 63 ? ~UINT64_C(0) : (UINT64_C(1) << (bit + 1)) - 1);
+  for (;;) {
+    if (word) {
+      return (int32_t)(w * 64 + 63 - (uint32_t)__builtin_clzll(word));
+    }
+    if (w-- == 0) {
+      return -1;
+    }
+    word = ~words[w];
+  }
+}
+
+static uint32_t words_card_range(uint64_t const words[], uint32_t lo, uint32_t hi) {
+  uint32_t n = 0;
+  for (uint32_t w = lo / 64; w <= hi / 64; w++) {
+    uint32_t first = (w == lo / 64) ? lo % 64 : 0;
+    uint32_t last = (w == hi / 64) ? hi % 64 : 63;
+    uint64_t bits = (~UINT64_C(0) << first) & (last == 63 ? ~UINT64_C(0) : (UINT64_C(1) << (last + 1)) - 1);
+    n += (uint32_t)__builtin_popcountll(words[w] & bits);
+  }
+  return n;
+}
+
+// ========= containers =========
+
+// the first position whose value is not less than x
+static uint32_t lower_bound16(uint16_t const v[], uint32_t n, uint32_t x) {
+  uint32_t lo = 0, hi = n;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (v[mid] < x) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// the position of the last run starting at or before x, -1 if not found
+static int32_t run_find(roaring_container_t const* c, uint32_t x) {
+  uint16_t const* runs = (uint16_t const*)c->data;
+  int32_t lo = 0, hi = (int32_t)c->n - 1, found = -1;
+  while (lo <= hi) {
+    int32_t mid = (lo + hi) / 2;
+    if (runs[2 * mid] <= x) {
+      found = mid;
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return found;
+}
+
+static uint32_t run_end(roaring_container_t const* c, int32_t i) {
+  uint16_t const* runs = (uint16_t const*)c->data;
+  return (uint32_t)runs[2 * i] + runs[2 * i + 1];
+}
+
+static bool container_get(roaring_container_t const* c, uint32_t low) {
+  switch (c->kind) {
+    case ROARING_ARRAY: {
+      uint16_t const* v = (uint16_t const*)c->data;
+      uint32_t i = lower_bound16(v, c->n, low);
+      return i < c->n && v[i] == low;
+    }
+    case ROARING_BITMAP:
+      return (((uint64_t const*)c->data)[low / 64] >> (low % 64)) & 1;
+    default: {
+      int32_t i = run_find(c, low);
+      return i >= 0 && low <= run_end(c, i);
+    }
+  }
+}
+
+static void container_to_words(roaring_container_t const* c, uint64_t words[]) {
+  if (c->kind == ROARING_BITMAP) {
+    memcpy(words, c->data, BITMAP_BYTES);
+    return;
+  }
+  memset(words, 0, BITMAP_BYTES);
+  uint16_t const* v = (uint16_t const*)c->data;
+  for (uint32_t i = 0; i < c->n; i++) {
+    if (c->kind == ROARING_ARRAY) {
+      words[v[i] / 64] |= UINT64_C(1) << (v[i] % 64);
+    } else {
+      words_range_op(words, v[2 * i], (uint32_t)v[2 * i] + v[2 * i + 1], BITMASK_SET);
+    }
+  }
+}
+
+// stores words in the cheapest container kind, returns the number of set bits or -1 on failed.
+static int32_t container_from_words(roaring_container_t* c, uint64_t const words[]) {
+  uint32_t card = 0, runs = 0;
+  uint64_t carry = 0;
+  for (uint32_t w = 0; w < ROARING_BITMAP_WORDS; w++) {
+    card += (uint32_t)__builtin_popcountll(words[w]);
+    // a run starts at a set bit after a clear bit
+    runs += (uint32_t)__builtin_popcountll(words[w] & ~((words[w] << 1) | carry));
+    carry = words[w] >> 63;
+  }
+  if (card == 0) {
+    return 0;
+  }
+
+  uint8_t kind = ROARING_BITMAP;
+  uint32_t elms = BITMAP_BYTES / sizeof(uint16_t);
+  if (runs * 2 < elms && runs * 2 <= card) {
+    kind = ROARING_RUN;
+    elms = runs * 2;
+  } else if (card <= ROARING_ARRAY_MAX) {
+    kind = ROARING_ARRAY;
+    elms = card;
+  }
+
+  if (elms > c->cap || elms < c->cap / 2) {
+    void* data = realloc(c->data, elms * sizeof(uint16_t));
+    if (data == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    c->data = data;
+    c->cap = elms;
+  }
+
+  c->kind = kind;
+  if (kind == ROARING_BITMAP) {
+    memcpy(c->data, words, BITMAP_BYTES);
+    c->n = card;
+  } else if (kind == ROARING_ARRAY) {
+    uint16_t* v = (uint16_t*)c->data;
+    uint32_t n = 0;
+    for (uint32_t w = 0; w < ROARING_BITMAP_WORDS; w++) {
+      for (uint64_t word = words[w]; word; word &= word - 1) {
+        v[n++] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(word));
+      }
+    }
+    c->n = n;
+  } else {
+    uint16_t* v = (uint16_t*)c->data;
+    uint32_t n = 0;
+    for (uint32_t start = words_next(words, 0, true); start < ROARING_CHUNK_BITS;) {
+      uint32_t end = words_next(words, start, false);
+      v[2 * n] = (uint16_t)start;
+      v[2 * n + 1] = (uint16_t)(end - start - 1);
+      n++;
+      start = words_next(words, end, true);
+    }
+    c->n = n;
+  }
+  return (int32_t)card;
+}
+
+static int32_t container_next_set(roaring_container_t const* c, uint32_t low) {
+  switch (c->kind) {
+    case ROARING_ARRAY: {
+      uint16_t const* v = (uint16_t const*)c->data;
+      uint32_t i = lower_bound16(v, c->n, low);
+      return i < c->n ? v[i] : -1;
+    }
+    case ROARING_BITMAP: {
+      uint32_t i = words_next((uint64_t const*)c->data, low, true);
+      return i < ROARING_CHUNK_BITS ? (int32_t)i : -1;
+    }
+    default: {
+      int32_t i = run_find(c, low);
+      if (i >= 0 && low <= run_end(c, i)) {
+        return (int32_t)low;
+      }
+      return (uint32_t)(i + 1) < c->n ? ((uint16_t const*)c->data)[2 * (i + 1)] : -1;
+    }
+  }
+}
+
+static int32_t container_next_clear(roaring_container_t const* c, uint32_t low) {
+  switch (c->kind) {
+    case ROARING_ARRAY: {
+      uint16_t const* v = (uint16_t const*)c->data;
+      uint32_t i = lower_bound16(v, c->n, low);
+      while (i < c->n && v[i] == low) {
+        i++;
+        low++;
+      }
+      return low < ROARING_CHUNK_BITS ? (int32_t)low : -1;
+    }
+    case ROARING_BITMAP: {
+      uint32_t i = words_next((uint64_t const*)c->data, low, false);
+      return i < ROARING_CHUNK_BITS ? (int32_t)i : -1;
+    }
+    default: {
+      // runs are never adjacent, the bit after a run is clear
+      int32_t i = run_find(c, low);
+      if (i < 0 || low > run_end(c, i)) {
+        return (int32_t)low;
+      }
+      uint32_t end = run_end(c, i);
+      return end + 1 < ROARING_CHUNK_BITS ? (int32_t)(end + 1) : -1;
+    }
+  }
+}
+
+static int32_t container_prev_clear(roaring_container_t const* c, uint32_t low) {
+  switch (c->kind) {
+    case ROARING_ARRAY: {
+      uint16_t const* v = (uint16_t const*)c->data;
+      int32_t i = (int32_t)lower_bound16(v, c->n, low + 1) - 1;
+      while (i >= 0 && v[i] == low) {
+        if (low == 0) {
+          return -1;
+        }
+        i--;
+        low--;
+      }
+      return (int32_t)low;
+    }
+    case ROARING_BITMAP:
+      return words_prev_clear((uint64_t const*)c->data, low);
+    default: {
+      int32_t i = run_find(c, low);
+      if (i < 0 || low > run_end(c, i)) {
+        return (int32_t)low;
+      }
+      uint32_t start = ((uint16_t const*)c->data)[2 * i];
+      return start > 0 ? (int32_t)(start - 1) : -1;
+    }
+  }
+}
+
+static uint32_t container_card_range(roaring_container_t const* c, uint32_t lo, uint32_t hi) {
+  switch (c->kind) {
+    case ROARING_ARRAY: {
+      uint16_t const* v = (uint16_t const*)c->data;
+      return lower_bound16(v, c->n, hi + 1) - lower_bound16(v, c->n, lo);
+    }
+    case ROARING_BITMAP:
+      if (lo == 0 && hi == ROARING_CHUNK_BITS - 1) {
+        return c->n;
+      }
+      return words_card_range((uint64_t const*)c->data, lo, hi);
+    default: {
+      uint32_t n = 0;
+      for (uint32_t i = 0; i < c->n; i++) {
+        uint32_t start = ((uint16_t const*)c->data)[2 * i];
+        uint32_t end = run_end(c, (int32_t)i);
+        uint32_t first = start > lo ? start : lo;
+        uint32_t last = end < hi ? end : hi;
+        if (first <= last) {
+          n += last - first + 1;
+        }
+      }
+      return n;
+    }
+  }
+}
+
+static size_t container_bytes(roaring_container_t const* c) { return (size_t)c->cap * sizeof(uint16_t); }
+
+// ========= compressed bitmap =========
+
+// returns the position of the key, or -1 with the insertion position.
+static int32_t roaring_find(roaring_t const* r, uint64_t key, uint32_t* pos) {
+  uint32_t lo = 0, hi = r->n;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (r->containers[mid].key < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (pos) {
+    *pos = lo;
+  }
+  return (lo < r->n && r->containers[lo].key == key) ? (int32_t)lo : -1;
+}
+
+static roaring_container_t* roaring_insert(roaring_t* r, uint32_t pos, uint64_t key) {
+  if (r->n == r->cap) {
+    uint32_t cap = r->cap ? r->cap * 2 : 4;
+    roaring_container_t* n = realloc(r->containers, cap * sizeof(roaring_container_t));
+    if (n == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return NULL;
+    }
+    r->containers = n;
+    r->cap = cap;
+  }
+  memmove(&r->containers[pos + 1], &r->containers[pos], (r->n - pos) * sizeof(roaring_container_t));
+  roaring_container_t* c = &r->containers[pos];
+  memset(c, 0, sizeof(roaring_container_t));
+  c->key = key;
+  c->kind = ROARING_ARRAY;
+  r->n++;
+  return c;
+}
+
+static void roaring_remove(roaring_t* r, uint32_t pos) {
+  free(r->containers[pos].data);
+  memmove(&r->containers[pos], &r->containers[pos + 1], (r->n - pos - 1) * sizeof(roaring_container_t));
+  r->n--;
+}
+
+roaring_t* roaring_new() {
+  roaring_t* r = malloc(sizeof(roaring_t));
+  if (r == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(r, 0, sizeof(roaring_t));
+  return r;
+}
+
+void roaring_free(roaring_t* r) {
+  if (r) {
+    for (uint32_t i = 0; i < r->n; i++) {
+      free(r->containers[i].data);
+    }
+    free(r->containers);
+    free(r);
+  }
+}
+
+roaring_t* roaring_clone(roaring_t const* r) {
+  roaring_t* n = roaring_new();
+  if (n == NULL || r->n == 0) {
+    return n;
+  }
+  n->containers = malloc(r->n * sizeof(roaring_container_t));
+  if (n->containers == NULL) {
+    free(n);
+    return NULL;
+  }
+  n->cap = r->n;
+  for (uint32_t i = 0; i < r->n; i++) {
+    roaring_container_t* c = &n->containers[i];
+    *c = r->containers[i];
+    c->data = malloc(container_bytes(c));
+    if (c->data == NULL) {
+      n->n = i;
+      roaring_free(n);
+      return NULL;
+    }
+    memcpy(c->data, r->containers[i].data, container_bytes(c));
+  }
+  n->n = r->n;
+  return n;
+}
+
+bool roaring_get(roaring_t const* r, uint64_t index) {
+  int32_t i = roaring_find(r, CHUNK_KEY(index), NULL);
+  return i >= 0 && container_get(&r->containers[i], CHUNK_LOW(index));
+}
+
+int roaring_set_chunk(roaring_t* r, uint64_t key, uint64_t const words[]) {
+  uint32_t pos = 0;
+  int32_t i = roaring_find(r, key, &pos);
+  roaring_container_t* c = i >= 0 ? &r->containers[i] : NULL;
+  if (c == NULL) {
+    // skips an empty chunk
+    uint32_t w = 0;
+    while (w < ROARING_BITMAP_WORDS && words[w] == 0) {
+      w++;
+    }
+    if (w == ROARING_BITMAP_WORDS) {
+      return 0;
+    }
+    if ((c = roaring_insert(r, pos, key)) == NULL) {
+      return -1;
+    }
+    i = (int32_t)pos;
+  }
+
+  int32_t card = container_from_words(c, words);
+  if (card < 0) {
+    if (c->n == 0) {
+      roaring_remove(r, (uint32_t)i);
+    }
+    return -1;
+  }
+  if (card == 0) {
+    roaring_remove(r, (uint32_t)i);
+  }
+  return 0;
+}
+
+void roaring_chunk_words(roaring_t const* r, uint32_t i, uint64_t words[]) {
+  container_to_words(&r->containers[i], words);
+}
+
+// sets or clears a bit of an array container in place, returns false if the array can't hold it.
+static bool array_update(roaring_t* r, uint32_t pos, uint32_t low, bitmask_op_t op) {
+  roaring_container_t* c = &r->containers[pos];
+  uint16_t* v = (uint16_t*)c->data;
+  uint32_t i = lower_bound16(v, c->n, low);
+  bool present = i < c->n && v[i] == low;
+  if (op == BITMASK_TOGGLE) {
+    op = present ? BITMASK_CLEAR : BITMASK_SET;
+  }
+
+  if (op == BITMASK_CLEAR) {
+    if (present) {
+      memmove(&v[i], &v[i + 1], (c->n - i - 1) * sizeof(uint16_t));
+      if (--c->n == 0) {
+        roaring_remove(r, pos);
+      }
+    }
+    return true;
+  }
+
+  if (present) {
+    return true;
+  }
+  if (c->n == ROARING_ARRAY_MAX) {
+    return false;
+  }
+  if (c->n == c->cap) {
+    uint32_t cap = c->cap ? c->cap * 2 : 4;
+    if (cap > ROARING_ARRAY_MAX) {
+      cap = ROARING_ARRAY_MAX;
+    }
+    v = realloc(c->data, cap * sizeof(uint16_t));
+    if (v == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return false;
+    }
+    c->data = v;
+    c->cap = cap;
+  }
+  memmove(&v[i + 1], &v[i], (c->n - i) * sizeof(uint16_t));
+  v[i] = (uint16_t)low;
+  c->n++;
+  return true;
+}
+
+int roaring_range_op(roaring_t* r, uint64_t start, uint64_t count, bitmask_op_t op) {
+  if (count == 0) {
+    return 0;
+  }
+  if (count > UINT64_MAX - start) {
+    printf("[%s:%d] out of range\n", __func__, __LINE__);
+    return -1;
+  }
+
+  uint64_t last = start + count - 1;
+  uint64_t* words = NULL;
+  int ret = 0;
+  for (uint64_t key = CHUNK_KEY(start); key <= CHUNK_KEY(last); key++) {
+    uint32_t lo = key == CHUNK_KEY(start) ? CHUNK_LOW(start) : 0;
+    uint32_t hi = key == CHUNK_KEY(last) ? CHUNK_LOW(last) : ROARING_CHUNK_BITS - 1;
+    uint32_t pos = 0;
+    int32_t i = roaring_find(r, key, &pos);
+
+    if (op == BITMASK_CLEAR) {
+      if (i < 0) {
+        // jumps to the next chunk with bits
+        if (pos >= r->n || r->containers[pos].key > CHUNK_KEY(last)) {
+          break;
+        }
+        key = r->containers[pos].key - 1;
+        continue;
+      }
+      if (lo == 0 && hi == ROARING_CHUNK_BITS - 1) {
+        roaring_remove(r, (uint32_t)i);
+        continue;
+      }
+    }
+
+    if (i < 0) {
+      roaring_container_t* c = roaring_insert(r, pos, key);
+      if (c == NULL) {
+        ret = -1;
+        break;
+      }
+      i = (int32_t)pos;
+    }
+    roaring_container_t* c = &r->containers[i];
+
+    // a full chunk is a single run
+    if (op == BITMASK_SET && lo == 0 && hi == ROARING_CHUNK_BITS - 1) {
+      if (c->cap < 2) {
+        void* data = realloc(c->data, 2 * sizeof(uint16_t));
+        if (data == NULL) {
+          printf("[%s:%d] OOM\n", __func__, __LINE__);
+          if (c->n == 0) {
+            roaring_remove(r, (uint32_t)i);
+          }
+          ret = -1;
+          break;
+        }
+        c->data = data;
+        c->cap = 2;
+      }
+      c->kind = ROARING_RUN;
+      c->n = 1;
+      ((uint16_t*)c->data)[0] = 0;
+      ((uint16_t*)c->data)[1] = ROARING_CHUNK_BITS - 1;
+      continue;
+    }
+
+    // a single bit of an array is updated in place
+    if (lo == hi && c->kind == ROARING_ARRAY && array_update(r, (uint32_t)i, lo, op)) {
+      continue;
+    }
+
+    if (words == NULL && (words = malloc(BITMAP_BYTES)) == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      if (c->n == 0) {
+        roaring_remove(r, (uint32_t)i);
+      }
+      ret = -1;
+      break;
+    }
+    container_to_words(c, words);
+    words_range_op(words, lo, hi, op);
+    if (roaring_set_chunk(r, key, words) != 0) {
+      ret = -1;
+      break;
+    }
+  }
+  free(words);
+  return ret;
+}
+
+uint64_t roaring_find_next_set(roaring_t const* r, uint64_t from) {
+  uint32_t pos = 0;
+  roaring_find(r, CHUNK_KEY(from), &pos);
+  for (; pos < r->n; pos++) {
+    roaring_container_t const* c = &r->containers[pos];
+    int32_t low = container_next_set(c, c->key == CHUNK_KEY(from) ? CHUNK_LOW(from) : 0);
+    if (low >= 0) {
+      return (c->key << 16) | (uint32_t)low;
+    }
+  }
+  return BITMASK_NONE;
+}
+
+uint64_t roaring_find_next_clear(roaring_t const* r, uint64_t from) {
+  uint64_t key = CHUNK_KEY(from);
+  uint32_t low = CHUNK_LOW(from);
+  uint32_t pos = 0;
+  int32_t i = roaring_find(r, key, &pos);
+  for (;;) {
+    if (i < 0) {
+      return (key << 16) | low;
+    }
+    int32_t found = container_next_clear(&r->containers[i], low);
+    if (found >= 0) {
+      return (key << 16) | (uint32_t)found;
+    }
+    // the chunk is full up to the end, checks the next chunk
+    key++;
+    low = 0;
+    i = ((uint32_t)i + 1 < r->n && r->containers[i + 1].key == key) ? i + 1 : -1;
+  }
+}
+
+uint64_t roaring_find_prev_clear(roaring_t const* r, uint64_t from) {
+  uint64_t key = CHUNK_KEY(from);
+  uint32_t low = CHUNK_LOW(from);
+  int32_t i = roaring_find(r, key, NULL);
+  for (;;) {
+    if (i < 0) {
+      return (key << 16) | low;
+    }
+    int32_t found = container_prev_clear(&r->containers[i], low);
+    if (found >= 0) {
+      return (key << 16) | (uint32_t)found;
+    }
+    if (key == 0) {
+      return BITMASK_NONE;
+    }
+    key--;
+    low = ROARING_CHUNK_BITS - 1;
+    i = (i > 0 && r->containers[i - 1].key == key) ? i - 1 : -1;
+  }
+}
+
+uint64_t roaring_popcount_range(roaring_t const* r, uint64_t start, uint64_t count) {
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t last = count > UINT64_MAX - start ? UINT64_MAX : start + count - 1;
+  uint64_t n = 0;
+  uint32_t pos = 0;
+  roaring_find(r, CHUNK_KEY(start), &pos);
+  for (; pos < r->n && r->containers[pos].key <= CHUNK_KEY(last); pos++) {
+    roaring_container_t const* c = &r->containers[pos];
+    uint32_t lo = c->key == CHUNK_KEY(start) ? CHUNK_LOW(start) : 0;
+    uint32_t hi = c->key == CHUNK_KEY(last) ? CHUNK_LOW(last) : ROARING_CHUNK_BITS - 1;
+    n += container_card_range(c, lo, hi);
+  }
+  return n;
+}
+
+size_t roaring_memory(roaring_t const* r) {
+  size_t bytes = sizeof(roaring_t) + r->cap * sizeof(roaring_container_t);
+  for (uint32_t i = 0; i < r->n; i++) {
+    bytes += container_bytes(&r->containers[i]);
+  }
+  return bytes;
+}
+
+// ========= serialization =========
+
+static bool put_le(byte_buf_t* buf, uint64_t v, size_t bytes) {
+  byte_t b[8];
+  for (size_t i = 0; i < bytes; i++) {
+    b[i] = (byte_t)(v >> (8 * i));
+  }
+  return byte_buf_append(buf, b, bytes);
+}
+
+static uint64_t get_le(byte_t const data[], size_t bytes) {
+  uint64_t v = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    v |= (uint64_t)data[i] << (8 * i);
+  }
+  return v;
+}
+
+int roaring_serialize(roaring_t const* r, byte_buf_t* buf) {
+  bool ok = byte_buf_append(buf, (byte_t const*)roaring_magic, sizeof(roaring_magic)) &&
+            put_le(buf, ROARING_FORMAT_VERSION, 4) && put_le(buf, r->n, 4);
+  for (uint32_t i = 0; ok && i < r->n; i++) {
+    roaring_container_t const* c = &r->containers[i];
+    ok = put_le(buf, c->key, 8) && put_le(buf, c->kind, 1) && put_le(buf, c->n, 4);
+    if (c->kind == ROARING_BITMAP) {
+      uint64_t const* words = (uint64_t const*)c->data;
+      for (uint32_t w = 0; ok && w < ROARING_BITMAP_WORDS; w++) {
+        ok = put_le(buf, words[w], 8);
+      }
+    } else {
+      uint16_t const* v = (uint16_t const*)c->data;
+      uint32_t elms = c->kind == ROARING_RUN ? 2 * c->n : c->n;
+      for (uint32_t e = 0; ok && e < elms; e++) {
+        ok = put_le(buf, v[e], 2);
+      }
+    }
+  }
+  if (!ok) {
+    printf("[%s:%d] append buffer failed\n", __func__, __LINE__);
+    return -1;
+  }
+  return 0;
+}
+
+// validates a decoded container, values must be sorted and runs must not touch.
+static bool container_is_valid(roaring_container_t const* c) {
+  uint16_t const* v = (uint16_t const*)c->data;
+  if (c->kind == ROARING_ARRAY) {
+    for (uint32_t i = 1; i < c->n; i++) {
+      if (v[i] <= v[i - 1]) {
+        return false;
+      }
+    }
+    return c->n > 0 && c->n <= ROARING_ARRAY_MAX;
+  }
+  if (c->kind == ROARING_RUN) {
+    for (uint32_t i = 0; i < c->n; i++) {
+      uint32_t end = (uint32_t)v[2 * i] + v[2 * i + 1];
+      if (end >= ROARING_CHUNK_BITS || (i > 0 && v[2 * i] <= run_end(c, (int32_t)i - 1) + 1)) {
+        return false;
+      }
+    }
+    return c->n > 0;
+  }
+  return c->n > 0 && c->n == words_card_range((uint64_t const*)c->data, 0, ROARING_CHUNK_BITS - 1);
+}
+
+roaring_t* roaring_deserialize(byte_t const data[], size_t len) {
+  if (len < 12 || memcmp(data, roaring_magic, sizeof(roaring_magic)) != 0 ||
+      get_le(data + 4, 4) != ROARING_FORMAT_VERSION) {
+    printf("[%s:%d] invalid header\n", __func__, __LINE__);
+    return NULL;
+  }
+  uint32_t n = (uint32_t)get_le(data + 8, 4);
+  size_t off = 12;
+
+  roaring_t* r = roaring_new();
+  if (r == NULL) {
+    return NULL;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    if (len - off < 13) {
+      goto err;
+    }
+    uint64_t key = get_le(data + off, 8);
+    uint8_t kind = data[off + 8];
+    uint32_t cn = (uint32_t)get_le(data + off + 9, 4);
+    off += 13;
+    if (kind > ROARING_RUN || key > CHUNK_KEY(UINT64_MAX) || (r->n > 0 && key <= r->containers[r->n - 1].key) ||
+        (kind != ROARING_BITMAP && cn > ROARING_CHUNK_BITS)) {
+      goto err;
+    }
+
+    uint32_t elms = kind == ROARING_BITMAP ? BITMAP_BYTES / sizeof(uint16_t) : (kind == ROARING_RUN ? 2 * cn : cn);
+    size_t payload = kind == ROARING_BITMAP ? BITMAP_BYTES : (size_t)elms * sizeof(uint16_t);
+    if (len - off < payload) {
+      goto err;
+    }
+    roaring_container_t* c = roaring_insert(r, r->n, key);
+    if (c == NULL || (elms && (c->data = malloc(elms * sizeof(uint16_t))) == NULL)) {
+      goto err;
+    }
+    c->kind = kind;
+    c->n = cn;
+    c->cap = elms;
+    if (kind == ROARING_BITMAP) {
+      for (uint32_t w = 0; w < ROARING_BITMAP_WORDS; w++) {
+        ((uint64_t*)c->data)[w] = get_le(data + off + 8 * w, 8);
+      }
+    } else {
+      for (uint32_t e = 0; e < elms; e++) {
+        ((uint16_t*)c->data)[e] = (uint16_t)get_le(data + off + 2 * e, 2);
+      }
+    }
+    off += payload;
+    if (!container_is_valid(c)) {
+      goto err;
+    }
+  }
+  if (off != len) {
+    goto err;
+  }
+  return r;
+
+err:
+  printf("[%s:%d] invalid data\n", __func__, __LINE__);
+  roaring_free(r);
+  return NULL;
+}
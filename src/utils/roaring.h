@@ -0,0 +1,181 @@
+#ifndef __UTILS_ROARING_H__
+#define __UTILS_ROARING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/types.h"
+#include "utils/bitmask.h"
+#include "utils/byte_buffer.h"
+
+/**
+ * @brief A compressed bitmap
+ *
+ * Indices are split into chunks of 65536 bits, a chunk with set bits is stored in the cheapest of three containers: a
+ * sorted array of set bits, a bitmap, or a sorted list of runs. Long runs of set bits cost a few bytes per chunk.
+ *
+ */
+
+// the number of bits in a chunk
+#define ROARING_CHUNK_BITS 65536
+// the number of words in a bitmap container
+#define ROARING_BITMAP_WORDS (ROARING_CHUNK_BITS / 64)
+// the maximum number of values in an array container
+#define ROARING_ARRAY_MAX 4096
+// the serialization format version
+#define ROARING_FORMAT_VERSION 1
+
+typedef enum { ROARING_ARRAY = 0, ROARING_BITMAP, ROARING_RUN } roaring_kind_t;
+
+typedef struct {
+  uint64_t key;  // the index of the chunk
+  uint8_t kind;  // roaring_kind_t
+  uint32_t n;    // values of an array, runs of a run container, or set bits of a bitmap
+  uint32_t cap;  // the allocated number of uint16_t in data
+  void* data;    // uint16_t values, uint16_t (start, length - 1) pairs, or uint64_t words
+} roaring_container_t;
+
+typedef struct roaring_s {
+  roaring_container_t* containers;  // sorted by key
+  uint32_t n;
+  uint32_t cap;
+} roaring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates an empty compressed bitmap
+ *
+ * @return roaring_t* NULL on failed
+ */
+roaring_t* roaring_new();
+
+/**
+ * @brief Frees a compressed bitmap
+ *
+ * @param[in] r A compressed bitmap
+ */
+void roaring_free(roaring_t* r);
+
+/**
+ * @brief Copies a compressed bitmap
+ *
+ * @param[in] r A compressed bitmap
+ * @return roaring_t* NULL on failed
+ */
+roaring_t* roaring_clone(roaring_t const* r);
+
+/**
+ * @brief Gets the value of a bit
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] index The index of a bit
+ * @return bool
+ */
+bool roaring_get(roaring_t const* r, uint64_t index);
+
+/**
+ * @brief bit operation on a range of bits, a chunk at a time
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] start The index of the first bit
+ * @param[in] count The number of bits
+ * @param[in] op Bit operation
+ * @return int 0 on success, -1 on failed
+ */
+int roaring_range_op(roaring_t* r, uint64_t start, uint64_t count, bitmask_op_t op);
+
+/**
+ * @brief Finds the first set bit at or after the given index
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit, BITMASK_NONE if not found
+ */
+uint64_t roaring_find_next_set(roaring_t const* r, uint64_t from);
+
+/**
+ * @brief Finds the first clear bit at or after the given index
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit
+ */
+uint64_t roaring_find_next_clear(roaring_t const* r, uint64_t from);
+
+/**
+ * @brief Finds the last clear bit at or before the given index
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] from A given index
+ * @return uint64_t The index of the bit, BITMASK_NONE if not found
+ */
+uint64_t roaring_find_prev_clear(roaring_t const* r, uint64_t from);
+
+/**
+ * @brief Counts set bits in a range
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] start The index of the first bit
+ * @param[in] count The number of bits
+ * @return uint64_t The number of set bits
+ */
+uint64_t roaring_popcount_range(roaring_t const* r, uint64_t start, uint64_t count);
+
+/**
+ * @brief Stores a chunk from its bitmap words, the chunk is removed if no bit is set
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] key The index of the chunk
+ * @param[in] words ROARING_BITMAP_WORDS words of the chunk
+ * @return int 0 on success
+ */
+int roaring_set_chunk(roaring_t* r, uint64_t key, uint64_t const words[]);
+
+/**
+ * @brief Expands the i-th container to bitmap words
+ *
+ * @param[in] r A compressed bitmap
+ * @param[in] i The position of a container
+ * @param[out] words ROARING_BITMAP_WORDS words
+ */
+void roaring_chunk_words(roaring_t const* r, uint32_t i, uint64_t words[]);
+
+/**
+ * @brief Gets the allocated bytes of a compressed bitmap
+ *
+ * @param[in] r A compressed bitmap
+ * @return size_t
+ */
+size_t roaring_memory(roaring_t const* r);
+
+/**
+ * @brief Appends the serialized bitmap to a buffer
+ *
+ * The format is little endian: "GSRB", version (u32), containers (u32), then key (u64), kind (u8), n (u32), and the
+ * payload of each container. The payload is n values (u16) of an array, n (start, length - 1) pairs (u16) of a run
+ * container, or ROARING_BITMAP_WORDS words (u64) of a bitmap.
+ *
+ * @param[in] r A compressed bitmap
+ * @param[out] buf A byte buffer
+ * @return int 0 on success
+ */
+int roaring_serialize(roaring_t const* r, byte_buf_t* buf);
+
+/**
+ * @brief Creates a compressed bitmap from serialized data
+ *
+ * @param[in] data The serialized data
+ * @param[in] len The length of data
+ * @return roaring_t* NULL on invalid data
+ */
+roaring_t* roaring_deserialize(byte_t const data[], size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,9 @@
 #include <inttypes.h>
+#include <pthread.h>
 #include <string.h>
+#ifndef __XTENSA__
+#include <unistd.h>
+#endif
 
 #include "wallet/address_manager.h"
 
@@ -11,22 +15,20 @@ static void am_update_spent_address(wallet_am_t* const am, uint64_t index, bool
 
 // searches for the first unspent address and updates it.
 static void am_update_first_unspent_index(wallet_am_t* const am) {
-  for (uint64_t i = am->first_unspent_idx; i < am->last_addr_index; i++) {
-    if (am_is_spent_address(am, i) == false) {
-      am->first_unspent_idx = i;
-      return;
-    }
+  uint64_t i = bitmask_find_next_clear(am->spent_addr, am->first_unspent_idx);
+  if (i < am->last_addr_index) {
+    am->first_unspent_idx = i;
+    return;
   }
   printf("[%s:%d] first unspent not found?\n", __func__, __LINE__);
 }
 
 // searches for the last unspent address and updates it.
 static void am_update_last_unspent_index(wallet_am_t* const am) {
-  for (uint64_t i = am->last_unspent_idx; i > 0; i--) {
-    if (am_is_spent_address(am, i) == false) {
-      am->last_unspent_idx = i;
-      return;
-    }
+  uint64_t i = bitmask_find_prev_clear(am->spent_addr, am->last_unspent_idx);
+  if (i != BITMASK_NONE && i > 0) {
+    am->last_unspent_idx = i;
+    return;
   }
   printf("[%s:%d] last unspent not found?\n", __func__, __LINE__);
 }
@@ -45,11 +47,17 @@ wallet_am_t* am_new(byte_t const seed[], uint64_t last_addr_index, bitmask_t* sp
     randombytes_buf((void* const)am->seed, TANGLE_SEED_BYTES);
   }
 
-  // init spent address bitmask
+  // init spent address bitmask, large wallets use the compressed representation
+  bool compressed = last_addr_index >= AM_COMPRESSED_MIN_ADDRS;
   if (spent_addr) {
-    am->spent_addr = bitmask_clone(spent_addr);
+    am->spent_addr = bitmask_convert(spent_addr, compressed);
   } else {
-    am->spent_addr = bitmask_new();
+    am->spent_addr = compressed ? bitmask_new_compressed() : bitmask_new();
+  }
+  if (!am->spent_addr) {
+    printf("[%s %d] create spent address bitmask failed\n", __func__, __LINE__);
+    free(am);
+    return NULL;
   }
 
   am->last_addr_index = last_addr_index;
@@ -83,6 +91,84 @@ void am_get_address(wallet_am_t* const am, uint64_t index, byte_t out_addr[]) {
   address_get(am->seed, index, ADDRESS_VER_ED25519, out_addr);
 }
 
+typedef struct {
+  byte_t const* seed;
+  uint64_t start;
+  uint64_t count;
+  address_t* out;
+} am_derive_job_t;
+
+static void* am_derive_worker(void* arg) {
+  am_derive_job_t* job = (am_derive_job_t*)arg;
+  for (uint64_t i = 0; i < job->count; i++) {
+    address_get(job->seed, job->start + i, ADDRESS_VER_ED25519, job->out[i].addr);
+    job->out[i].index = job->start + i;
+  }
+  return NULL;
+}
+
+static size_t am_derive_threads(uint64_t count) {
+  size_t threads = 1;
+  // ESP32 derives on the calling thread, it has no core count to query
+#ifndef __XTENSA__
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cores > 1) {
+    threads = cores > AM_DERIVE_MAX_THREADS ? AM_DERIVE_MAX_THREADS : (size_t)cores;
+  }
+#endif
+  if (count / AM_DERIVE_MIN_PER_THREAD < threads) {
+    threads = count / AM_DERIVE_MIN_PER_THREAD;
+  }
+  return threads ? threads : 1;
+}
+
+int am_derive_addresses(wallet_am_t const* const am, uint64_t start, uint64_t count, address_t out[]) {
+  if (count == 0) {
+    return 0;
+  }
+
+  size_t threads = am_derive_threads(count);
+  am_derive_job_t jobs[AM_DERIVE_MAX_THREADS];
+  uint64_t chunk = count / threads;
+  for (size_t i = 0; i < threads; i++) {
+    jobs[i].seed = am->seed;
+    jobs[i].start = start + i * chunk;
+    jobs[i].count = (i == threads - 1) ? count - i * chunk : chunk;
+    jobs[i].out = out + i * chunk;
+  }
+
+  if (threads > 1) {
+    pthread_t tid[AM_DERIVE_MAX_THREADS];
+    size_t started = 0;
+    // libsodium must be initialized before it's used from multiple threads
+    if (sodium_init() < 0) {
+      printf("[%s:%d] sodium init failed\n", __func__, __LINE__);
+      return -1;
+    }
+    // the calling thread works on the first chunk
+    for (size_t i = 1; i < threads; i++) {
+      if (pthread_create(&tid[i], NULL, am_derive_worker, &jobs[i]) != 0) {
+        break;
+      }
+      started = i;
+    }
+    am_derive_worker(&jobs[0]);
+    for (size_t i = 1; i <= started; i++) {
+      pthread_join(tid[i], NULL);
+    }
+    // derives the remaining chunks if a thread couldn't be created
+    for (size_t i = started + 1; i < threads; i++) {
+      am_derive_worker(&jobs[i]);
+    }
+    return 0;
+  }
+
+  for (size_t i = 0; i < threads; i++) {
+    am_derive_worker(&jobs[i]);
+  }
+  return 0;
+}
+
 // generates and returns a new unused address.
 void am_get_new_address(wallet_am_t* const am, byte_t out_addr[]) {
   am_get_address(am, am->last_addr_index + 1, out_addr);
@@ -135,12 +221,11 @@ addr_list_t* am_unspent_addresses(wallet_am_t* const am) {
     return NULL;
   }
 
-  for (uint64_t i = am->first_unspent_idx; i <= am->last_addr_index; i++) {
-    if (!am_is_spent_address(am, i)) {
-      address_get(am->seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
-      tmp_addr.index = i;
-      addr_list_push(list, &tmp_addr);
-    }
+  uint64_t i = 0;
+  BITMASK_FOREACH_CLEAR(am->spent_addr, i, am->first_unspent_idx, am->last_addr_index + 1) {
+    address_get(am->seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
+    tmp_addr.index = i;
+    addr_list_push(list, &tmp_addr);
   }
   return list;
 }
@@ -152,12 +237,11 @@ addr_list_t* am_spent_addresses(wallet_am_t* const am) {
     return NULL;
   }
 
-  for (uint64_t i = 0; i <= am->last_addr_index; i++) {
-    if (am_is_spent_address(am, i)) {
-      address_get(am->seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
-      tmp_addr.index = i;
-      addr_list_push(list, &tmp_addr);
-    }
+  uint64_t i = 0;
+  BITMASK_FOREACH_SET(am->spent_addr, i, 0, am->last_addr_index + 1) {
+    address_get(am->seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
+    tmp_addr.index = i;
+    addr_list_push(list, &tmp_addr);
   }
   return list;
 }
@@ -6,6 +6,13 @@
 #include "core/address.h"
 #include "utils/bitmask.h"
 
+// the minimum number of addresses derived by a thread
+#define AM_DERIVE_MIN_PER_THREAD 64
+// the maximum number of threads used for address derivation
+#define AM_DERIVE_MAX_THREADS 16
+// wallets with at least this number of addresses keep spent addresses in a compressed bitmask
+#define AM_COMPRESSED_MIN_ADDRS 65536
+
 /**
  * @brief A wallet address represents an address in a wallet. It extends the normal address type with an index number
  * that was used to generate the address from its seed.
@@ -35,6 +42,9 @@ extern "C" {
  * @param[in] last_addr_index The last address of this wallet, 0 for new a wallet
  * @param[in] spent_addr The spent address bitmask, NULL for new wallet
  * @return wallet_am_t*
+ *
+ * The spent address bitmask is copied into a compressed bitmask if last_addr_index reaches AM_COMPRESSED_MIN_ADDRS,
+ * or a dense bitmask otherwise.
  */
 wallet_am_t* am_new(byte_t const seed[], uint64_t last_addr_index, bitmask_t* spent_addr);
 
@@ -54,6 +64,19 @@ void am_free(wallet_am_t* am);
  */
 void am_get_address(wallet_am_t* const am, uint64_t index, byte_t out_addr[]);
 
+/**
+ * @brief Derives a range of addresses, large ranges are split across threads.
+ *
+ * It doesn't change the status of the address manager.
+ *
+ * @param[in] am A wallet manager instance
+ * @param[in] start The first address index
+ * @param[in] count The number of addresses
+ * @param[out] out An array of `count` addresses
+ * @return int 0 on success
+ */
+int am_derive_addresses(wallet_am_t const* const am, uint64_t start, uint64_t count, address_t out[]);
+
 /**
  * @brief Generates and retruns a new unused address.
  *
@@ -0,0 +1,459 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef __XTENSA__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "utils/allocator.h"
+#include "wallet/asset_registry.h"
+
+static char const ar_magic[4] = {'G', 'S', 'A', 'R'};
+
+// colors are hashes, folds all words so crafted colors still spread.
+static uint32_t ar_hash(byte_t const color[]) {
+  uint64_t w[BALANCE_COLOR_BYTES / sizeof(uint64_t)];
+  memcpy(w, color, sizeof(w));
+  uint64_t h = w[0] ^ w[1] ^ w[2] ^ w[3];
+  return (uint32_t)((h * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+// FNV-1a
+static uint32_t ar_str_hash(char const* s) {
+  uint32_t h = 2166136261u;
+  while (*s) {
+    h = (h ^ (uint8_t)*s++) * 16777619u;
+  }
+  return h;
+}
+
+// returns the slot of the color, or the empty slot where it would be inserted.
+static uint32_t ar_probe(wallet_ar_entry_t const* slots, uint32_t capacity, byte_t const color[]) {
+  uint32_t mask = capacity - 1;
+  uint32_t i = ar_hash(color) & mask;
+  while (slots[i].used && memcmp(slots[i].color, color, BALANCE_COLOR_BYTES) != 0) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static void ar_unmap(wallet_ar_t* ar) {
+  if (ar->map) {
+#ifndef __XTENSA__
+    munmap(ar->map, ar->map_len);
+#else
+    free(ar->map);
+#endif
+    ar->map = NULL;
+    ar->map_len = 0;
+  }
+}
+
+// copies slots and strings of a mapped file to the heap before changing them.
+static int ar_own(wallet_ar_t* ar) {
+  if (ar->map == NULL) {
+    return 0;
+  }
+
+  wallet_ar_entry_t* slots = malloc(sizeof(wallet_ar_entry_t) * ar->capacity);
+  uint32_t pool_cap = ar->pool_len ? ar->pool_len : 64;
+  char* pool = malloc(pool_cap);
+  if (slots == NULL || pool == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(slots);
+    free(pool);
+    return -1;
+  }
+  memcpy(slots, ar->slots, sizeof(wallet_ar_entry_t) * ar->capacity);
+  if (ar->pool_len) {
+    memcpy(pool, ar->pool, ar->pool_len);
+  }
+  ar_unmap(ar);
+  ar->slots = slots;
+  ar->pool = pool;
+  ar->pool_cap = pool_cap;
+  return 0;
+}
+
+static int ar_resize(wallet_ar_t* ar, uint32_t capacity) {
+  wallet_ar_entry_t* slots = calloc(capacity, sizeof(wallet_ar_entry_t));
+  if (slots == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  for (uint32_t i = 0; i < ar->capacity; i++) {
+    if (ar->slots[i].used) {
+      slots[ar_probe(slots, capacity, ar->slots[i].color)] = ar->slots[i];
+    }
+  }
+  free(ar->slots);
+  ar->slots = slots;
+  ar->capacity = capacity;
+  return 0;
+}
+
+static void ar_strs_insert(uint32_t* strs, uint32_t cap, char const* pool, uint32_t off) {
+  uint32_t mask = cap - 1;
+  uint32_t i = ar_str_hash(pool + off) & mask;
+  while (strs[i] != WALLET_AR_NO_STR) {
+    i = (i + 1) & mask;
+  }
+  strs[i] = off;
+}
+
+// rebuilds the interning set with all strings in the pool, with room for one more.
+static int ar_strs_rebuild(wallet_ar_t* ar) {
+  uint32_t count = 0;
+  for (uint32_t off = 0; off < ar->pool_len; off += strlen(ar->pool + off) + 1) {
+    count++;
+  }
+  uint32_t cap = WALLET_AR_MIN_CAPACITY;
+  while ((count + 1) * 2 > cap) {
+    cap *= 2;
+  }
+
+  uint32_t* strs = malloc(sizeof(uint32_t) * cap);
+  if (strs == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  memset(strs, 0xff, sizeof(uint32_t) * cap);
+  for (uint32_t off = 0; off < ar->pool_len; off += strlen(ar->pool + off) + 1) {
+    ar_strs_insert(strs, cap, ar->pool, off);
+  }
+  free(ar->strs);
+  ar->strs = strs;
+  ar->strs_cap = cap;
+  ar->strs_count = count;
+  return 0;
+}
+
+// returns the offset of an identical string in the pool, or appends it.
+static uint32_t ar_intern(wallet_ar_t* ar, char const* s) {
+  if ((ar->strs == NULL || (ar->strs_count + 1) * 2 > ar->strs_cap) && ar_strs_rebuild(ar) != 0) {
+    return WALLET_AR_NO_STR;
+  }
+
+  uint32_t mask = ar->strs_cap - 1;
+  uint32_t i = ar_str_hash(s) & mask;
+  while (ar->strs[i] != WALLET_AR_NO_STR) {
+    if (strcmp(ar->pool + ar->strs[i], s) == 0) {
+      return ar->strs[i];
+    }
+    i = (i + 1) & mask;
+  }
+
+  size_t len = strlen(s) + 1;
+  if (ar->pool_len + len >= WALLET_AR_NO_STR) {
+    printf("[%s:%d] string pool is full\n", __func__, __LINE__);
+    return WALLET_AR_NO_STR;
+  }
+  if (ar->pool_len + len > ar->pool_cap) {
+    uint32_t cap = ar->pool_cap ? ar->pool_cap : 64;
+    while (ar->pool_len + len > cap) {
+      cap *= 2;
+    }
+    char* pool = realloc(ar->pool, cap);
+    if (pool == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return WALLET_AR_NO_STR;
+    }
+    ar->pool = pool;
+    ar->pool_cap = cap;
+  }
+
+  uint32_t off = ar->pool_len;
+  memcpy(ar->pool + off, s, len);
+  ar->pool_len += len;
+  ar->strs[i] = off;
+  ar->strs_count++;
+  return off;
+}
+
+wallet_ar_t* wallet_ar_new() {
+  wallet_ar_t* ar = malloc(sizeof(wallet_ar_t));
+  if (ar == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(ar, 0, sizeof(wallet_ar_t));
+  ar->slots = calloc(WALLET_AR_MIN_CAPACITY, sizeof(wallet_ar_entry_t));
+  if (ar->slots == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    free(ar);
+    return NULL;
+  }
+  ar->capacity = WALLET_AR_MIN_CAPACITY;
+  return ar;
+}
+
+void wallet_ar_free(wallet_ar_t* ar) {
+  if (ar) {
+    if (ar->map) {
+      ar_unmap(ar);
+    } else {
+      free(ar->slots);
+      free(ar->pool);
+    }
+    free(ar->strs);
+    free(ar);
+  }
+}
+
+int wallet_ar_register_asset(wallet_ar_t* ar, wallet_asset_t const* asset) {
+  if (asset == NULL || asset->name == NULL) {
+    printf("[%s:%d] an asset name is required\n", __func__, __LINE__);
+    return -1;
+  }
+
+  if (ar_own(ar) != 0) {
+    return -1;
+  }
+
+  // keeps the load factor under 3/4
+  if ((ar->count + 1) * 4 > ar->capacity * 3 && ar_resize(ar, ar->capacity * 2) != 0) {
+    return -1;
+  }
+
+  uint32_t name = ar_intern(ar, asset->name->buf);
+  uint32_t symbol = asset->symbol ? ar_intern(ar, asset->symbol->buf) : WALLET_AR_NO_STR;
+  if (name == WALLET_AR_NO_STR || (asset->symbol && symbol == WALLET_AR_NO_STR)) {
+    return -1;
+  }
+
+  wallet_ar_entry_t* e = &ar->slots[ar_probe(ar->slots, ar->capacity, asset->color)];
+  if (!e->used) {
+    ar->count++;
+  }
+  memset(e, 0, sizeof(wallet_ar_entry_t));
+  memcpy(e->color, asset->color, BALANCE_COLOR_BYTES);
+  memcpy(e->address, asset->address, TANGLE_ADDRESS_BYTES);
+  e->used = 1;
+  e->name = name;
+  e->symbol = symbol;
+  e->precision = asset->precision;
+  e->amount = asset->amount;
+  return 0;
+}
+
+int wallet_ar_remove(wallet_ar_t* ar, byte_t const color[]) {
+  if (wallet_ar_find(ar, color) == NULL || ar_own(ar) != 0) {
+    return -1;
+  }
+
+  // backward shift deletion, moves following entries of the cluster into the gap
+  uint32_t mask = ar->capacity - 1;
+  uint32_t gap = ar_probe(ar->slots, ar->capacity, color);
+  uint32_t i = gap;
+  for (;;) {
+    i = (i + 1) & mask;
+    if (!ar->slots[i].used) {
+      break;
+    }
+    uint32_t home = ar_hash(ar->slots[i].color) & mask;
+    // moves it if its home is not in (gap, i]
+    if (((i - home) & mask) >= ((i - gap) & mask)) {
+      ar->slots[gap] = ar->slots[i];
+      gap = i;
+    }
+  }
+  memset(&ar->slots[gap], 0, sizeof(wallet_ar_entry_t));
+  ar->count--;
+  return 0;
+}
+
+wallet_ar_entry_t const* wallet_ar_find(wallet_ar_t const* ar, byte_t const color[]) {
+  wallet_ar_entry_t const* e = &ar->slots[ar_probe(ar->slots, ar->capacity, color)];
+  return e->used ? e : NULL;
+}
+
+char const* wallet_ar_name(wallet_ar_t const* ar, byte_t const color[]) {
+  wallet_ar_entry_t const* e = wallet_ar_find(ar, color);
+  return e ? ar->pool + e->name : NULL;
+}
+
+char const* wallet_ar_symbol(wallet_ar_t const* ar, byte_t const color[]) {
+  wallet_ar_entry_t const* e = wallet_ar_find(ar, color);
+  return (e && e->symbol != WALLET_AR_NO_STR) ? ar->pool + e->symbol : NULL;
+}
+
+int wallet_ar_precision(wallet_ar_t const* ar, byte_t const color[]) {
+  wallet_ar_entry_t const* e = wallet_ar_find(ar, color);
+  return e ? e->precision : -1;
+}
+
+int wallet_ar_format_balance(wallet_ar_t const* ar, byte_t const color[], int64_t value, char buf[], size_t buf_len) {
+  int n = 0;
+  wallet_ar_entry_t const* e = wallet_ar_find(ar, color);
+  if (e == NULL) {
+    n = snprintf(buf, buf_len, "%" PRId64, value);
+    return (n < 0 || (size_t)n >= buf_len) ? -1 : 0;
+  }
+
+  char const* unit = ar->pool + (e->symbol != WALLET_AR_NO_STR ? e->symbol : e->name);
+  // 10^18 is the largest power of 10 in int64_t
+  int precision = e->precision < 0 ? 0 : (e->precision > 18 ? 18 : e->precision);
+  uint64_t scale = 1;
+  for (int i = 0; i < precision; i++) {
+    scale *= 10;
+  }
+  uint64_t abs = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+  char const* sign = value < 0 ? "-" : "";
+  if (precision == 0) {
+    n = snprintf(buf, buf_len, "%s%" PRIu64 " %s", sign, abs, unit);
+  } else {
+    n = snprintf(buf, buf_len, "%s%" PRIu64 ".%0*" PRIu64 " %s", sign, abs / scale, precision, abs % scale, unit);
+  }
+  return (n < 0 || (size_t)n >= buf_len) ? -1 : 0;
+}
+
+int wallet_ar_save(wallet_ar_t const* ar, char const path[]) {
+  char tmp_path[256];
+  if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+    printf("[%s:%d] path is too long\n", __func__, __LINE__);
+    return -1;
+  }
+
+  wallet_ar_file_hdr_t hdr = {};
+  memcpy(hdr.magic, ar_magic, sizeof(ar_magic));
+  hdr.version = WALLET_AR_FILE_VERSION;
+  hdr.entry_size = sizeof(wallet_ar_entry_t);
+  hdr.capacity = ar->capacity;
+  hdr.count = ar->count;
+  hdr.pool_len = ar->pool_len;
+
+  FILE* f = fopen(tmp_path, "wb");
+  if (f == NULL) {
+    printf("[%s:%d] open %s failed\n", __func__, __LINE__, tmp_path);
+    return -1;
+  }
+  bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+            fwrite(ar->slots, sizeof(wallet_ar_entry_t), ar->capacity, f) == ar->capacity &&
+            (ar->pool_len == 0 || fwrite(ar->pool, 1, ar->pool_len, f) == ar->pool_len);
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(tmp_path, path) != 0) {
+    printf("[%s:%d] write %s failed\n", __func__, __LINE__, path);
+    remove(tmp_path);
+    return -1;
+  }
+  return 0;
+}
+
+// maps a whole file read-only, the buffer is read into the heap on platforms without mmap.
+static void* ar_map_file(char const path[], size_t* len) {
+#ifndef __XTENSA__
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  void* map = NULL;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      map = NULL;
+    } else {
+      *len = (size_t)st.st_size;
+    }
+  }
+  close(fd);
+  return map;
+#else
+  FILE* f = fopen(path, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  void* buf = NULL;
+  if (fseek(f, 0, SEEK_END) == 0) {
+    long size = ftell(f);
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = malloc((size_t)size)) != NULL) {
+      if (fread(buf, 1, (size_t)size, f) == (size_t)size) {
+        *len = (size_t)size;
+      } else {
+        free(buf);
+        buf = NULL;
+      }
+    }
+  }
+  fclose(f);
+  return buf;
+#endif
+}
+
+// validates a mapped file, offsets must stay in the file.
+static bool ar_file_is_valid(byte_t const* map, size_t len) {
+  wallet_ar_file_hdr_t hdr;
+  if (len < sizeof(hdr)) {
+    return false;
+  }
+  memcpy(&hdr, map, sizeof(hdr));
+  if (memcmp(hdr.magic, ar_magic, sizeof(ar_magic)) != 0 || hdr.version != WALLET_AR_FILE_VERSION ||
+      hdr.entry_size != sizeof(wallet_ar_entry_t) || hdr.capacity < WALLET_AR_MIN_CAPACITY ||
+      (hdr.capacity & (hdr.capacity - 1)) != 0 || (uint64_t)hdr.count * 4 > (uint64_t)hdr.capacity * 3) {
+    return false;
+  }
+  uint64_t expected = sizeof(hdr) + (uint64_t)hdr.capacity * sizeof(wallet_ar_entry_t) + hdr.pool_len;
+  if (expected != len) {
+    return false;
+  }
+
+  char const* pool = (char const*)map + sizeof(hdr) + (size_t)hdr.capacity * sizeof(wallet_ar_entry_t);
+  if (hdr.pool_len && pool[hdr.pool_len - 1] != '\0') {
+    return false;
+  }
+  wallet_ar_entry_t const* slots = (wallet_ar_entry_t const*)(map + sizeof(hdr));
+  uint32_t used = 0;
+  for (uint32_t i = 0; i < hdr.capacity; i++) {
+    if (slots[i].used) {
+      used++;
+      if (slots[i].name >= hdr.pool_len ||
+          (slots[i].symbol != WALLET_AR_NO_STR && slots[i].symbol >= hdr.pool_len)) {
+        return false;
+      }
+    }
+  }
+  // at least one empty slot, so probing always stops
+  return used == hdr.count && used < hdr.capacity;
+}
+
+wallet_ar_t* wallet_ar_load(char const path[]) {
+  size_t len = 0;
+  byte_t* map = ar_map_file(path, &len);
+  if (map == NULL) {
+    printf("[%s:%d] read %s failed\n", __func__, __LINE__, path);
+    return NULL;
+  }
+
+  wallet_ar_t* ar = malloc(sizeof(wallet_ar_t));
+  if (ar == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+  }
+  if (ar == NULL || !ar_file_is_valid(map, len)) {
+    if (ar) {
+      printf("[%s:%d] invalid asset registry file %s\n", __func__, __LINE__, path);
+    }
+    free(ar);
+#ifndef __XTENSA__
+    munmap(map, len);
+#else
+    free(map);
+#endif
+    return NULL;
+  }
+
+  wallet_ar_file_hdr_t hdr;
+  memcpy(&hdr, map, sizeof(hdr));
+  memset(ar, 0, sizeof(wallet_ar_t));
+  ar->map = map;
+  ar->map_len = len;
+  ar->slots = (wallet_ar_entry_t*)(map + sizeof(hdr));
+  ar->capacity = hdr.capacity;
+  ar->count = hdr.count;
+  ar->pool = (char*)(map + sizeof(hdr) + (size_t)hdr.capacity * sizeof(wallet_ar_entry_t));
+  ar->pool_len = hdr.pool_len;
+  return ar;
+}
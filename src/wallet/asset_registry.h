@@ -1,6 +1,10 @@
 #ifndef __WALLET_ASSET_REGISTRY_H__
 #define __WALLET_ASSET_REGISTRY_H__
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "core/address.h"
 #include "core/balance.h"
 #include "utils/iota_str.h"
@@ -18,27 +22,174 @@ typedef struct {
   uint64_t amount; /**< the amount of tokens that we want to create */
 } wallet_asset_t;
 
-// hashtable of assets
+// the initial number of slots, must be a power of 2
+#define WALLET_AR_MIN_CAPACITY 16
+// an offset in the string pool for no string
+#define WALLET_AR_NO_STR UINT32_MAX
+// the file format version
+#define WALLET_AR_FILE_VERSION 1
+
+/**
+ * @brief A slot of the registry, the layout is also the on-disk layout.
+ *
+ * Names and symbols are offsets in the string pool, identical strings are stored once.
+ *
+ */
+typedef struct {
+  byte_t color[BALANCE_COLOR_BYTES];
+  byte_t address[TANGLE_ADDRESS_BYTES];
+  uint8_t used;
+  uint32_t name;
+  uint32_t symbol;
+  int32_t precision;
+  uint64_t amount;
+} wallet_ar_entry_t;
+
+// the file header, followed by the slots and the string pool
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t entry_size;
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t pool_len;
+  uint32_t reserved[2];
+} wallet_ar_file_hdr_t;
+
+/**
+ * @brief An open addressing hash table of assets keyed by color
+ *
+ * A registry loaded from a file reads slots and strings in place from the mapped file, they are copied to the heap on
+ * the first change.
+ *
+ */
+typedef struct {
+  wallet_ar_entry_t* slots;  // a power of 2 number of slots, linear probing
+  uint32_t capacity;
+  uint32_t count;
+  char* pool;                // NUL terminated strings
+  uint32_t pool_len;
+  uint32_t pool_cap;
+  uint32_t* strs;            // an open addressing set of string offsets for interning, built on demand
+  uint32_t strs_cap;
+  uint32_t strs_count;
+  void* map;                 // the mapped file, NULL if slots and pool are owned
+  size_t map_len;
+} wallet_ar_t;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-int wallet_ar_new();
+/**
+ * @brief Creates an empty asset registry
+ *
+ * @return wallet_ar_t* NULL on failed
+ */
+wallet_ar_t* wallet_ar_new();
+
+/**
+ * @brief Frees an asset registry
+ *
+ * @param[in] ar An asset registry
+ */
+void wallet_ar_free(wallet_ar_t* ar);
+
+/**
+ * @brief Registers an asset, so we can look up names and symbol of colored coins. An existing asset is replaced.
+ *
+ * @param[in] ar An asset registry
+ * @param[in] asset An asset with a name, the symbol is optional
+ * @return int 0 on success
+ */
+int wallet_ar_register_asset(wallet_ar_t* ar, wallet_asset_t const* asset);
+
+/**
+ * @brief Removes an asset from the registry
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the asset
+ * @return int 0 on success, -1 if it's not registered
+ */
+int wallet_ar_remove(wallet_ar_t* ar, byte_t const color[]);
+
+/**
+ * @brief Finds an asset by color
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the asset
+ * @return wallet_ar_entry_t const* NULL if not found
+ */
+wallet_ar_entry_t const* wallet_ar_find(wallet_ar_t const* ar, byte_t const color[]);
+
+/**
+ * @brief Gets the name of an asset
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the asset
+ * @return char const* NULL if not found
+ */
+char const* wallet_ar_name(wallet_ar_t const* ar, byte_t const color[]);
+
+/**
+ * @brief Gets the symbol of an asset
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the asset
+ * @return char const* NULL if not found or the asset has no symbol
+ */
+char const* wallet_ar_symbol(wallet_ar_t const* ar, byte_t const color[]);
+
+/**
+ * @brief Gets the precision of an asset
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the asset
+ * @return int The number of decimal places, -1 if not found
+ */
+int wallet_ar_precision(wallet_ar_t const* ar, byte_t const color[]);
 
-// registers an asset in the registry, so we can look up names and symbol of colored coins.
-int wallet_ar_register_asset(byte_t const color[], wallet_asset_t* asset);
+/**
+ * @brief Formats a balance with the precision and the symbol (or name) of its asset
+ *
+ * Unregistered colors are formatted as a raw value.
+ *
+ * @param[in] ar An asset registry
+ * @param[in] color The color of the balance
+ * @param[in] value The balance value
+ * @param[out] buf A buffer holds the output string
+ * @param[in] buf_len The size of the buffer
+ * @return int 0 on success, -1 if the buffer is too small
+ */
+int wallet_ar_format_balance(wallet_ar_t const* ar, byte_t const color[], int64_t value, char buf[], size_t buf_len);
 
-// returns the name of the given asset.
-int wallet_ar_name(byte_t const color[]);
+/**
+ * @brief Saves the registry to a file, the file is replaced atomically
+ *
+ * @param[in] ar An asset registry
+ * @param[in] path The file path
+ * @return int 0 on success
+ */
+int wallet_ar_save(wallet_ar_t const* ar, char const path[]);
 
-// returns the symbol of the token.
-int wallet_ar_symbol(byte_t const color[]);
+/**
+ * @brief Loads a registry from a file, slots and strings are read in place from the mapped file.
+ *
+ * @param[in] path The file path
+ * @return wallet_ar_t* NULL on failed
+ */
+wallet_ar_t* wallet_ar_load(char const path[]);
 
-int wallet_ar_precision(byte_t const color[]);
+/**
+ * @brief Gets the number of registered assets
+ *
+ * @param[in] ar An asset registry
+ * @return size_t
+ */
+static size_t wallet_ar_count(wallet_ar_t const* ar) { return ar->count; }
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
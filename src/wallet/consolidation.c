@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "utarray.h"
+#include "utils/allocator.h"
+#include "wallet/consolidation.h"
+
+// an output that can be swept
+typedef struct {
+  unspent_outputs_t *elm;
+  output_ids_t *id;
+  int64_t value;  // the value of the swept color
+} sweep_candidate_t;
+
+static UT_icd const sweep_candidate_icd = {sizeof(sweep_candidate_t), NULL, NULL, NULL};
+
+static bool sweep_output_free(output_reservation_t *r, unspent_outputs_t *elm, output_ids_t *id) {
+  return !elm->spent && id->st.confirmed && !reservation_is_reserved(r, elm->addr, id->id);
+}
+
+static bool sweep_value_fits(sweep_policy_t const *p, int64_t value) {
+  return value > 0 && (p->dust_value == 0 || (uint64_t)value <= p->dust_value);
+}
+
+static int sweep_candidate_cmp(void const *a, void const *b) {
+  int64_t va = ((sweep_candidate_t const *)a)->value;
+  int64_t vb = ((sweep_candidate_t const *)b)->value;
+  return va < vb ? -1 : va > vb;
+}
+
+// counts sweepable outputs by color, returns the most fragmented color in counts.
+static balance_ht_t *sweep_count_colors(output_reservation_t *r, unspent_outputs_t **t, sweep_policy_t const *p,
+                                        balance_ht_t **counts) {
+  balance_ht_t *top = NULL;
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) {
+      if (!sweep_output_free(r, elm, id)) {
+        continue;
+      }
+      balance_ht_t *bal, *bal_tmp;
+      HASH_ITER(hh, id->balances, bal, bal_tmp) {
+        if (!sweep_value_fits(p, bal->value)) {
+          continue;
+        }
+        balance_ht_t *n = balance_ht_find(counts, bal->color);
+        if (n) {
+          n->value++;
+        } else if (balance_ht_add(counts, bal->color, 1) == 0) {
+          n = balance_ht_find(counts, bal->color);
+        }
+        if (n && (top == NULL || n->value > top->value)) {
+          top = n;
+        }
+      }
+    }
+  }
+  return top;
+}
+
+unspent_outputs_t *sweep_select(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                sweep_policy_t const *p, byte_t color[]) {
+  if (!sweep_policy_valid(p)) {
+    printf("[%s:%d] invalid sweep policy\n", __func__, __LINE__);
+    return NULL;
+  }
+
+  balance_ht_t *counts = balance_ht_init();
+  balance_ht_t *top = sweep_count_colors(r, t, p, &counts);
+  if (top == NULL || top->value < (int64_t)p->min_outputs) {
+    balance_ht_free(&counts);
+    return NULL;
+  }
+  memcpy(color, top->color, BALANCE_COLOR_BYTES);
+  balance_ht_free(&counts);
+
+  // the smallest outputs of the color are swept first
+  UT_array *candidates = NULL;
+  utarray_new(candidates, &sweep_candidate_icd);
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) {
+      balance_ht_t *bal = balance_ht_find(&id->balances, color);
+      if (bal && sweep_value_fits(p, bal->value) && sweep_output_free(r, elm, id)) {
+        sweep_candidate_t c = {.elm = elm, .id = id, .value = bal->value};
+        utarray_push_back(candidates, &c);
+      }
+    }
+  }
+  utarray_sort(candidates, sweep_candidate_cmp);
+
+  unspent_outputs_t *selected = unspent_outputs_init();
+  size_t inputs = 0;
+  sweep_candidate_t *c = NULL;
+  for (c = (sweep_candidate_t *)utarray_front(candidates); c != NULL && inputs < p->max_inputs;
+       c = (sweep_candidate_t *)utarray_next(candidates, c)) {
+    if (reservation_take(r, ticket, c->elm->addr, c->id->id) != 0) {
+      continue;
+    }
+    unspent_outputs_t *in = unspent_outputs_find(&selected, c->elm->addr);
+    if (in == NULL) {
+      unspent_outputs_add(&selected, c->elm->addr, c->elm->addr_index, NULL);
+      in = unspent_outputs_find(&selected, c->elm->addr);
+    }
+    output_ids_add(&in->ids, c->id->id, c->id->balances, &c->id->st);
+    inputs++;
+  }
+  utarray_free(candidates);
+  return selected;
+}
+
+size_t sweep_free_outputs(output_reservation_t *r, unspent_outputs_t **t) {
+  size_t n = 0;
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) {
+      if (sweep_output_free(r, elm, id)) {
+        n++;
+      }
+    }
+  }
+  return n;
+}
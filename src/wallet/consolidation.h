@@ -0,0 +1,94 @@
+#ifndef __WALLET_CONSOLIDATION_H__
+#define __WALLET_CONSOLIDATION_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/unspent_outputs.h"
+#include "wallet/output_reservation.h"
+
+/**
+ * @brief UTXO consolidation
+ *
+ * Small deposits leave many outputs on many addresses, and every payment that uses them needs more inputs and
+ * signatures. A sweep collects free confirmed outputs of the most fragmented color into one transaction whose only
+ * output goes to a new address of the same wallet.
+ *
+ */
+
+// the maximum number of inputs of a transaction
+#define SWEEP_MAX_INPUTS 127
+// the default minimum number of outputs of a color to sweep
+#define SWEEP_DEFAULT_MIN_OUTPUTS 16
+// the default number of milliseconds without payments before sweeping
+#define SWEEP_DEFAULT_IDLE_MS 60000
+// the default maximum number of sweep transactions in a run
+#define SWEEP_DEFAULT_MAX_TXS 4
+
+typedef struct {
+  uint32_t min_outputs;  // a color is swept if it's held by at least this number of free outputs
+  uint32_t max_inputs;   // the maximum number of inputs of a sweep transaction, at most SWEEP_MAX_INPUTS
+  uint64_t dust_value;   // only outputs holding at most this value of the color are swept, 0 for any
+  uint32_t idle_ms;      // the background refresher sweeps if no payment was issued for this long
+  uint32_t max_txs;      // the maximum number of sweep transactions in a run, 0 disables background sweeps
+} sweep_policy_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets a policy to the defaults
+ *
+ * @param[out] p A sweep policy
+ */
+static void sweep_policy_init(sweep_policy_t *p) {
+  p->min_outputs = SWEEP_DEFAULT_MIN_OUTPUTS;
+  p->max_inputs = SWEEP_MAX_INPUTS;
+  p->dust_value = 0;
+  p->idle_ms = SWEEP_DEFAULT_IDLE_MS;
+  p->max_txs = SWEEP_DEFAULT_MAX_TXS;
+}
+
+/**
+ * @brief Checks if a policy is valid
+ *
+ * @param[in] p A sweep policy
+ * @return true The policy can be used
+ * @return false Invalid limits
+ */
+static bool sweep_policy_valid(sweep_policy_t const *p) {
+  return p->min_outputs >= 2 && p->max_inputs >= 2 && p->max_inputs <= SWEEP_MAX_INPUTS;
+}
+
+/**
+ * @brief Selects and reserves the outputs of a sweep transaction
+ *
+ * The color held by the most free confirmed outputs is chosen if it reaches the minimum number of outputs, and its
+ * smallest outputs are selected up to the input limit. Spent addresses and reserved outputs are skipped, all colors of
+ * a selected output are consumed.
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ * @param[in] t An unspent output hash table
+ * @param[in] p A sweep policy
+ * @param[out] color The swept color
+ * @return unspent_outputs_t* The selected outputs grouped by address, NULL if nothing needs a sweep
+ */
+unspent_outputs_t *sweep_select(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                sweep_policy_t const *p, byte_t color[]);
+
+/**
+ * @brief Counts free confirmed outputs that a sweep could use
+ *
+ * @param[in] r A reservation table
+ * @param[in] t An unspent output hash table
+ * @return size_t The number of outputs
+ */
+size_t sweep_free_outputs(output_reservation_t *r, unspent_outputs_t **t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "utils/allocator.h"
+#include "wallet/output_reservation.h"
+
+static reserved_output_t *reservation_find(output_reservation_t *r, byte_t const addr[], byte_t const tx_id[]) {
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  memcpy(output_id, addr, TANGLE_ADDRESS_BYTES);
+  memcpy(output_id + TANGLE_ADDRESS_BYTES, tx_id, TX_ID_BYTES);
+
+  reserved_output_t *elm = NULL;
+  HASH_FIND(hh, r->outputs, output_id, TX_OUTPUT_ID_BYTES, elm);
+  return elm;
+}
+
+output_reservation_t *reservation_new() {
+  output_reservation_t *r = malloc(sizeof(output_reservation_t));
+  if (r == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  r->outputs = NULL;
+  r->next_ticket = 1;
+  return r;
+}
+
+void reservation_free(output_reservation_t *r) {
+  if (r) {
+    reserved_output_t *elm, *tmp;
+    HASH_ITER(hh, r->outputs, elm, tmp) {
+      HASH_DEL(r->outputs, elm);
+      free(elm);
+    }
+    free(r);
+  }
+}
+
+uint32_t reservation_ticket(output_reservation_t *r) {
+  uint32_t ticket = r->next_ticket++;
+  if (r->next_ticket == 0) {
+    // 0 is not a valid ticket
+    r->next_ticket = 1;
+  }
+  return ticket;
+}
+
+bool reservation_is_reserved(output_reservation_t *r, byte_t const addr[], byte_t const tx_id[]) {
+  return reservation_find(r, addr, tx_id) != NULL;
+}
+
+int reservation_take(output_reservation_t *r, uint32_t ticket, byte_t const addr[], byte_t const tx_id[]) {
+  if (reservation_find(r, addr, tx_id)) {
+    return -1;
+  }
+
+  reserved_output_t *elm = malloc(sizeof(reserved_output_t));
+  if (elm == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+  memcpy(elm->output_id, addr, TANGLE_ADDRESS_BYTES);
+  memcpy(elm->output_id + TANGLE_ADDRESS_BYTES, tx_id, TX_ID_BYTES);
+  elm->ticket = ticket;
+  elm->committed = false;
+  HASH_ADD(hh, r->outputs, output_id, TX_OUTPUT_ID_BYTES, elm);
+  return 0;
+}
+
+// checks if an output has a color that is still needed.
+static bool output_is_needed(output_ids_t *id, balance_ht_t **remaining) {
+  balance_ht_t *bal, *tmp;
+  HASH_ITER(hh, id->balances, bal, tmp) {
+    balance_ht_t *need = balance_ht_find(remaining, bal->color);
+    if (need && need->value > 0 && bal->value > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// subtracts balances of an output from the remaining, returns true if nothing is needed.
+static bool output_consume(output_ids_t *id, balance_ht_t **remaining) {
+  balance_ht_t *bal, *tmp;
+  HASH_ITER(hh, id->balances, bal, tmp) {
+    balance_ht_t *need = balance_ht_find(remaining, bal->color);
+    if (need) {
+      need->value -= bal->value;
+    }
+  }
+  HASH_ITER(hh, *remaining, bal, tmp) {
+    if (bal->value > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+unspent_outputs_t *reservation_select_colors(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                             balance_ht_t **required) {
+  unspent_outputs_t *selected = unspent_outputs_init();
+  balance_ht_t *remaining = balance_ht_clone(required);
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, *t, elm, tmp) {
+    if (elm->spent) {
+      continue;
+    }
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) {
+      if (!id->st.confirmed || !output_is_needed(id, &remaining) || reservation_is_reserved(r, elm->addr, id->id)) {
+        continue;
+      }
+      if (reservation_take(r, ticket, elm->addr, id->id) != 0) {
+        continue;
+      }
+
+      unspent_outputs_t *in = unspent_outputs_find(&selected, elm->addr);
+      if (in == NULL) {
+        unspent_outputs_add(&selected, elm->addr, elm->addr_index, NULL);
+        in = unspent_outputs_find(&selected, elm->addr);
+      }
+      output_ids_add(&in->ids, id->id, id->balances, &id->st);
+
+      if (output_consume(id, &remaining)) {
+        goto done;
+      }
+    }
+  }
+done:
+  balance_ht_free(&remaining);
+  return selected;
+}
+
+unspent_outputs_t *reservation_select(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                      uint64_t required_balance, byte_t color[]) {
+  balance_ht_t *required = balance_ht_init();
+  if (balance_ht_add(&required, color, (int64_t)required_balance) != 0) {
+    return NULL;
+  }
+  unspent_outputs_t *selected = reservation_select_colors(r, ticket, t, &required);
+  balance_ht_free(&required);
+  return selected;
+}
+
+void reservation_release(output_reservation_t *r, uint32_t ticket) {
+  reserved_output_t *elm, *tmp;
+  HASH_ITER(hh, r->outputs, elm, tmp) {
+    if (elm->ticket == ticket) {
+      HASH_DEL(r->outputs, elm);
+      free(elm);
+    }
+  }
+}
+
+void reservation_commit(output_reservation_t *r, uint32_t ticket) {
+  reserved_output_t *elm, *tmp;
+  HASH_ITER(hh, r->outputs, elm, tmp) {
+    if (elm->ticket == ticket) {
+      elm->committed = true;
+    }
+  }
+}
+
+void reservation_prune(output_reservation_t *r, unspent_outputs_t **t) {
+  reserved_output_t *elm, *tmp;
+  HASH_ITER(hh, r->outputs, elm, tmp) {
+    if (!elm->committed) {
+      continue;
+    }
+    unspent_outputs_t *addr = unspent_outputs_find(t, elm->output_id);
+    // spent addresses are not refreshed anymore and never selected, their outputs would stay reserved forever
+    if (addr == NULL || addr->spent || output_ids_find(&addr->ids, elm->output_id + TANGLE_ADDRESS_BYTES) == NULL) {
+      // consumed on the node
+      HASH_DEL(r->outputs, elm);
+      free(elm);
+    }
+  }
+}
+
+bool reservation_addr_exhausted(output_reservation_t *r, unspent_outputs_t *elm) {
+  output_ids_t *id, *tmp;
+  HASH_ITER(hh, elm->ids, id, tmp) {
+    if (!reservation_is_reserved(r, elm->addr, id->id)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,155 @@
+#ifndef __WALLET_OUTPUT_RESERVATION_H__
+#define __WALLET_OUTPUT_RESERVATION_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/transaction.h"
+#include "core/unspent_outputs.h"
+#include "uthash.h"
+
+/**
+ * @brief Output level reservations
+ *
+ * Outputs are reserved under a ticket while a transaction is being built. The ticket is released if the transaction
+ * is not sent, or committed once it's sent. A committed output stays reserved until the node stops reporting it as
+ * unspent, so transactions can be built back to back against local state without conflicting inputs.
+ *
+ */
+
+typedef struct {
+  byte_t output_id[TX_OUTPUT_ID_BYTES];  // address + transaction id
+  uint32_t ticket;
+  bool committed;
+  UT_hash_handle hh;
+} reserved_output_t;
+
+typedef struct {
+  reserved_output_t *outputs;
+  uint32_t next_ticket;
+} output_reservation_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty reservation table
+ *
+ * @return output_reservation_t* NULL on failed
+ */
+output_reservation_t *reservation_new();
+
+/**
+ * @brief Frees a reservation table
+ *
+ * @param[in] r A reservation table
+ */
+void reservation_free(output_reservation_t *r);
+
+/**
+ * @brief Gets a new ticket for a transaction
+ *
+ * @param[in] r A reservation table
+ * @return uint32_t A ticket, never 0
+ */
+uint32_t reservation_ticket(output_reservation_t *r);
+
+/**
+ * @brief Checks if an output is reserved
+ *
+ * @param[in] r A reservation table
+ * @param[in] addr The address of the output
+ * @param[in] tx_id The transaction id of the output
+ * @return true The output is reserved by a ticket
+ * @return false The output is free
+ */
+bool reservation_is_reserved(output_reservation_t *r, byte_t const addr[], byte_t const tx_id[]);
+
+/**
+ * @brief Reserves an output under a ticket
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ * @param[in] addr The address of the output
+ * @param[in] tx_id The transaction id of the output
+ * @return int 0 on success, -1 if it's reserved already
+ */
+int reservation_take(output_reservation_t *r, uint32_t ticket, byte_t const addr[], byte_t const tx_id[]);
+
+/**
+ * @brief Selects and reserves free confirmed outputs that are sufficient to the given balance
+ *
+ * Spent addresses and reserved outputs are skipped, all selected outputs are reserved under the ticket.
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ * @param[in] t An unspent output hash table
+ * @param[in] required_balance A required balance
+ * @param[in] color A required color
+ * @return unspent_outputs_t* The selected outputs grouped by address
+ */
+unspent_outputs_t *reservation_select(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                      uint64_t required_balance, byte_t color[]);
+
+/**
+ * @brief Selects and reserves free confirmed outputs that are sufficient to the required balances of multiple colors
+ *
+ * An output is selected if it holds a color that is still needed, all colors of a selected output are consumed.
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ * @param[in] t An unspent output hash table
+ * @param[in] required A balance table of required values by color
+ * @return unspent_outputs_t* The selected outputs grouped by address
+ */
+unspent_outputs_t *reservation_select_colors(output_reservation_t *r, uint32_t ticket, unspent_outputs_t **t,
+                                             balance_ht_t **required);
+
+/**
+ * @brief Releases all outputs of a ticket, it's used when a transaction was not sent.
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ */
+void reservation_release(output_reservation_t *r, uint32_t ticket);
+
+/**
+ * @brief Commits all outputs of a ticket, it's used when a transaction was sent.
+ *
+ * @param[in] r A reservation table
+ * @param[in] ticket A ticket
+ */
+void reservation_commit(output_reservation_t *r, uint32_t ticket);
+
+/**
+ * @brief Drops committed outputs that are no longer in the unspent output table, or are on a spent address
+ *
+ * @param[in] r A reservation table
+ * @param[in] t An unspent output hash table from the latest refresh
+ */
+void reservation_prune(output_reservation_t *r, unspent_outputs_t **t);
+
+/**
+ * @brief Checks if all outputs of an address are reserved
+ *
+ * @param[in] r A reservation table
+ * @param[in] elm An element of the unspent output table
+ * @return true No free output on this address
+ * @return false At least one output is free
+ */
+bool reservation_addr_exhausted(output_reservation_t *r, unspent_outputs_t *elm);
+
+/**
+ * @brief Gets the number of reserved outputs
+ *
+ * @param[in] r A reservation table
+ * @return size_t
+ */
+static size_t reservation_count(output_reservation_t *r) { return HASH_COUNT(r->outputs); }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
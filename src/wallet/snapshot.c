@@ -0,0 +1,94 @@
+#include <sched.h>
+#include <stdio.h>
+
+#include "utils/allocator.h"
+#include "wallet/snapshot.h"
+
+static wallet_snapshot_t *snapshot_new() {
+  wallet_snapshot_t *snap = malloc(sizeof(wallet_snapshot_t));
+  if (snap == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  snap->version = 0;
+  snap->timestamp = 0;
+  snap->balance = 0;
+  snap->store = utxo_store_new();
+  if (snap->store == NULL) {
+    free(snap);
+    return NULL;
+  }
+  return snap;
+}
+
+static void snapshot_free(wallet_snapshot_t *snap) {
+  if (snap) {
+    utxo_store_free(snap->store);
+    free(snap);
+  }
+}
+
+int snapshot_rcu_init(snapshot_rcu_t *rcu) {
+  rcu->spare = NULL;
+  rcu->epoch = 0;
+  rcu->readers[0] = 0;
+  rcu->readers[1] = 0;
+  rcu->current = snapshot_new();
+  return rcu->current ? 0 : -1;
+}
+
+void snapshot_rcu_destroy(snapshot_rcu_t *rcu) {
+  snapshot_free(rcu->current);
+  snapshot_free(rcu->spare);
+  rcu->current = NULL;
+  rcu->spare = NULL;
+}
+
+wallet_snapshot_t *snapshot_writable(snapshot_rcu_t *rcu) {
+  wallet_snapshot_t *snap = rcu->spare;
+  if (snap) {
+    rcu->spare = NULL;
+    return snap;
+  }
+  return snapshot_new();
+}
+
+void snapshot_publish(snapshot_rcu_t *rcu, wallet_snapshot_t *next) {
+  // only writers change the current pointer, the snapshot must be complete before it's visible
+  next->version = rcu->current->version + 1;
+  wallet_snapshot_t *prev = __atomic_exchange_n(&rcu->current, next, __ATOMIC_SEQ_CST);
+
+  // readers registered from now on see the new snapshot, waits for readers of the previous epoch
+  uint64_t epoch = __atomic_fetch_add(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&rcu->readers[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+    sched_yield();
+  }
+
+  snapshot_free(rcu->spare);
+  rcu->spare = prev;
+}
+
+void snapshot_discard(snapshot_rcu_t *rcu, wallet_snapshot_t *snap) {
+  snapshot_free(rcu->spare);
+  rcu->spare = snap;
+}
+
+wallet_snapshot_t const *snapshot_read_begin(snapshot_rcu_t *rcu, snapshot_read_t *r) {
+  for (;;) {
+    uint64_t epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST);
+    uint32_t slot = epoch & 1;
+    __atomic_fetch_add(&rcu->readers[slot], 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST) == epoch) {
+      r->slot = slot;
+      r->snap = __atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST);
+      return r->snap;
+    }
+    // the epoch flipped, registers again in the new slot
+    __atomic_fetch_sub(&rcu->readers[slot], 1, __ATOMIC_SEQ_CST);
+  }
+}
+
+void snapshot_read_end(snapshot_rcu_t *rcu, snapshot_read_t *r) {
+  __atomic_fetch_sub(&rcu->readers[r->slot], 1, __ATOMIC_SEQ_CST);
+  r->snap = NULL;
+}
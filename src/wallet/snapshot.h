@@ -0,0 +1,103 @@
+#ifndef __WALLET_SNAPSHOT_H__
+#define __WALLET_SNAPSHOT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/utxo_store.h"
+
+/**
+ * @brief Immutable read snapshots of the wallet state
+ *
+ * Readers pin the current snapshot without taking a lock: they register in one of two reader slots selected by the
+ * epoch parity and load the snapshot pointer. A writer fills a private snapshot, swaps the pointer atomically, flips
+ * the epoch, and waits until the slot of the previous epoch drains. The replaced snapshot is then unreachable and is
+ * kept as a spare for the next publish. Writers must be serialized by the caller.
+ *
+ */
+
+typedef struct {
+  uint64_t version;    // increased by every publish
+  uint64_t timestamp;  // milliseconds since the Epoch
+  uint64_t balance;    // the sum of confirmed balances that are not spent locally
+  utxo_store_t *store;
+} wallet_snapshot_t;
+
+typedef struct {
+  wallet_snapshot_t *current;
+  wallet_snapshot_t *spare;  // a reclaimed snapshot, reused by the next publish
+  uint64_t epoch;
+  uint32_t readers[2];  // active readers by epoch parity
+} snapshot_rcu_t;
+
+// a pinned snapshot
+typedef struct {
+  wallet_snapshot_t const *snap;
+  uint32_t slot;
+} snapshot_read_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a snapshot domain with an empty snapshot
+ *
+ * @param[in] rcu A snapshot domain
+ * @return int 0 on success
+ */
+int snapshot_rcu_init(snapshot_rcu_t *rcu);
+
+/**
+ * @brief Frees all snapshots, there must be no active reader.
+ *
+ * @param[in] rcu A snapshot domain
+ */
+void snapshot_rcu_destroy(snapshot_rcu_t *rcu);
+
+/**
+ * @brief Gets a private snapshot for the writer to fill in
+ *
+ * @param[in] rcu A snapshot domain
+ * @return wallet_snapshot_t* NULL on failed
+ */
+wallet_snapshot_t *snapshot_writable(snapshot_rcu_t *rcu);
+
+/**
+ * @brief Publishes a snapshot from snapshot_writable() and waits for readers of the replaced one
+ *
+ * @param[in] rcu A snapshot domain
+ * @param[in] next The new snapshot
+ */
+void snapshot_publish(snapshot_rcu_t *rcu, wallet_snapshot_t *next);
+
+/**
+ * @brief Returns a snapshot from snapshot_writable() without publishing it
+ *
+ * @param[in] rcu A snapshot domain
+ * @param[in] snap The unpublished snapshot
+ */
+void snapshot_discard(snapshot_rcu_t *rcu, wallet_snapshot_t *snap);
+
+/**
+ * @brief Pins the current snapshot, it's lock-free and doesn't block writers from publishing.
+ *
+ * @param[in] rcu A snapshot domain
+ * @param[out] r The pinned snapshot
+ * @return wallet_snapshot_t const* The snapshot, valid until snapshot_read_end()
+ */
+wallet_snapshot_t const *snapshot_read_begin(snapshot_rcu_t *rcu, snapshot_read_t *r);
+
+/**
+ * @brief Unpins a snapshot
+ *
+ * @param[in] rcu A snapshot domain
+ * @param[in] r The pinned snapshot
+ */
+void snapshot_read_end(snapshot_rcu_t *rcu, snapshot_read_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
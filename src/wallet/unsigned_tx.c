@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sodium.h"
+#include "utils/allocator.h"
+#include "wallet/unsigned_tx.h"
+
+static UT_icd const utx_signer_icd = {sizeof(utx_signer_t), NULL, NULL, NULL};
+
+static char const utx_magic[4] = {'G', 'S', 'U', 'T'};
+
+wallet_utx_t* utx_new() {
+  wallet_utx_t* utx = malloc(sizeof(wallet_utx_t));
+  if (utx == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(utx, 0, sizeof(wallet_utx_t));
+  utx->tx.inputs = tx_inputs_new();
+  utx->tx.outputs = tx_outputs_new();
+  utx->tx.signatures = ed_signatures_init();
+  utarray_new(utx->signers, &utx_signer_icd);
+  return utx;
+}
+
+void utx_free(wallet_utx_t* utx) {
+  if (utx) {
+    if (utx->tx.inputs) {
+      tx_inputs_free(utx->tx.inputs);
+    }
+    if (utx->tx.outputs) {
+      tx_outputs_free(utx->tx.outputs);
+    }
+    ed_signatures_destory(&utx->tx.signatures);
+    if (utx->signers) {
+      utarray_free(utx->signers);
+    }
+    free(utx);
+  }
+}
+
+void utx_add_signer(wallet_utx_t* utx, byte_t const addr[], uint64_t addr_index) {
+  utx_signer_t signer = {};
+  memcpy(signer.addr, addr, TANGLE_ADDRESS_BYTES);
+  signer.addr_index = addr_index;
+  utarray_push_back(utx->signers, &signer);
+}
+
+int utx_sign(wallet_utx_t* utx, byte_t const seed[]) {
+  if (utx_signers_len(utx) == 0 || tx_outputs_len(utx->tx.outputs) == 0) {
+    printf("[%s:%d] nothing to sign\n", __func__, __LINE__);
+    return -1;
+  }
+
+  // calculate essence of the transaction
+  byte_buf_t* essence = tx_essence(&utx->tx);
+  if (essence == NULL) {
+    printf("[%s:%d] transaction essence calculation failed\n", __func__, __LINE__);
+    return -1;
+  }
+
+  byte_t addr_pub[ED_PUBLIC_KEY_BYTES] = {};
+  byte_t addr_priv[ED_PRIVATE_KEY_BYTES] = {};
+  byte_t addr_sig[ED_SIGNATURE_BYTES] = {};
+  ed_signatures_destory(&utx->tx.signatures);
+
+  int ret = 0;
+  utx_signer_t* signer = NULL;
+  for (signer = (utx_signer_t*)utarray_front(utx->signers); signer != NULL && ret == 0;
+       signer = (utx_signer_t*)utarray_next(utx->signers, signer)) {
+    sign_signature(seed, signer->addr_index, essence->data, essence->len, addr_sig);
+    address_ed25519_keypair(seed, signer->addr_index, addr_pub, addr_priv);
+    ret = ed_signatures_add(&utx->tx.signatures, signer->addr, addr_pub, addr_sig);
+  }
+  // don't keep private keys on the stack, a plain memset is removed as a dead store
+  sodium_memzero(addr_priv, sizeof(addr_priv));
+  byte_buf_free(essence);
+  return ret;
+}
+
+int utx_submit(tangle_client_conf_t const* endpoint, wallet_utx_t* utx, res_send_tx_t* res) {
+  if (!utx_is_signed(utx) || tx_signautres_valid(&utx->tx) == false) {
+    printf("[%s:%d] transaction validation failed\n", __func__, __LINE__);
+    return -1;
+  }
+
+  byte_buf_t* tx_bytes = tx_2_base64(&utx->tx);
+  if (tx_bytes == NULL) {
+    printf("[%s:%d] encode transaction failed\n", __func__, __LINE__);
+    return -1;
+  }
+  int ret = send_tx_bytes(endpoint, tx_bytes->data, res);
+  if (ret != 0) {
+    printf("[%s:%d] send transaction failed\n", __func__, __LINE__);
+  }
+  byte_buf_free(tx_bytes);
+  return ret;
+}
+
+// ========= serialization =========
+
+static bool put_le(byte_buf_t* buf, uint64_t v, size_t bytes) {
+  byte_t b[8];
+  for (size_t i = 0; i < bytes; i++) {
+    b[i] = (byte_t)(v >> (8 * i));
+  }
+  return byte_buf_append(buf, b, bytes);
+}
+
+// reads a little endian value, returns false if data is too short.
+static bool get_le(byte_t const data[], size_t len, size_t* off, size_t bytes, uint64_t* v) {
+  if (len - *off < bytes) {
+    return false;
+  }
+  *v = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    *v |= (uint64_t)data[*off + i] << (8 * i);
+  }
+  *off += bytes;
+  return true;
+}
+
+static bool get_bytes(byte_t const data[], size_t len, size_t* off, byte_t out[], size_t bytes) {
+  if (len - *off < bytes) {
+    return false;
+  }
+  memcpy(out, data + *off, bytes);
+  *off += bytes;
+  return true;
+}
+
+int utx_serialize(wallet_utx_t* utx, byte_buf_t* buf) {
+  bool ok = byte_buf_append(buf, (byte_t const*)utx_magic, sizeof(utx_magic)) && put_le(buf, UTX_FORMAT_VERSION, 4) &&
+            put_le(buf, utx->ticket, 4);
+
+  // inputs
+  byte_t* input = NULL;
+  ok = ok && put_le(buf, tx_inputs_len(utx->tx.inputs), 4);
+  TX_INPUTS_FOREACH(utx->tx.inputs, input) { ok = ok && byte_buf_append(buf, input, TX_OUTPUT_ID_BYTES); }
+
+  // outputs
+  tx_output_t* out = NULL;
+  ok = ok && put_le(buf, tx_outputs_len(utx->tx.outputs), 4);
+  TX_OUTPUTS_FOREACH(utx->tx.outputs, out) {
+    ok = ok && byte_buf_append(buf, out->address, TANGLE_ADDRESS_BYTES) && put_le(buf, out->addr_index, 8) &&
+         put_le(buf, balance_list_len(out->balances), 4);
+    for (size_t i = 0; ok && i < balance_list_len(out->balances); i++) {
+      balance_t* b = balance_list_at(out->balances, i);
+      ok = byte_buf_append(buf, b->color, BALANCE_COLOR_BYTES) && put_le(buf, (uint64_t)b->value, 8);
+    }
+  }
+
+  // signers
+  utx_signer_t* signer = NULL;
+  ok = ok && put_le(buf, utx_signers_len(utx), 4);
+  for (signer = (utx_signer_t*)utarray_front(utx->signers); ok && signer != NULL;
+       signer = (utx_signer_t*)utarray_next(utx->signers, signer)) {
+    ok = byte_buf_append(buf, signer->addr, TANGLE_ADDRESS_BYTES) && put_le(buf, signer->addr_index, 8);
+  }
+
+  // signatures
+  ed_signature_t *sig, *tmp;
+  ok = ok && put_le(buf, ed_signatures_count(&utx->tx.signatures), 4);
+  HASH_ITER(hh, utx->tx.signatures, sig, tmp) {
+    ok = ok && byte_buf_append(buf, sig->address, TANGLE_ADDRESS_BYTES) &&
+         byte_buf_append(buf, sig->pub_key, ED_PUBLIC_KEY_BYTES) &&
+         byte_buf_append(buf, sig->signature, ED_SIGNATURE_BYTES);
+  }
+
+  if (!ok) {
+    printf("[%s:%d] append buffer failed\n", __func__, __LINE__);
+    return -1;
+  }
+  return 0;
+}
+
+wallet_utx_t* utx_deserialize(byte_t const data[], size_t len) {
+  size_t off = 0;
+  uint64_t v = 0;
+  if (len < sizeof(utx_magic) || memcmp(data, utx_magic, sizeof(utx_magic)) != 0) {
+    printf("[%s:%d] invalid header\n", __func__, __LINE__);
+    return NULL;
+  }
+  off += sizeof(utx_magic);
+  if (!get_le(data, len, &off, 4, &v) || v != UTX_FORMAT_VERSION) {
+    printf("[%s:%d] unsupported version\n", __func__, __LINE__);
+    return NULL;
+  }
+
+  wallet_utx_t* utx = utx_new();
+  if (utx == NULL) {
+    return NULL;
+  }
+  if (!get_le(data, len, &off, 4, &v)) {
+    goto err;
+  }
+  utx->ticket = (uint32_t)v;
+
+  // inputs
+  uint64_t n = 0;
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  if (!get_le(data, len, &off, 4, &n)) {
+    goto err;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (!get_bytes(data, len, &off, output_id, TX_OUTPUT_ID_BYTES)) {
+      goto err;
+    }
+    tx_inputs_push(utx->tx.inputs, output_id);
+  }
+
+  // outputs
+  if (!get_le(data, len, &off, 4, &n)) {
+    goto err;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    tx_output_t out = {};
+    uint64_t balances = 0;
+    if (!get_bytes(data, len, &off, out.address, TANGLE_ADDRESS_BYTES) || !get_le(data, len, &off, 8, &out.addr_index) ||
+        !get_le(data, len, &off, 4, &balances)) {
+      goto err;
+    }
+    out.balances = balance_list_new();
+    for (uint64_t b = 0; b < balances; b++) {
+      balance_t bal = {};
+      if (!get_bytes(data, len, &off, bal.color, BALANCE_COLOR_BYTES) || !get_le(data, len, &off, 8, &v)) {
+        balance_list_free(out.balances);
+        goto err;
+      }
+      bal.value = (int64_t)v;
+      balance_list_push(out.balances, &bal);
+    }
+    tx_outputs_push(utx->tx.outputs, &out);
+    balance_list_free(out.balances);
+  }
+
+  // signers
+  if (!get_le(data, len, &off, 4, &n)) {
+    goto err;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    utx_signer_t signer = {};
+    if (!get_bytes(data, len, &off, signer.addr, TANGLE_ADDRESS_BYTES) ||
+        !get_le(data, len, &off, 8, &signer.addr_index)) {
+      goto err;
+    }
+    utarray_push_back(utx->signers, &signer);
+  }
+
+  // signatures
+  if (!get_le(data, len, &off, 4, &n) || n > utx_signers_len(utx)) {
+    goto err;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    byte_t addr[TANGLE_ADDRESS_BYTES], pub[ED_PUBLIC_KEY_BYTES], sig[ED_SIGNATURE_BYTES];
+    if (!get_bytes(data, len, &off, addr, sizeof(addr)) || !get_bytes(data, len, &off, pub, sizeof(pub)) ||
+        !get_bytes(data, len, &off, sig, sizeof(sig)) || ed_signatures_add(&utx->tx.signatures, addr, pub, sig) != 0) {
+      goto err;
+    }
+  }
+  if (off != len) {
+    goto err;
+  }
+  return utx;
+
+err:
+  printf("[%s:%d] invalid data\n", __func__, __LINE__);
+  utx_free(utx);
+  return NULL;
+}
@@ -0,0 +1,130 @@
+#ifndef __WALLET_UNSIGNED_TX_H__
+#define __WALLET_UNSIGNED_TX_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/api/send_transaction.h"
+#include "client/client_service.h"
+#include "core/transaction.h"
+#include "utarray.h"
+#include "utils/byte_buffer.h"
+
+/**
+ * @brief A transaction between pipeline stages
+ *
+ * A payment is built, signed, and submitted in separate stages. Building needs the wallet state, signing needs the
+ * seed and is CPU bound, and submitting is I/O bound, so each stage can run on its own worker pool or process. The
+ * binary format carries the essence, the addresses that sign it, and the signatures once it's signed.
+ *
+ */
+
+// the serialization format version
+#define UTX_FORMAT_VERSION 1
+
+// an input address that signs the transaction
+typedef struct {
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  uint64_t addr_index;
+} utx_signer_t;
+
+typedef struct {
+  uint32_t ticket;    // the reservation ticket of the inputs, only meaningful to the building wallet
+  transaction_t tx;   // inputs and outputs, signatures are added by utx_sign()
+  UT_array* signers;  // utx_signer_t, one per input address
+} wallet_utx_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty transaction
+ *
+ * @return wallet_utx_t* NULL on failed
+ */
+wallet_utx_t* utx_new();
+
+/**
+ * @brief Frees a transaction
+ *
+ * @param[in] utx A transaction
+ */
+void utx_free(wallet_utx_t* utx);
+
+/**
+ * @brief Adds an input address that signs the transaction
+ *
+ * @param[in] utx A transaction
+ * @param[in] addr The address
+ * @param[in] addr_index The index of the address
+ */
+void utx_add_signer(wallet_utx_t* utx, byte_t const addr[], uint64_t addr_index);
+
+/**
+ * @brief Gets the number of signers
+ *
+ * @param[in] utx A transaction
+ * @return size_t
+ */
+static size_t utx_signers_len(wallet_utx_t const* utx) { return utarray_len(utx->signers); }
+
+/**
+ * @brief Checks if a transaction is signed by all signers
+ *
+ * @param[in] utx A transaction
+ * @return bool
+ */
+static bool utx_is_signed(wallet_utx_t* utx) {
+  return utx_signers_len(utx) > 0 && ed_signatures_count(&utx->tx.signatures) == utx_signers_len(utx);
+}
+
+/**
+ * @brief Signs a transaction, the essence is computed once for all signers
+ *
+ * It doesn't touch any wallet state and can run on any thread.
+ *
+ * @param[in] utx A transaction
+ * @param[in] seed The seed of the input addresses
+ * @return int 0 on success
+ */
+int utx_sign(wallet_utx_t* utx, byte_t const seed[]);
+
+/**
+ * @brief Validates the signatures and sends a signed transaction
+ *
+ * @param[in] endpoint The endpoint
+ * @param[in] utx A signed transaction
+ * @param[out] res The response
+ * @return int 0 on success
+ */
+int utx_submit(tangle_client_conf_t const* endpoint, wallet_utx_t* utx, res_send_tx_t* res);
+
+/**
+ * @brief Appends a transaction to a buffer
+ *
+ * The format is little endian: "GSUT", version (u32), ticket (u32), inputs (u32) and their output ids, outputs (u32)
+ * and per output the address, address index (u64), balances (u32) and per balance the color and value (i64), signers
+ * (u32) and per signer the address and address index (u64), then signatures (u32) and per signature the address,
+ * public key, and signature.
+ *
+ * @param[in] utx A transaction
+ * @param[out] buf A byte buffer
+ * @return int 0 on success
+ */
+int utx_serialize(wallet_utx_t* utx, byte_buf_t* buf);
+
+/**
+ * @brief Creates a transaction from serialized data
+ *
+ * @param[in] data The serialized data
+ * @param[in] len The length of data
+ * @return wallet_utx_t* NULL on invalid data
+ */
+wallet_utx_t* utx_deserialize(byte_t const data[], size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,10 +1,13 @@
+#include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "client/api/get_funds.h"
 #include "client/api/get_node_info.h"
 #include "client/api/get_unspent_outputs.h"
 #include "client/api/send_transaction.h"
+#include "utils/metrics.h"
 #include "wallet/wallet.h"
 
 static tx_inputs_t* wallet_build_inputs(wallet_t* w, unspent_outputs_t* unspent) {
@@ -19,124 +22,234 @@ static tx_inputs_t* wallet_build_inputs(wallet_t* w, unspent_outputs_t* unspent)
       tx_inputs_push(inputs, output_id);
     }
   }
+  metric_observe(&g_metric_selection_inputs, tx_inputs_len(inputs));
 
   return inputs;
 }
 
-static tx_outputs_t* wallet_build_outputs(wallet_t* w, send_funds_op_t* dest, unspent_outputs_t* unspent) {
-  tx_outputs_t* outputs = tx_outputs_new();
-  uint64_t output_balance = unspent_outputs_balance_with_color(&unspent, dest->color);
-  bool recv_eq_remainder = false;
-  // is the remainder needed?
-  if (output_balance > dest->amount) {
-    if (empty_byte_array(dest->remainder, TANGLE_ADDRESS_BYTES)) {
-      tx_output_t out = {};
-      for (uint64_t i = w->addr_manager->first_unspent_idx; i <= w->addr_manager->last_addr_index; i++) {
-        address_get(w->addr_manager->seed, i, ADDRESS_VER_ED25519, dest->remainder);
-        if (unspent_outputs_find(&unspent, dest->remainder) == NULL) {
-          out.addr_index = i;
-          break;
-        }
-        if (i == w->addr_manager->last_addr_index) {
-          am_get_new_address(w->addr_manager, dest->remainder);
-          out.addr_index = w->addr_manager->last_addr_index + 1;
-        }
-      }
+// adds a new address to the unspent outputs table and indices.
+static void wallet_track_address(wallet_t* w, byte_t const addr[], uint64_t index) {
+  if (unspent_outputs_find(&w->unspent, addr) == NULL) {
+    unspent_outputs_add(&w->unspent, addr, index, NULL);
+    unspent_index_add(w->index, unspent_outputs_find(&w->unspent, addr));
+  }
+}
 
-      memcpy(out.address, dest->remainder, TANGLE_ADDRESS_BYTES);
+// an output of the transaction being built, balances to the same address are merged.
+typedef struct {
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  uint64_t addr_index;
+  balance_ht_t* balances;
+  UT_hash_handle hh;
+} wallet_output_t;
+
+static int wallet_output_add(wallet_output_t** t, byte_t const addr[], uint64_t addr_index, byte_t const color[],
+                             int64_t value) {
+  wallet_output_t* out = NULL;
+  HASH_FIND(hh, *t, addr, TANGLE_ADDRESS_BYTES, out);
+  if (out == NULL) {
+    out = malloc(sizeof(wallet_output_t));
+    if (out == NULL) {
+      printf("[%s:%d] OOM\n", __func__, __LINE__);
+      return -1;
+    }
+    memcpy(out->addr, addr, TANGLE_ADDRESS_BYTES);
+    out->addr_index = addr_index;
+    out->balances = balance_ht_init();
+    HASH_ADD(hh, *t, addr, TANGLE_ADDRESS_BYTES, out);
+  }
 
-      // create balance
-      balance_t balance = {};
-      memcpy(balance.color, dest->color, BALANCE_COLOR_BYTES);
-
-      if (memcmp(dest->receiver, dest->remainder, TANGLE_ADDRESS_BYTES) == 0) {
-        // put all outputs in the same address
-        recv_eq_remainder = true;
-        balance.value = (int64_t)output_balance;
-      } else {
-        balance.value = (int64_t)output_balance - dest->amount;
-      }
-      out.balances = balance_list_new();
-      balance_list_push(out.balances, &balance);
+  balance_ht_t* bal = balance_ht_find(&out->balances, color);
+  if (bal) {
+    bal->value += value;
+    return 0;
+  }
+  return balance_ht_add(&out->balances, color, value);
+}
 
-      // add to transaction output list
-      tx_outputs_push(outputs, &out);
+static void wallet_outputs_free(wallet_output_t** t) {
+  wallet_output_t *out, *tmp;
+  HASH_ITER(hh, *t, out, tmp) {
+    balance_ht_free(&out->balances);
+    HASH_DEL(*t, out);
+    free(out);
+  }
+}
 
-      balance_list_free(out.balances);
+// generates a new address and adds it to the unspent outputs table, returns its index.
+static uint64_t wallet_new_address(wallet_t* w, byte_t addr[]) {
+  am_get_new_address(w->addr_manager, addr);
+  wallet_track_address(w, addr, w->addr_manager->last_addr_index);
+  return w->addr_manager->last_addr_index;
+}
+
+// looks up an unspent address which is not used as an input, or creates a new one.
+static uint64_t wallet_find_remainder(wallet_t* w, unspent_outputs_t* inputs, byte_t remainder[]) {
+  for (uint64_t i = w->addr_manager->first_unspent_idx; i <= w->addr_manager->last_addr_index; i++) {
+    unspent_outputs_t* elm = unspent_index_find_by_addr_index(w->index, i);
+    if (elm && !elm->spent && unspent_outputs_find(&inputs, elm->addr) == NULL) {
+      memcpy(remainder, elm->addr, TANGLE_ADDRESS_BYTES);
+      return i;
     }
   }
+  return wallet_new_address(w, remainder);
+}
 
-  if (!recv_eq_remainder) {
-    // add unspent to output
-    // creates output with dest address
-    tx_output_t out = {};
-    balance_t bal = {};
-    memcpy(out.address, dest->receiver, TANGLE_ADDRESS_BYTES);
-    memcpy(bal.color, dest->color, BALANCE_COLOR_BYTES);
-    bal.value = dest->amount;
-    out.balances = balance_list_new();
-    balance_list_push(out.balances, &bal);
-    tx_outputs_push(outputs, &out);
-    balance_list_free(out.balances);
+// builds one output per address, all colors of the inputs that are not paid go to a single remainder output.
+static tx_outputs_t* wallet_build_outputs(wallet_t* w, wallet_payment_t const payments[], size_t count,
+                                          byte_t remainder[], unspent_outputs_t* inputs) {
+  wallet_output_t* outs = NULL;
+  tx_outputs_t* outputs = NULL;
+
+  // sums of inputs by color, the paid amounts are subtracted from it
+  balance_ht_t* left = balance_ht_init();
+  unspent_outputs_t *in, *in_tmp;
+  HASH_ITER(hh, inputs, in, in_tmp) {
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, in->ids, id, id_tmp) {
+      balance_ht_t *bal, *bal_tmp;
+      HASH_ITER(hh, id->balances, bal, bal_tmp) {
+        balance_ht_t* sum = balance_ht_find(&left, bal->color);
+        if (sum) {
+          sum->value += bal->value;
+        } else if (balance_ht_add(&left, bal->color, bal->value) != 0) {
+          goto end;
+        }
+      }
+    }
   }
 
-  return outputs;
-}
+  for (size_t i = 0; i < count; i++) {
+    if (wallet_output_add(&outs, payments[i].receiver, 0, payments[i].color, (int64_t)payments[i].amount) != 0) {
+      goto end;
+    }
+    balance_ht_t* sum = balance_ht_find(&left, payments[i].color);
+    if (sum == NULL) {
+      printf("[%s:%d] no input holds the color of payment %zu\n", __func__, __LINE__, i);
+      goto end;
+    }
+    sum->value -= (int64_t)payments[i].amount;
+  }
 
-static int wallet_sign_tx(wallet_t* w, transaction_t* tx, unspent_outputs_t* inputs) {
-  if (tx == NULL || tx->outputs == NULL || tx->inputs == NULL) {
-    printf("[%s:%d] null parameters\n", __func__, __LINE__);
-    return -1;
+  // is the remainder needed?
+  balance_ht_t *bal, *bal_tmp;
+  HASH_ITER(hh, left, bal, bal_tmp) {
+    if (bal->value <= 0) {
+      continue;
+    }
+    uint64_t addr_index = 0;
+    if (empty_byte_array(remainder, TANGLE_ADDRESS_BYTES)) {
+      addr_index = wallet_find_remainder(w, inputs, remainder);
+    } else {
+      unspent_outputs_t* elm = unspent_outputs_find(&w->unspent, remainder);
+      addr_index = elm ? elm->addr_index : 0;
+    }
+    if (wallet_output_add(&outs, remainder, addr_index, bal->color, bal->value) != 0) {
+      goto end;
+    }
   }
 
-  // calculate essence of the transaction
-  byte_buf_t* essence = tx_essence(tx);
-  if (essence == NULL) {
-    printf("[%s:%d] transaction essence calculation failed\n", __func__, __LINE__);
-    return -1;
+  outputs = tx_outputs_new();
+  wallet_output_t *out, *out_tmp;
+  HASH_ITER(hh, outs, out, out_tmp) {
+    tx_output_t tx_out = {};
+    tx_out.addr_index = out->addr_index;
+    memcpy(tx_out.address, out->addr, TANGLE_ADDRESS_BYTES);
+    tx_out.balances = balance_list_new();
+    HASH_ITER(hh, out->balances, bal, bal_tmp) {
+      balance_t balance = {};
+      balance_init(bal->color, bal->value, &balance);
+      balance_list_push(tx_out.balances, &balance);
+    }
+    tx_outputs_push(outputs, &tx_out);
+    balance_list_free(tx_out.balances);
   }
 
-  // get signature
-  byte_t addr_pub[ED_PUBLIC_KEY_BYTES] = {};
-  byte_t addr_priv[ED_PRIVATE_KEY_BYTES] = {};
-  byte_t addr_sig[ED_SIGNATURE_BYTES] = {};
-  tx_output_t* out = NULL;
+end:
+  balance_ht_free(&left);
+  wallet_outputs_free(&outs);
+  return outputs;
+}
 
-  if (tx->signatures) {
-    ed_signatures_destory(&tx->signatures);
+static uint64_t wallet_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static endpoint_pool_t* wallet_endpoint_pool(wallet_t* w) {
+  pthread_mutex_lock(&w->lock);
+  endpoint_pool_t* pool = w->endpoints;
+  pthread_mutex_unlock(&w->lock);
+  return pool;
+}
+
+// the node of a request, the best one of the pool if set. Returns the index of the node in the pool or -1.
+static int wallet_endpoint(wallet_t* w, tangle_client_conf_t* conf) {
+  endpoint_pool_t* pool = wallet_endpoint_pool(w);
+  int node = pool ? endpoint_pool_pick(pool, conf) : -1;
+  if (node < 0) {
+    *conf = w->endpoint;
   }
-  tx->signatures = ed_signatures_init();
+  return node;
+}
 
-  unspent_outputs_t *in, *in_tmp;
-  HASH_ITER(hh, inputs, in, in_tmp) {
-    sign_signature(w->addr_manager->seed, in->addr_index, essence->data, essence->len, addr_sig);
-    address_ed25519_keypair(w->addr_manager->seed, in->addr_index, addr_pub, addr_priv);
-    ed_signatures_add(&tx->signatures, in->addr, addr_pub, addr_sig);
+// reports the result of a request to the pool
+static void wallet_endpoint_report(wallet_t* w, int node, int ret, uint64_t start_us) {
+  endpoint_pool_t* pool = wallet_endpoint_pool(w);
+  if (pool && node >= 0) {
+    endpoint_pool_report(pool, node, ret, endpoint_now_us() - start_us);
   }
+}
 
-  byte_buf_free(essence);
-  return 0;
+// publishes a new snapshot after the unspent outputs table changed, the caller holds the wallet lock.
+static void wallet_publish_snapshot(wallet_t* w) {
+  wallet_snapshot_t* next = snapshot_writable(&w->snapshots);
+  if (next == NULL) {
+    printf("[%s:%d] create snapshot failed\n", __func__, __LINE__);
+    return;
+  }
+  if (utxo_store_load(next->store, &w->unspent) != 0) {
+    printf("[%s:%d] update utxo store failed\n", __func__, __LINE__);
+    snapshot_discard(&w->snapshots, next);
+    return;
+  }
+  next->balance = utxo_store_balance(next->store, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT);
+  next->timestamp = wallet_now_ms();
+  metric_set(&g_metric_utxo_outputs, (int64_t)next->store->len);
+  snapshot_publish(&w->snapshots, next);
 }
 
-wallet_t* wallet_init(char const url[], uint16_t port, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
+wallet_t* wallet_open(char const url[], uint16_t port, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
                       uint64_t last_unspent) {
+  address_t* addrs = NULL;
   wallet_t* ctx = malloc(sizeof(wallet_t));
   if (ctx == NULL) {
     printf("[%s %d] OOM\n", __func__, __LINE__);
     return NULL;
   }
+  memset(ctx, 0, sizeof(wallet_t));
+  pthread_mutex_init(&ctx->lock, NULL);
+  pthread_mutex_init(&ctx->refresher.lock, NULL);
+  pthread_cond_init(&ctx->refresher.cond, NULL);
+  sweep_policy_init(&ctx->sweep);
+  ctx->sweep.max_txs = 0;
+  ctx->refresh_chunk = UNSPENT_OUTPUTS_CHUNK_SIZE;
+  ctx->refresh_inflight = UNSPENT_OUTPUTS_MAX_INFLIGHT;
+  ctx->endpoints = NULL;
 
   // address manager, we should update address status later.
   // TODO: init local unspent/spent addresses
-  bitmask_t* addr_mask = bitmask_new();
+  bitmask_t* addr_mask = last_addr >= AM_COMPRESSED_MIN_ADDRS ? bitmask_new_compressed() : bitmask_new();
   if (addr_mask == NULL) {
     printf("[%s %d] create bitmask failed\n", __func__, __LINE__);
     goto err;
   }
 
   // mask spent address
-  for (uint64_t i = 0; i < first_unspent; i++) {
-    bitmask_op(addr_mask, i, BITMASK_SET);
+  if (bitmask_range_op(addr_mask, 0, first_unspent, BITMASK_SET) != 0) {
+    printf("[%s %d] mask spent addresses failed\n", __func__, __LINE__);
+    goto err;
   }
 
   ctx->addr_manager = am_new(seed, last_addr, addr_mask);
@@ -154,23 +267,46 @@ wallet_t* wallet_init(char const url[], uint16_t port, byte_t const seed[], uint
 
   // init unspent output manager
   ctx->unspent = unspent_outputs_init();
+  if (snapshot_rcu_init(&ctx->snapshots) != 0) {
+    printf("[%s %d] create snapshot failed\n", __func__, __LINE__);
+    goto err;
+  }
+
+  // derives addresses once, the table is the source of addresses for indices and refresh requests.
+  addrs = malloc(sizeof(address_t) * (last_addr + 1));
+  if (addrs == NULL || am_derive_addresses(ctx->addr_manager, 0, last_addr + 1, addrs) != 0) {
+    printf("[%s %d] derive addresses failed\n", __func__, __LINE__);
+    goto err;
+  }
   for (uint64_t i = 0; i <= last_addr; i++) {
-    address_t tmp_addr = {};
-    address_get(seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
-    unspent_outputs_add(&ctx->unspent, tmp_addr.addr, i, NULL);
+    unspent_outputs_add(&ctx->unspent, addrs[i].addr, i, NULL);
     if (i < first_unspent) {
-      unspent_outputs_set_spent(&ctx->unspent, tmp_addr.addr, true);
+      unspent_outputs_set_spent(&ctx->unspent, addrs[i].addr, true);
     }
   }
 
-  // fetch remote status, sync with node
-  if (wallet_refresh(ctx, true) == false) {
-    printf("[%s:%d] wallet status update failed\n", __func__, __LINE__);
+  ctx->index = unspent_index_new();
+  if (ctx->index == NULL || unspent_index_rebuild(ctx->index, &ctx->unspent) != 0) {
+    printf("[%s %d] create unspent index failed\n", __func__, __LINE__);
+    goto err;
+  }
+
+  ctx->reserved = reservation_new();
+  if (ctx->reserved == NULL) {
+    printf("[%s %d] create output reservation failed\n", __func__, __LINE__);
+    goto err;
+  }
+
+  ctx->asset_reg = wallet_ar_new();
+  if (ctx->asset_reg == NULL) {
+    printf("[%s %d] create asset registry failed\n", __func__, __LINE__);
+    goto err;
   }
 
   if (addr_mask) {
     bitmask_free(addr_mask);
   }
+  free(addrs);
 
   return ctx;
 
@@ -178,19 +314,42 @@ err:
   if (addr_mask) {
     bitmask_free(addr_mask);
   }
+  free(addrs);
 
   wallet_free(ctx);
   return NULL;
 }
 
+wallet_t* wallet_init(char const url[], uint16_t port, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
+                      uint64_t last_unspent) {
+  wallet_t* ctx = wallet_open(url, port, seed, last_addr, first_unspent, last_unspent);
+  // fetch remote status, sync with node
+  if (ctx && wallet_refresh(ctx, true) == false) {
+    printf("[%s:%d] wallet status update failed\n", __func__, __LINE__);
+  }
+  return ctx;
+}
+
 void wallet_free(wallet_t* w) {
   if (w) {
+    wallet_refresher_stop(w);
     if (w->addr_manager) {
       am_free(w->addr_manager);
     }
+    if (w->index) {
+      unspent_index_free(w->index);
+    }
     if (w->unspent) {
       unspent_outputs_free(&w->unspent);
     }
+    snapshot_rcu_destroy(&w->snapshots);
+    if (w->reserved) {
+      reservation_free(w->reserved);
+    }
+    wallet_ar_free(w->asset_reg);
+    pthread_mutex_destroy(&w->lock);
+    pthread_mutex_destroy(&w->refresher.lock);
+    pthread_cond_destroy(&w->refresher.cond);
   }
   free(w);
 }
@@ -201,6 +360,11 @@ bool wallet_is_node_synced(wallet_t* w) {
     return false;
   }
 
+  endpoint_pool_t* pool = wallet_endpoint_pool(w);
+  if (pool) {
+    return endpoint_pool_check(pool) > 0;
+  }
+
   res_node_info_t info;
   if (get_node_info(&w->endpoint, &info) != 0) {
     printf("[%s:%d] get node info failed\n", __func__, __LINE__);
@@ -209,29 +373,106 @@ bool wallet_is_node_synced(wallet_t* w) {
   return info.is_synced;
 }
 
-void wallet_receive_address(wallet_t* w, byte_t addr[]) { am_get_last_unspent_address(w->addr_manager, addr); }
+void wallet_receive_address(wallet_t* w, byte_t addr[]) {
+  pthread_mutex_lock(&w->lock);
+  am_get_last_unspent_address(w->addr_manager, addr);
+  pthread_mutex_unlock(&w->lock);
+}
 
-void wallet_new_receive_address(wallet_t* w, byte_t addr[]) { am_get_new_address(w->addr_manager, addr); }
+void wallet_new_receive_address(wallet_t* w, byte_t addr[]) {
+  pthread_mutex_lock(&w->lock);
+  am_get_new_address(w->addr_manager, addr);
+  wallet_track_address(w, addr, w->addr_manager->last_addr_index);
+  pthread_mutex_unlock(&w->lock);
+}
 
-void wallet_remainder_address(wallet_t* w, byte_t addr[]) { am_get_first_unspent_address(w->addr_manager, addr); }
+void wallet_remainder_address(wallet_t* w, byte_t addr[]) {
+  pthread_mutex_lock(&w->lock);
+  am_get_first_unspent_address(w->addr_manager, addr);
+  pthread_mutex_unlock(&w->lock);
+}
 
 uint64_t wallet_remainder_address_index(wallet_t* w) { return w->addr_manager->first_unspent_idx; }
 
-addr_list_t* wallet_addresses(wallet_t* w) { return am_addresses(w->addr_manager); }
+addr_list_t* wallet_addresses(wallet_t* w) {
+  pthread_mutex_lock(&w->lock);
+  addr_list_t* list = am_addresses(w->addr_manager);
+  pthread_mutex_unlock(&w->lock);
+  return list;
+}
+
+addr_list_t* wallet_unspent_addresses(wallet_t* w) {
+  pthread_mutex_lock(&w->lock);
+  addr_list_t* list = am_unspent_addresses(w->addr_manager);
+  pthread_mutex_unlock(&w->lock);
+  return list;
+}
+
+addr_list_t* wallet_spent_addresses(wallet_t* const w) {
+  pthread_mutex_lock(&w->lock);
+  addr_list_t* list = am_spent_addresses(w->addr_manager);
+  pthread_mutex_unlock(&w->lock);
+  return list;
+}
+
+// gets tracked addresses from the unspent outputs table instead of deriving them again.
+static addr_list_t* wallet_tracked_addresses(wallet_t* w, bool include_spent) {
+  addr_list_t* list = addr_list_new();
+  if (list == NULL) {
+    return NULL;
+  }
 
-addr_list_t* wallet_unspent_addresses(wallet_t* w) { return am_unspent_addresses(w->addr_manager); }
+  address_t tmp_addr = {};
+  for (uint64_t i = 0; i <= w->addr_manager->last_addr_index; i++) {
+    unspent_outputs_t* elm = unspent_index_find_by_addr_index(w->index, i);
+    if (elm && (include_spent || !elm->spent)) {
+      memcpy(tmp_addr.addr, elm->addr, TANGLE_ADDRESS_BYTES);
+      tmp_addr.index = i;
+      addr_list_push(list, &tmp_addr);
+    }
+  }
+  return list;
+}
 
-addr_list_t* wallet_spent_addresses(wallet_t* const w) { return am_spent_addresses(w->addr_manager); }
+addr_list_t* wallet_refresh_addresses(wallet_t* w, bool include_spent) {
+  pthread_mutex_lock(&w->lock);
+  addr_list_t* addrs = wallet_tracked_addresses(w, include_spent);
+  pthread_mutex_unlock(&w->lock);
+  return addrs;
+}
+
+void wallet_refresh_apply(wallet_t* w, unspent_outputs_t** res) {
+  pthread_mutex_lock(&w->lock);
+  unspent_outputs_t *unspent, *tmp;
+  HASH_ITER(hh, *res, unspent, tmp) {
+    // get the local status of this address
+    unspent_outputs_t* elm = unspent_outputs_find(&w->unspent, unspent->addr);
+    bool is_spent = false;
+    if (elm) {
+      // restore the spent status
+      is_spent = elm->spent;
+      unspent_index_remove(w->index, elm);
+      unspent_outputs_update(&w->unspent, unspent->addr, unspent->ids);
+      unspent_index_add(w->index, elm);
+      // mark the output as spent if we already marked it as spent locally
+      unspent_outputs_set_spent(&w->unspent, unspent->addr, is_spent);
+    } else {
+      // the address index is taken from the request, see get_unspent_outputs_sharded()
+      unspent_outputs_add(&w->unspent, unspent->addr, unspent->addr_index, unspent->ids);
+      unspent_index_add(w->index, unspent_outputs_find(&w->unspent, unspent->addr));
+    }
+  }
+  // outputs of sent transactions are released once the node consumed them
+  reservation_prune(w->reserved, &w->unspent);
+  wallet_publish_snapshot(w);
+  pthread_mutex_unlock(&w->lock);
+}
 
 bool wallet_refresh(wallet_t* w, bool include_spent) {
   bool ret = true;
-  addr_list_t* addrs = NULL;
-  bool has_ids = false;
-  if (include_spent) {
-    addrs = wallet_addresses(w);
-  } else {
-    addrs = wallet_unspent_addresses(w);
-  }
+  uint64_t start_us = endpoint_now_us();
+  unspent_outputs_t* res = unspent_outputs_init();
+  addr_list_t* addrs = wallet_refresh_addresses(w, include_spent);
 
   if (addrs == NULL || addr_list_len(addrs) == 0) {
     printf("[%s:%d] empty address list\n", __func__, __LINE__);
@@ -239,37 +480,151 @@ bool wallet_refresh(wallet_t* w, bool include_spent) {
     goto end;
   }
 
-  unspent_outputs_t* res = unspent_outputs_init();
-
-  if (get_unspent_outputs(&w->endpoint, addrs, &res) == 0) {
-    unspent_outputs_t *unspent, *tmp;
-    HASH_ITER(hh, res, unspent, tmp) {
-      // get the local status of this address
-      unspent_outputs_t* elm = unspent_outputs_find(&w->unspent, unspent->addr);
-      bool is_spent = false;
-      if (elm) {
-        // restore the spent status
-        is_spent = elm->spent;
-        unspent_outputs_update(&w->unspent, unspent->addr, unspent->ids);
-        // mark the output as spent if we already marked it as spent locally
-        unspent_outputs_set_spent(&w->unspent, unspent->addr, is_spent);
-      } else {
-        // TODO: we don't know the address index from unspent outputs API response
-        unspent_outputs_add(&w->unspent, unspent->addr, unspent->addr_index, unspent->ids);
-      }
-    }
+  // the local state is not locked during the request
+  pthread_mutex_lock(&w->lock);
+  size_t chunk = w->refresh_chunk, inflight = w->refresh_inflight;
+  endpoint_pool_t* pool = w->endpoints;
+  pthread_mutex_unlock(&w->lock);
+  int res_ret = -1;
+  if (pool && addr_list_len(addrs) <= chunk) {
+    // a single request, it's hedged over the pool
+    res_ret = endpoint_pool_get_unspent_outputs(pool, addrs, &res);
+  } else {
+    tangle_client_conf_t conf;
+    uint64_t start = endpoint_now_us();
+    int node = wallet_endpoint(w, &conf);
+    res_ret = get_unspent_outputs_sharded(&conf, addrs, chunk, inflight, &res);
+    wallet_endpoint_report(w, node, res_ret, start);
+  }
+  if (res_ret == 0) {
+    wallet_refresh_apply(w, &res);
+  } else {
+    printf("[%s:%d] fetch unspent outputs failed\n", __func__, __LINE__);
+    ret = false;
   }
 
 end:
   addr_list_free(addrs);
   unspent_outputs_free(&res);
+  metric_observe(&g_metric_refresh_duration, endpoint_now_us() - start_us);
 
   return ret;
 }
 
 uint64_t wallet_balance(wallet_t* w) {
   wallet_refresh(w, false);
-  return unspent_outputs_balance(&w->unspent);
+  return wallet_balance_cached(w, NULL);
+}
+
+uint64_t wallet_balance_cached(wallet_t* w, uint64_t* timestamp) {
+  snapshot_read_t r;
+  wallet_snapshot_t const* snap = snapshot_read_begin(&w->snapshots, &r);
+  uint64_t balance = snap->balance;
+  if (timestamp) {
+    *timestamp = snap->timestamp;
+  }
+  snapshot_read_end(&w->snapshots, &r);
+  return balance;
+}
+
+wallet_snapshot_t const* wallet_snapshot_acquire(wallet_t* w, snapshot_read_t* r) {
+  return snapshot_read_begin(&w->snapshots, r);
+}
+
+void wallet_snapshot_release(wallet_t* w, snapshot_read_t* r) { snapshot_read_end(&w->snapshots, r); }
+
+// sweeps fragmented outputs if background sweeps are on and no payment was issued recently.
+static void wallet_sweep_idle(wallet_t* w) {
+  pthread_mutex_lock(&w->lock);
+  uint32_t max_txs = w->sweep.max_txs;
+  bool idle = wallet_now_ms() - w->last_payment_ms >= w->sweep.idle_ms;
+  pthread_mutex_unlock(&w->lock);
+
+  if (max_txs > 0 && idle && wallet_consolidate(w, max_txs) < 0) {
+    printf("[%s:%d] background sweep failed\n", __func__, __LINE__);
+  }
+}
+
+static void* wallet_refresher_loop(void* arg) {
+  wallet_t* w = (wallet_t*)arg;
+  wallet_refresher_t* r = &w->refresher;
+
+  pthread_mutex_lock(&r->lock);
+  while (r->running) {
+    // waits for interval +/- jitter, or a stop signal
+    int64_t wait_ms = r->interval_ms;
+    if (r->jitter_ms) {
+      wait_ms += (int64_t)randombytes_uniform(2 * r->jitter_ms + 1) - r->jitter_ms;
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += wait_ms / 1000;
+    deadline.tv_nsec += (wait_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    int rc = 0;
+    while (r->running && rc != ETIMEDOUT) {
+      rc = pthread_cond_timedwait(&r->cond, &r->lock, &deadline);
+    }
+    if (!r->running) {
+      break;
+    }
+
+    pthread_mutex_unlock(&r->lock);
+    if (wallet_refresh(w, false) == false) {
+      printf("[%s:%d] background refresh failed\n", __func__, __LINE__);
+    } else {
+      wallet_sweep_idle(w);
+    }
+    pthread_mutex_lock(&r->lock);
+  }
+  pthread_mutex_unlock(&r->lock);
+  return NULL;
+}
+
+int wallet_refresher_start(wallet_t* w, uint32_t interval_ms, uint32_t jitter_ms) {
+  if (interval_ms == 0) {
+    printf("[%s:%d] invalid interval\n", __func__, __LINE__);
+    return -1;
+  }
+  if (jitter_ms > interval_ms) {
+    printf("[%s:%d] jitter must not exceed the interval\n", __func__, __LINE__);
+    return -1;
+  }
+
+  wallet_refresher_t* r = &w->refresher;
+  pthread_mutex_lock(&r->lock);
+  if (r->running) {
+    pthread_mutex_unlock(&r->lock);
+    printf("[%s:%d] refresher is running\n", __func__, __LINE__);
+    return -1;
+  }
+  r->interval_ms = interval_ms;
+  r->jitter_ms = jitter_ms;
+  r->running = true;
+  if (pthread_create(&r->thread, NULL, wallet_refresher_loop, w) != 0) {
+    r->running = false;
+    pthread_mutex_unlock(&r->lock);
+    printf("[%s:%d] create refresher thread failed\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_unlock(&r->lock);
+  return 0;
+}
+
+void wallet_refresher_stop(wallet_t* w) {
+  wallet_refresher_t* r = &w->refresher;
+  pthread_mutex_lock(&r->lock);
+  if (!r->running) {
+    pthread_mutex_unlock(&r->lock);
+    return;
+  }
+  r->running = false;
+  pthread_cond_signal(&r->cond);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
 }
 
 int wallet_request_funds(wallet_t* w) {
@@ -277,93 +632,324 @@ int wallet_request_funds(wallet_t* w) {
   byte_t receiver[TANGLE_ADDRESS_BYTES];
   res_get_funds_t res = {};
   wallet_receive_address(w, receiver);
-  ret = get_funds(&w->endpoint, receiver, &res);
+  tangle_client_conf_t conf;
+  uint64_t start = endpoint_now_us();
+  int node = wallet_endpoint(w, &conf);
+  ret = get_funds(&conf, receiver, &res);
+  wallet_endpoint_report(w, node, ret, start);
   printf("[%s:%d] message ID: %s\n", __func__, __LINE__, res.msg_id);
   return ret;
 }
 
-int wallet_send_funds(wallet_t* w, send_funds_op_t* dest) {
+// builds a transaction of reserved inputs, the caller holds the wallet lock. The ticket is released on failure.
+static wallet_utx_t* wallet_build_utx(wallet_t* w, uint32_t ticket, unspent_outputs_t* inputs,
+                                      wallet_payment_t const payments[], size_t count, byte_t remainder[]) {
+  wallet_utx_t* utx = utx_new();
+  if (utx == NULL) {
+    reservation_release(w->reserved, ticket);
+    return NULL;
+  }
+  utx->ticket = ticket;
+
+  // transaction inputs and their signers
+  tx_inputs_free(utx->tx.inputs);
+  utx->tx.inputs = wallet_build_inputs(w, inputs);
+  unspent_outputs_t *in, *in_tmp;
+  HASH_ITER(hh, inputs, in, in_tmp) { utx_add_signer(utx, in->addr, in->addr_index); }
+
+  // transaction outputs
+  tx_outputs_free(utx->tx.outputs);
+  utx->tx.outputs = wallet_build_outputs(w, payments, count, remainder, inputs);
+  if (utx->tx.outputs == NULL) {
+    printf("[%s:%d] build transaction outputs failed\n", __func__, __LINE__);
+    reservation_release(w->reserved, ticket);
+    utx_free(utx);
+    return NULL;
+  }
+  return utx;
+}
+
+// commits or releases the inputs of a transaction, the caller holds the wallet lock.
+static void wallet_utx_finish(wallet_t* w, wallet_utx_t* utx, bool sent) {
+  if (!sent) {
+    reservation_release(w->reserved, utx->ticket);
+    return;
+  }
+
+  // keep inputs reserved until the node consumed them
+  reservation_commit(w->reserved, utx->ticket);
+
+  // mark address as spent if all outputs on it are used by sent transactions
+  utx_signer_t* signer = NULL;
+  for (signer = (utx_signer_t*)utarray_front(utx->signers); signer != NULL;
+       signer = (utx_signer_t*)utarray_next(utx->signers, signer)) {
+    unspent_outputs_t* elm = unspent_outputs_find(&w->unspent, signer->addr);
+    if (elm && reservation_addr_exhausted(w->reserved, elm)) {
+      unspent_outputs_set_spent(&w->unspent, signer->addr, true);
+      am_mark_spent_address(w->addr_manager, signer->addr_index);
+    }
+  }
+  wallet_publish_snapshot(w);
+}
+
+// builds, signs, and sends a transaction of reserved inputs. The caller holds the wallet lock, it's released while
+// signing and sending. The ticket is committed if the transaction is sent, or released otherwise.
+static int wallet_issue_tx(wallet_t* w, uint32_t ticket, unspent_outputs_t* inputs, wallet_payment_t const payments[],
+                           size_t count, byte_t remainder[]) {
+  wallet_utx_t* utx = wallet_build_utx(w, ticket, inputs, payments, count, remainder);
+  if (utx == NULL) {
+    return -1;
+  }
+
+  // inputs are reserved, the local state is not locked while signing and sending
+  pthread_mutex_unlock(&w->lock);
+  int ret = wallet_sign_utx(w, utx);
+  if (ret == 0) {
+    res_send_tx_t res = {};
+    tangle_client_conf_t conf;
+    uint64_t start = endpoint_now_us();
+    int node = wallet_endpoint(w, &conf);
+    if ((ret = utx_submit(&conf, utx, &res)) == 0) {
+      printf("[%s:%d] message ID: %s\n", __func__, __LINE__, res.msg_id);
+    }
+    wallet_endpoint_report(w, node, ret, start);
+  }
+  pthread_mutex_lock(&w->lock);
+
+  wallet_utx_finish(w, utx, ret == 0);
+  utx_free(utx);
+  return ret;
+}
+
+int wallet_build_batch(wallet_t* w, send_batch_op_t* op, wallet_utx_t** utx) {
   int ret = 0;
-  transaction_t tx = {};
+  balance_ht_t* required = balance_ht_init();
+  *utx = NULL;
 
-  // validating send funds options
-  if (dest->amount <= 0 || empty_byte_array(dest->receiver, TANGLE_ADDRESS_BYTES)) {
-    printf("[%s:%d] Invalid amount or receiver address\n", __func__, __LINE__);
+  // validating payments
+  if (op->payments == NULL || op->count == 0) {
+    printf("[%s:%d] empty payments\n", __func__, __LINE__);
     return -1;
   }
+  for (size_t i = 0; i < op->count; i++) {
+    wallet_payment_t const* p = &op->payments[i];
+    if (p->amount == 0 || p->amount > INT64_MAX || empty_byte_array(p->receiver, TANGLE_ADDRESS_BYTES)) {
+      printf("[%s:%d] Invalid amount or receiver address of payment %zu\n", __func__, __LINE__, i);
+      balance_ht_free(&required);
+      return -1;
+    }
+    // required balances by color
+    balance_ht_t* sum = balance_ht_find(&required, p->color);
+    if (sum && (int64_t)p->amount > INT64_MAX - sum->value) {
+      printf("[%s:%d] total amount of payments overflows\n", __func__, __LINE__);
+      balance_ht_free(&required);
+      return -1;
+    }
+    if (sum) {
+      sum->value += (int64_t)p->amount;
+    } else if (balance_ht_add(&required, p->color, (int64_t)p->amount) != 0) {
+      balance_ht_free(&required);
+      return -1;
+    }
+  }
 
   // sync with node before sending
-  wallet_refresh(w, false);
+  if (!op->skip_refresh) {
+    wallet_refresh(w, false);
+  }
 
-  // looking for request founds in current unspent outputs
-  unspent_outputs_t* consumed_outputs = unspent_outputs_required_outputs(&w->unspent, dest->amount, dest->color);
+  pthread_mutex_lock(&w->lock);
+  w->last_payment_ms = wallet_now_ms();
+  // looking for request founds in current unspent outputs, selected outputs are reserved under the ticket
+  uint32_t ticket = reservation_ticket(w->reserved);
+  unspent_outputs_t* consumed_outputs = reservation_select_colors(w->reserved, ticket, &w->unspent, &required);
   if (!consumed_outputs) {
     printf("[%s:%d] error on finding outputs\n", __func__, __LINE__);
+    reservation_release(w->reserved, ticket);
+    pthread_mutex_unlock(&w->lock);
+    balance_ht_free(&required);
     return -1;
   }
 
   // is the balance enough?
-  uint64_t output_balance = unspent_outputs_balance_with_color(&consumed_outputs, dest->color);
-  if (output_balance < dest->amount) {
-    printf("[%s:%d] Insufficient balance (balance %" PRIu64 " < required %" PRIu64 ")\n", __func__, __LINE__,
-           output_balance, dest->amount);
-    ret = -1;
-    goto end;
+  balance_ht_t *req, *req_tmp;
+  HASH_ITER(hh, required, req, req_tmp) {
+    uint64_t output_balance = unspent_outputs_balance_with_color(&consumed_outputs, req->color);
+    if (output_balance < (uint64_t)req->value) {
+      printf("[%s:%d] Insufficient balance (balance %" PRIu64 " < required %" PRIu64 ")\n", __func__, __LINE__,
+             output_balance, (uint64_t)req->value);
+      ret = -1;
+      break;
+    }
   }
 
-  // build transaction
-  // transaction inputs
-  tx.inputs = wallet_build_inputs(w, consumed_outputs);
+  if (ret == 0) {
+    *utx = wallet_build_utx(w, ticket, consumed_outputs, op->payments, op->count, op->remainder);
+    ret = *utx ? 0 : -1;
+  } else {
+    reservation_release(w->reserved, ticket);
+  }
+  pthread_mutex_unlock(&w->lock);
+  unspent_outputs_free(&consumed_outputs);
+  balance_ht_free(&required);
+  return ret;
+}
 
-  // transaction outputs
-  tx.outputs = wallet_build_outputs(w, dest, consumed_outputs);
+int wallet_sign_utx(wallet_t* w, wallet_utx_t* utx) {
+  // the seed never changes, it's not locked
+  return utx_sign(utx, w->addr_manager->seed);
+}
 
-  // sign transaction
-  wallet_sign_tx(w, &tx, consumed_outputs);
+int wallet_submit_utx(wallet_t* w, wallet_utx_t* utx) {
+  res_send_tx_t res = {};
+  tangle_client_conf_t conf;
+  uint64_t start = endpoint_now_us();
+  int node = wallet_endpoint(w, &conf);
+  int ret = utx_submit(&conf, utx, &res);
+  if (ret == 0) {
+    printf("[%s:%d] message ID: %s\n", __func__, __LINE__, res.msg_id);
+  }
+  wallet_endpoint_report(w, node, ret, start);
+  pthread_mutex_lock(&w->lock);
+  wallet_utx_finish(w, utx, ret == 0);
+  pthread_mutex_unlock(&w->lock);
+  return ret;
+}
 
-  // validate tx
-  if (tx_signautres_valid(&tx) == false) {
-    printf("[%s:%d] transaction validation failed\n", __func__, __LINE__);
-    ret = -1;
-    goto end;
+void wallet_cancel_utx(wallet_t* w, wallet_utx_t* utx) {
+  pthread_mutex_lock(&w->lock);
+  wallet_utx_finish(w, utx, false);
+  pthread_mutex_unlock(&w->lock);
+}
 
+int wallet_send_batch(wallet_t* w, send_batch_op_t* op) {
+  wallet_utx_t* utx = NULL;
+  if (wallet_build_batch(w, op, &utx) != 0) {
+    return -1;
+  }
+
+  int ret = wallet_sign_utx(w, utx);
+  if (ret == 0) {
+    ret = wallet_submit_utx(w, utx);
   } else {
-    res_send_tx_t res = {};
-    byte_buf_t* tx_bytes = tx_2_base64(&tx);
-    if (send_tx_bytes(&w->endpoint, tx_bytes->data, &res) == 0) {
-      // success
-      printf("[%s:%d] message ID: %s\n", __func__, __LINE__, res.msg_id);
-    } else {
-      printf("[%s:%d send transaction failed\n", __func__, __LINE__);
-    }
-    byte_buf_free(tx_bytes);
+    wallet_cancel_utx(w, utx);
   }
+  utx_free(utx);
+  return ret;
+}
 
-  // mark address as spent if transaction sent successfully
-  unspent_outputs_t *output_sent, *tmp_sent;
-  HASH_ITER(hh, consumed_outputs, output_sent, tmp_sent) {
-    unspent_outputs_set_spent(&w->unspent, output_sent->addr, true);
-    am_mark_spent_address(w->addr_manager, output_sent->addr_index);
+int wallet_set_refresh_shards(wallet_t* w, size_t chunk_size, size_t max_inflight) {
+  if (chunk_size == 0 || max_inflight == 0) {
+    printf("[%s:%d] invalid shard size\n", __func__, __LINE__);
+    return -1;
   }
+  pthread_mutex_lock(&w->lock);
+  w->refresh_chunk = chunk_size;
+  w->refresh_inflight = max_inflight;
+  pthread_mutex_unlock(&w->lock);
+  return 0;
+}
 
-end:
-  // clean up
-  if (tx.inputs) {
-    tx_inputs_free(tx.inputs);
+void wallet_set_endpoint_pool(wallet_t* w, endpoint_pool_t* pool) {
+  pthread_mutex_lock(&w->lock);
+  w->endpoints = pool;
+  pthread_mutex_unlock(&w->lock);
+}
+
+void wallet_set_compression(wallet_t* w, bool enable) {
+  pthread_mutex_lock(&w->lock);
+  w->endpoint.compress = enable;
+  pthread_mutex_unlock(&w->lock);
+}
+
+void wallet_set_transport(wallet_t* w, http_transport_t const* transport) {
+  pthread_mutex_lock(&w->lock);
+  w->endpoint.transport = transport;
+  pthread_mutex_unlock(&w->lock);
+}
+
+int wallet_set_sweep_policy(wallet_t* w, sweep_policy_t const* policy) {
+  if (!sweep_policy_valid(policy)) {
+    printf("[%s:%d] invalid sweep policy\n", __func__, __LINE__);
+    return -1;
   }
-  if (tx.outputs) {
-    tx_outputs_free(tx.outputs);
+  pthread_mutex_lock(&w->lock);
+  w->sweep = *policy;
+  pthread_mutex_unlock(&w->lock);
+  return 0;
+}
+
+int wallet_consolidate(wallet_t* w, uint32_t max_txs) {
+  int sent = 0;
+  pthread_mutex_lock(&w->lock);
+  sweep_policy_t policy = w->sweep;
+  for (uint32_t i = 0; i < max_txs; i++) {
+    byte_t color[BALANCE_COLOR_BYTES];
+    byte_t target[TANGLE_ADDRESS_BYTES] = {};
+    // outputs of previous sweeps are reserved, each sweep takes new inputs
+    uint32_t ticket = reservation_ticket(w->reserved);
+    unspent_outputs_t* inputs = sweep_select(w->reserved, ticket, &w->unspent, &policy, color);
+    if (inputs == NULL) {
+      break;
+    }
+    // an address of the wallet could be an input of a later sweep and be marked spent while this sweep's output is
+    // inbound, refreshes would skip it then. Each sweep goes to a new address instead.
+    wallet_new_address(w, target);
+    // no payments, all balances of the inputs go to the target address
+    int ret = wallet_issue_tx(w, ticket, inputs, NULL, 0, target);
+    unspent_outputs_free(&inputs);
+    if (ret != 0) {
+      printf("[%s:%d] sweep transaction failed\n", __func__, __LINE__);
+      if (sent == 0) {
+        sent = -1;
+      }
+      break;
+    }
+    sent++;
   }
-  if (tx.signatures) {
-    ed_signatures_destory(&tx.signatures);
+  pthread_mutex_unlock(&w->lock);
+  return sent;
+}
+
+int wallet_send_funds(wallet_t* w, send_funds_op_t* dest) {
+  wallet_payment_t payment = {};
+  payment.amount = dest->amount;
+  memcpy(payment.receiver, dest->receiver, TANGLE_ADDRESS_BYTES);
+  memcpy(payment.color, dest->color, BALANCE_COLOR_BYTES);
+
+  send_batch_op_t op = {};
+  op.payments = &payment;
+  op.count = 1;
+  op.skip_refresh = dest->skip_refresh;
+  memcpy(op.remainder, dest->remainder, TANGLE_ADDRESS_BYTES);
+
+  int ret = wallet_send_batch(w, &op);
+  memcpy(dest->remainder, op.remainder, TANGLE_ADDRESS_BYTES);
+  return ret;
+}
+
+int wallet_tx_inclusion_state(wallet_t* w, byte_t const tx_id[], inclusion_state_t* st) {
+  int ret = -1;
+  pthread_mutex_lock(&w->lock);
+  tx_inputs_t* outputs = unspent_index_find_by_tx(w->index, tx_id);
+  if (outputs && tx_inputs_len(outputs) > 0) {
+    // all outputs of a transaction share the same inclusion state
+    unspent_outputs_t* elm = unspent_outputs_find(&w->unspent, tx_inputs_at(outputs, 0));
+    output_ids_t* id = elm ? output_ids_find(&elm->ids, tx_id) : NULL;
+    if (id) {
+      memcpy(st, &id->st, sizeof(inclusion_state_t));
+      ret = 0;
+    }
   }
-  unspent_outputs_free(&consumed_outputs);
+  pthread_mutex_unlock(&w->lock);
   return ret;
 }
 
 void wallet_status_print(wallet_t* w) {
+  pthread_mutex_lock(&w->lock);
   printf("========= Wallet Status =========\n");
   am_print(w->addr_manager);
   printf("========= outputs =========\n");
   unspent_outputs_print(&w->unspent);
+  pthread_mutex_unlock(&w->lock);
 }
@@ -1,17 +1,46 @@
 #ifndef __WALLET_API_H__
 #define __WALLET_API_H__
 
+#include <pthread.h>
 #include <stdbool.h>
 
 #include "client/client_service.h"
+#include "client/endpoint_pool.h"
+#include "client/network/http.h"
+#include "core/unspent_index.h"
 #include "core/unspent_outputs.h"
 #include "wallet/address_manager.h"
 #include "wallet/asset_registry.h"
+#include "wallet/consolidation.h"
+#include "wallet/output_reservation.h"
+#include "wallet/snapshot.h"
+#include "wallet/unsigned_tx.h"
+
+// the background refresher
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pthread_t thread;
+  bool running;
+  uint32_t interval_ms;
+  uint32_t jitter_ms;
+} wallet_refresher_t;
+
 typedef struct {
   tangle_client_conf_t endpoint;
   wallet_am_t* addr_manager;
-  unspent_outputs_t* unspent;  // unspent outputs
-  // wallet_ar_t asset_reg;
+  unspent_outputs_t* unspent;      // unspent outputs
+  unspent_index_t* index;          // address index and transaction id lookups of unspent outputs
+  output_reservation_t* reserved;  // outputs used by built or in-flight transactions
+  pthread_mutex_t lock;            // serializes writers, guards the address manager, unspent outputs, and indices
+  snapshot_rcu_t snapshots;        // columnar views of unspent outputs for lock-free readers
+  wallet_refresher_t refresher;
+  wallet_ar_t* asset_reg;          // names, symbols, and precisions of colored coins
+  sweep_policy_t sweep;            // consolidation of fragmented outputs, background sweeps are off by default
+  uint64_t last_payment_ms;        // the time of the last payment, sweeps wait for idle periods
+  size_t refresh_chunk;            // addresses per unspent outputs request
+  size_t refresh_inflight;         // concurrent unspent outputs requests
+  endpoint_pool_t* endpoints;      // routes requests over several nodes, NULL to use the endpoint only
 } wallet_t;
 
 // a struct that is used to aggregate the optional parameters provided in the send founds call
@@ -20,8 +49,24 @@ typedef struct {
   byte_t receiver[TANGLE_ADDRESS_BYTES];
   byte_t color[BALANCE_COLOR_BYTES];
   byte_t remainder[TANGLE_ADDRESS_BYTES];
+  bool skip_refresh;  // uses local state instead of syncing with the node before sending
 } send_funds_op_t;
 
+// a payment of a batch
+typedef struct {
+  uint64_t amount;
+  byte_t receiver[TANGLE_ADDRESS_BYTES];
+  byte_t color[BALANCE_COLOR_BYTES];
+} wallet_payment_t;
+
+// payments that are issued in one transaction
+typedef struct {
+  wallet_payment_t* payments;
+  size_t count;
+  byte_t remainder[TANGLE_ADDRESS_BYTES];
+  bool skip_refresh;  // uses local state instead of syncing with the node before sending
+} send_batch_op_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +85,20 @@ extern "C" {
 wallet_t* wallet_init(char const url[], uint16_t port, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
                       uint64_t last_unspent);
 
+/**
+ * @brief Creates a wallet instance without syncing with the node
+ *
+ * @param[in] url The URL of an endpoint
+ * @param[in] port The port number, 0 for default port (8443 or 443)
+ * @param[in] seed The seed, NULL for random seed
+ * @param[in] last_addr The last address index
+ * @param[in] first_unspent The first unspent address index
+ * @param[in] last_unspent The last unspent address index
+ * @return wallet_t* A wallet instance
+ */
+wallet_t* wallet_open(char const url[], uint16_t port, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
+                      uint64_t last_unspent);
+
 /**
  * @brief Refresh wallet status with node
  *
@@ -50,6 +109,23 @@ wallet_t* wallet_init(char const url[], uint16_t port, byte_t const seed[], uint
  */
 bool wallet_refresh(wallet_t* w, bool include_spent);
 
+/**
+ * @brief Gets the addresses to refresh, it's the first half of wallet_refresh().
+ *
+ * @param[in] w A wallet instance
+ * @param[in] include_spent False for unspent address only
+ * @return addr_list_t* A list of tracked addresses
+ */
+addr_list_t* wallet_refresh_addresses(wallet_t* w, bool include_spent);
+
+/**
+ * @brief Applies unspent outputs from the node, it's the second half of wallet_refresh().
+ *
+ * @param[in] w A wallet instance
+ * @param[in] res The unspent outputs of the wallet addresses
+ */
+void wallet_refresh_apply(wallet_t* w, unspent_outputs_t** res);
+
 /**
  * @brief Frees a wallet instance
  *
@@ -130,6 +206,68 @@ int wallet_request_funds(wallet_t* w);
  */
 uint64_t wallet_balance(wallet_t* w);
 
+/**
+ * @brief Gets the last balance without syncing with the node
+ *
+ * The value is published by wallet_refresh(), wallet_send_funds(), and the background refresher. It's read from the
+ * current snapshot without taking a lock.
+ *
+ * @param[in] w A wallet instance
+ * @param[out] timestamp The time of the last update in milliseconds since the Epoch, 0 if never updated. Can be NULL.
+ * @return uint64_t The sum of confirmed balances
+ */
+uint64_t wallet_balance_cached(wallet_t* w, uint64_t* timestamp);
+
+/**
+ * @brief Pins the current snapshot of the wallet state without taking a lock
+ *
+ * The snapshot is immutable, writers publish a new one instead. Keep it pinned briefly, a writer waits for readers
+ * of the replaced snapshot before reusing it.
+ *
+ * @param[in] w A wallet instance
+ * @param[out] r A read handle for wallet_snapshot_release()
+ * @return wallet_snapshot_t const* The current snapshot
+ */
+wallet_snapshot_t const* wallet_snapshot_acquire(wallet_t* w, snapshot_read_t* r);
+
+/**
+ * @brief Unpins a snapshot from wallet_snapshot_acquire()
+ *
+ * @param[in] w A wallet instance
+ * @param[in] r The read handle
+ */
+void wallet_snapshot_release(wallet_t* w, snapshot_read_t* r);
+
+/**
+ * @brief Starts a background thread that refreshes the wallet periodically
+ *
+ * @param[in] w A wallet instance
+ * @param[in] interval_ms The refresh interval in milliseconds, greater than 0
+ * @param[in] jitter_ms A random offset in [-jitter_ms, jitter_ms] is applied to each interval, must not exceed the
+ * interval
+ * @return int 0 on success, -1 on failed or it's running already
+ */
+int wallet_refresher_start(wallet_t* w, uint32_t interval_ms, uint32_t jitter_ms);
+
+/**
+ * @brief Stops the background refresher, it's called by wallet_free()
+ *
+ * @param[in] w A wallet instance
+ */
+void wallet_refresher_stop(wallet_t* w);
+
+/**
+ * @brief Gets the inclusion state of the outputs created by a transaction
+ *
+ * It's a local lookup, call wallet_refresh() to get the latest state from the node.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] tx_id A transaction id
+ * @param[out] st The inclusion state
+ * @return int 0 on success, -1 if the transaction has no outputs in this wallet
+ */
+int wallet_tx_inclusion_state(wallet_t* w, byte_t const tx_id[], inclusion_state_t* st);
+
 /**
  * @brief Prints out local wallet status
  *
@@ -140,12 +278,131 @@ void wallet_status_print(wallet_t* w);
 /**
  * @brief Issues a payment of the given option
  *
+ * Inputs are reserved per output while the transaction is built. They are released if the transaction is not sent,
+ * so payments can be issued back to back with `skip_refresh` without conflicting inputs.
+ *
  * @param[in] w A wallet instance
  * @param[in] dest A send funds option
  * @return int 0 on success
  */
 int wallet_send_funds(wallet_t* w, send_funds_op_t* dest);
 
+/**
+ * @brief Issues multiple payments in one transaction
+ *
+ * Inputs are selected once across all colors, payments to the same receiver are merged into one output, and the
+ * unpaid balances of all colors go to a single remainder output. The transaction is signed once.
+ *
+ * It runs wallet_build_batch(), wallet_sign_utx(), and wallet_submit_utx() in a row.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] op A batch of payments, the remainder is set to the used address if it's empty
+ * @return int 0 on success
+ */
+int wallet_send_batch(wallet_t* w, send_batch_op_t* op);
+
+/**
+ * @brief Selects inputs and builds an unsigned transaction of a batch, the first stage of wallet_send_batch()
+ *
+ * Inputs are reserved under the ticket of the transaction until it's submitted or canceled by this wallet. The
+ * transaction can be serialized with utx_serialize() to be signed and sent elsewhere.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] op A batch of payments, the remainder is set to the used address if it's empty
+ * @param[out] utx The unsigned transaction, free it with utx_free()
+ * @return int 0 on success
+ */
+int wallet_build_batch(wallet_t* w, send_batch_op_t* op, wallet_utx_t** utx);
+
+/**
+ * @brief Signs a transaction with the seed of the wallet, it doesn't lock the wallet
+ *
+ * @param[in] w A wallet instance
+ * @param[in] utx A transaction built by this wallet
+ * @return int 0 on success
+ */
+int wallet_sign_utx(wallet_t* w, wallet_utx_t* utx);
+
+/**
+ * @brief Sends a signed transaction, its inputs are committed if it's sent or released otherwise
+ *
+ * @param[in] w A wallet instance
+ * @param[in] utx A transaction built by this wallet
+ * @return int 0 on success
+ */
+int wallet_submit_utx(wallet_t* w, wallet_utx_t* utx);
+
+/**
+ * @brief Releases the inputs of a transaction that will not be submitted
+ *
+ * @param[in] w A wallet instance
+ * @param[in] utx A transaction built by this wallet
+ */
+void wallet_cancel_utx(wallet_t* w, wallet_utx_t* utx);
+
+/**
+ * @brief Sets how a refresh splits the address list into concurrent requests
+ *
+ * @param[in] w A wallet instance
+ * @param[in] chunk_size The number of addresses per request, UNSPENT_OUTPUTS_CHUNK_SIZE by default
+ * @param[in] max_inflight The number of concurrent requests, UNSPENT_OUTPUTS_MAX_INFLIGHT by default
+ * @return int 0 on success
+ */
+int wallet_set_refresh_shards(wallet_t* w, size_t chunk_size, size_t max_inflight);
+
+/**
+ * @brief Routes requests of a wallet over a pool of nodes instead of its endpoint
+ *
+ * The pool is not owned by the wallet, it must outlive the wallet and can be shared by wallets.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] pool An endpoint pool, NULL to use the endpoint of the wallet
+ */
+void wallet_set_endpoint_pool(wallet_t* w, endpoint_pool_t* pool);
+
+/**
+ * @brief Asks the node for compressed responses, it's off by default
+ *
+ * Responses are decoded as they arrive, large unspent outputs responses shrink several times on the wire.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] enable True to offer gzip and deflate encodings
+ */
+void wallet_set_compression(wallet_t* w, bool enable);
+
+/**
+ * @brief Sends the requests of the wallet endpoint through a transport
+ *
+ * @param[in] w A wallet instance
+ * @param[in] transport A transport outliving the wallet, NULL for the default http transport
+ */
+void wallet_set_transport(wallet_t* w, http_transport_t const* transport);
+
+/**
+ * @brief Sets the consolidation policy of a wallet
+ *
+ * The background refresher sweeps fragmented outputs after a refresh if `max_txs` is not 0 and no payment was issued
+ * for `idle_ms`.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] policy A sweep policy
+ * @return int 0 on success, -1 on an invalid policy
+ */
+int wallet_set_sweep_policy(wallet_t* w, sweep_policy_t const* policy);
+
+/**
+ * @brief Consolidates fragmented outputs now
+ *
+ * Each sweep transaction moves the smallest free outputs of the most fragmented color to a new address of this
+ * wallet, it stops once no color reaches the minimum number of outputs of the policy. It uses local state, refresh the
+ * wallet before calling it.
+ *
+ * @param[in] w A wallet instance
+ * @param[in] max_txs The maximum number of sweep transactions
+ * @return int The number of sent sweep transactions, -1 if the first one failed
+ */
+int wallet_consolidate(wallet_t* w, uint32_t max_txs);
+
 // ========= TODO =========
 
 // creates a new colored token with the given details.
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "client/api/get_unspent_outputs.h"
+#include "utils/allocator.h"
+#include "wallet/wallet_manager.h"
+
+static UT_icd const wm_entry_icd = {sizeof(wm_entry_t), NULL, NULL, NULL};
+
+// the owners of an address in a batched request
+typedef struct wm_owner_s {
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  size_t slot;
+  struct wm_owner_s* also;  // another wallet of the same seed holding the address
+  UT_hash_handle hh;
+} wm_owner_t;
+
+// a wallet of a refresh round, it's looked up by id after the request since it may be removed meanwhile
+typedef struct {
+  uint64_t id;
+  addr_list_t* addrs;
+} wm_due_t;
+
+static uint64_t wm_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// the next refresh time of a wallet, interval +/- jitter from now.
+static uint64_t wm_next_due(wallet_manager_t* m, uint64_t now) {
+  int64_t delay = m->interval_ms;
+  if (m->jitter_ms) {
+    delay += (int64_t)randombytes_uniform(2 * m->jitter_ms + 1) - m->jitter_ms;
+  }
+  return now + (uint64_t)delay;
+}
+
+// the entry of a managed wallet, the caller holds the manager lock.
+static wm_entry_t* wm_find(wallet_manager_t* m, uint64_t id) {
+  wm_entry_t* e = NULL;
+  for (e = (wm_entry_t*)utarray_front(m->wallets); e != NULL; e = (wm_entry_t*)utarray_next(m->wallets, e)) {
+    if (e->id == id) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static void wm_owners_free(wm_owner_t** owners) {
+  wm_owner_t *elm, *tmp;
+  HASH_ITER(hh, *owners, elm, tmp) {
+    HASH_DEL(*owners, elm);
+    while (elm) {
+      wm_owner_t* also = elm->also;
+      free(elm);
+      elm = also;
+    }
+  }
+}
+
+// sends a batched request without holding the manager lock, the response is split to the owning wallets.
+static int wm_flush(wallet_manager_t* m, wm_due_t const due[], size_t n) {
+  int ret = 0;
+  wm_owner_t* owners = NULL;
+  addr_list_t* addrs = addr_list_new();
+  unspent_outputs_t* res = unspent_outputs_init();
+  unspent_outputs_t** per_wallet = calloc(n, sizeof(unspent_outputs_t*));
+  if (addrs == NULL || per_wallet == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    ret = -1;
+    goto end;
+  }
+
+  for (size_t i = 0; i < n && ret == 0; i++) {
+    address_t* addr = NULL;
+    ADDR_LIST_FOREACH(due[i].addrs, addr) {
+      wm_owner_t* found = NULL;
+      HASH_FIND(hh, owners, addr->addr, TANGLE_ADDRESS_BYTES, found);
+      wm_owner_t* owner = malloc(sizeof(wm_owner_t));
+      if (owner == NULL) {
+        printf("[%s:%d] OOM\n", __func__, __LINE__);
+        ret = -1;
+        break;
+      }
+      memcpy(owner->addr, addr->addr, TANGLE_ADDRESS_BYTES);
+      owner->slot = i;
+      owner->also = NULL;
+      if (found) {
+        // the same seed is managed twice, the address is requested once and given to both wallets
+        owner->also = found->also;
+        found->also = owner;
+        continue;
+      }
+      HASH_ADD(hh, owners, addr, TANGLE_ADDRESS_BYTES, owner);
+      addr_list_push(addrs, addr);
+    }
+  }
+
+  if (ret == 0 && get_unspent_outputs(&m->endpoint, addrs, &res) != 0) {
+    printf("[%s:%d] get unspent outputs of %zu wallets failed\n", __func__, __LINE__, n);
+    ret = -1;
+  }
+
+  if (ret == 0) {
+    unspent_outputs_t *elm, *tmp;
+    HASH_ITER(hh, res, elm, tmp) {
+      wm_owner_t* owner = NULL;
+      HASH_FIND(hh, owners, elm->addr, TANGLE_ADDRESS_BYTES, owner);
+      for (; owner; owner = owner->also) {
+        unspent_outputs_add(&per_wallet[owner->slot], elm->addr, elm->addr_index, elm->ids);
+      }
+    }
+  }
+
+end:
+  // failed wallets are retried in the next interval, removed ones are skipped
+  pthread_mutex_lock(&m->lock);
+  uint64_t next = wm_now_ms();
+  for (size_t i = 0; i < n; i++) {
+    wm_entry_t* e = wm_find(m, due[i].id);
+    if (e && ret == 0) {
+      wallet_refresh_apply(e->w, &per_wallet[i]);
+    }
+    if (e) {
+      e->due_ms = wm_next_due(m, next);
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+
+  for (size_t i = 0; per_wallet && i < n; i++) {
+    unspent_outputs_free(&per_wallet[i]);
+  }
+  free(per_wallet);
+  unspent_outputs_free(&res);
+  if (addrs) {
+    addr_list_free(addrs);
+  }
+  wm_owners_free(&owners);
+  return ret;
+}
+
+// refreshes wallets that are due, or all wallets if forced. The wallets are collected under the manager lock, the
+// requests are sent without it.
+static int wm_round(wallet_manager_t* m, bool force) {
+  int ret = 0;
+  size_t n = 0;
+  pthread_mutex_lock(&m->round_lock);
+  pthread_mutex_lock(&m->lock);
+  uint64_t now = wm_now_ms();
+  size_t batch_addrs = m->batch_addrs;
+  wm_due_t* due = malloc(sizeof(wm_due_t) * (utarray_len(m->wallets) + 1));
+  if (due == NULL) {
+    pthread_mutex_unlock(&m->lock);
+    pthread_mutex_unlock(&m->round_lock);
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return -1;
+  }
+
+  wm_entry_t* e = NULL;
+  for (e = (wm_entry_t*)utarray_front(m->wallets); e != NULL; e = (wm_entry_t*)utarray_next(m->wallets, e)) {
+    if (!force && e->due_ms > now) {
+      continue;
+    }
+
+    addr_list_t* wallet_addrs = wallet_refresh_addresses(e->w, false);
+    if (wallet_addrs == NULL || addr_list_len(wallet_addrs) == 0) {
+      e->due_ms = wm_next_due(m, now);
+      if (wallet_addrs) {
+        addr_list_free(wallet_addrs);
+      }
+      continue;
+    }
+    due[n].id = e->id;
+    due[n++].addrs = wallet_addrs;
+  }
+  pthread_mutex_unlock(&m->lock);
+
+  // a wallet is never split across requests
+  size_t first = 0, len = 0;
+  for (size_t i = 0; i < n; i++) {
+    size_t wallet_len = addr_list_len(due[i].addrs);
+    if (i > first && len + wallet_len > batch_addrs) {
+      ret |= wm_flush(m, due + first, i - first);
+      first = i;
+      len = 0;
+    }
+    len += wallet_len;
+  }
+  if (n > first) {
+    ret |= wm_flush(m, due + first, n - first);
+  }
+  pthread_mutex_unlock(&m->round_lock);
+
+  for (size_t i = 0; i < n; i++) {
+    addr_list_free(due[i].addrs);
+  }
+  free(due);
+  return ret;
+}
+
+wallet_manager_t* wallet_manager_new(char const url[], uint16_t port) {
+  if (strlen(url) >= sizeof(((tangle_client_conf_t*)0)->url)) {
+    printf("[%s:%d] URL is too long\n", __func__, __LINE__);
+    return NULL;
+  }
+
+  wallet_manager_t* m = malloc(sizeof(wallet_manager_t));
+  if (m == NULL) {
+    printf("[%s:%d] OOM\n", __func__, __LINE__);
+    return NULL;
+  }
+  memset(m, 0, sizeof(wallet_manager_t));
+  strcpy(m->endpoint.url, url);
+  m->endpoint.port = port;
+  m->batch_addrs = WALLET_MANAGER_BATCH_ADDRS;
+  utarray_new(m->wallets, &wm_entry_icd);
+  pthread_mutex_init(&m->lock, NULL);
+  pthread_mutex_init(&m->round_lock, NULL);
+  pthread_mutex_init(&m->sched_lock, NULL);
+  pthread_cond_init(&m->sched_cond, NULL);
+  return m;
+}
+
+void wallet_manager_free(wallet_manager_t* m) {
+  if (m) {
+    wallet_manager_stop(m);
+    wm_entry_t* e = NULL;
+    for (e = (wm_entry_t*)utarray_front(m->wallets); e != NULL; e = (wm_entry_t*)utarray_next(m->wallets, e)) {
+      wallet_free(e->w);
+    }
+    utarray_free(m->wallets);
+    pthread_mutex_destroy(&m->lock);
+    pthread_mutex_destroy(&m->round_lock);
+    pthread_mutex_destroy(&m->sched_lock);
+    pthread_cond_destroy(&m->sched_cond);
+    free(m);
+  }
+}
+
+wallet_t* wallet_manager_add(wallet_manager_t* m, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
+                             uint64_t last_unspent) {
+  wallet_t* w = wallet_open(m->endpoint.url, m->endpoint.port, seed, last_addr, first_unspent, last_unspent);
+  if (w == NULL) {
+    return NULL;
+  }
+  wallet_set_compression(w, m->endpoint.compress);
+  wallet_set_transport(w, m->endpoint.transport);
+
+  // due immediately
+  wm_entry_t e = {.w = w, .due_ms = 0};
+  pthread_mutex_lock(&m->lock);
+  e.id = ++m->next_id;
+  utarray_push_back(m->wallets, &e);
+  pthread_mutex_unlock(&m->lock);
+
+  // wakes up the scheduler
+  pthread_mutex_lock(&m->sched_lock);
+  pthread_cond_signal(&m->sched_cond);
+  pthread_mutex_unlock(&m->sched_lock);
+  return w;
+}
+
+int wallet_manager_remove(wallet_manager_t* m, wallet_t* w) {
+  int ret = -1;
+  pthread_mutex_lock(&m->lock);
+  for (size_t i = 0; i < utarray_len(m->wallets); i++) {
+    wm_entry_t* e = (wm_entry_t*)utarray_eltptr(m->wallets, i);
+    if (e->w == w) {
+      utarray_erase(m->wallets, i, 1);
+      wallet_free(w);
+      ret = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+  return ret;
+}
+
+size_t wallet_manager_count(wallet_manager_t* m) {
+  pthread_mutex_lock(&m->lock);
+  size_t len = utarray_len(m->wallets);
+  pthread_mutex_unlock(&m->lock);
+  return len;
+}
+
+int wallet_manager_refresh(wallet_manager_t* m) { return wm_round(m, true); }
+
+// the earliest refresh time of all wallets.
+static uint64_t wm_earliest_due(wallet_manager_t* m, uint64_t now) {
+  pthread_mutex_lock(&m->lock);
+  uint64_t due = now + m->interval_ms;
+  wm_entry_t* e = NULL;
+  for (e = (wm_entry_t*)utarray_front(m->wallets); e != NULL; e = (wm_entry_t*)utarray_next(m->wallets, e)) {
+    if (e->due_ms < due) {
+      due = e->due_ms;
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+  return due;
+}
+
+static void* wm_scheduler(void* arg) {
+  wallet_manager_t* m = (wallet_manager_t*)arg;
+
+  pthread_mutex_lock(&m->sched_lock);
+  while (m->running) {
+    uint64_t now = wm_now_ms();
+    uint64_t due = wm_earliest_due(m, now);
+    if (due > now) {
+      struct timespec deadline = {.tv_sec = due / 1000, .tv_nsec = (due % 1000) * 1000000};
+      // wakes up on the deadline, a new wallet, or a stop signal
+      pthread_cond_timedwait(&m->sched_cond, &m->sched_lock, &deadline);
+      continue;
+    }
+
+    pthread_mutex_unlock(&m->sched_lock);
+    wm_round(m, false);
+    pthread_mutex_lock(&m->sched_lock);
+  }
+  pthread_mutex_unlock(&m->sched_lock);
+  return NULL;
+}
+
+int wallet_manager_start(wallet_manager_t* m, uint32_t interval_ms, uint32_t jitter_ms) {
+  if (interval_ms == 0) {
+    printf("[%s:%d] invalid interval\n", __func__, __LINE__);
+    return -1;
+  }
+  if (jitter_ms > interval_ms) {
+    printf("[%s:%d] jitter must not exceed the interval\n", __func__, __LINE__);
+    return -1;
+  }
+
+  pthread_mutex_lock(&m->sched_lock);
+  if (m->running) {
+    pthread_mutex_unlock(&m->sched_lock);
+    printf("[%s:%d] scheduler is running\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_lock(&m->lock);
+  m->interval_ms = interval_ms;
+  m->jitter_ms = jitter_ms;
+  pthread_mutex_unlock(&m->lock);
+  m->running = true;
+  if (pthread_create(&m->sched_thread, NULL, wm_scheduler, m) != 0) {
+    m->running = false;
+    pthread_mutex_unlock(&m->sched_lock);
+    printf("[%s:%d] create scheduler thread failed\n", __func__, __LINE__);
+    return -1;
+  }
+  pthread_mutex_unlock(&m->sched_lock);
+  return 0;
+}
+
+void wallet_manager_stop(wallet_manager_t* m) {
+  pthread_mutex_lock(&m->sched_lock);
+  if (!m->running) {
+    pthread_mutex_unlock(&m->sched_lock);
+    return;
+  }
+  m->running = false;
+  pthread_cond_signal(&m->sched_cond);
+  pthread_mutex_unlock(&m->sched_lock);
+  pthread_join(m->sched_thread, NULL);
+}
@@ -0,0 +1,125 @@
+#ifndef __WALLET_MANAGER_H__
+#define __WALLET_MANAGER_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "client/client_service.h"
+#include "utarray.h"
+#include "wallet/wallet.h"
+
+/**
+ * @brief Manages many wallets on one endpoint
+ *
+ * Addresses of the wallets that are due for a refresh are coalesced into batched unspent outputs requests, and each
+ * response is split back to the owning wallets. A scheduler thread refreshes every wallet once per interval.
+ *
+ */
+
+// the default maximum number of addresses in a request
+#define WALLET_MANAGER_BATCH_ADDRS 1000
+
+// a managed wallet
+typedef struct {
+  wallet_t* w;
+  uint64_t id;      // identifies the wallet in a refresh round, it may be removed while requests are sent
+  uint64_t due_ms;  // the next refresh time in milliseconds since the Epoch
+} wm_entry_t;
+
+typedef struct {
+  tangle_client_conf_t endpoint;  // shared by all managed wallets
+  UT_array* wallets;              // a list of wm_entry_t
+  size_t batch_addrs;             // the maximum number of addresses in a request
+  uint64_t next_id;               // the id of the last added wallet
+  pthread_mutex_t lock;           // guards the wallet list and the interval, it's not held while requests are sent
+  pthread_mutex_t round_lock;     // serializes refresh rounds
+  // scheduler
+  pthread_mutex_t sched_lock;
+  pthread_cond_t sched_cond;
+  pthread_t sched_thread;
+  bool running;
+  uint32_t interval_ms;  // guarded by lock
+  uint32_t jitter_ms;    // guarded by lock
+} wallet_manager_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates a wallet manager
+ *
+ * @param[in] url The URL of an endpoint
+ * @param[in] port The port number, 0 for default port
+ * @return wallet_manager_t* NULL on failed
+ */
+wallet_manager_t* wallet_manager_new(char const url[], uint16_t port);
+
+/**
+ * @brief Stops the scheduler and frees the manager with all managed wallets
+ *
+ * @param[in] m A wallet manager
+ */
+void wallet_manager_free(wallet_manager_t* m);
+
+/**
+ * @brief Creates a wallet that is owned by the manager, it's synced by the next refresh round.
+ *
+ * @param[in] m A wallet manager
+ * @param[in] seed The seed, NULL for random seed
+ * @param[in] last_addr The last address index
+ * @param[in] first_unspent The first unspent address index
+ * @param[in] last_unspent The last unspent address index
+ * @return wallet_t* A wallet instance, NULL on failed
+ */
+wallet_t* wallet_manager_add(wallet_manager_t* m, byte_t const seed[], uint64_t last_addr, uint64_t first_unspent,
+                             uint64_t last_unspent);
+
+/**
+ * @brief Removes and frees a managed wallet
+ *
+ * @param[in] m A wallet manager
+ * @param[in] w A managed wallet
+ * @return int 0 on success, -1 if the wallet is not managed
+ */
+int wallet_manager_remove(wallet_manager_t* m, wallet_t* w);
+
+/**
+ * @brief Gets the number of managed wallets
+ *
+ * @param[in] m A wallet manager
+ * @return size_t
+ */
+size_t wallet_manager_count(wallet_manager_t* m);
+
+/**
+ * @brief Refreshes all managed wallets with batched requests
+ *
+ * @param[in] m A wallet manager
+ * @return int 0 on success, -1 if any request failed
+ */
+int wallet_manager_refresh(wallet_manager_t* m);
+
+/**
+ * @brief Starts the scheduler thread, each wallet is refreshed once per interval
+ *
+ * @param[in] m A wallet manager
+ * @param[in] interval_ms The refresh interval of a wallet in milliseconds, greater than 0
+ * @param[in] jitter_ms A random offset in [-jitter_ms, jitter_ms] to spread wallets over the interval
+ * @return int 0 on success
+ */
+int wallet_manager_start(wallet_manager_t* m, uint32_t interval_ms, uint32_t jitter_ms);
+
+/**
+ * @brief Stops the scheduler thread
+ *
+ * @param[in] m A wallet manager
+ */
+void wallet_manager_stop(wallet_manager_t* m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "client/client_stats.h"
+#include "client/network/http.h"
+#include "client/network/http_inproc.h"
+#include "unity/unity.h"
+
+static int ok_handler(void* ctx, char const* method, char const* path, byte_t const body[], size_t len,
+                      byte_buf_t* response) {
+  if (strcmp(path, "/fail") == 0) {
+    return -1;
+  }
+  byte_buf_append(response, (byte_t const*)"{\"ok\":true}", strlen("{\"ok\":true}"));
+  return 0;
+}
+
+void test_record_phases() {
+  client_stats_reset();
+  // a new https connection
+  http_req_stats_t stats = {.wire_bytes = 100,
+                            .body_bytes = 300,
+                            .sent_bytes = 20,
+                            .lookup_us = 10,
+                            .connect_us = 30,
+                            .tls_us = 100,
+                            .first_byte_us = 500,
+                            .total_us = 600};
+  client_stats_record("https://node.example:8080/info?x=1", 0, &stats);
+  // a reused connection of the same endpoint
+  stats.reused = true;
+  client_stats_record("https://node.example:8080/value/unspentOutputs", 0, &stats);
+  // a failed request only counts in the total
+  stats.total_us = 5000;
+  client_stats_record("https://node.example:8080/info", -1, &stats);
+
+  TEST_ASSERT_EQUAL_UINT32(1, client_stats_count());
+  client_endpoint_stats_t s;
+  TEST_ASSERT(client_stats_get("https://node.example:8080", &s) == 0);
+  TEST_ASSERT_EQUAL_STRING("https://node.example:8080", s.endpoint);
+  TEST_ASSERT_EQUAL_UINT64(3, s.requests);
+  TEST_ASSERT_EQUAL_UINT64(1, s.errors);
+  TEST_ASSERT_EQUAL_UINT64(1, s.connections);
+  TEST_ASSERT_EQUAL_UINT64(60, s.sent_bytes);
+  TEST_ASSERT_EQUAL_UINT64(300, s.received_bytes);
+
+  TEST_ASSERT_EQUAL_UINT64(1, s.phases[CLIENT_PHASE_LOOKUP].count);
+  TEST_ASSERT_EQUAL_UINT64(10, s.phases[CLIENT_PHASE_LOOKUP].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(20, s.phases[CLIENT_PHASE_CONNECT].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(70, s.phases[CLIENT_PHASE_TLS].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(2, s.phases[CLIENT_PHASE_SERVER].count);
+  TEST_ASSERT_EQUAL_UINT64(800, s.phases[CLIENT_PHASE_SERVER].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(200, s.phases[CLIENT_PHASE_TRANSFER].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(3, s.phases[CLIENT_PHASE_TOTAL].count);
+  TEST_ASSERT_EQUAL_UINT64(5000, s.phases[CLIENT_PHASE_TOTAL].max_us);
+
+  // no TLS for plain http, the steps a transport doesn't time don't go negative
+  http_req_stats_t plain = {.lookup_us = 5, .connect_us = 5, .tls_us = 5, .first_byte_us = 3, .total_us = 9};
+  client_stats_record("http://127.0.0.1:14265/info", 0, &plain);
+  TEST_ASSERT(client_stats_get("http://127.0.0.1:14265/", &s) == 0);
+  TEST_ASSERT_EQUAL_UINT64(1, s.phases[CLIENT_PHASE_CONNECT].count);
+  TEST_ASSERT_EQUAL_UINT64(0, s.phases[CLIENT_PHASE_TLS].count);
+  TEST_ASSERT_EQUAL_UINT64(0, s.phases[CLIENT_PHASE_SERVER].sum_us);
+  TEST_ASSERT_EQUAL_UINT64(6, s.phases[CLIENT_PHASE_TRANSFER].sum_us);
+  TEST_ASSERT(client_stats_get("http://127.0.0.1:8080", &s) == -1);
+  TEST_ASSERT_EQUAL_UINT32(2, client_stats_count());
+}
+
+void test_percentiles() {
+  client_stats_reset();
+  client_hist_t hist = {};
+  TEST_ASSERT_EQUAL_UINT64(0, client_hist_percentile(&hist, 50));
+
+  // 90 fast requests and 10 slow ones
+  for (int i = 0; i < 100; i++) {
+    http_req_stats_t stats = {.reused = true, .total_us = i < 90 ? 100 : 70000};
+    client_stats_record("http://node", 0, &stats);
+  }
+  client_endpoint_stats_t s;
+  TEST_ASSERT(client_stats_get("http://node/info", &s) == 0);
+  client_hist_t const* total = &s.phases[CLIENT_PHASE_TOTAL];
+  TEST_ASSERT_EQUAL_UINT64(100, total->count);
+  // the upper bound of the bucket from 64 to 128 us
+  TEST_ASSERT_EQUAL_UINT64(128, client_hist_percentile(total, 50));
+  TEST_ASSERT_EQUAL_UINT64(128, client_hist_percentile(total, 90));
+  // at most the maximum
+  TEST_ASSERT_EQUAL_UINT64(70000, client_hist_percentile(total, 91));
+  TEST_ASSERT_EQUAL_UINT64(70000, client_hist_percentile(total, 100));
+  TEST_ASSERT_EQUAL_UINT64(128, client_hist_percentile(total, 0));
+
+  // durations under a microsecond and beyond the last bucket
+  http_req_stats_t stats = {.reused = true, .total_us = 0};
+  client_stats_record("http://edge", 0, &stats);
+  stats.total_us = UINT64_MAX / 2;
+  client_stats_record("http://edge", 0, &stats);
+  TEST_ASSERT(client_stats_get("http://edge", &s) == 0);
+  total = &s.phases[CLIENT_PHASE_TOTAL];
+  TEST_ASSERT_EQUAL_UINT64(1, total->buckets[0]);
+  TEST_ASSERT_EQUAL_UINT64(1, total->buckets[CLIENT_STATS_BUCKETS - 1]);
+  TEST_ASSERT_EQUAL_UINT64(0, client_hist_percentile(total, 50));
+  TEST_ASSERT_EQUAL_UINT64(UINT64_MAX / 2, client_hist_percentile(total, 100));
+}
+
+void test_enable_list_reset() {
+  client_stats_reset();
+  http_req_stats_t stats = {.total_us = 10};
+  client_stats_enable(false);
+  client_stats_record("http://a", 0, &stats);
+  TEST_ASSERT_EQUAL_UINT32(0, client_stats_count());
+  client_stats_enable(true);
+  client_stats_record("http://a", 0, &stats);
+  client_stats_record("http://b:80/x", 0, &stats);
+  client_stats_record(NULL, -1, &stats);
+
+  client_endpoint_stats_t list[4];
+  TEST_ASSERT_EQUAL_UINT32(3, client_stats_count());
+  TEST_ASSERT_EQUAL_UINT32(2, client_stats_list(list, 2));
+  TEST_ASSERT_EQUAL_UINT32(3, client_stats_list(list, 4));
+  TEST_ASSERT(client_stats_get(NULL, list) == 0);
+  TEST_ASSERT_EQUAL_STRING("", list[0].endpoint);
+  TEST_ASSERT_EQUAL_UINT64(1, list[0].errors);
+  client_stats_print();
+
+  TEST_ASSERT_EQUAL_STRING("tls", client_phase_name(CLIENT_PHASE_TLS));
+  TEST_ASSERT_EQUAL_STRING("unknown", client_phase_name(CLIENT_PHASE_COUNT));
+  client_stats_reset();
+  TEST_ASSERT_EQUAL_UINT32(0, client_stats_count());
+}
+
+void test_client_requests() {
+  client_stats_reset();
+  http_transport_t* t = http_inproc_new(ok_handler, NULL);
+  TEST_ASSERT_NOT_NULL(t);
+  http_req_stats_t stats = {};
+  http_client_config_t conf = {.url = "http://node.inproc/info", .transport = t};
+  byte_buf_t* response = byte_buf_new();
+  TEST_ASSERT(http_client_get(&conf, response) == 0);
+  // the caller's stats are optional, they get the same numbers as the recorder
+  conf.stats = &stats;
+  TEST_ASSERT(http_client_get(&conf, response) == 0);
+  TEST_ASSERT_EQUAL_UINT64(strlen("{\"ok\":true}"), stats.wire_bytes);
+  TEST_ASSERT(stats.reused);
+  TEST_ASSERT(stats.first_byte_us <= stats.total_us);
+  conf.url = "http://node.inproc/fail";
+  TEST_ASSERT(http_client_get(&conf, response) == -1);
+
+  client_endpoint_stats_t s;
+  TEST_ASSERT(client_stats_get("http://node.inproc", &s) == 0);
+  TEST_ASSERT_EQUAL_UINT64(3, s.requests);
+  TEST_ASSERT_EQUAL_UINT64(1, s.errors);
+  TEST_ASSERT_EQUAL_UINT64(0, s.connections);
+  TEST_ASSERT_EQUAL_UINT64(2 * strlen("{\"ok\":true}"), s.received_bytes);
+  TEST_ASSERT_EQUAL_UINT64(2, s.phases[CLIENT_PHASE_SERVER].count);
+  TEST_ASSERT_EQUAL_UINT64(0, s.phases[CLIENT_PHASE_LOOKUP].count);
+  byte_buf_free(response);
+  http_inproc_free(t);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_record_phases);
+  RUN_TEST(test_percentiles);
+  RUN_TEST(test_enable_list_reset);
+  RUN_TEST(test_client_requests);
+
+  return UNITY_END();
+}
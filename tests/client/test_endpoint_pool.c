@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client/endpoint_pool.h"
+#include "client/network/http.h"
+#include "test_server.h"
+#include "unity/unity.h"
+
+#define NODES 3
+
+static char const* const g_unspent =
+    "{\"unspent_outputs\":[{\"address\":\"YQp3UbW56TX9HTm1XTUw1tRWHhLg8tKnNhT5FDq5MLNb\",\"output_ids\":[{\"id\":"
+    "\"ALC5JTNWc3dxeF4gwiCHnLEPTATbXt3pX2HxoGqV15WWkT84CuiFty3cCRq5QaF3mYK5b87jpXyPLKbpsAdMPvaS\",\"balances\":[{"
+    "\"value\":1337,\"color\":\"IOTA\"}],\"inclusion_state\":{\"confirmed\":true,\"liked\":true,\"finalized\":true}}]"
+    "}]}";
+
+// a local node answering the info and unspentOutputs APIs, the test and server threads share it atomically
+typedef struct {
+  test_server_t server;
+  bool synced;
+  uint32_t delay_ms;  // the delay of unspentOutputs answers
+  size_t unspent_requests;
+} node_server_t;
+
+static node_server_t g_nodes[NODES];
+
+static bool server_fn(test_server_t* s, int fd, test_request_t const* req) {
+  node_server_t* node = (node_server_t*)s->ctx;
+  char body[512];
+  if (strstr(req->path, "unspentOutputs")) {
+    __atomic_fetch_add(&node->unspent_requests, 1, __ATOMIC_SEQ_CST);
+    usleep(__atomic_load_n(&node->delay_ms, __ATOMIC_SEQ_CST) * 1000);
+    snprintf(body, sizeof(body), "%s", g_unspent);
+  } else {
+    snprintf(body, sizeof(body), "{\"version\":\"v0.3.0\",\"identityID\":\"KBTmE299rMU\",\"synced\":%s}",
+             __atomic_load_n(&node->synced, __ATOMIC_SEQ_CST) ? "true" : "false");
+  }
+  // the client may be gone if it was a hedged race
+  test_server_reply(s, fd, "200 OK", body, true);
+  return false;
+}
+
+static void servers_start() {
+  for (int i = 0; i < NODES; i++) {
+    test_server_start(&g_nodes[i].server, server_fn, &g_nodes[i], 0);
+  }
+}
+
+static void servers_stop() {
+  for (int i = 0; i < NODES; i++) {
+    test_server_stop(&g_nodes[i].server);
+  }
+}
+
+static endpoint_pool_t* pool_of_nodes() {
+  endpoint_pool_t* pool = endpoint_pool_new();
+  TEST_ASSERT_NOT_NULL(pool);
+  for (int i = 0; i < NODES; i++) {
+    __atomic_store_n(&g_nodes[i].unspent_requests, 0, __ATOMIC_SEQ_CST);
+    TEST_ASSERT(endpoint_pool_add(pool, g_nodes[i].server.url, 0) == 0);
+  }
+  return pool;
+}
+
+void test_endpoint_routing() {
+  tangle_client_conf_t conf = {};
+  endpoint_pool_t* pool = endpoint_pool_new();
+  TEST_ASSERT(endpoint_pool_pick(pool, &conf) == -1);
+  TEST_ASSERT(endpoint_pool_add(pool, NULL, 0) == -1);
+  endpoint_pool_free(pool);
+
+  // node 2 is out of sync
+  __atomic_store_n(&g_nodes[0].synced, true, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&g_nodes[1].synced, true, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&g_nodes[2].synced, false, __ATOMIC_SEQ_CST);
+  pool = pool_of_nodes();
+  TEST_ASSERT_EQUAL_INT(2, endpoint_pool_check(pool));
+
+  // the lowest latency wins among synced nodes
+  for (int i = 0; i < 16; i++) {
+    endpoint_pool_report(pool, 0, 0, 5000);
+    endpoint_pool_report(pool, 1, 0, 1000);
+    endpoint_pool_report(pool, 2, 0, 10);
+  }
+  TEST_ASSERT_EQUAL_INT(1, endpoint_pool_pick(pool, &conf));
+  TEST_ASSERT_EQUAL_STRING(g_nodes[1].server.url, conf.url);
+
+  // the moving average follows the latency
+  for (int i = 0; i < 32; i++) {
+    endpoint_pool_report(pool, 1, 0, 20000);
+  }
+  TEST_ASSERT_EQUAL_INT(0, endpoint_pool_pick(pool, &conf));
+
+  // failing nodes are skipped until a health check succeeds
+  for (int i = 0; i < ENDPOINT_MAX_FAILURES; i++) {
+    endpoint_pool_report(pool, 0, -1, 0);
+  }
+  TEST_ASSERT_EQUAL_INT(1, endpoint_pool_pick(pool, &conf));
+  endpoint_t node = {};
+  TEST_ASSERT(endpoint_pool_status(pool, 0, &node) == 0);
+  TEST_ASSERT_EQUAL_UINT32(ENDPOINT_MAX_FAILURES, node.failures);
+  TEST_ASSERT_EQUAL_UINT32(ENDPOINT_MAX_FAILURES, node.errors);
+  TEST_ASSERT_EQUAL_INT(2, endpoint_pool_check(pool));
+  TEST_ASSERT(endpoint_pool_status(pool, 0, &node) == 0);
+  TEST_ASSERT_EQUAL_UINT32(0, node.failures);
+  TEST_ASSERT(endpoint_pool_status(pool, NODES, &node) == -1);
+
+  endpoint_pool_free(pool);
+}
+
+void test_endpoint_hedged_read() {
+  __atomic_store_n(&g_nodes[0].synced, true, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&g_nodes[1].synced, true, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&g_nodes[2].synced, true, __ATOMIC_SEQ_CST);
+  endpoint_pool_t* pool = pool_of_nodes();
+  TEST_ASSERT_EQUAL_INT(NODES, endpoint_pool_check(pool));
+  TEST_ASSERT(endpoint_pool_set_hedge(pool, 100, 0) == -1);
+  TEST_ASSERT(endpoint_pool_set_hedge(pool, 90, 20) == 0);
+
+  // node 0 looks fastest but stalls, node 1 is the second best
+  for (int i = 0; i < 16; i++) {
+    endpoint_pool_report(pool, 0, 0, 1000);
+    endpoint_pool_report(pool, 1, 0, 2000);
+    endpoint_pool_report(pool, 2, 0, 50000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(20, endpoint_pool_hedge_delay(pool, 0));
+  TEST_ASSERT_EQUAL_UINT32(50, endpoint_pool_hedge_delay(pool, 2));
+  __atomic_store_n(&g_nodes[0].delay_ms, 1500, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&g_nodes[1].delay_ms, 0, __ATOMIC_SEQ_CST);
+
+  addr_list_t* addrs = addr_list_new();
+  address_t addr = {};
+  addr_list_push(addrs, &addr);
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  uint64_t start = endpoint_now_us();
+  TEST_ASSERT(endpoint_pool_get_unspent_outputs(pool, addrs, &unspent) == 0);
+  uint64_t elapsed_ms = (endpoint_now_us() - start) / 1000;
+  TEST_ASSERT_EQUAL_UINT64(1337, unspent_outputs_balance(&unspent));
+  // answered by the hedge, long before the stalled node
+  TEST_ASSERT(elapsed_ms < 1000);
+  TEST_ASSERT_EQUAL_UINT32(1, __atomic_load_n(&g_nodes[0].unspent_requests, __ATOMIC_SEQ_CST));
+  TEST_ASSERT_EQUAL_UINT32(1, __atomic_load_n(&g_nodes[1].unspent_requests, __ATOMIC_SEQ_CST));
+  endpoint_t node = {};
+  endpoint_pool_status(pool, 1, &node);
+  TEST_ASSERT_EQUAL_UINT64(1, node.hedges);
+  TEST_ASSERT_EQUAL_UINT64(1, node.wins);
+
+  // a table with data is rejected
+  TEST_ASSERT(endpoint_pool_get_unspent_outputs(pool, addrs, &unspent) == -1);
+  unspent_outputs_free(&unspent);
+
+  // without hedging, a failing node falls over to the next one
+  __atomic_store_n(&g_nodes[0].delay_ms, 0, __ATOMIC_SEQ_CST);
+  endpoint_pool_set_hedge(pool, 0, 0);
+  endpoint_pool_t* broken = endpoint_pool_new();
+  endpoint_pool_add(broken, "http://127.0.0.1:1/", 0);
+  endpoint_pool_add(broken, g_nodes[2].server.url, 0);
+  // both are unsynced, the closed port is reported as fast to be tried first
+  __atomic_store_n(&g_nodes[2].synced, false, __ATOMIC_SEQ_CST);
+  endpoint_pool_check(broken);
+  endpoint_pool_report(broken, 0, 0, 1);
+  unspent = unspent_outputs_init();
+  TEST_ASSERT(endpoint_pool_get_unspent_outputs(broken, addrs, &unspent) == 0);
+  TEST_ASSERT_EQUAL_UINT64(1337, unspent_outputs_balance(&unspent));
+  unspent_outputs_free(&unspent);
+  endpoint_pool_status(broken, 0, &node);
+  TEST_ASSERT_EQUAL_UINT64(2, node.errors);
+  endpoint_pool_status(broken, 1, &node);
+  TEST_ASSERT_EQUAL_UINT64(0, node.hedges);
+  endpoint_pool_free(broken);
+
+  addr_list_free(addrs);
+  endpoint_pool_free(pool);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  http_client_init();
+  servers_start();
+  RUN_TEST(test_endpoint_routing);
+  RUN_TEST(test_endpoint_hedged_read);
+  servers_stop();
+  http_client_clean();
+
+  return UNITY_END();
+}
@@ -1,9 +1,67 @@
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 #include <unity/unity.h>
 
 #include "client/api/get_unspent_outputs.h"
+#include "client/api/json_stream.h"
+#include "client/api/json_utils.h"
 #include "client/network/http.h"
+#include "test_server.h"
+
+#define SHARD_ADDRS 1000
+#define SHARD_CHUNK 64
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t g_max_request_addrs = 0;
+
+// answers with one output of value 1 for each requested address.
+static bool server_fn(test_server_t* s, int fd, test_request_t const* req) {
+  char const* body = req->body;
+  cJSON* j_req = cJSON_Parse(body);
+  cJSON* j_addrs = cJSON_GetObjectItemCaseSensitive(j_req, "addresses");
+  cJSON* j_res = cJSON_CreateObject();
+  cJSON* j_unspent = cJSON_CreateArray();
+  cJSON_AddItemToObject(j_res, "unspent_outputs", j_unspent);
+  size_t n = 0;
+  cJSON* j_addr = NULL;
+  cJSON_ArrayForEach(j_addr, j_addrs) {
+    byte_t output_id[TX_OUTPUT_ID_BYTES] = {};
+    char id_str[TX_OUTPUT_ID_BASE58_BUF];
+    address_from_base58(j_addr->valuestring, output_id);
+    tx_output_id_2_base58(output_id, id_str);
+    cJSON* j_elm = cJSON_CreateObject();
+    cJSON_AddStringToObject(j_elm, "address", j_addr->valuestring);
+    cJSON* j_ids = cJSON_CreateArray();
+    cJSON_AddItemToObject(j_elm, "output_ids", j_ids);
+    cJSON* j_id = cJSON_CreateObject();
+    cJSON_AddStringToObject(j_id, "id", id_str);
+    cJSON* j_bal = cJSON_CreateObject();
+    cJSON_AddNumberToObject(j_bal, "value", 1);
+    cJSON_AddStringToObject(j_bal, "color", "IOTA");
+    cJSON* j_bals = cJSON_CreateArray();
+    cJSON_AddItemToObject(j_id, "balances", j_bals);
+    cJSON_AddItemToArray(j_bals, j_bal);
+    cJSON* j_state = cJSON_CreateObject();
+    cJSON_AddBoolToObject(j_state, "confirmed", true);
+    cJSON_AddItemToObject(j_id, "inclusion_state", j_state);
+    cJSON_AddItemToArray(j_ids, j_id);
+    cJSON_AddItemToArray(j_unspent, j_elm);
+    n++;
+  }
+  pthread_mutex_lock(&g_lock);
+  if (n > g_max_request_addrs) {
+    g_max_request_addrs = n;
+  }
+  pthread_mutex_unlock(&g_lock);
+  char* text = cJSON_PrintUnformatted(j_res);
+  test_server_reply(s, fd, "200 OK", text, true);
+  free(text);
+  cJSON_Delete(j_res);
+  cJSON_Delete(j_req);
+  return false;
+}
 
 void test_unspent_outputs() {
   tangle_client_conf_t ctx = {
@@ -95,6 +153,91 @@ void test_deser_unspent_outputs() {
   TEST_ASSERT_EQUAL_UINT64(2574, unspent_outputs_balance(&unspents));
   unspent_outputs_free(&unspents);
   TEST_ASSERT_NULL(unspents);
+
+  // the decoder takes a response in chunks of any size
+  unspent_decoder_t* dec = unspent_decoder_new(&unspents);
+  TEST_ASSERT_NOT_NULL(dec);
+  for (size_t i = 0; i < strlen(data5); i++) {
+    TEST_ASSERT(unspent_decoder_feed(dec, (byte_t const*)data5 + i, 1) == 0);
+  }
+  TEST_ASSERT(unspent_decoder_finish(dec) == 0);
+  unspent_decoder_free(dec);
+  TEST_ASSERT_EQUAL_UINT32(3, unspent_outputs_count(&unspents));
+  TEST_ASSERT_EQUAL_UINT64(2674, unspent_outputs_balance(&unspents));
+  unspent_outputs_free(&unspents);
+
+  // a truncated response
+  dec = unspent_decoder_new(&unspents);
+  TEST_ASSERT(unspent_decoder_feed(dec, (byte_t const*)data5, strlen(data5) / 2) == 0);
+  TEST_ASSERT(unspent_decoder_finish(dec) == -1);
+  unspent_decoder_free(dec);
+  unspent_outputs_free(&unspents);
+
+  // long values which are not decoded are skipped, a long value which is decoded fails
+  char const* fields[] = {"\"note\":\"", "\"address\":\""};
+  for (size_t i = 0; i < 2; i++) {
+    size_t long_len = JSON_STREAM_MAX_TOKEN * 8;
+    char* data = malloc(strlen(data1) + long_len + 32);
+    TEST_ASSERT_NOT_NULL(data);
+    // the long field goes in front of the first record
+    size_t head = strlen("{\"unspent_outputs\":[{");
+    int n = sprintf(data, "%.*s%s", (int)head, data1, fields[i]);
+    memset(data + n, 'x', long_len);
+    sprintf(data + n + long_len, "\",%s", data1 + head);
+    TEST_ASSERT(deser_unspent_outputs(data, &unspents) == (i == 0 ? 0 : -1));
+    if (i == 0) {
+      TEST_ASSERT_EQUAL_UINT64(1337, unspent_outputs_balance(&unspents));
+    }
+    unspent_outputs_free(&unspents);
+    free(data);
+  }
+}
+
+void test_unspent_outputs_sharded() {
+  test_server_t server;
+  test_server_start(&server, server_fn, NULL, 0);
+  tangle_client_conf_t conf = {};
+  snprintf(conf.url, sizeof(conf.url), "%s", server.url);
+
+  byte_t seed[TANGLE_SEED_BYTES];
+  randombytes_buf(seed, TANGLE_SEED_BYTES);
+  addr_list_t* addrs = addr_list_new();
+  address_t tmp_addr = {};
+  for (uint64_t i = 0; i < SHARD_ADDRS; i++) {
+    address_get(seed, i, ADDRESS_VER_ED25519, tmp_addr.addr);
+    tmp_addr.index = i;
+    addr_list_push(addrs, &tmp_addr);
+  }
+
+  // chunks are merged into one table with address indexes
+  unspent_outputs_t* unspents = unspent_outputs_init();
+  TEST_ASSERT(get_unspent_outputs_sharded(&conf, addrs, SHARD_CHUNK, 4, &unspents) == 0);
+  TEST_ASSERT_EQUAL_UINT32((SHARD_ADDRS + SHARD_CHUNK - 1) / SHARD_CHUNK, test_server_requests(&server));
+  pthread_mutex_lock(&g_lock);
+  size_t max_addrs = g_max_request_addrs;
+  pthread_mutex_unlock(&g_lock);
+  TEST_ASSERT_EQUAL_UINT32(SHARD_CHUNK, max_addrs);
+  TEST_ASSERT_EQUAL_UINT32(SHARD_ADDRS, unspent_outputs_count(&unspents));
+  TEST_ASSERT_EQUAL_UINT64(SHARD_ADDRS, unspent_outputs_balance(&unspents));
+  for (size_t i = 0; i < SHARD_ADDRS; i += 97) {
+    address_t* a = addr_list_at(addrs, i);
+    unspent_outputs_t* elm = unspent_outputs_find(&unspents, a->addr);
+    TEST_ASSERT_NOT_NULL(elm);
+    TEST_ASSERT_EQUAL_UINT64(a->index, elm->addr_index);
+  }
+  unspent_outputs_free(&unspents);
+
+  // invalid sizes
+  TEST_ASSERT(get_unspent_outputs_sharded(&conf, addrs, 0, 4, &unspents) == -1);
+  TEST_ASSERT(get_unspent_outputs_sharded(&conf, addrs, SHARD_CHUNK, 0, &unspents) == -1);
+
+  // a failed chunk fails the request
+  tangle_client_conf_t closed = {.url = "http://127.0.0.1:1/"};
+  TEST_ASSERT(get_unspent_outputs_sharded(&closed, addrs, SHARD_CHUNK, 4, &unspents) == -1);
+  unspent_outputs_free(&unspents);
+
+  addr_list_free(addrs);
+  test_server_stop(&server);
 }
 
 int main() {
@@ -103,6 +246,7 @@ int main() {
   http_client_init();
 
   RUN_TEST(test_deser_unspent_outputs);
+  RUN_TEST(test_unspent_outputs_sharded);
   // RUN_TEST(test_unspent_outputs);
 
   http_client_clean();
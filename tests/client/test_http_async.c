@@ -0,0 +1,357 @@
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "client/api/get_node_info.h"
+#include "client/api/get_unspent_outputs.h"
+#include "client/api/send_transaction.h"
+#include "client/client_stats.h"
+#include "client/network/http_async.h"
+#include "test_server.h"
+#include "unity/unity.h"
+
+#define CONCURRENT_REQUESTS 200
+#define MAX_WATCHES 64
+#define BIG_BODY_LEN (1024 * 1024)
+#define SLOW_REQUESTS 16
+
+static char const* const g_body =
+    "{\"version\":\"v0.3.0\",\"identityID\":\"KBTmE299rMU\",\"synced\":true,\"transaction_id\":"
+    "\"4uQeVj5tqViQh7yWWGStvkEG1Zmhx6uasJtWCJziofM\"}";
+
+// the gzip encoding of an unspent outputs response of 867 bytes, with a balance of 2674
+#define GZ_BODY_PLAIN_LEN 867
+static byte_t const g_gz_body[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xb5, 0x90, 0x5b, 0x8f, 0xa2, 0x40, 0x10, 0x85, 0xff,
+    0x4b, 0x3f, 0xf3, 0x30, 0xc8, 0x45, 0x98, 0x37, 0x45, 0x91, 0x1d, 0xc0, 0x45, 0x6c, 0x04, 0x76, 0x62, 0x0c, 0x57,
+    0x69, 0x2e, 0xcd, 0xa5, 0x1b, 0x54, 0x8c, 0xff, 0x7d, 0xd9, 0x4c, 0x36, 0xbb, 0x99, 0xc4, 0x97, 0x49, 0x26, 0xf5,
+    0x52, 0x55, 0xa9, 0x7c, 0xa7, 0xce, 0xb9, 0x83, 0x1e, 0x93, 0x26, 0xc1, 0xf4, 0x54, 0xf7, 0xb4, 0xe9, 0x29, 0x01,
+    0xaf, 0xef, 0x77, 0x10, 0xc4, 0x71, 0x97, 0x90, 0xa9, 0x07, 0x9e, 0x81, 0x7d, 0xf2, 0x66, 0x0c, 0x21, 0x67, 0xe5,
+    0x9c, 0xca, 0x56, 0xbc, 0x49, 0xa5, 0x81, 0xfa, 0x39, 0x5c, 0x2a, 0xa6, 0x7f, 0x31, 0xaa, 0x42, 0xc8, 0x87, 0x80,
+    0x75, 0x3c, 0x64, 0xe5, 0x15, 0x60, 0xc0, 0x07, 0xe4, 0x84, 0xe2, 0x3f, 0x9c, 0xe3, 0x83, 0xf9, 0x1f, 0xe5, 0xe8,
+    0x4e, 0xae, 0x0f, 0x69, 0xa7, 0xdb, 0xac, 0x8d, 0x6d, 0xb4, 0x6c, 0xbc, 0xbd, 0x7e, 0xad, 0xc5, 0x95, 0x8d, 0x07,
+    0x57, 0xac, 0xdb, 0x34, 0x25, 0x9b, 0x74, 0xd5, 0xad, 0xd6, 0xe8, 0x60, 0x7a, 0x9f, 0x51, 0x77, 0x80, 0xe2, 0x09,
+    0x21, 0xcf, 0xcf, 0x83, 0x43, 0x23, 0x92, 0x8d, 0x48, 0x5c, 0x6d, 0xe4, 0xb1, 0x69, 0x43, 0xa3, 0x3e, 0x14, 0xf4,
+    0x40, 0xf8, 0xa2, 0xea, 0x46, 0xb9, 0xc2, 0xbc, 0x1f, 0x9d, 0xdd, 0x74, 0x4b, 0x67, 0x5d, 0x6d, 0xe7, 0xd6, 0xf2,
+    0x97, 0xb1, 0x73, 0x07, 0xcc, 0xe9, 0x37, 0x3e, 0x5b, 0xd2, 0xce, 0x87, 0x2c, 0xa1, 0x3e, 0x9b, 0xda, 0x66, 0x1b,
+    0x75, 0x0b, 0x4d, 0xac, 0x5a, 0x79, 0x3f, 0x6a, 0xe2, 0x5e, 0x9d, 0xe4, 0xc2, 0xa0, 0x0c, 0x70, 0x94, 0x7c, 0x88,
+    0x0d, 0x41, 0xd9, 0x27, 0xe0, 0x95, 0x7d, 0x79, 0x61, 0x40, 0x54, 0x97, 0x75, 0x37, 0x69, 0xff, 0xf8, 0x09, 0x17,
+    0xe0, 0x71, 0x64, 0x00, 0xc2, 0x51, 0xd9, 0x13, 0x54, 0xe3, 0x13, 0xa1, 0x01, 0x9d, 0xce, 0xee, 0xd3, 0x0d, 0x4e,
+    0x51, 0x57, 0x25, 0xd3, 0x8f, 0xb4, 0xeb, 0x13, 0x06, 0x94, 0xa8, 0xf8, 0x37, 0xa4, 0x08, 0x07, 0x25, 0x1a, 0xff,
+    0x2e, 0x1e, 0x8f, 0x4f, 0xc1, 0xf8, 0xbb, 0x86, 0x73, 0x42, 0x57, 0x10, 0xa1, 0x27, 0x6b, 0xb0, 0x62, 0x3d, 0xe8,
+    0x5c, 0x58, 0x6a, 0xbb, 0x5a, 0x66, 0x9c, 0x25, 0xaa, 0xe3, 0x6d, 0x06, 0x05, 0x75, 0xd5, 0x0a, 0xa6, 0xb1, 0x0d,
+    0x9f, 0x04, 0xb3, 0x30, 0x14, 0xe1, 0x0d, 0x6e, 0xdd, 0x88, 0x8b, 0xaf, 0x89, 0xca, 0x9f, 0x2f, 0x48, 0xd1, 0xb0,
+    0xb1, 0xb6, 0xe0, 0x02, 0x86, 0x1e, 0xe5, 0x1a, 0x6f, 0xa6, 0x5d, 0xeb, 0x4d, 0x7b, 0x60, 0x05, 0xd7, 0x0d, 0x94,
+    0xb9, 0x34, 0xb2, 0x8e, 0x93, 0x8a, 0xc9, 0xc1, 0xdb, 0x3b, 0x58, 0x2e, 0xfa, 0xd8, 0x8d, 0x84, 0x71, 0xb3, 0x25,
+    0x9e, 0x44, 0xb3, 0x2e, 0x41, 0xbb, 0xb5, 0x1e, 0x8c, 0xa6, 0x96, 0x66, 0xe6, 0xb3, 0x60, 0x66, 0xdc, 0xfc, 0x5b,
+    0x92, 0x61, 0xbe, 0xe0, 0xa7, 0x80, 0x12, 0xaf, 0xf4, 0x48, 0xa5, 0x37, 0x2e, 0x52, 0xec, 0x56, 0xd8, 0x05, 0x2a,
+    0x57, 0xf9, 0xba, 0x10, 0x4a, 0xf3, 0xbc, 0xf1, 0x6e, 0x96, 0xa1, 0x87, 0x0d, 0x59, 0xc4, 0xa6, 0x35, 0x04, 0xfb,
+    0x67, 0x7e, 0xb8, 0x6f, 0xf2, 0x73, 0x9c, 0xea, 0x37, 0x8d, 0x82, 0xd5, 0x09, 0x63, 0x03, 0x00, 0x00};
+
+static test_server_t g_server;
+static tangle_client_conf_t g_conf = {};
+
+// answers every request with the same JSON body and closes the connection, a gzip encoded unspent outputs response
+// if the client accepts it. /big answers with a large body, /slow takes a while.
+static bool server_fn(test_server_t* s, int fd, test_request_t const* req) {
+  char const* encoding = strstr(req->head, "Accept-Encoding:");
+  if (strcmp(req->path, "/big") == 0) {
+    char* big = malloc(BIG_BODY_LEN + 128);
+    int n = sprintf(big, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\nConnection: close\r\n\r\n", BIG_BODY_LEN);
+    for (int i = 0; i < BIG_BODY_LEN; i++) {
+      big[n + i] = (char)(i % 251);
+    }
+    test_server_send(s, fd, big, n + BIG_BODY_LEN);
+    free(big);
+  } else if (strcmp(req->path, "/keep") == 0) {
+    test_server_reply(s, fd, "200 OK", g_body, false);
+    return true;
+  } else if (strcmp(req->path, "/slow") == 0) {
+    usleep(50 * 1000);
+    test_server_reply(s, fd, "200 OK", g_body, true);
+  } else if (encoding && strstr(encoding, "gzip")) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Encoding: gzip\r\n"
+                     "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                     sizeof(g_gz_body));
+    test_server_send(s, fd, head, n);
+    test_server_send(s, fd, g_gz_body, sizeof(g_gz_body));
+  } else {
+    test_server_reply(s, fd, "200 OK", g_body, true);
+  }
+  return false;
+}
+
+static void node_info_cb(int ret, res_node_info_t* res, void* ctx) {
+  if (ret == 0 && strcmp(res->version, "v0.3.0") == 0 && res->is_synced) {
+    (*(size_t*)ctx)++;
+  }
+}
+
+static void send_tx_cb_fn(int ret, res_send_tx_t* res, void* ctx) {
+  if (ret == 0 && strcmp(res->msg_id, "4uQeVj5tqViQh7yWWGStvkEG1Zmhx6uasJtWCJziofM") == 0) {
+    (*(size_t*)ctx)++;
+  }
+}
+
+static void failed_cb(int ret, res_node_info_t* res, void* ctx) {
+  if (ret != 0) {
+    (*(size_t*)ctx)++;
+  }
+}
+
+void test_async_builtin_loop() {
+  size_t done = 0;
+  http_loop_t* loop = http_loop_new();
+  TEST_ASSERT_NOT_NULL(loop);
+
+  // one thread drives all requests
+  for (int i = 0; i < CONCURRENT_REQUESTS; i++) {
+    TEST_ASSERT(get_node_info_async(loop, &g_conf, node_info_cb, &done) == 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(CONCURRENT_REQUESTS, http_loop_pending(loop));
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 30000));
+  TEST_ASSERT_EQUAL_UINT32(CONCURRENT_REQUESTS, done);
+
+  // a closed port fails through the callback
+  tangle_client_conf_t closed = {.url = "http://127.0.0.1:1/"};
+  done = 0;
+  TEST_ASSERT(get_node_info_async(loop, &closed, failed_cb, &done) == 0);
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 30000));
+  TEST_ASSERT_EQUAL_UINT32(1, done);
+
+  http_loop_free(loop);
+}
+
+typedef struct {
+  struct pollfd fds[MAX_WATCHES];
+  size_t n;
+} watch_set_t;
+
+static void watch_fn(int fd, int events, void* ctx) {
+  watch_set_t* set = (watch_set_t*)ctx;
+  size_t i = 0;
+  while (i < set->n && set->fds[i].fd != fd) {
+    i++;
+  }
+  if (events == 0) {
+    if (i < set->n) {
+      set->fds[i] = set->fds[--set->n];
+    }
+    return;
+  }
+  if (i == set->n) {
+    TEST_ASSERT(set->n < MAX_WATCHES);
+    set->fds[set->n++].fd = fd;
+  }
+  set->fds[i].events = ((events & HTTP_EV_IN) ? POLLIN : 0) | ((events & HTTP_EV_OUT) ? POLLOUT : 0);
+}
+
+void test_async_external_loop() {
+  size_t done = 0;
+  watch_set_t set = {};
+  http_loop_t* loop = http_loop_new();
+  http_loop_set_watch(loop, watch_fn, &set);
+
+  byte_t tx_bytes[] = "dHJhbnNhY3Rpb24=";
+  for (int i = 0; i < 8; i++) {
+    TEST_ASSERT(send_tx_bytes_async(loop, &g_conf, tx_bytes, send_tx_cb_fn, &done) == 0);
+  }
+
+  // an application's own poll loop
+  for (int round = 0; http_loop_pending(loop) > 0 && round < 10000; round++) {
+    long timeout = http_loop_timeout(loop);
+    int ready = poll(set.fds, set.n, timeout < 0 || timeout > 100 ? 100 : (int)timeout);
+    TEST_ASSERT(ready >= 0);
+    struct pollfd fired[MAX_WATCHES];
+    size_t n = set.n;
+    memcpy(fired, set.fds, sizeof(struct pollfd) * n);
+    for (size_t i = 0; i < n; i++) {
+      if (fired[i].revents) {
+        int events = ((fired[i].revents & POLLIN) ? HTTP_EV_IN : 0) | ((fired[i].revents & POLLOUT) ? HTTP_EV_OUT : 0) |
+                     ((fired[i].revents & (POLLERR | POLLHUP)) ? HTTP_EV_ERR : 0);
+        TEST_ASSERT(http_loop_socket_action(loop, fired[i].fd, events) == 0);
+      }
+    }
+    if (http_loop_timeout(loop) == 0) {
+      TEST_ASSERT(http_loop_timeout_action(loop) == 0);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(8, done);
+  TEST_ASSERT_EQUAL_UINT32(0, set.n);
+
+  // cancelled and pending requests complete with an error
+  done = 0;
+  TEST_ASSERT(get_node_info_async(loop, &g_conf, failed_cb, &done) == 0);
+  http_client_config_t http_conf = {.url = g_conf.url};
+  http_req_t* req = http_loop_get(loop, &http_conf, NULL, NULL);
+  TEST_ASSERT_NOT_NULL(req);
+  http_loop_cancel(loop, req);
+  TEST_ASSERT_EQUAL_UINT32(1, http_loop_pending(loop));
+  http_loop_free(loop);
+  TEST_ASSERT_EQUAL_UINT32(1, done);
+}
+
+typedef struct {
+  pthread_t loop_thread;
+  bool on_loop_thread;
+  size_t calls;
+  size_t len;
+  size_t max_part;
+  bool valid;
+  size_t done;
+} big_t;
+
+static int big_write(byte_t const data[], size_t len, void* ctx) {
+  big_t* big = (big_t*)ctx;
+  big->on_loop_thread = big->on_loop_thread && pthread_equal(big->loop_thread, pthread_self());
+  for (size_t i = 0; i < len; i++) {
+    big->valid = big->valid && data[i] == (byte_t)((big->len + i) % 251);
+  }
+  big->calls++;
+  big->len += len;
+  big->max_part = len > big->max_part ? len : big->max_part;
+  return 0;
+}
+
+static void big_cb(int ret, byte_buf_t* response, void* ctx) {
+  if (ret == 0) {
+    ((big_t*)ctx)->done++;
+  }
+}
+
+void test_async_streaming() {
+  // the body is handed over in parts on the thread driving the loop
+  char url[sizeof(g_server.url) + 8];
+  snprintf(url, sizeof(url), "%sbig", g_server.url);
+  http_client_config_t http_conf = {.url = url};
+  big_t big = {.loop_thread = pthread_self(), .on_loop_thread = true, .valid = true};
+  http_loop_t* loop = http_loop_new();
+  TEST_ASSERT_NOT_NULL(http_loop_post_stream(loop, &http_conf, NULL, big_write, big_cb, &big));
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 30000));
+  TEST_ASSERT_EQUAL_UINT32(1, big.done);
+  TEST_ASSERT_EQUAL_UINT32(BIG_BODY_LEN, big.len);
+  TEST_ASSERT_TRUE(big.valid);
+  TEST_ASSERT_TRUE(big.on_loop_thread);
+  TEST_ASSERT(big.calls > 1);
+  TEST_ASSERT(big.max_part < BIG_BODY_LEN / 4);
+
+  // requests overlap, without a connection or a thread for each of them in builds without libcurl
+  snprintf(url, sizeof(url), "%sslow", g_server.url);
+  pthread_mutex_lock(&g_server.lock);
+  g_server.max_active = g_server.active;
+  pthread_mutex_unlock(&g_server.lock);
+  big.done = 0;
+  for (int i = 0; i < SLOW_REQUESTS; i++) {
+    TEST_ASSERT_NOT_NULL(http_loop_get(loop, &http_conf, big_cb, &big));
+  }
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 30000));
+  TEST_ASSERT_EQUAL_UINT32(SLOW_REQUESTS, big.done);
+  TEST_ASSERT(test_server_max_active(&g_server) > 1);
+#ifdef HTTP_SOCKET_DEFAULT
+  TEST_ASSERT(test_server_max_active(&g_server) < SLOW_REQUESTS / 2);
+#endif
+  http_loop_free(loop);
+}
+
+static void keep_cb(int ret, byte_buf_t* response, void* ctx) {
+  if (ret == 0 && response->len > 0) {
+    (*(int*)ctx)++;
+  }
+}
+
+void test_async_shared_connections() {
+  // a connection opened by a blocking request is reused by the loop
+  char url[sizeof(g_server.url) + 8];
+  snprintf(url, sizeof(url), "%skeep", g_server.url);
+  http_client_config_t http_conf = {.url = url};
+  byte_buf_t* res = byte_buf_new();
+  TEST_ASSERT_NOT_NULL(res);
+  TEST_ASSERT_EQUAL_INT(0, http_client_get(&http_conf, res));
+  int accepted = test_server_accepted(&g_server);
+
+  int done = 0;
+  http_loop_t* loop = http_loop_new();
+  TEST_ASSERT_NOT_NULL(http_loop_get(loop, &http_conf, keep_cb, &done));
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 5000));
+  http_loop_free(loop);
+  TEST_ASSERT_EQUAL_INT(1, done);
+  TEST_ASSERT_EQUAL_INT(accepted, test_server_accepted(&g_server));
+  byte_buf_free(res);
+}
+
+void test_compressed_transfer() {
+  // the API decodes the compressed body as it arrives
+  tangle_client_conf_t conf = g_conf;
+  conf.compress = true;
+  addr_list_t* addrs = addr_list_new();
+  address_t addr = {};
+  addr_list_push(addrs, &addr);
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  TEST_ASSERT(get_unspent_outputs(&conf, addrs, &unspent) == 0);
+  TEST_ASSERT_EQUAL_UINT64(2674, unspent_outputs_balance(&unspent));
+  unspent_outputs_free(&unspent);
+  addr_list_free(addrs);
+
+  // stats of a compressed and a plain transfer
+  http_req_stats_t stats = {};
+  http_client_config_t http_conf = {.url = g_conf.url, .compress = true, .stats = &stats};
+  byte_buf_t* res = byte_buf_new();
+  TEST_ASSERT(http_client_get(&http_conf, res) == 0);
+  TEST_ASSERT_EQUAL_UINT64(sizeof(g_gz_body), stats.wire_bytes);
+  TEST_ASSERT_EQUAL_UINT64(GZ_BODY_PLAIN_LEN, stats.body_bytes);
+  TEST_ASSERT_EQUAL_UINT32(GZ_BODY_PLAIN_LEN, res->len);
+  res->len = 0;
+  http_conf.compress = false;
+  TEST_ASSERT(http_client_get(&http_conf, res) == 0);
+  TEST_ASSERT_EQUAL_UINT64(strlen(g_body), stats.wire_bytes);
+  TEST_ASSERT_EQUAL_UINT64(strlen(g_body), stats.body_bytes);
+  // the steps of a request follow each other
+  TEST_ASSERT(stats.lookup_us <= stats.connect_us);
+  TEST_ASSERT(stats.connect_us <= stats.tls_us);
+  TEST_ASSERT(stats.tls_us <= stats.first_byte_us);
+  TEST_ASSERT(stats.first_byte_us <= stats.total_us);
+  TEST_ASSERT(stats.total_us > 0);
+  byte_buf_free(res);
+
+  // the same on a loop
+  stats = (http_req_stats_t){};
+  http_conf.compress = true;
+  http_loop_t* loop = http_loop_new();
+  TEST_ASSERT_NOT_NULL(http_loop_get(loop, &http_conf, NULL, NULL));
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 30000));
+  TEST_ASSERT_EQUAL_UINT64(sizeof(g_gz_body), stats.wire_bytes);
+  TEST_ASSERT_EQUAL_UINT64(GZ_BODY_PLAIN_LEN, stats.body_bytes);
+  TEST_ASSERT(stats.first_byte_us <= stats.total_us);
+  http_loop_free(loop);
+
+  // blocking and async requests are all recorded under the endpoint
+  client_endpoint_stats_t endpoint;
+  TEST_ASSERT(client_stats_get(g_conf.url, &endpoint) == 0);
+  TEST_ASSERT(endpoint.requests >= 4);
+  TEST_ASSERT(endpoint.connections >= 1);
+  TEST_ASSERT(endpoint.errors < endpoint.requests);
+  TEST_ASSERT(endpoint.received_bytes > 0);
+  TEST_ASSERT_EQUAL_UINT64(endpoint.requests, endpoint.phases[CLIENT_PHASE_TOTAL].count);
+  TEST_ASSERT_EQUAL_UINT64(0, endpoint.phases[CLIENT_PHASE_TLS].count);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  http_client_init();
+  test_server_start(&g_server, server_fn, NULL, 0);
+  snprintf(g_conf.url, sizeof(g_conf.url), "%s", g_server.url);
+  RUN_TEST(test_async_builtin_loop);
+  RUN_TEST(test_async_external_loop);
+  RUN_TEST(test_async_streaming);
+  RUN_TEST(test_async_shared_connections);
+#ifndef HTTP_SOCKET_DEFAULT  // the socket transport doesn't offer compression
+  RUN_TEST(test_compressed_transfer);
+#endif
+  test_server_stop(&g_server);
+  http_client_clean();
+
+  return UNITY_END();
+}
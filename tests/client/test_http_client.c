@@ -1,4 +1,5 @@
 #include <curl/curl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -79,9 +80,62 @@ void test_http() {
   http_client_clean();
 }
 
+#define POOL_THREADS 8
+#define POOL_REQUESTS 4
+
+// requests to a closed local port fail fast, the handle goes back to the pool anyway.
+static void* pool_worker(void* arg) {
+  http_client_config_t conf = {0};
+  conf.url = "http://127.0.0.1:1/";
+  for (int i = 0; i < POOL_REQUESTS; i++) {
+    byte_buf_t* response = byte_buf_new();
+    http_client_get(&conf, response);
+    byte_buf_free(response);
+  }
+  return NULL;
+}
+
+void test_http_pool() {
+  http_pool_stats_t stats = {};
+  http_client_init();
+  TEST_ASSERT(http_client_pool_config(0, HTTP_POOL_DEFAULT_IDLE_MS) == -1);
+  TEST_ASSERT(http_client_pool_config(2, HTTP_POOL_DEFAULT_IDLE_MS) == 0);
+
+  // concurrent requests share at most 2 handles
+  pthread_t tid[POOL_THREADS];
+  for (int i = 0; i < POOL_THREADS; i++) {
+    pthread_create(&tid[i], NULL, pool_worker, NULL);
+  }
+  for (int i = 0; i < POOL_THREADS; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  http_client_pool_stats(&stats);
+  TEST_ASSERT_EQUAL_UINT32(0, stats.busy);
+  TEST_ASSERT(stats.created <= 2);
+  TEST_ASSERT_EQUAL_UINT32(stats.created, stats.idle);
+  TEST_ASSERT_EQUAL_UINT32(POOL_THREADS * POOL_REQUESTS, stats.created + stats.reused);
+
+  // shrinking closes idle handles
+  TEST_ASSERT(http_client_pool_config(1, HTTP_POOL_DEFAULT_IDLE_MS) == 0);
+  http_client_pool_stats(&stats);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.idle);
+
+  // expired handles are not reused
+  size_t created = stats.created;
+  TEST_ASSERT(http_client_pool_config(1, 0) == 0);
+  pool_worker(NULL);
+  http_client_pool_stats(&stats);
+  TEST_ASSERT_EQUAL_UINT32(1, stats.idle);
+  TEST_ASSERT_EQUAL_UINT32(created + POOL_REQUESTS, stats.created);
+
+  TEST_ASSERT(http_client_pool_config(HTTP_POOL_DEFAULT_SIZE, HTTP_POOL_DEFAULT_IDLE_MS) == 0);
+  http_client_clean();
+}
+
 int main(void) {
   UNITY_BEGIN();
 
+  RUN_TEST(test_http_pool);
   RUN_TEST(test_http);
 
   return UNITY_END();
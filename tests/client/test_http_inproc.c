@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "client/api/get_node_info.h"
+#include "client/api/get_unspent_outputs.h"
+#include "client/network/http.h"
+#include "client/network/http_async.h"
+#include "client/network/http_inproc.h"
+#include "unity/unity.h"
+
+static char const* const g_info = "{\"version\":\"v0.3.0\",\"identityID\":\"KBTmE299rMU\",\"synced\":true}";
+// the output of an address, each request is answered with a new address
+static char const* const g_unspent =
+    "{\"unspent_outputs\":[{\"address\":\"%s\",\"output_ids\":[{\"id\":"
+    "\"ALC5JTNWc3dxeF4gwiCHnLEPTATbXt3pX2HxoGqV15WWkT84CuiFty3cCRq5QaF3mYK5b87jpXyPLKbpsAdMPvaS\",\"balances\":[{"
+    "\"value\":1337,\"color\":\"IOTA\"}],\"inclusion_state\":{\"confirmed\":true,\"liked\":true,\"finalized\":true}}]"
+    "}]}";
+
+// the requests seen by the handler
+typedef struct {
+  size_t requests;
+  size_t unspent_requests;
+  char method[8];
+  char path[64];
+  char body[128];
+} node_t;
+
+static int node_handler(void* ctx, char const* method, char const* path, byte_t const body[], size_t len,
+                        byte_buf_t* response) {
+  node_t* node = (node_t*)ctx;
+  node->requests++;
+  snprintf(node->method, sizeof(node->method), "%s", method);
+  snprintf(node->path, sizeof(node->path), "%s", path);
+  snprintf(node->body, sizeof(node->body), "%.*s", (int)len, body ? (char const*)body : "");
+  char res[512];
+  if (strcmp(path, "/info") == 0) {
+    snprintf(res, sizeof(res), "%s", g_info);
+  } else if (strcmp(path, "/value/unspentOutputs") == 0) {
+    byte_t addr[TANGLE_ADDRESS_BYTES];
+    char addr_str[TANGLE_ADDRESS_BASE58_BUF];
+    byte_t seed[TANGLE_SEED_BYTES] = {};
+    address_get(seed, node->unspent_requests++, ADDRESS_VER_ED25519, addr);
+    address_2_base58(addr, addr_str);
+    snprintf(res, sizeof(res), g_unspent, addr_str);
+  } else {
+    return -1;
+  }
+  byte_buf_append(response, (byte_t const*)res, strlen(res));
+  return 0;
+}
+
+void test_inproc_requests() {
+  node_t node = {};
+  TEST_ASSERT_NULL(http_inproc_new(NULL, NULL));
+  http_transport_t* t = http_inproc_new(node_handler, &node);
+  TEST_ASSERT_NOT_NULL(t);
+  TEST_ASSERT_EQUAL_STRING("inproc", t->name);
+  TEST_ASSERT(http_default_transport() != t);
+
+  http_req_stats_t stats = {};
+  http_client_config_t conf = {.url = "http://node.inproc/info", .stats = &stats, .transport = t};
+  byte_buf_t* response = byte_buf_new();
+  TEST_ASSERT(http_client_get(&conf, response) == 0);
+  TEST_ASSERT_EQUAL_STRING("GET", node.method);
+  TEST_ASSERT_EQUAL_STRING("/info", node.path);
+  TEST_ASSERT_EQUAL_MEMORY(g_info, response->data, strlen(g_info));
+  TEST_ASSERT_EQUAL_UINT64(strlen(g_info), stats.wire_bytes);
+  TEST_ASSERT_EQUAL_UINT64(strlen(g_info), stats.body_bytes);
+
+  // the null terminator of a request is not part of the body
+  byte_buf_t* request = byte_buf_new_with_data((byte_t*)"{\"a\":1}", strlen("{\"a\":1}") + 1);
+  byte_buf_t* echo = byte_buf_new();
+  conf.url = "http://node.inproc/value/unspentOutputs";
+  TEST_ASSERT(http_client_post(&conf, request, echo) == 0);
+  TEST_ASSERT_EQUAL_STRING("POST", node.method);
+  TEST_ASSERT_EQUAL_STRING("{\"a\":1}", node.body);
+  conf.url = "http://node.inproc/missing";
+  TEST_ASSERT(http_client_post(&conf, request, echo) == -1);
+  TEST_ASSERT_EQUAL_UINT32(3, node.requests);
+
+  byte_buf_free(request);
+  byte_buf_free(echo);
+  byte_buf_free(response);
+  http_inproc_free(t);
+}
+
+static void info_cb(int ret, res_node_info_t* res, void* ctx) {
+  if (ret == 0 && res->is_synced) {
+    (*(int*)ctx)++;
+  }
+}
+
+void test_inproc_client_apis() {
+  node_t node = {};
+  http_transport_t* t = http_inproc_new(node_handler, &node);
+  tangle_client_conf_t conf = {.url = "http://node.inproc/", .port = 0, .transport = t};
+
+  res_node_info_t info = {};
+  TEST_ASSERT(get_node_info(&conf, &info) == 0);
+  TEST_ASSERT_EQUAL_STRING("v0.3.0", info.version);
+  TEST_ASSERT_TRUE(info.is_synced);
+
+  // requests of the loop are performed by the transport
+  http_loop_t* loop = http_loop_new();
+  int synced = 0;
+  for (int i = 0; i < 4; i++) {
+    TEST_ASSERT(get_node_info_async(loop, &conf, info_cb, &synced) == 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, http_loop_pending(loop));
+  TEST_ASSERT_EQUAL_INT32(0, http_loop_timeout(loop));
+  TEST_ASSERT_EQUAL_INT(0, http_loop_run(loop, 1000));
+  TEST_ASSERT_EQUAL_INT(4, synced);
+
+  // cancelled before they're performed
+  TEST_ASSERT(get_node_info_async(loop, &conf, info_cb, &synced) == 0);
+  http_loop_free(loop);
+  TEST_ASSERT_EQUAL_INT(4, synced);
+  TEST_ASSERT_EQUAL_UINT32(5, node.requests);
+
+  // every shard is answered by the handler
+  node.unspent_requests = 0;
+  addr_list_t* addrs = addr_list_new();
+  address_t addr = {};
+  for (int i = 0; i < 5; i++) {
+    addr_list_push(addrs, &addr);
+  }
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  TEST_ASSERT(get_unspent_outputs_sharded(&conf, addrs, 2, 2, &unspent) == 0);
+  TEST_ASSERT_EQUAL_UINT32(5 + 3, node.requests);
+  TEST_ASSERT_EQUAL_STRING("/value/unspentOutputs", node.path);
+  TEST_ASSERT_EQUAL_UINT64(3 * 1337, unspent_outputs_balance(&unspent));
+  unspent_outputs_free(&unspent);
+  addr_list_free(addrs);
+
+  http_inproc_free(t);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  http_client_init();
+  RUN_TEST(test_inproc_requests);
+  RUN_TEST(test_inproc_client_apis);
+  http_client_clean();
+
+  return UNITY_END();
+}
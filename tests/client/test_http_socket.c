@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "client/api/get_node_info.h"
+#include "client/client_stats.h"
+#include "client/network/http_socket.h"
+#include "test_server.h"
+#include "unity/unity.h"
+
+#define BIG_BODY_LEN 200000
+// the TLS hook of the tests scrambles bytes instead of encrypting them
+#define TLS_MASK 0x5a
+
+static char const* const g_info = "{\"version\":\"v0.3.0\",\"identityID\":\"KBTmE299rMU\",\"synced\":true}";
+
+// answers a request by its path, returns false if the connection is closed afterwards
+static bool srv_respond(test_server_t* s, int fd, test_request_t const* req) {
+  char const* path = req->path;
+  if (strcmp(path, "/length") == 0) {
+    test_server_reply(s, fd, "200 OK", req->len ? req->body : "hello", false);
+  } else if (strcmp(path, "/info") == 0) {
+    // chunks arrive in separate reads, with an extension and a trailer
+    size_t info_len = strlen(g_info);
+    char part[128];
+    int n = snprintf(part, sizeof(part), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n%zx;ext=1\r\n%.10s\r\n",
+                     (size_t)10, g_info);
+    test_server_send(s, fd, part, n);
+    usleep(2000);
+    n = snprintf(part, sizeof(part), "%zX\r\n%s\r\n", info_len - 10, g_info + 10);
+    test_server_send(s, fd, part, n - 5);
+    usleep(2000);
+    test_server_send(s, fd, part + n - 5, 5);
+    test_server_send(s, fd, "0\r\nX-Trailer: 1\r\n\r\n", 19);
+  } else if (strcmp(path, "/close") == 0) {
+    test_server_reply(s, fd, "200 OK", "closed", true);
+    return false;
+  } else if (strcmp(path, "/eof") == 0) {
+    test_server_send(s, fd, "HTTP/1.0 200 OK\r\n\r\nuntil the end", 32);
+    return false;
+  } else if (strcmp(path, "/drop") == 0) {
+    // keep-alive is announced but the connection is closed
+    test_server_reply(s, fd, "200 OK", "dropped", false);
+    return false;
+  } else if (strcmp(path, "/big") == 0) {
+    char* big = malloc(BIG_BODY_LEN + 64);
+    int n = sprintf(big, "HTTP/1.1 200 OK\r\nContent-Length: %d\r\n\r\n", BIG_BODY_LEN);
+    for (int i = 0; i < BIG_BODY_LEN; i++) {
+      big[n + i] = (char)(i % 251);
+    }
+    test_server_send(s, fd, big, n + BIG_BODY_LEN);
+    free(big);
+  } else if (strcmp(path, "/continue") == 0) {
+    test_server_send(s, fd, "HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", 65);
+  } else if (strcmp(path, "/short") == 0) {
+    test_server_send(s, fd, "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort", 44);
+    return false;
+  } else if (strcmp(path, "/badlength") == 0) {
+    test_server_send(s, fd, "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\nbad", 42);
+    return false;
+  } else if (strcmp(path, "/hugelength") == 0) {
+    test_server_send(s, fd, "HTTP/1.1 200 OK\r\nContent-Length: 18446744073709551616\r\n\r\nbad", 60);
+    return false;
+  } else if (strcmp(path, "/badchunk") == 0) {
+    // the size line is empty, the size must not be taken from the next line
+    test_server_send(s, fd, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n\r\n3\r\nbad\r\n0\r\n\r\n", 62);
+    return false;
+  } else if (strcmp(path, "/badstatus") == 0) {
+    test_server_send(s, fd, "HTTP/1.1  200 OK\r\nContent-Length: 3\r\n\r\nbad", 42);
+    return false;
+  } else if (strcmp(path, "/hang") == 0) {
+    char c;
+    while (recv(fd, &c, 1, 0) > 0) {
+    }
+    return false;
+  } else {
+    test_server_reply(s, fd, "404 Not Found", "{\"error\":\"not found\"}", false);
+  }
+  return true;
+}
+
+static int get(http_transport_t const* t, test_server_t* s, char const* path, byte_buf_t* response) {
+  char url[128];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u%s", s->port, path);
+  http_client_config_t conf = {.url = url, .transport = t};
+  response->len = 0;
+  return http_client_get(&conf, response);
+}
+
+static void assert_body(char const* expected, byte_buf_t* response) {
+  TEST_ASSERT_EQUAL_UINT32(strlen(expected), response->len);
+  TEST_ASSERT_EQUAL_MEMORY(expected, response->data, response->len);
+}
+
+void test_socket_requests() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, 0);
+  http_transport_t* t = http_socket_new(NULL);
+  TEST_ASSERT_NOT_NULL(t);
+  TEST_ASSERT_EQUAL_STRING("socket", t->name);
+
+  byte_buf_t* response = byte_buf_new();
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  assert_body("hello", response);
+  char host[64];
+  snprintf(host, sizeof(host), "GET /length HTTP/1.1\r\nHost: 127.0.0.1:%u\r\n", s.port);
+  TEST_ASSERT_EQUAL_MEMORY(host, s.head, strlen(host));
+
+  // the null terminator of a request is not sent
+  char url[128];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u/length?a=1#fragment", s.port);
+  http_req_stats_t stats = {};
+  http_client_config_t conf = {.url = url, .transport = t, .stats = &stats};
+  byte_buf_t* request = byte_buf_new_with_data((byte_t*)"{\"a\":1}", strlen("{\"a\":1}") + 1);
+  response->len = 0;
+  TEST_ASSERT(http_client_post(&conf, request, response) == 0);
+  assert_body("{\"a\":1}", response);
+  TEST_ASSERT_EQUAL_UINT64(7, stats.wire_bytes);
+  TEST_ASSERT_EQUAL_UINT64(7, stats.body_bytes);
+  TEST_ASSERT_EQUAL_UINT64(7, stats.sent_bytes);
+  TEST_ASSERT(stats.reused);
+  TEST_ASSERT(stats.first_byte_us <= stats.total_us);
+  TEST_ASSERT(strncmp(s.head, "POST /length?a=1 HTTP/1.1\r\n", 27) == 0);
+  TEST_ASSERT_NOT_NULL(strstr(s.head, "Content-Length: 7\r\n"));
+
+  // error responses are handed over like others
+  TEST_ASSERT(get(t, &s, "/missing", response) == 0);
+  assert_body("{\"error\":\"not found\"}", response);
+
+  // all requests share a connection
+  http_pool_stats_t pool = {};
+  http_socket_stats(t, &pool);
+  TEST_ASSERT_EQUAL_UINT32(1, pool.created);
+  TEST_ASSERT_EQUAL_UINT32(2, pool.reused);
+  TEST_ASSERT_EQUAL_UINT32(1, pool.idle);
+  TEST_ASSERT_EQUAL_UINT32(0, pool.busy);
+  TEST_ASSERT_EQUAL_INT(1, test_server_accepted(&s));
+
+  byte_buf_free(request);
+  byte_buf_free(response);
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+void test_socket_framing() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, 0);
+  http_transport_t* t = http_socket_new(NULL);
+  byte_buf_t* response = byte_buf_new();
+
+  // chunked responses through a client API
+  tangle_client_conf_t node = {.transport = t};
+  snprintf(node.url, sizeof(node.url), "http://127.0.0.1:%u/", s.port);
+  res_node_info_t info = {};
+  TEST_ASSERT(get_node_info(&node, &info) == 0);
+  TEST_ASSERT_EQUAL_STRING("v0.3.0", info.version);
+  TEST_ASSERT_TRUE(info.is_synced);
+  TEST_ASSERT(get(t, &s, "/continue", response) == 0);
+  assert_body("ok", response);
+  TEST_ASSERT_EQUAL_INT(1, test_server_accepted(&s));
+
+  // bodies delimited by the end of the connection, connections closed by the server
+  TEST_ASSERT(get(t, &s, "/eof", response) == 0);
+  assert_body("until the end", response);
+  TEST_ASSERT(get(t, &s, "/close", response) == 0);
+  assert_body("closed", response);
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  TEST_ASSERT_EQUAL_INT(3, test_server_accepted(&s));
+
+  // a truncated body fails
+  TEST_ASSERT(get(t, &s, "/short", response) == -1);
+
+  // invalid numbers in the framing fail the request
+  char const* invalid[] = {"/badlength", "/hugelength", "/badchunk", "/badstatus"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    TEST_ASSERT(get(t, &s, invalid[i], response) == -1);
+  }
+
+  byte_buf_free(response);
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+typedef struct {
+  size_t calls;
+  size_t max_part;
+  size_t len;
+  bool valid;
+  size_t abort_at;  // aborts once more bytes are received, 0 never aborts
+} big_t;
+
+static int big_write(byte_t const data[], size_t len, void* ctx) {
+  big_t* big = (big_t*)ctx;
+  for (size_t i = 0; i < len; i++) {
+    big->valid = big->valid && data[i] == (byte_t)((big->len + i) % 251);
+  }
+  big->calls++;
+  big->len += len;
+  big->max_part = len > big->max_part ? len : big->max_part;
+  return big->abort_at && big->len > big->abort_at ? -1 : 0;
+}
+
+void test_socket_stream() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, 0);
+  http_socket_conf_t sock_conf;
+  http_socket_conf_default(&sock_conf);
+  sock_conf.buf_size = HTTP_SOCKET_MIN_BUF_SIZE - 1;
+  TEST_ASSERT_NULL(http_socket_new(&sock_conf));
+  sock_conf.buf_size = HTTP_SOCKET_MIN_BUF_SIZE;
+  http_transport_t* t = http_socket_new(&sock_conf);
+
+  // the body is handed over in parts of the connection buffer
+  char url[128];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u/big", s.port);
+  http_client_config_t conf = {.url = url, .transport = t};
+  big_t big = {.valid = true};
+  TEST_ASSERT(http_client_post_stream(&conf, NULL, big_write, &big) == 0);
+  TEST_ASSERT_EQUAL_UINT32(BIG_BODY_LEN, big.len);
+  TEST_ASSERT_TRUE(big.valid);
+  TEST_ASSERT(big.max_part <= HTTP_SOCKET_MIN_BUF_SIZE);
+  TEST_ASSERT(big.calls >= BIG_BODY_LEN / HTTP_SOCKET_MIN_BUF_SIZE);
+
+  // an aborted transfer drops the connection
+  big = (big_t){.valid = true, .abort_at = 1000};
+  TEST_ASSERT(http_client_post_stream(&conf, NULL, big_write, &big) == -1);
+  http_pool_stats_t pool = {};
+  http_socket_stats(t, &pool);
+  TEST_ASSERT_EQUAL_UINT32(0, pool.idle);
+  TEST_ASSERT_EQUAL_UINT32(1, pool.reused);
+
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+void test_socket_reconnect() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, 0);
+  http_transport_t* t = http_socket_new(NULL);
+  byte_buf_t* response = byte_buf_new();
+
+  // the pooled connection was closed by the server, the request goes out again on a new one
+  TEST_ASSERT(get(t, &s, "/drop", response) == 0);
+  assert_body("dropped", response);
+  usleep(10000);
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  assert_body("hello", response);
+  http_pool_stats_t pool = {};
+  http_socket_stats(t, &pool);
+  TEST_ASSERT_EQUAL_UINT32(2, pool.created);
+  TEST_ASSERT_EQUAL_UINT32(1, pool.reused);
+
+  // expired connections are closed, a pool of 0 keeps none
+  http_socket_conf_t sock_conf;
+  http_socket_conf_default(&sock_conf);
+  sock_conf.idle_ms = 0;
+  TEST_ASSERT(http_socket_set_conf(NULL, &sock_conf) == -1);
+  TEST_ASSERT(http_socket_set_conf(t, &sock_conf) == 0);
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  sock_conf.pool_size = 0;
+  TEST_ASSERT(http_socket_set_conf(t, &sock_conf) == 0);
+  http_socket_stats(t, &pool);
+  TEST_ASSERT_EQUAL_UINT32(0, pool.idle);
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  http_socket_stats(t, &pool);
+  TEST_ASSERT_EQUAL_UINT32(4, pool.created);
+  TEST_ASSERT_EQUAL_UINT32(0, pool.idle);
+
+  byte_buf_free(response);
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+void test_socket_failures() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, 0);
+  http_socket_conf_t sock_conf;
+  http_socket_conf_default(&sock_conf);
+  sock_conf.timeout_ms = 100;
+  http_transport_t* t = http_socket_new(&sock_conf);
+  byte_buf_t* response = byte_buf_new();
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  TEST_ASSERT(get(t, &s, "/hang", response) == -1);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  TEST_ASSERT(end.tv_sec - start.tv_sec < 2);
+
+  // the request may have been processed, a timeout on a pooled connection doesn't send it again
+  TEST_ASSERT(get(t, &s, "/length", response) == 0);
+  int accepted = test_server_accepted(&s);
+  TEST_ASSERT(get(t, &s, "/hang", response) == -1);
+  TEST_ASSERT_EQUAL_INT(accepted, test_server_accepted(&s));
+
+  http_client_config_t conf = {.transport = t};
+  char const* urls[] = {"http://127.0.0.1:1/", "https://127.0.0.1:1/", "ftp://127.0.0.1/", "http://[::1/", "http://"};
+  for (size_t i = 0; i < sizeof(urls) / sizeof(urls[0]); i++) {
+    conf.url = (char*)urls[i];
+    TEST_ASSERT(http_client_get(&conf, response) == -1);
+  }
+
+  byte_buf_free(response);
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+// a TLS session of the test hook
+typedef struct {
+  int fd;
+} tls_session_t;
+
+typedef struct {
+  int connects;
+  char host[64];
+  char const* cert_pem;
+} tls_hook_t;
+
+static void mask(byte_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    data[i] ^= TLS_MASK;
+  }
+}
+
+static void* tls_connect(void* ctx, int fd, char const* host, char const* cert_pem) {
+  tls_hook_t* hook = (tls_hook_t*)ctx;
+  hook->connects++;
+  snprintf(hook->host, sizeof(hook->host), "%s", host);
+  hook->cert_pem = cert_pem;
+  tls_session_t* session = malloc(sizeof(tls_session_t));
+  session->fd = fd;
+  return session;
+}
+
+static ssize_t tls_read(void* session, byte_t buf[], size_t len) {
+  ssize_t n = recv(((tls_session_t*)session)->fd, buf, len, 0);
+  if (n > 0) {
+    mask(buf, n);
+  }
+  return n;
+}
+
+static ssize_t tls_write(void* session, byte_t const buf[], size_t len) {
+  byte_t* out = malloc(len);
+  memcpy(out, buf, len);
+  mask(out, len);
+  ssize_t n = send(((tls_session_t*)session)->fd, out, len, MSG_NOSIGNAL);
+  free(out);
+  return n;
+}
+
+static void tls_close(void* session) { free(session); }
+
+void test_socket_tls() {
+  test_server_t s;
+  test_server_start(&s, srv_respond, NULL, TLS_MASK);
+  tls_hook_t hook = {};
+  http_tls_t const tls = {
+      .connect = tls_connect, .read = tls_read, .write = tls_write, .close = tls_close, .ctx = &hook};
+  http_socket_conf_t sock_conf;
+  http_socket_conf_default(&sock_conf);
+  sock_conf.tls = &tls;
+  http_transport_t* t = http_socket_new(&sock_conf);
+
+  char url[128];
+  snprintf(url, sizeof(url), "https://127.0.0.1:%u/length", s.port);
+  http_req_stats_t stats = {};
+  http_client_config_t conf = {.url = url, .transport = t, .cert_pem = "PEM", .stats = &stats};
+  byte_buf_t* response = byte_buf_new();
+  for (int i = 0; i < 3; i++) {
+    response->len = 0;
+    TEST_ASSERT(http_client_get(&conf, response) == 0);
+    assert_body("hello", response);
+    // the steps of a request follow each other, only the first one connects
+    TEST_ASSERT(stats.reused == (i > 0));
+    if (i == 0) {
+      TEST_ASSERT(stats.lookup_us <= stats.connect_us);
+      TEST_ASSERT(stats.connect_us <= stats.tls_us);
+    }
+    TEST_ASSERT(stats.tls_us <= stats.first_byte_us);
+    TEST_ASSERT(stats.first_byte_us <= stats.total_us);
+  }
+  TEST_ASSERT_EQUAL_INT(1, hook.connects);
+
+  // the requests are recorded under the endpoint with a TLS handshake
+  client_endpoint_stats_t endpoint;
+  TEST_ASSERT(client_stats_get(url, &endpoint) == 0);
+  TEST_ASSERT_EQUAL_UINT64(3, endpoint.requests);
+  TEST_ASSERT_EQUAL_UINT64(1, endpoint.connections);
+  TEST_ASSERT_EQUAL_UINT64(1, endpoint.phases[CLIENT_PHASE_TLS].count);
+  TEST_ASSERT_EQUAL_UINT64(3, endpoint.phases[CLIENT_PHASE_SERVER].count);
+  TEST_ASSERT_EQUAL_STRING("127.0.0.1", hook.host);
+  TEST_ASSERT_EQUAL_STRING("PEM", hook.cert_pem);
+
+  byte_buf_free(response);
+  http_socket_free(t);
+  test_server_stop(&s);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_socket_requests);
+  RUN_TEST(test_socket_framing);
+  RUN_TEST(test_socket_stream);
+  RUN_TEST(test_socket_reconnect);
+  RUN_TEST(test_socket_failures);
+  RUN_TEST(test_socket_tls);
+
+  return UNITY_END();
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "client/api/json_stream.h"
+#include "unity/unity.h"
+
+// records events as a compact text
+typedef struct {
+  char out[1024];
+  size_t len;
+  int abort_at;  // aborts on the nth event, 0 for never
+  int events;
+} recorder_t;
+
+static int record(recorder_t* r, char const* fmt, char const* str, size_t len) {
+  r->len += snprintf(r->out + r->len, sizeof(r->out) - r->len, fmt, (int)len, str);
+  return ++r->events == r->abort_at ? -1 : 0;
+}
+
+static int on_begin(void* ctx, bool is_array) { return record(ctx, "%.*s", is_array ? "[" : "{", 1); }
+static int on_end(void* ctx, bool is_array) { return record(ctx, "%.*s", is_array ? "]" : "}", 1); }
+static int on_key(void* ctx, char const key[], size_t len) { return record(ctx, "k(%.*s)", key, len); }
+static int on_value(void* ctx, json_stream_value_t kind, char const str[], size_t len) {
+  if (str == NULL) {
+    // a skipped value, only its length is known
+    char n[24];
+    snprintf(n, sizeof(n), "%zu", len);
+    return record(ctx, kind == JSON_STREAM_STRING ? "S(%.*s)" : "N(%.*s)", n, strlen(n));
+  }
+  char const* fmt[] = {"s(%.*s)", "n(%.*s)", "t%.*s", "f%.*s", "z%.*s"};
+  return record(ctx, fmt[kind], str, kind > JSON_STREAM_NUMBER ? 0 : len);
+}
+
+static json_stream_cb_t const g_cb = {on_begin, on_end, on_key, on_value};
+
+// parses a document in chunks of the given size
+static int parse(char const* doc, size_t chunk, recorder_t* r) {
+  json_stream_t s;
+  json_stream_init(&s, &g_cb, r);
+  size_t len = strlen(doc);
+  for (size_t i = 0; i < len; i += chunk) {
+    if (json_stream_feed(&s, (byte_t const*)doc + i, len - i < chunk ? len - i : chunk) != 0) {
+      return -1;
+    }
+  }
+  return json_stream_end(&s);
+}
+
+void test_json_stream_events() {
+  char const* doc =
+      " {\"a\":[1,-2.5e3,true,false,null],\"b\":{},\"c\":[],\"d\":\"x\\\"\\n\\u00e9\\u4e2d\",\"e\":{\"f\":[[]]}} ";
+  char const* expect = "{k(a)[n(1)n(-2.5e3)tfz]k(b){}k(c)[]k(d)s(x\"\n\xc3\xa9\xe4\xb8\xad)k(e){k(f)[[]]}}";
+
+  // events don't depend on how the data is split
+  for (size_t chunk = 1; chunk <= strlen(doc); chunk++) {
+    recorder_t r = {};
+    TEST_ASSERT_EQUAL_INT(0, parse(doc, chunk, &r));
+    TEST_ASSERT_EQUAL_STRING(expect, r.out);
+  }
+
+  // top level scalars
+  recorder_t r = {};
+  TEST_ASSERT_EQUAL_INT(0, parse("42", 1, &r));
+  TEST_ASSERT_EQUAL_STRING("n(42)", r.out);
+  r = (recorder_t){};
+  TEST_ASSERT_EQUAL_INT(0, parse("\"str\"", 2, &r));
+  TEST_ASSERT_EQUAL_STRING("s(str)", r.out);
+}
+
+void test_json_stream_invalid() {
+  char const* invalid[] = {"",      "{",   "[1,]", "{\"a\"}",    "{\"a\":1,}",     "[1}",    "[1] [2]", "[tru]",
+                           "{1:2}", "[1 2]", "]",  "[\"\\x\"]", "[\"\\u12G4\"]", "[\"a\nb\"]", "{\"a\":1]"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    recorder_t r = {};
+    TEST_ASSERT_EQUAL_INT(-1, parse(invalid[i], 1, &r));
+  }
+
+  // nesting limit
+  char deep[JSON_STREAM_MAX_DEPTH * 2 + 3] = {};
+  for (int i = 0; i < JSON_STREAM_MAX_DEPTH; i++) {
+    deep[i] = '[';
+    deep[JSON_STREAM_MAX_DEPTH + i] = ']';
+  }
+  recorder_t r = {};
+  TEST_ASSERT_EQUAL_INT(0, parse(deep, 7, &r));
+  memmove(deep + 1, deep, JSON_STREAM_MAX_DEPTH * 2);
+  deep[0] = '[';
+  deep[JSON_STREAM_MAX_DEPTH * 2 + 1] = ']';
+  r = (recorder_t){};
+  TEST_ASSERT_EQUAL_INT(-1, parse(deep, 7, &r));
+
+  // longer keys and literals are invalid
+  char long_doc[JSON_STREAM_MAX_TOKEN + 16] = {};
+  snprintf(long_doc, sizeof(long_doc), "{\"%0*d\":1}", JSON_STREAM_MAX_TOKEN, 0);
+  r = (recorder_t){};
+  TEST_ASSERT_EQUAL_INT(0, parse(long_doc, 16, &r));
+  snprintf(long_doc, sizeof(long_doc), "{\"%0*d\":1}", JSON_STREAM_MAX_TOKEN + 1, 0);
+  r = (recorder_t){};
+  TEST_ASSERT_EQUAL_INT(-1, parse(long_doc, 16, &r));
+  memset(long_doc, 't', JSON_STREAM_MAX_TOKEN + 1);
+  long_doc[JSON_STREAM_MAX_TOKEN + 1] = '\0';
+  r = (recorder_t){};
+  TEST_ASSERT_EQUAL_INT(-1, parse(long_doc, 16, &r));
+}
+
+void test_json_stream_long_values() {
+  // strings and numbers up to the token limit are handed over
+  size_t const long_len = JSON_STREAM_MAX_TOKEN * 4;
+  char* doc = malloc(long_len * 2 + 64);
+  TEST_ASSERT_NOT_NULL(doc);
+  int n = sprintf(doc, "{\"a\":\"");
+  memset(doc + n, 'x', JSON_STREAM_MAX_TOKEN);
+  sprintf(doc + n + JSON_STREAM_MAX_TOKEN, "\"}");
+  recorder_t r = {};
+  TEST_ASSERT_EQUAL_INT(0, parse(doc, 16, &r));
+  // {k(a)s(...)}
+  TEST_ASSERT_EQUAL_UINT32(JSON_STREAM_MAX_TOKEN + 9, r.len);
+  TEST_ASSERT_EQUAL_MEMORY("{k(a)s(x", r.out, 8);
+
+  // longer ones are skipped with their length, escapes count as decoded
+  n = sprintf(doc, "{\"a\":\"\\u00e9");
+  memset(doc + n, 'x', long_len);
+  n += long_len;
+  n += sprintf(doc + n, "\",\"b\":[-");
+  memset(doc + n, '1', long_len);
+  n += long_len;
+  sprintf(doc + n, "],\"c\":\"y\"}");
+  char expect[128];
+  snprintf(expect, sizeof(expect), "{k(a)S(%zu)k(b)[N(%zu)]k(c)s(y)}", long_len + 2, long_len + 1);
+  for (size_t chunk = 1; chunk <= 64; chunk *= 4) {
+    r = (recorder_t){};
+    TEST_ASSERT_EQUAL_INT(0, parse(doc, chunk, &r));
+    TEST_ASSERT_EQUAL_STRING(expect, r.out);
+  }
+  free(doc);
+}
+
+void test_json_stream_abort() {
+  recorder_t r = {.abort_at = 3};
+  TEST_ASSERT_EQUAL_INT(-1, parse("{\"a\":1,\"b\":2}", 1, &r));
+  TEST_ASSERT_EQUAL_STRING("{k(a)n(1)", r.out);
+  TEST_ASSERT_EQUAL_INT(3, r.events);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_json_stream_events);
+  RUN_TEST(test_json_stream_invalid);
+  RUN_TEST(test_json_stream_long_values);
+  RUN_TEST(test_json_stream_abort);
+
+  return UNITY_END();
+}
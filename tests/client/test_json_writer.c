@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cJSON.h"
+#include "client/api/json_writer.h"
+#include "core/address.h"
+#include "unity/unity.h"
+
+#define MANY_ADDRESSES 10000
+
+void test_json_writer_document() {
+  byte_buf_t* buf = byte_buf_new();
+  json_writer_t w;
+  TEST_ASSERT(json_writer_init(&w, buf, 0) == 0);
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "a");
+  json_writer_array_begin(&w);
+  json_writer_uint64(&w, 0);
+  json_writer_uint64(&w, UINT64_MAX);
+  json_writer_bool(&w, true);
+  json_writer_bool(&w, false);
+  json_writer_object_begin(&w);
+  json_writer_object_end(&w);
+  json_writer_array_begin(&w);
+  json_writer_array_end(&w);
+  json_writer_array_end(&w);
+  json_writer_key(&w, "b");
+  json_writer_string(&w, "q\"b\\n\n\x01");
+  json_writer_key(&w, "c");
+  json_writer_string(&w, "q\"b\\n\n\t");
+  json_writer_object_end(&w);
+  TEST_ASSERT(json_writer_end(&w) == 0);
+  TEST_ASSERT_EQUAL_STRING(
+      "{\"a\":[0,18446744073709551615,true,false,{},[]],\"b\":\"q\\\"b\\\\n\\n\\u0001\",\"c\":\"q\\\"b\\\\n\\n\\t\"}",
+      (char*)buf->data);
+  TEST_ASSERT_EQUAL_UINT32(strlen((char*)buf->data) + 1, buf->len);
+
+  // escaped strings read back unchanged
+  cJSON* json = cJSON_Parse((char*)buf->data);
+  TEST_ASSERT_NOT_NULL(json);
+  TEST_ASSERT_EQUAL_STRING("q\"b\\n\n\t", cJSON_GetObjectItem(json, "c")->valuestring);
+  cJSON_Delete(json);
+  byte_buf_free(buf);
+}
+
+void test_json_writer_addresses() {
+  byte_t seed[TANGLE_SEED_BYTES] = {};
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  char addr_str[TANGLE_ADDRESS_BASE58_BUF];
+  char expect[128];
+
+  byte_buf_t* buf = byte_buf_new();
+  json_writer_t w;
+  json_writer_init(&w, buf, 16 + MANY_ADDRESSES * JSON_WRITER_ADDRESS_SIZE);
+  size_t cap = buf->cap;
+  json_writer_object_begin(&w);
+  json_writer_key(&w, "addresses");
+  json_writer_array_begin(&w);
+  for (uint64_t i = 0; i < MANY_ADDRESSES; i++) {
+    address_get(seed, i % 4, ADDRESS_VER_ED25519, addr);
+    json_writer_address(&w, addr);
+  }
+  json_writer_array_end(&w);
+  json_writer_object_end(&w);
+  TEST_ASSERT(json_writer_end(&w) == 0);
+  // written in the buffer allocated up front
+  TEST_ASSERT_EQUAL_UINT32(cap, buf->cap);
+
+  // matches the base58 encoding
+  address_get(seed, 0, ADDRESS_VER_ED25519, addr);
+  address_2_base58(addr, addr_str);
+  snprintf(expect, sizeof(expect), "{\"addresses\":[\"%s\",", addr_str);
+  TEST_ASSERT_EQUAL_INT(0, strncmp(expect, (char*)buf->data, strlen(expect)));
+
+  cJSON* json = cJSON_Parse((char*)buf->data);
+  TEST_ASSERT_NOT_NULL(json);
+  cJSON* addrs = cJSON_GetObjectItem(json, "addresses");
+  TEST_ASSERT_EQUAL_INT(MANY_ADDRESSES, cJSON_GetArraySize(addrs));
+  TEST_ASSERT_EQUAL_STRING(addr_str, cJSON_GetArrayItem(addrs, MANY_ADDRESSES - 4)->valuestring);
+  cJSON_Delete(json);
+  byte_buf_free(buf);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_json_writer_document);
+  RUN_TEST(test_json_writer_addresses);
+
+  return UNITY_END();
+}
@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client/api/get_funds.h"
+#include "client/api/get_node_info.h"
+#include "client/api/get_unspent_outputs.h"
+#include "client/api/send_transaction.h"
+#include "client/ledger_sim.h"
+#include "unity/unity.h"
+#include "utils/base64.h"
+#include "utils/metrics.h"
+#include "wallet/wallet.h"
+
+#define SIM_URL "http://ledger.sim/"
+
+static byte_t g_seed[TANGLE_SEED_BYTES];
+
+static void sim_conf(ledger_sim_t* sim, tangle_client_conf_t* conf) {
+  memset(conf, 0, sizeof(tangle_client_conf_t));
+  strcpy(conf->url, SIM_URL);
+  conf->transport = ledger_sim_transport(sim);
+}
+
+// the unspent outputs of one address
+static uint64_t unspent_balance(tangle_client_conf_t const* conf, byte_t const addr[], bool* confirmed) {
+  addr_list_t* addrs = addr_list_new();
+  address_t a = {};
+  memcpy(a.addr, addr, TANGLE_ADDRESS_BYTES);
+  addr_list_push(addrs, &a);
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  TEST_ASSERT(get_unspent_outputs(conf, addrs, &unspent) == 0);
+  uint64_t balance = unspent_outputs_balance(&unspent);
+  if (confirmed) {
+    unspent_outputs_t* elm = unspent_outputs_find(&unspent, addr);
+    *confirmed = elm && elm->ids && elm->ids->st.confirmed;
+  }
+  unspent_outputs_free(&unspent);
+  addr_list_free(addrs);
+  return balance;
+}
+
+void test_ledger_sim_apis() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  TEST_ASSERT_NOT_NULL(sim);
+  tangle_client_conf_t conf;
+  sim_conf(sim, &conf);
+
+  res_node_info_t info = {};
+  TEST_ASSERT(get_node_info(&conf, &info) == 0);
+  TEST_ASSERT_TRUE(info.is_synced);
+
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 0, ADDRESS_VER_ED25519, addr);
+  res_get_funds_t funds = {};
+  TEST_ASSERT(get_funds(&conf, addr, &funds) == 0);
+  TEST_ASSERT(strlen(funds.msg_id) > 0);
+  TEST_ASSERT(get_funds(&conf, addr, &funds) == 0);
+  bool confirmed = false;
+  TEST_ASSERT_EQUAL_UINT64(2 * LEDGER_SIM_FAUCET_AMOUNT, unspent_balance(&conf, addr, &confirmed));
+  TEST_ASSERT_TRUE(confirmed);
+  TEST_ASSERT_EQUAL_UINT64(2 * LEDGER_SIM_FAUCET_AMOUNT, ledger_sim_balance(sim, addr, NULL));
+
+  // invalid requests are answered with errors
+  res_send_tx_t res = {};
+  send_tx_bytes(&conf, (byte_t const*)"AAAA", &res);
+  TEST_ASSERT_EQUAL_STRING("", res.msg_id);
+  ledger_sim_stats_t stats = {};
+  ledger_sim_stats(sim, &stats);
+  TEST_ASSERT_EQUAL_UINT64(5, stats.requests);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.faucet);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.rejected);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.errors);
+  TEST_ASSERT_EQUAL_UINT64(2, stats.outputs);
+
+  ledger_sim_free(sim);
+}
+
+void test_ledger_sim_wallet() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  tangle_client_conf_t conf;
+  sim_conf(sim, &conf);
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 0, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT(ledger_sim_fund(sim, addr, 1000) == 0);
+
+  wallet_t* w = wallet_open(SIM_URL, 0, g_seed, 0, 0, 0);
+  TEST_ASSERT_NOT_NULL(w);
+  wallet_set_transport(w, ledger_sim_transport(sim));
+  TEST_ASSERT_TRUE(wallet_is_node_synced(w));
+  TEST_ASSERT_EQUAL_UINT64(1000, wallet_balance(w));
+
+  // the payment spends address 0, the remainder goes to a new address
+  byte_t receiver[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 100, ADDRESS_VER_ED25519, receiver);
+  send_funds_op_t op = {};
+  op.amount = 400;
+  memcpy(op.receiver, receiver, TANGLE_ADDRESS_BYTES);
+  metrics_reset();
+  TEST_ASSERT(wallet_send_funds(w, &op) == 0);
+  TEST_ASSERT_EQUAL_UINT64(0, ledger_sim_balance(sim, addr, NULL));
+  TEST_ASSERT_EQUAL_UINT64(400, ledger_sim_balance(sim, receiver, NULL));
+  TEST_ASSERT_EQUAL_UINT64(600, ledger_sim_balance(sim, op.remainder, NULL));
+  TEST_ASSERT_EQUAL_UINT64(600, wallet_balance(w));
+
+  ledger_sim_stats_t stats = {};
+  ledger_sim_stats(sim, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.accepted);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.rejected);
+
+  // the payment is recorded in the metrics registry
+  metric_values_t v;
+  metric_get(&g_metric_selection_inputs, NULL, &v);
+  TEST_ASSERT_EQUAL_UINT64(1, v.buckets[0]);
+  metric_get(&g_metric_signatures_created, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(1, v.value);
+  // the wallet checks the signature before submitting it, the node again
+  metric_get(&g_metric_signatures_verified, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(2, v.value);
+  metric_get(&g_metric_utxo_outputs, NULL, &v);
+  TEST_ASSERT(v.value > 0);
+  metric_get(&g_metric_refresh_duration, NULL, &v);
+  TEST_ASSERT(v.sum > 0);
+  TEST_ASSERT(metric_get(&g_metric_http_duration, "http://ledger.sim", &v) == 0);
+  TEST_ASSERT(metric_get(&g_metric_http_errors, "http://ledger.sim", &v) == -1);
+
+  wallet_free(w);
+  ledger_sim_free(sim);
+}
+
+// re-encodes a signed transaction with a flipped byte
+static byte_buf_t* tamper(byte_buf_t const* tx_b64, size_t offset_from_end) {
+  size_t b64_len = strlen((char const*)tx_b64->data);
+  size_t len = 0;
+  byte_t* raw = malloc(b64_len);
+  base64_decode(raw, b64_len, &len, tx_b64->data, b64_len);
+  raw[len - offset_from_end] ^= 0x1;
+  byte_buf_t* out = byte_buf_new();
+  byte_buf_reserve(out, b64_len + 4);
+  size_t out_len = 0;
+  base64_encode(out->data, out->cap, &out_len, raw, len);
+  out->data[out_len] = '\0';
+  out->len = out_len + 1;
+  free(raw);
+  return out;
+}
+
+void test_ledger_sim_rejects() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 0, ADDRESS_VER_ED25519, addr);
+  ledger_sim_fund(sim, addr, 1000);
+
+  wallet_t* w = wallet_open(SIM_URL, 0, g_seed, 0, 0, 0);
+  wallet_set_transport(w, ledger_sim_transport(sim));
+  wallet_payment_t payment = {.amount = 1000};
+  address_get(g_seed, 7, ADDRESS_VER_ED25519, payment.receiver);
+  send_batch_op_t op = {.payments = &payment, .count = 1};
+  wallet_utx_t* utx = NULL;
+  TEST_ASSERT(wallet_build_batch(w, &op, &utx) == 0);
+  TEST_ASSERT(wallet_sign_utx(w, utx) == 0);
+  byte_buf_t* tx_b64 = tx_2_base64(&utx->tx);
+  tangle_client_conf_t conf;
+  sim_conf(sim, &conf);
+
+  // a broken signature, the last byte of the transaction is the end of signatures
+  byte_buf_t* bad = tamper(tx_b64, 2);
+  res_send_tx_t res = {};
+  send_tx_bytes(&conf, bad->data, &res);
+  TEST_ASSERT_EQUAL_STRING("", res.msg_id);
+  // an output is changed after signing
+  byte_buf_free(bad);
+  bad = tamper(tx_b64, 1 + 1 + ED_PUBLIC_KEY_BYTES + ED_SIGNATURE_BYTES + sizeof(uint32_t) + 1);
+  send_tx_bytes(&conf, bad->data, &res);
+  TEST_ASSERT_EQUAL_STRING("", res.msg_id);
+  byte_buf_free(bad);
+  TEST_ASSERT_EQUAL_UINT64(1000, ledger_sim_balance(sim, addr, NULL));
+
+  // accepted once, the inputs are spent then
+  TEST_ASSERT(send_tx_bytes(&conf, tx_b64->data, &res) == 0);
+  TEST_ASSERT(strlen(res.msg_id) > 0);
+  memset(&res, 0, sizeof(res));
+  send_tx_bytes(&conf, tx_b64->data, &res);
+  TEST_ASSERT_EQUAL_STRING("", res.msg_id);
+  TEST_ASSERT_EQUAL_UINT64(1000, ledger_sim_balance(sim, payment.receiver, NULL));
+
+  ledger_sim_stats_t stats = {};
+  ledger_sim_stats(sim, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.accepted);
+  TEST_ASSERT_EQUAL_UINT64(3, stats.rejected);
+
+  byte_buf_free(tx_b64);
+  wallet_cancel_utx(w, utx);
+  utx_free(utx);
+  wallet_free(w);
+  ledger_sim_free(sim);
+}
+
+void test_ledger_sim_faults() {
+  ledger_sim_conf_t sim_c;
+  ledger_sim_conf_default(&sim_c);
+  sim_c.confirm_ms = 100;
+  sim_c.latency_ms = 20;
+  ledger_sim_t* sim = ledger_sim_new(&sim_c);
+  tangle_client_conf_t conf;
+  sim_conf(sim, &conf);
+
+  // new outputs are confirmed after the delay
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 0, ADDRESS_VER_ED25519, addr);
+  res_get_funds_t funds = {};
+  uint64_t start = endpoint_now_us();
+  TEST_ASSERT(get_funds(&conf, addr, &funds) == 0);
+  TEST_ASSERT(endpoint_now_us() - start >= 20000);
+  // pending outputs are not counted in the balance
+  bool confirmed = true;
+  TEST_ASSERT_EQUAL_UINT64(0, unspent_balance(&conf, addr, &confirmed));
+  TEST_ASSERT_FALSE(confirmed);
+  TEST_ASSERT_EQUAL_UINT64(LEDGER_SIM_FAUCET_AMOUNT, ledger_sim_balance(sim, addr, NULL));
+  usleep(150 * 1000);
+  TEST_ASSERT_EQUAL_UINT64(LEDGER_SIM_FAUCET_AMOUNT, unspent_balance(&conf, addr, &confirmed));
+  TEST_ASSERT_TRUE(confirmed);
+
+  // injected errors and failures
+  res_node_info_t info = {};
+  sim_c.latency_ms = 0;
+  sim_c.error_percent = 100;
+  ledger_sim_set_conf(sim, &sim_c);
+  TEST_ASSERT(get_node_info(&conf, &info) != 0);
+  sim_c.error_percent = 0;
+  sim_c.fail_percent = 100;
+  ledger_sim_set_conf(sim, &sim_c);
+  TEST_ASSERT(get_node_info(&conf, &info) == -1);
+  sim_c.fail_percent = 0;
+  sim_c.synced = false;
+  ledger_sim_set_conf(sim, &sim_c);
+  TEST_ASSERT(get_node_info(&conf, &info) == 0);
+  TEST_ASSERT_FALSE(info.is_synced);
+
+  // a share of requests fails, the same seed fails the same requests
+  sim_c.error_percent = 30;
+  size_t failed[2] = {};
+  for (int run = 0; run < 2; run++) {
+    ledger_sim_set_conf(sim, &sim_c);
+    for (int i = 0; i < 100; i++) {
+      failed[run] += get_node_info(&conf, &info) != 0;
+    }
+  }
+  TEST_ASSERT(failed[0] > 10 && failed[0] < 50);
+  TEST_ASSERT_EQUAL_UINT32(failed[0], failed[1]);
+
+  ledger_sim_stats_t stats = {};
+  ledger_sim_stats(sim, &stats);
+  TEST_ASSERT_EQUAL_UINT64(1, stats.failures);
+  TEST_ASSERT_EQUAL_UINT64(1 + failed[0] * 2, stats.errors);
+
+  ledger_sim_free(sim);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  random_seed(g_seed);
+  RUN_TEST(test_ledger_sim_apis);
+  RUN_TEST(test_ledger_sim_wallet);
+  RUN_TEST(test_ledger_sim_rejects);
+  RUN_TEST(test_ledger_sim_faults);
+
+  return UNITY_END();
+}
@@ -0,0 +1,323 @@
+#ifndef __TEST_SERVER_H__
+#define __TEST_SERVER_H__
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "core/types.h"
+#include "unity/unity.h"
+
+/**
+ * @brief A local http server of the client tests
+ *
+ * Every connection is served by its own thread, the requests of a connection are answered one after another by the
+ * handler of the server. Stopping the server closes the connections still open.
+ *
+ */
+
+typedef struct test_server_s test_server_t;
+
+// a received request
+typedef struct {
+  char const* head;  // the request line and the headers, null terminated
+  char const* path;  // the path without the query
+  char const* body;
+  size_t len;
+} test_request_t;
+
+/**
+ * @brief Answers a request
+ *
+ * @param[in] s The server
+ * @param[in] fd The connection
+ * @param[in] req The request
+ * @return bool false if the connection is closed afterwards
+ */
+typedef bool (*test_server_fn)(test_server_t* s, int fd, test_request_t const* req);
+
+struct test_server_s {
+  int fd;
+  uint16_t port;
+  char url[64];  // http://127.0.0.1:<port>/
+  byte_t mask;   // bytes are xored with the mask in both directions, 0 leaves them
+  test_server_fn fn;
+  void* ctx;  // the context of the handler
+  pthread_t tid;
+  pthread_mutex_t lock;
+  int* conns;  // the open connections
+  size_t active;
+  size_t conns_cap;
+  size_t max_active;
+  int accepted;
+  size_t requests;
+  char head[512];  // the head of the last request
+};
+
+typedef struct {
+  test_server_t* s;
+  int fd;
+} test_server_conn_t;
+
+static inline void test_server_mask(test_server_t* s, byte_t* data, size_t len) {
+  for (size_t i = 0; s->mask && i < len; i++) {
+    data[i] ^= s->mask;
+  }
+}
+
+/**
+ * @brief Sends data on a connection, errors of connections closed by the client are ignored
+ *
+ * @param[in] s The server
+ * @param[in] fd The connection
+ * @param[in] data The data
+ * @param[in] len The length of the data
+ */
+static inline void test_server_send(test_server_t* s, int fd, void const* data, size_t len) {
+  byte_t* out = malloc(len);
+  if (out == NULL) {
+    return;
+  }
+  memcpy(out, data, len);
+  test_server_mask(s, out, len);
+  for (size_t sent = 0; sent < len;) {
+    ssize_t n = send(fd, out + sent, len - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      break;
+    }
+    sent += (size_t)n;
+  }
+  free(out);
+}
+
+/**
+ * @brief Sends a response with a JSON body and its length
+ *
+ * @param[in] s The server
+ * @param[in] fd The connection
+ * @param[in] status The status code and reason, like "200 OK"
+ * @param[in] body The body
+ * @param[in] close Whether the response announces that the connection is closed
+ */
+static inline void test_server_reply(test_server_t* s, int fd, char const* status, char const* body, bool close) {
+  size_t body_len = strlen(body);
+  char* res = malloc(body_len + 256);
+  if (res == NULL) {
+    return;
+  }
+  int n = sprintf(res, "HTTP/1.1 %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n%s\r\n", status,
+                  body_len, close ? "Connection: close\r\n" : "");
+  memcpy(res + n, body, body_len);
+  test_server_send(s, fd, res, n + body_len);
+  free(res);
+}
+
+static inline void test_server_drop(test_server_t* s, int fd) {
+  pthread_mutex_lock(&s->lock);
+  for (size_t i = 0; i < s->active; i++) {
+    if (s->conns[i] == fd) {
+      s->conns[i] = s->conns[--s->active];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&s->lock);
+  close(fd);
+}
+
+static inline void* test_server_conn_fn(void* arg) {
+  test_server_conn_t* c = (test_server_conn_t*)arg;
+  test_server_t* s = c->s;
+  int fd = c->fd;
+  free(c);
+  size_t cap = 4096, len = 0;
+  char* buf = malloc(cap);
+  for (bool keep = buf != NULL; keep;) {
+    // the head, then the body of its length
+    char* end = NULL;
+    size_t need = 0;
+    for (;;) {
+      buf[len] = '\0';
+      if (end == NULL && (end = strstr(buf, "\r\n\r\n")) != NULL) {
+        char const* cl = strstr(buf, "Content-Length: ");
+        need = end + 4 - buf + (cl && cl < end ? strtoul(cl + 16, NULL, 10) : 0);
+      }
+      if (end && len >= need) {
+        break;
+      }
+      if (len + 1 == cap) {
+        char* bigger = realloc(buf, cap * 2);
+        if (bigger == NULL) {
+          goto done;
+        }
+        buf = bigger;
+        cap *= 2;
+        end = NULL;
+      }
+      ssize_t n = recv(fd, buf + len, cap - 1 - len, 0);
+      if (n <= 0) {
+        goto done;
+      }
+      test_server_mask(s, (byte_t*)buf + len, (size_t)n);
+      len += (size_t)n;
+    }
+
+    // the head and the body are null terminated for the handler
+    size_t head_len = end + 4 - buf;
+    char* head = malloc(need + 2);
+    if (head == NULL) {
+      break;
+    }
+    memcpy(head, buf, head_len);
+    head[head_len] = '\0';
+    char* body = head + head_len + 1;
+    memcpy(body, buf + head_len, need - head_len);
+    body[need - head_len] = '\0';
+    char path[256] = {};
+    sscanf(head, "%*s %255s", path);
+    path[strcspn(path, "?")] = '\0';
+    pthread_mutex_lock(&s->lock);
+    s->requests++;
+    snprintf(s->head, sizeof(s->head), "%s", head);
+    pthread_mutex_unlock(&s->lock);
+
+    test_request_t req = {.head = head, .path = path, .body = body, .len = need - head_len};
+    keep = s->fn(s, fd, &req);
+    free(head);
+    memmove(buf, buf + need, len - need);
+    len -= need;
+  }
+done:
+  free(buf);
+  test_server_drop(s, fd);
+  return NULL;
+}
+
+static inline void* test_server_accept_fn(void* arg) {
+  test_server_t* s = (test_server_t*)arg;
+  int fd;
+  while ((fd = accept(s->fd, NULL, NULL)) >= 0) {
+    test_server_conn_t* c = malloc(sizeof(test_server_conn_t));
+    pthread_mutex_lock(&s->lock);
+    if (c && s->active == s->conns_cap) {
+      size_t cap = s->conns_cap ? s->conns_cap * 2 : 16;
+      int* conns = realloc(s->conns, sizeof(int) * cap);
+      if (conns) {
+        s->conns = conns;
+        s->conns_cap = cap;
+      }
+    }
+    if (c == NULL || s->active == s->conns_cap) {
+      pthread_mutex_unlock(&s->lock);
+      free(c);
+      close(fd);
+      continue;
+    }
+    c->s = s;
+    c->fd = fd;
+    s->conns[s->active++] = fd;
+    s->max_active = s->active > s->max_active ? s->active : s->max_active;
+    s->accepted++;
+    pthread_mutex_unlock(&s->lock);
+    pthread_t tid;
+    pthread_create(&tid, NULL, test_server_conn_fn, c);
+    pthread_detach(tid);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Starts a server on a free port of the loopback interface
+ *
+ * @param[out] s The server
+ * @param[in] fn The handler of requests
+ * @param[in] ctx The context of the handler
+ * @param[in] mask The mask of the bytes on the wire, 0 for none
+ */
+static inline void test_server_start(test_server_t* s, test_server_fn fn, void* ctx, byte_t mask) {
+  memset(s, 0, sizeof(test_server_t));
+  pthread_mutex_init(&s->lock, NULL);
+  s->fn = fn;
+  s->ctx = ctx;
+  s->mask = mask;
+  s->fd = socket(AF_INET, SOCK_STREAM, 0);
+  TEST_ASSERT(s->fd >= 0);
+  struct sockaddr_in addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t addr_len = sizeof(addr);
+  TEST_ASSERT(bind(s->fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+  TEST_ASSERT(listen(s->fd, 512) == 0);
+  getsockname(s->fd, (struct sockaddr*)&addr, &addr_len);
+  s->port = ntohs(addr.sin_port);
+  snprintf(s->url, sizeof(s->url), "http://127.0.0.1:%u/", s->port);
+  pthread_create(&s->tid, NULL, test_server_accept_fn, s);
+}
+
+/**
+ * @brief Stops accepting, closes the open connections and waits for their threads
+ *
+ * @param[in] s The server
+ */
+static inline void test_server_stop(test_server_t* s) {
+  shutdown(s->fd, SHUT_RDWR);
+  close(s->fd);
+  pthread_join(s->tid, NULL);
+  pthread_mutex_lock(&s->lock);
+  for (size_t i = 0; i < s->active; i++) {
+    shutdown(s->conns[i], SHUT_RDWR);
+  }
+  pthread_mutex_unlock(&s->lock);
+  for (size_t active = 1; active > 0; usleep(1000)) {
+    pthread_mutex_lock(&s->lock);
+    active = s->active;
+    pthread_mutex_unlock(&s->lock);
+  }
+  free(s->conns);
+  pthread_mutex_destroy(&s->lock);
+}
+
+/**
+ * @brief Gets the number of accepted connections
+ *
+ * @param[in] s The server
+ * @return int
+ */
+static inline int test_server_accepted(test_server_t* s) {
+  pthread_mutex_lock(&s->lock);
+  int accepted = s->accepted;
+  pthread_mutex_unlock(&s->lock);
+  return accepted;
+}
+
+/**
+ * @brief Gets the number of answered requests
+ *
+ * @param[in] s The server
+ * @return size_t
+ */
+static inline size_t test_server_requests(test_server_t* s) {
+  pthread_mutex_lock(&s->lock);
+  size_t requests = s->requests;
+  pthread_mutex_unlock(&s->lock);
+  return requests;
+}
+
+/**
+ * @brief Gets the most connections which were open at the same time
+ *
+ * @param[in] s The server
+ * @return size_t
+ */
+static inline size_t test_server_max_active(test_server_t* s) {
+  pthread_mutex_lock(&s->lock);
+  size_t max_active = s->max_active;
+  pthread_mutex_unlock(&s->lock);
+  return max_active;
+}
+
+#endif
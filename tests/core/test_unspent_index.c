@@ -0,0 +1,78 @@
+#include <stdio.h>
+
+#include "core/unspent_index.h"
+#include "unity/unity.h"
+
+void test_unspent_index() {
+  byte_t addr_a[TANGLE_ADDRESS_BYTES] = {};
+  byte_t addr_b[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_a[TX_ID_BYTES] = {};
+  byte_t tx_b[TX_ID_BYTES] = {};
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  inclusion_state_t st = {.confirmed = true};
+  randombytes_buf((void* const)addr_a, TANGLE_ADDRESS_BYTES);
+  randombytes_buf((void* const)addr_b, TANGLE_ADDRESS_BYTES);
+  randombytes_buf((void* const)tx_a, TX_ID_BYTES);
+  randombytes_buf((void* const)tx_b, TX_ID_BYTES);
+
+  balance_ht_t* bals = balance_ht_init();
+  balance_ht_add(&bals, color, 100);
+
+  // tx_a has outputs on both addresses, tx_b only on addr_b
+  output_ids_t* ids = output_ids_init();
+  output_ids_add(&ids, tx_a, bals, &st);
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  unspent_outputs_add(&unspent, addr_a, 3, ids);
+  output_ids_add(&ids, tx_b, bals, &st);
+  unspent_outputs_add(&unspent, addr_b, 7, ids);
+
+  unspent_index_t* idx = unspent_index_new();
+  TEST_ASSERT_NOT_NULL(idx);
+  TEST_ASSERT(unspent_index_rebuild(idx, &unspent) == 0);
+
+  // by address index
+  unspent_outputs_t* elm = unspent_index_find_by_addr_index(idx, 7);
+  TEST_ASSERT_NOT_NULL(elm);
+  TEST_ASSERT_EQUAL_MEMORY(addr_b, elm->addr, TANGLE_ADDRESS_BYTES);
+  TEST_ASSERT_NULL(unspent_index_find_by_addr_index(idx, 5));
+
+  // by transaction id
+  tx_inputs_t* outs = unspent_index_find_by_tx(idx, tx_a);
+  TEST_ASSERT_NOT_NULL(outs);
+  TEST_ASSERT_EQUAL_UINT32(2, tx_inputs_len(outs));
+  outs = unspent_index_find_by_tx(idx, tx_b);
+  TEST_ASSERT_NOT_NULL(outs);
+  TEST_ASSERT_EQUAL_UINT32(1, tx_inputs_len(outs));
+  TEST_ASSERT_EQUAL_MEMORY(addr_b, tx_inputs_at(outs, 0), TANGLE_ADDRESS_BYTES);
+  TEST_ASSERT_EQUAL_MEMORY(tx_b, tx_inputs_at(outs, 0) + TANGLE_ADDRESS_BYTES, TX_ID_BYTES);
+
+  // updates an entry, tx_b is gone from addr_b
+  elm = unspent_outputs_find(&unspent, addr_b);
+  unspent_index_remove(idx, elm);
+  output_ids_remove(&ids, tx_b);
+  unspent_outputs_update(&unspent, addr_b, ids);
+  TEST_ASSERT(unspent_index_add(idx, elm) == 0);
+  TEST_ASSERT_NULL(unspent_index_find_by_tx(idx, tx_b));
+  TEST_ASSERT_EQUAL_UINT32(2, tx_inputs_len(unspent_index_find_by_tx(idx, tx_a)));
+  TEST_ASSERT_EQUAL_PTR(elm, unspent_index_find_by_addr_index(idx, 7));
+
+  // removes an entry from the index then the table
+  elm = unspent_outputs_find(&unspent, addr_a);
+  unspent_index_remove(idx, elm);
+  unspent_outputs_remove(&unspent, addr_a);
+  TEST_ASSERT_NULL(unspent_index_find_by_addr_index(idx, 3));
+  TEST_ASSERT_EQUAL_UINT32(1, tx_inputs_len(unspent_index_find_by_tx(idx, tx_a)));
+
+  unspent_index_free(idx);
+  unspent_outputs_free(&unspent);
+  output_ids_free(&ids);
+  balance_ht_free(&bals);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_unspent_index);
+
+  return UNITY_END();
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+
+#include "core/utxo_store.h"
+#include "unity/unity.h"
+
+void test_inclusion_state_bits() {
+  inclusion_state_t st = {.confirmed = true, .liked = true, .preferred = true};
+  inclusion_bits_t bits = inclusion_state_pack(&st);
+  TEST_ASSERT_EQUAL_UINT8(INCLUSION_CONFIRMED | INCLUSION_LIKED | INCLUSION_PREFERRED, bits);
+
+  inclusion_state_t out = {};
+  inclusion_state_unpack(bits, &out);
+  TEST_ASSERT_EQUAL_MEMORY(&st, &out, sizeof(inclusion_state_t));
+}
+
+void test_utxo_store() {
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  byte_t iota[BALANCE_COLOR_BYTES] = {};
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  balance_color_random(color);
+
+  utxo_store_t* s = utxo_store_new();
+  TEST_ASSERT_NOT_NULL(s);
+
+  uint32_t slot = 0;
+  TEST_ASSERT(utxo_store_add_slot(s, addr, 0, &slot) == 0);
+  TEST_ASSERT_EQUAL_UINT32(0, slot);
+
+  TEST_ASSERT(utxo_store_add(s, slot, tx_id, iota, 100, INCLUSION_CONFIRMED) == 0);
+  TEST_ASSERT(utxo_store_add(s, slot, tx_id, color, 10, INCLUSION_CONFIRMED) == 0);
+  TEST_ASSERT(utxo_store_add(s, slot, tx_id, iota, 1000, INCLUSION_SOLID) == 0);
+  TEST_ASSERT(utxo_store_add(s, slot, tx_id, iota, 5, INCLUSION_CONFIRMED | INCLUSION_REJECTED) == 0);
+  TEST_ASSERT(utxo_store_add(s, slot, tx_id, color, 7, INCLUSION_CONFIRMED | UTXO_LOCAL_SPENT) == 0);
+  TEST_ASSERT_EQUAL_UINT32(5, utxo_store_len(s));
+  // colors are interned
+  TEST_ASSERT_EQUAL_UINT32(2, s->color_len);
+
+  TEST_ASSERT_EQUAL_UINT64(122, utxo_store_balance(s, INCLUSION_CONFIRMED, 0));
+  TEST_ASSERT_EQUAL_UINT64(115, utxo_store_balance(s, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT));
+  TEST_ASSERT_EQUAL_UINT64(1122, utxo_store_balance(s, 0, 0));
+  TEST_ASSERT_EQUAL_UINT64(105, utxo_store_balance_with_color(s, iota, INCLUSION_CONFIRMED, 0));
+  TEST_ASSERT_EQUAL_UINT64(100, utxo_store_spendable(s, iota));
+  TEST_ASSERT_EQUAL_UINT64(10, utxo_store_spendable(s, color));
+
+  uint64_t sums[2] = {};
+  utxo_store_balance_by_color(s, UTXO_SPENDABLE_REQUIRED, UTXO_SPENDABLE_FORBIDDEN, sums);
+  uint32_t id = 0;
+  TEST_ASSERT_TRUE(utxo_store_color_id(s, color, &id));
+  TEST_ASSERT_EQUAL_UINT64(10, sums[id]);
+  TEST_ASSERT_TRUE(utxo_store_color_id(s, iota, &id));
+  TEST_ASSERT_EQUAL_UINT64(100, sums[id]);
+
+  utxo_store_clear(s);
+  TEST_ASSERT_EQUAL_UINT32(0, utxo_store_len(s));
+  TEST_ASSERT_EQUAL_UINT64(0, utxo_store_spendable(s, iota));
+
+  utxo_store_free(s);
+}
+
+void test_utxo_store_load() {
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  inclusion_state_t st = {.confirmed = true};
+
+  balance_ht_t* bals = balance_ht_init();
+  balance_ht_add(&bals, color, 100);
+  balance_color_random(color);
+  balance_ht_add(&bals, color, 1000);
+
+  output_ids_t* ids = output_ids_init();
+  randombytes_buf((void* const)tx_id, TX_ID_BYTES);
+  output_ids_add(&ids, tx_id, bals, &st);
+
+  unspent_outputs_t* unspent = unspent_outputs_init();
+  randombytes_buf((void* const)addr, TANGLE_ADDRESS_BYTES);
+  unspent_outputs_add(&unspent, addr, 0, ids);
+  randombytes_buf((void* const)addr, TANGLE_ADDRESS_BYTES);
+  unspent_outputs_add(&unspent, addr, 1, ids);
+  randombytes_buf((void* const)addr, TANGLE_ADDRESS_BYTES);
+  unspent_outputs_add(&unspent, addr, 2, ids);
+  unspent_outputs_set_spent(&unspent, addr, true);
+
+  utxo_store_t* s = utxo_store_new();
+  TEST_ASSERT(utxo_store_load(s, &unspent) == 0);
+  TEST_ASSERT_EQUAL_UINT32(6, utxo_store_len(s));
+  TEST_ASSERT_EQUAL_UINT32(3, s->slot_len);
+  // same results as the hash table
+  TEST_ASSERT_EQUAL_UINT64(unspent_outputs_balance(&unspent),
+                           utxo_store_balance(s, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT));
+  TEST_ASSERT_EQUAL_UINT64(unspent_outputs_balance_with_color(&unspent, color),
+                           utxo_store_balance_with_color(s, color, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT));
+
+  // reloading doesn't duplicate rows
+  TEST_ASSERT(utxo_store_load(s, &unspent) == 0);
+  TEST_ASSERT_EQUAL_UINT32(6, utxo_store_len(s));
+
+  utxo_store_free(s);
+  unspent_outputs_free(&unspent);
+  output_ids_free(&ids);
+  balance_ht_free(&bals);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_inclusion_state_bits);
+  RUN_TEST(test_utxo_store);
+  RUN_TEST(test_utxo_store_load);
+
+  return UNITY_END();
+}
@@ -1,7 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "unity/unity.h"
 #include "utils/bitmask.h"
+#include "utils/roaring.h"
 
 void test_bitmask() {
   printf("bitmask new\n");
@@ -50,17 +52,255 @@ void test_bitmask() {
 
   printf("bitmask clone\n");
   bitmask_t* n = bitmask_clone(b);
-  TEST_ASSERT_EQUAL_MEMORY(n->byte, b->byte, b->cap);
+  TEST_ASSERT_EQUAL_MEMORY(n->words, b->words, b->cap * sizeof(uint64_t));
   bitmask_show(n);
 
   bitmask_free(b);
   bitmask_free(n);
 }
 
+void test_bitmask_range() {
+  bitmask_t* b = bitmask_new();
+
+  // within a word
+  TEST_ASSERT(bitmask_range_op(b, 3, 5, BITMASK_SET) == 0);
+  TEST_ASSERT_EQUAL_UINT64(5, bitmask_popcount(b));
+  TEST_ASSERT_FALSE(bitmask_get(b, 2));
+  TEST_ASSERT_TRUE(bitmask_get(b, 3));
+  TEST_ASSERT_TRUE(bitmask_get(b, 7));
+  TEST_ASSERT_FALSE(bitmask_get(b, 8));
+
+  // across words, grows the capacity
+  TEST_ASSERT(bitmask_range_op(b, 60, 200, BITMASK_SET) == 0);
+  TEST_ASSERT_EQUAL_UINT64(205, bitmask_popcount(b));
+  TEST_ASSERT_EQUAL_UINT64(200, bitmask_popcount_range(b, 60, 200));
+  TEST_ASSERT_EQUAL_UINT64(10, bitmask_popcount_range(b, 250, 1000));
+  TEST_ASSERT_TRUE(b->cap >= 5);
+
+  TEST_ASSERT(bitmask_range_op(b, 100, 64, BITMASK_CLEAR) == 0);
+  TEST_ASSERT_EQUAL_UINT64(141, bitmask_popcount(b));
+  TEST_ASSERT(bitmask_range_op(b, 0, 64, BITMASK_TOGGLE) == 0);
+  TEST_ASSERT_FALSE(bitmask_get(b, 3));
+  TEST_ASSERT_TRUE(bitmask_get(b, 0));
+  TEST_ASSERT_FALSE(bitmask_get(b, 60));
+
+  // clearing out of capacity doesn't grow it
+  uint64_t cap = b->cap;
+  TEST_ASSERT(bitmask_range_op(b, 1 << 20, 100, BITMASK_CLEAR) == 0);
+  TEST_ASSERT(bitmask_op(b, 1 << 20, BITMASK_CLEAR) == 0);
+  TEST_ASSERT_EQUAL_UINT64(cap, b->cap);
+  TEST_ASSERT_FALSE(bitmask_get(b, 1 << 20));
+  TEST_ASSERT(bitmask_range_op(b, UINT64_MAX, 2, BITMASK_SET) == -1);
+
+  bitmask_free(b);
+}
+
+void test_bitmask_find() {
+  bitmask_t* b = bitmask_new();
+
+  TEST_ASSERT_EQUAL_UINT64(BITMASK_NONE, bitmask_find_next_set(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(0, bitmask_find_next_clear(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(1000, bitmask_find_next_clear(b, 1000));
+  TEST_ASSERT_EQUAL_UINT64(5, bitmask_find_prev_clear(b, 5));
+
+  TEST_ASSERT(bitmask_range_op(b, 0, 130, BITMASK_SET) == 0);
+  TEST_ASSERT_EQUAL_UINT64(130, bitmask_find_next_clear(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(BITMASK_NONE, bitmask_find_prev_clear(b, 129));
+  TEST_ASSERT_EQUAL_UINT64(130, bitmask_find_prev_clear(b, 130));
+  TEST_ASSERT_EQUAL_UINT64(70, bitmask_find_next_set(b, 70));
+  TEST_ASSERT_EQUAL_UINT64(BITMASK_NONE, bitmask_find_next_set(b, 130));
+
+  TEST_ASSERT(bitmask_op(b, 64, BITMASK_CLEAR) == 0);
+  TEST_ASSERT_EQUAL_UINT64(64, bitmask_find_next_clear(b, 1));
+  TEST_ASSERT_EQUAL_UINT64(64, bitmask_find_prev_clear(b, 128));
+  TEST_ASSERT_EQUAL_UINT64(65, bitmask_find_next_set(b, 64));
+
+  // iterators
+  uint64_t i = 0, n = 0;
+  BITMASK_FOREACH_CLEAR(b, i, 0, 140) {
+    TEST_ASSERT_TRUE(i == 64 || i >= 130);
+    n++;
+  }
+  TEST_ASSERT_EQUAL_UINT64(11, n);
+  n = 0;
+  BITMASK_FOREACH_SET(b, i, 60, 1000) {
+    TEST_ASSERT_TRUE(bitmask_get(b, i));
+    n++;
+  }
+  TEST_ASSERT_EQUAL_UINT64(69, n);
+
+  bitmask_free(b);
+}
+
+void test_bitmask_large() {
+  uint64_t const bits = 10 * 1000 * 1000;
+  bitmask_t* b = bitmask_new();
+
+  TEST_ASSERT(bitmask_range_op(b, 0, bits, BITMASK_SET) == 0);
+  TEST_ASSERT(bitmask_op(b, bits - 7, BITMASK_CLEAR) == 0);
+  TEST_ASSERT(bitmask_op(b, 7, BITMASK_CLEAR) == 0);
+  TEST_ASSERT_EQUAL_UINT64(bits - 2, bitmask_popcount(b));
+  TEST_ASSERT_EQUAL_UINT64(bits - 7, bitmask_find_next_clear(b, 8));
+  TEST_ASSERT_EQUAL_UINT64(7, bitmask_find_prev_clear(b, bits - 8));
+  TEST_ASSERT_EQUAL_UINT64(bits, bitmask_find_next_clear(b, bits - 6));
+
+  bitmask_free(b);
+}
+
+static uint8_t chunk_kind(bitmask_t const* b, uint64_t key) {
+  for (uint32_t i = 0; i < b->roaring->n; i++) {
+    if (b->roaring->containers[i].key == key) {
+      return b->roaring->containers[i].kind;
+    }
+  }
+  return UINT8_MAX;
+}
+
+void test_bitmask_compressed() {
+  bitmask_t* b = bitmask_new_compressed();
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_TRUE(bitmask_is_compressed(b));
+  TEST_ASSERT_EQUAL_UINT64(BITMASK_NONE, bitmask_find_next_set(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(1000, bitmask_find_next_clear(b, 1000));
+
+  // sparse bits are kept in an array
+  for (uint64_t i = 0; i < 100; i++) {
+    TEST_ASSERT(bitmask_op(b, i * 3, BITMASK_SET) == 0);
+  }
+  TEST_ASSERT_EQUAL_UINT8(ROARING_ARRAY, chunk_kind(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(100, bitmask_popcount(b));
+  TEST_ASSERT_TRUE(bitmask_get(b, 297));
+  TEST_ASSERT_FALSE(bitmask_get(b, 298));
+
+  // a long run of spent addresses
+  TEST_ASSERT(bitmask_range_op(b, 0, 50000, BITMASK_SET) == 0);
+  TEST_ASSERT_EQUAL_UINT8(ROARING_RUN, chunk_kind(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(50000, bitmask_find_next_clear(b, 0));
+  TEST_ASSERT_EQUAL_UINT64(BITMASK_NONE, bitmask_find_prev_clear(b, 49999));
+
+  // dense random bits are kept in a bitmap
+  for (uint64_t i = 0; i < 20000; i++) {
+    TEST_ASSERT(bitmask_op(b, ROARING_CHUNK_BITS + i * 3, BITMASK_SET) == 0);
+  }
+  TEST_ASSERT_EQUAL_UINT8(ROARING_BITMAP, chunk_kind(b, 1));
+
+  // full chunks cost a single run, clearing them removes the containers
+  TEST_ASSERT(bitmask_range_op(b, 5 * ROARING_CHUNK_BITS, 100 * ROARING_CHUNK_BITS, BITMASK_SET) == 0);
+  TEST_ASSERT_EQUAL_UINT32(102, b->roaring->n);
+  TEST_ASSERT_TRUE(bitmask_memory(b) < 32 * 1024);
+  TEST_ASSERT_EQUAL_UINT64(105 * ROARING_CHUNK_BITS, bitmask_find_next_clear(b, 5 * ROARING_CHUNK_BITS));
+  TEST_ASSERT(bitmask_range_op(b, 5 * ROARING_CHUNK_BITS, 100 * ROARING_CHUNK_BITS, BITMASK_CLEAR) == 0);
+  TEST_ASSERT_EQUAL_UINT32(2, b->roaring->n);
+  TEST_ASSERT_EQUAL_UINT64(70000, bitmask_popcount(b));
+
+  // toggling a whole chunk
+  TEST_ASSERT(bitmask_range_op(b, 0, ROARING_CHUNK_BITS, BITMASK_TOGGLE) == 0);
+  TEST_ASSERT_EQUAL_UINT64(ROARING_CHUNK_BITS - 50000, bitmask_popcount_range(b, 0, ROARING_CHUNK_BITS));
+  TEST_ASSERT_EQUAL_UINT64(50000, bitmask_find_next_set(b, 0));
+
+  bitmask_free(b);
+}
+
+void test_bitmask_compressed_random() {
+  bitmask_t* dense = bitmask_new();
+  bitmask_t* comp = bitmask_new_compressed();
+  uint64_t const bits = 4 * ROARING_CHUNK_BITS;
+  srand(42);
+
+  for (int round = 0; round < 2000; round++) {
+    uint64_t start = (uint64_t)rand() % bits;
+    // mostly short ranges, some across chunks
+    uint64_t count = (uint64_t)rand() % (round % 10 == 0 ? 2 * ROARING_CHUNK_BITS : 100) + 1;
+    bitmask_op_t op = (bitmask_op_t)(rand() % 3);
+    TEST_ASSERT(bitmask_range_op(dense, start, count, op) == 0);
+    TEST_ASSERT(bitmask_range_op(comp, start, count, op) == 0);
+
+    uint64_t from = (uint64_t)rand() % (bits + 1000);
+    TEST_ASSERT_EQUAL(bitmask_get(dense, from), bitmask_get(comp, from));
+    TEST_ASSERT_EQUAL_UINT64(bitmask_find_next_set(dense, from), bitmask_find_next_set(comp, from));
+    TEST_ASSERT_EQUAL_UINT64(bitmask_find_prev_clear(dense, from), bitmask_find_prev_clear(comp, from));
+    TEST_ASSERT_EQUAL_UINT64(bitmask_popcount_range(dense, from, count), bitmask_popcount_range(comp, from, count));
+    // the dense capacity might end in a run of set bits
+    uint64_t next = bitmask_find_next_clear(dense, from);
+    if (next < dense->cap * BITMASK_WORD_BITS) {
+      TEST_ASSERT_EQUAL_UINT64(next, bitmask_find_next_clear(comp, from));
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT64(bitmask_popcount(dense), bitmask_popcount(comp));
+
+  // converts in both directions
+  bitmask_t* c = bitmask_convert(dense, true);
+  bitmask_t* d = bitmask_convert(comp, false);
+  TEST_ASSERT_NOT_NULL(c);
+  TEST_ASSERT_NOT_NULL(d);
+  TEST_ASSERT_TRUE(bitmask_is_compressed(c));
+  TEST_ASSERT_FALSE(bitmask_is_compressed(d));
+  for (uint64_t i = 0; i < bits + 1000; i++) {
+    bool v = bitmask_get(dense, i);
+    TEST_ASSERT_EQUAL(v, bitmask_get(c, i));
+    TEST_ASSERT_EQUAL(v, bitmask_get(d, i));
+  }
+
+  bitmask_free(c);
+  bitmask_free(d);
+  bitmask_free(dense);
+  bitmask_free(comp);
+}
+
+void test_bitmask_serialize() {
+  bitmask_t* dense = bitmask_new();
+  TEST_ASSERT(bitmask_range_op(dense, 0, 200000, BITMASK_SET) == 0);
+  TEST_ASSERT(bitmask_op(dense, 1000, BITMASK_CLEAR) == 0);
+  for (uint64_t i = 0; i < 10000; i++) {
+    TEST_ASSERT(bitmask_op(dense, 300000 + i * 2, BITMASK_SET) == 0);
+  }
+  TEST_ASSERT(bitmask_op(dense, 1000000, BITMASK_SET) == 0);
+  TEST_ASSERT(bitmask_op(dense, 1000002, BITMASK_SET) == 0);
+
+  // both representations share the same format
+  byte_buf_t* a = byte_buf_new();
+  byte_buf_t* b = byte_buf_new();
+  bitmask_t* comp = bitmask_convert(dense, true);
+  TEST_ASSERT(bitmask_serialize(dense, a) == 0);
+  TEST_ASSERT(bitmask_serialize(comp, b) == 0);
+  TEST_ASSERT_EQUAL_UINT64(a->len, b->len);
+  TEST_ASSERT_EQUAL_MEMORY(a->data, b->data, a->len);
+  TEST_ASSERT_EQUAL_MEMORY("GSRB", a->data, 4);
+
+  bitmask_t* n = bitmask_deserialize(a->data, a->len);
+  TEST_ASSERT_NOT_NULL(n);
+  TEST_ASSERT_EQUAL_UINT64(bitmask_popcount(dense), bitmask_popcount(n));
+  TEST_ASSERT_EQUAL_UINT64(1000, bitmask_find_next_clear(n, 0));
+  TEST_ASSERT_EQUAL_UINT64(1000000, bitmask_find_next_set(n, 320000));
+
+  // truncated or corrupted data is rejected
+  TEST_ASSERT_NULL(bitmask_deserialize(a->data, a->len - 1));
+  TEST_ASSERT_NULL(bitmask_deserialize(a->data, 8));
+  a->data[4] = 2;
+  TEST_ASSERT_NULL(bitmask_deserialize(a->data, a->len));
+  a->data[4] = 1;
+  // the last array isn't sorted
+  a->data[a->len - 2] = 0;
+  a->data[a->len - 1] = 0;
+  TEST_ASSERT_NULL(bitmask_deserialize(a->data, a->len));
+
+  bitmask_free(n);
+  bitmask_free(comp);
+  bitmask_free(dense);
+  byte_buf_free(a);
+  byte_buf_free(b);
+}
+
 int main() {
   UNITY_BEGIN();
 
   RUN_TEST(test_bitmask);
+  RUN_TEST(test_bitmask_range);
+  RUN_TEST(test_bitmask_find);
+  RUN_TEST(test_bitmask_large);
+  RUN_TEST(test_bitmask_compressed);
+  RUN_TEST(test_bitmask_compressed_random);
+  RUN_TEST(test_bitmask_serialize);
 
   return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core/address.h"
+#include "unity/unity.h"
+#include "utils/metrics.h"
+
+#define THREADS 4
+#define ADDS_PER_THREAD 100000
+
+static uint64_t const g_bounds[] = {10, 100, 1000};
+
+// the rendered registry as a string
+static char* render() {
+  byte_buf_t* out = byte_buf_new();
+  TEST_ASSERT(metrics_render(out) == 0);
+  byte_buf_append(out, (byte_t const*)"", 1);
+  char* text = strdup((char const*)out->data);
+  byte_buf_free(out);
+  return text;
+}
+
+void test_metrics_counter_gauge() {
+  metrics_reset();
+  metric_values_t v;
+  metric_add(&g_metric_signatures_created, 2);
+  metric_add(&g_metric_signatures_created, 3);
+  TEST_ASSERT(metric_get(&g_metric_signatures_created, NULL, &v) == 0);
+  TEST_ASSERT_EQUAL_INT64(5, v.value);
+  metric_set(&g_metric_utxo_outputs, 42);
+  metric_add(&g_metric_utxo_outputs, -2);
+  TEST_ASSERT(metric_get(&g_metric_utxo_outputs, NULL, &v) == 0);
+  TEST_ASSERT_EQUAL_INT64(40, v.value);
+
+  char* text = render();
+  TEST_ASSERT_NOT_NULL(strstr(text,
+                              "# HELP goshimmer_client_signatures_created_total Created signatures.\n"
+                              "# TYPE goshimmer_client_signatures_created_total counter\n"
+                              "goshimmer_client_signatures_created_total 5\n"));
+  TEST_ASSERT_NOT_NULL(strstr(text, "# TYPE goshimmer_client_utxo_outputs gauge\ngoshimmer_client_utxo_outputs 40\n"));
+  free(text);
+
+  metrics_reset();
+  TEST_ASSERT(metric_get(&g_metric_signatures_created, NULL, &v) == 0);
+  TEST_ASSERT_EQUAL_INT64(0, v.value);
+}
+
+void test_metrics_histogram() {
+  metric_t hist = {.name = "test_latency_seconds",
+                   .help = "Test latency.",
+                   .type = METRIC_HISTOGRAM,
+                   .bounds = g_bounds,
+                   .bounds_len = 3,
+                   .scale = 1e-3};
+  TEST_ASSERT(metrics_register(&hist) == 0);
+  // bounds are inclusive upper bounds
+  uint64_t values[] = {0, 10, 11, 100, 5000};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    metric_observe(&hist, values[i]);
+  }
+  metric_values_t v;
+  TEST_ASSERT(metric_get(&hist, NULL, &v) == 0);
+  TEST_ASSERT_EQUAL_UINT64(2, v.buckets[0]);
+  TEST_ASSERT_EQUAL_UINT64(2, v.buckets[1]);
+  TEST_ASSERT_EQUAL_UINT64(0, v.buckets[2]);
+  TEST_ASSERT_EQUAL_UINT64(1, v.buckets[3]);
+  TEST_ASSERT_EQUAL_UINT64(5121, v.sum);
+
+  // buckets are cumulative and rendered in base units
+  char* text = render();
+  TEST_ASSERT_NOT_NULL(strstr(text,
+                              "# HELP test_latency_seconds Test latency.\n"
+                              "# TYPE test_latency_seconds histogram\n"
+                              "test_latency_seconds_bucket{le=\"0.01\"} 2\n"
+                              "test_latency_seconds_bucket{le=\"0.1\"} 4\n"
+                              "test_latency_seconds_bucket{le=\"1\"} 4\n"
+                              "test_latency_seconds_bucket{le=\"+Inf\"} 5\n"
+                              "test_latency_seconds_sum 5.121\n"
+                              "test_latency_seconds_count 5\n"));
+  free(text);
+
+  // names are unique, histograms need bounds
+  TEST_ASSERT(metrics_register(&hist) == -1);
+  metric_t same = {.name = "test_latency_seconds", .type = METRIC_COUNTER};
+  TEST_ASSERT(metrics_register(&same) == -1);
+  metric_t no_bounds = {.name = "test_no_bounds", .type = METRIC_HISTOGRAM};
+  TEST_ASSERT(metrics_register(&no_bounds) == -1);
+  TEST_ASSERT(metrics_register(NULL) == -1);
+
+  metrics_unregister(&hist);
+  text = render();
+  TEST_ASSERT_NULL(strstr(text, "test_latency_seconds"));
+  free(text);
+}
+
+void test_metrics_labels() {
+  metrics_reset();
+  metric_observe_label(&g_metric_http_duration, "http://node:8080", 1500);
+  metric_observe_label(&g_metric_http_duration, "http://node:8080", 40000000);
+  metric_add_label(&g_metric_http_errors, "http://node:8080", 1);
+  metric_add_label(&g_metric_http_errors, "a\"b\\c\nd", 1);
+
+  metric_values_t v;
+  TEST_ASSERT(metric_get(&g_metric_http_duration, "http://node:8080", &v) == 0);
+  TEST_ASSERT_EQUAL_UINT64(1, v.buckets[1]);
+  TEST_ASSERT_EQUAL_UINT64(1, v.buckets[g_metric_http_duration.bounds_len]);
+  TEST_ASSERT(metric_get(&g_metric_http_duration, "http://other:8080", &v) == -1);
+
+  char* text = render();
+  TEST_ASSERT_NOT_NULL(strstr(text,
+                              "goshimmer_client_http_request_duration_seconds_bucket{endpoint=\"http://node:8080\","
+                              "le=\"0.001\"} 0\n"
+                              "goshimmer_client_http_request_duration_seconds_bucket{endpoint=\"http://node:8080\","
+                              "le=\"0.0025\"} 1\n"));
+  TEST_ASSERT_NOT_NULL(
+      strstr(text, "goshimmer_client_http_request_duration_seconds_count{endpoint=\"http://node:8080\"} 2\n"));
+  TEST_ASSERT_NOT_NULL(strstr(text, "goshimmer_client_http_errors_total{endpoint=\"http://node:8080\"} 1\n"));
+  TEST_ASSERT_NOT_NULL(strstr(text, "goshimmer_client_http_errors_total{endpoint=\"a\\\"b\\\\c\\nd\"} 1\n"));
+  free(text);
+
+  // the number of series is limited
+  char label[32];
+  for (int i = 0; i < METRICS_MAX_SERIES + 10; i++) {
+    snprintf(label, sizeof(label), "http://node%d", i);
+    metric_add_label(&g_metric_http_errors, label, 1);
+  }
+  TEST_ASSERT(metric_get(&g_metric_http_errors, METRICS_LABEL_OTHER, &v) == 0);
+  TEST_ASSERT_EQUAL_INT64(12, v.value);
+  // a real label value "other" has its own series, the overflow label is reserved
+  metrics_reset();
+  metric_add_label(&g_metric_http_errors, "other", 1);
+  metric_add_label(&g_metric_http_errors, METRICS_LABEL_OTHER, 1);
+  TEST_ASSERT(metric_get(&g_metric_http_errors, "other", &v) == 0);
+  TEST_ASSERT_EQUAL_INT64(1, v.value);
+  TEST_ASSERT(metric_get(&g_metric_http_errors, METRICS_LABEL_OTHER, &v) == -1);
+  metrics_reset();
+  TEST_ASSERT(metric_get(&g_metric_http_errors, "http://node:8080", &v) == -1);
+}
+
+static void* add_fn(void* arg) {
+  for (int i = 0; i < ADDS_PER_THREAD; i++) {
+    metric_add(&g_metric_signatures_created, 1);
+    metric_observe(&g_metric_selection_inputs, 3);
+  }
+  return NULL;
+}
+
+void test_metrics_concurrent() {
+  metrics_reset();
+  pthread_t tid[THREADS];
+  for (int i = 0; i < THREADS; i++) {
+    pthread_create(&tid[i], NULL, add_fn, NULL);
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  metric_values_t v;
+  metric_get(&g_metric_signatures_created, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(THREADS * ADDS_PER_THREAD, v.value);
+  metric_get(&g_metric_selection_inputs, NULL, &v);
+  TEST_ASSERT_EQUAL_UINT64(THREADS * ADDS_PER_THREAD, v.buckets[2]);
+  TEST_ASSERT_EQUAL_UINT64(3 * THREADS * ADDS_PER_THREAD, v.sum);
+
+  // resets while values are updated
+  for (int i = 0; i < THREADS; i++) {
+    pthread_create(&tid[i], NULL, add_fn, NULL);
+  }
+  for (int i = 0; i < 100; i++) {
+    metrics_reset();
+  }
+  for (int i = 0; i < THREADS; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  metric_get(&g_metric_signatures_created, NULL, &v);
+  TEST_ASSERT(v.value <= THREADS * ADDS_PER_THREAD);
+}
+
+void test_metrics_instrumentation() {
+  metrics_reset();
+  byte_t seed[TANGLE_SEED_BYTES] = {};
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(seed, 0, ADDRESS_VER_ED25519, addr);
+  address_get(seed, 1, ADDRESS_VER_ED25519, addr);
+
+  byte_t data[] = "data";
+  byte_t sig[ED_SIGNATURE_BYTES];
+  byte_t pub[ED_PUBLIC_KEY_BYTES];
+  byte_t priv[ED_PRIVATE_KEY_BYTES];
+  sign_signature(seed, 0, data, sizeof(data), sig);
+  address_ed25519_keypair(seed, 0, pub, priv);
+  TEST_ASSERT_TRUE(sign_verify_signature(sig, data, sizeof(data), pub));
+  sig[0] ^= 1;
+  TEST_ASSERT_FALSE(sign_verify_signature(sig, data, sizeof(data), pub));
+
+  metric_values_t v;
+  metric_get(&g_metric_address_derivations, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(2, v.value);
+  metric_get(&g_metric_signatures_created, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(1, v.value);
+  metric_get(&g_metric_signatures_verified, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(2, v.value);
+  metric_get(&g_metric_signature_failures, NULL, &v);
+  TEST_ASSERT_EQUAL_INT64(1, v.value);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_metrics_counter_gauge);
+  RUN_TEST(test_metrics_histogram);
+  RUN_TEST(test_metrics_labels);
+  RUN_TEST(test_metrics_concurrent);
+  RUN_TEST(test_metrics_instrumentation);
+
+  return UNITY_END();
+}
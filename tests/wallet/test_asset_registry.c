@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "unity/unity.h"
+#include "wallet/asset_registry.h"
+
+#define ASSETS 1000
+
+static char const* const g_path = "test_asset_registry.bin";
+
+static void asset_color(byte_t color[], int i) {
+  memset(color, 0, BALANCE_COLOR_BYTES);
+  memcpy(color, &i, sizeof(i));
+  color[BALANCE_COLOR_BYTES - 1] = 0xAB;
+}
+
+static int register_asset(wallet_ar_t* ar, int i, char const* name, char const* symbol, int precision) {
+  wallet_asset_t asset = {};
+  asset_color(asset.color, i);
+  asset.name = iota_str_new(name);
+  asset.symbol = symbol ? iota_str_new(symbol) : NULL;
+  asset.precision = precision;
+  asset.amount = (uint64_t)i;
+  int ret = wallet_ar_register_asset(ar, &asset);
+  iota_str_destroy(asset.name);
+  if (asset.symbol) {
+    iota_str_destroy(asset.symbol);
+  }
+  return ret;
+}
+
+void test_asset_registry() {
+  byte_t color[BALANCE_COLOR_BYTES];
+  char name[32];
+  wallet_ar_t* ar = wallet_ar_new();
+  TEST_ASSERT_NOT_NULL(ar);
+
+  for (int i = 0; i < ASSETS; i++) {
+    sprintf(name, "token %d", i);
+    // symbols are shared by many assets
+    TEST_ASSERT(register_asset(ar, i, name, i % 2 ? "ODD" : NULL, i % 7) == 0);
+  }
+  TEST_ASSERT_EQUAL_UINT32(ASSETS, wallet_ar_count(ar));
+  TEST_ASSERT(ar->capacity * 3 >= ar->count * 4);
+
+  for (int i = 0; i < ASSETS; i++) {
+    asset_color(color, i);
+    sprintf(name, "token %d", i);
+    TEST_ASSERT_EQUAL_STRING(name, wallet_ar_name(ar, color));
+    TEST_ASSERT_EQUAL_INT(i % 7, wallet_ar_precision(ar, color));
+    if (i % 2) {
+      TEST_ASSERT_EQUAL_STRING("ODD", wallet_ar_symbol(ar, color));
+    } else {
+      TEST_ASSERT_NULL(wallet_ar_symbol(ar, color));
+    }
+  }
+  // interned symbols
+  asset_color(color, 1);
+  char const* sym = wallet_ar_symbol(ar, color);
+  asset_color(color, 3);
+  TEST_ASSERT_EQUAL_PTR(sym, wallet_ar_symbol(ar, color));
+
+  // unknown color
+  asset_color(color, ASSETS);
+  TEST_ASSERT_NULL(wallet_ar_find(ar, color));
+  TEST_ASSERT_NULL(wallet_ar_name(ar, color));
+  TEST_ASSERT_EQUAL_INT(-1, wallet_ar_precision(ar, color));
+
+  // replaces an asset
+  TEST_ASSERT(register_asset(ar, 10, "renamed", "NEW", 2) == 0);
+  TEST_ASSERT_EQUAL_UINT32(ASSETS, wallet_ar_count(ar));
+  asset_color(color, 10);
+  TEST_ASSERT_EQUAL_STRING("renamed", wallet_ar_name(ar, color));
+
+  // removes half of them, the others are still reachable
+  for (int i = 0; i < ASSETS; i += 2) {
+    asset_color(color, i);
+    TEST_ASSERT(wallet_ar_remove(ar, color) == 0);
+  }
+  TEST_ASSERT(wallet_ar_remove(ar, color) == -1);
+  TEST_ASSERT_EQUAL_UINT32(ASSETS / 2, wallet_ar_count(ar));
+  for (int i = 0; i < ASSETS; i++) {
+    asset_color(color, i);
+    TEST_ASSERT((wallet_ar_find(ar, color) != NULL) == (i % 2 == 1));
+  }
+
+  // an asset name is required
+  wallet_asset_t nameless = {};
+  TEST_ASSERT(wallet_ar_register_asset(ar, &nameless) == -1);
+
+  wallet_ar_free(ar);
+}
+
+void test_asset_registry_format() {
+  char buf[64];
+  byte_t color[BALANCE_COLOR_BYTES];
+  wallet_ar_t* ar = wallet_ar_new();
+  TEST_ASSERT_NOT_NULL(ar);
+  TEST_ASSERT(register_asset(ar, 1, "Euro", "EUR", 2) == 0);
+  TEST_ASSERT(register_asset(ar, 2, "Apple", NULL, 0) == 0);
+
+  asset_color(color, 1);
+  TEST_ASSERT(wallet_ar_format_balance(ar, color, 1205, buf, sizeof(buf)) == 0);
+  TEST_ASSERT_EQUAL_STRING("12.05 EUR", buf);
+  TEST_ASSERT(wallet_ar_format_balance(ar, color, -7, buf, sizeof(buf)) == 0);
+  TEST_ASSERT_EQUAL_STRING("-0.07 EUR", buf);
+  TEST_ASSERT(wallet_ar_format_balance(ar, color, 1205, buf, 4) == -1);
+
+  asset_color(color, 2);
+  TEST_ASSERT(wallet_ar_format_balance(ar, color, 3, buf, sizeof(buf)) == 0);
+  TEST_ASSERT_EQUAL_STRING("3 Apple", buf);
+
+  // unregistered
+  asset_color(color, 3);
+  TEST_ASSERT(wallet_ar_format_balance(ar, color, 42, buf, sizeof(buf)) == 0);
+  TEST_ASSERT_EQUAL_STRING("42", buf);
+
+  wallet_ar_free(ar);
+}
+
+void test_asset_registry_file() {
+  byte_t color[BALANCE_COLOR_BYTES];
+  char name[32];
+  wallet_ar_t* ar = wallet_ar_new();
+  TEST_ASSERT_NOT_NULL(ar);
+  for (int i = 0; i < 100; i++) {
+    sprintf(name, "token %d", i);
+    TEST_ASSERT(register_asset(ar, i, name, "SYM", 3) == 0);
+  }
+  TEST_ASSERT(wallet_ar_save(ar, g_path) == 0);
+  wallet_ar_free(ar);
+
+  ar = wallet_ar_load(g_path);
+  TEST_ASSERT_NOT_NULL(ar);
+  TEST_ASSERT_NOT_NULL(ar->map);
+  TEST_ASSERT_EQUAL_UINT32(100, wallet_ar_count(ar));
+  for (int i = 0; i < 100; i++) {
+    asset_color(color, i);
+    sprintf(name, "token %d", i);
+    TEST_ASSERT_EQUAL_STRING(name, wallet_ar_name(ar, color));
+    TEST_ASSERT_EQUAL_STRING("SYM", wallet_ar_symbol(ar, color));
+    TEST_ASSERT_EQUAL_UINT64(i, wallet_ar_find(ar, color)->amount);
+  }
+
+  // the first change copies the mapped file, interned strings are found again
+  TEST_ASSERT(register_asset(ar, 100, "token 100", "SYM", 3) == 0);
+  TEST_ASSERT_NULL(ar->map);
+  asset_color(color, 0);
+  char const* sym = wallet_ar_symbol(ar, color);
+  asset_color(color, 100);
+  TEST_ASSERT_EQUAL_PTR(sym, wallet_ar_symbol(ar, color));
+  TEST_ASSERT_EQUAL_UINT32(101, wallet_ar_count(ar));
+  wallet_ar_free(ar);
+
+  // a corrupted file is rejected
+  FILE* f = fopen(g_path, "r+b");
+  TEST_ASSERT_NOT_NULL(f);
+  fwrite("GSAX", 1, 4, f);
+  fclose(f);
+  TEST_ASSERT_NULL(wallet_ar_load(g_path));
+  TEST_ASSERT_NULL(wallet_ar_load("no_such_file.bin"));
+  remove(g_path);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_asset_registry);
+  RUN_TEST(test_asset_registry_format);
+  RUN_TEST(test_asset_registry_file);
+
+  return UNITY_END();
+}
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client/ledger_sim.h"
+#include "test_utils.h"
+#include "unity/unity.h"
+#include "wallet/consolidation.h"
+#include "wallet/wallet.h"
+
+#define DUST_OUTPUTS 20
+
+static byte_t g_dust[BALANCE_COLOR_BYTES] = {};
+static byte_t g_token[BALANCE_COLOR_BYTES] = {0xC0, 0x10, 0x4};
+
+// dust outputs of 1 to 20 spread across 4 addresses, 3 outputs of a token, and a pending dust output.
+static unspent_outputs_t* build_table(byte_t addr[][TANGLE_ADDRESS_BYTES]) {
+  unspent_outputs_t* t = unspent_outputs_init();
+  for (int a = 0; a < 4; a++) {
+    randombytes_buf((void* const)addr[a], TANGLE_ADDRESS_BYTES);
+    for (int i = a; i < DUST_OUTPUTS; i += 4) {
+      test_add_output(&t, addr[a], a, g_dust, i + 1, true, NULL);
+    }
+    if (a < 3) {
+      test_add_output(&t, addr[a], a, g_token, 1000, true, NULL);
+    }
+    if (a == 0) {
+      test_add_output(&t, addr[a], a, g_dust, 1, false, NULL);
+    }
+  }
+  return t;
+}
+
+static size_t selected_outputs(unspent_outputs_t* sel) {
+  size_t n = 0;
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, sel, elm, tmp) { n += output_ids_count(&elm->ids); }
+  return n;
+}
+
+void test_sweep_select() {
+  byte_t addr[4][TANGLE_ADDRESS_BYTES];
+  byte_t color[BALANCE_COLOR_BYTES];
+  unspent_outputs_t* t = build_table(addr);
+  output_reservation_t* r = reservation_new();
+  TEST_ASSERT_EQUAL_UINT32(DUST_OUTPUTS + 3, sweep_free_outputs(r, &t));
+
+  sweep_policy_t p;
+  sweep_policy_init(&p);
+  p.min_outputs = 10;
+  p.max_inputs = 8;
+
+  // the smallest dust outputs go first
+  uint32_t a = reservation_ticket(r);
+  unspent_outputs_t* sel_a = sweep_select(r, a, &t, &p, color);
+  TEST_ASSERT_NOT_NULL(sel_a);
+  TEST_ASSERT_EQUAL_MEMORY(g_dust, color, BALANCE_COLOR_BYTES);
+  TEST_ASSERT_EQUAL_UINT32(8, selected_outputs(sel_a));
+  TEST_ASSERT_EQUAL_UINT64(36, unspent_outputs_balance_with_color(&sel_a, g_dust));
+  TEST_ASSERT_EQUAL_UINT32(8, reservation_count(r));
+
+  // back to back sweeps don't share inputs
+  uint32_t b = reservation_ticket(r);
+  unspent_outputs_t* sel_b = sweep_select(r, b, &t, &p, color);
+  TEST_ASSERT_EQUAL_UINT32(8, selected_outputs(sel_b));
+  TEST_ASSERT_EQUAL_UINT64(100, unspent_outputs_balance_with_color(&sel_b, g_dust));
+
+  // 4 dust outputs are left, not worth a sweep
+  uint32_t c = reservation_ticket(r);
+  TEST_ASSERT_NULL(sweep_select(r, c, &t, &p, color));
+  TEST_ASSERT_EQUAL_UINT32(16, reservation_count(r));
+
+  // released outputs are selectable again
+  reservation_release(r, b);
+  unspent_outputs_free(&sel_b);
+  sel_b = sweep_select(r, b, &t, &p, color);
+  TEST_ASSERT_EQUAL_UINT32(8, selected_outputs(sel_b));
+
+  unspent_outputs_free(&sel_a);
+  unspent_outputs_free(&sel_b);
+  unspent_outputs_free(&t);
+  reservation_free(r);
+}
+
+void test_sweep_policy() {
+  byte_t addr[4][TANGLE_ADDRESS_BYTES];
+  byte_t color[BALANCE_COLOR_BYTES];
+  unspent_outputs_t* t = build_table(addr);
+  output_reservation_t* r = reservation_new();
+
+  sweep_policy_t p;
+  sweep_policy_init(&p);
+  TEST_ASSERT_TRUE(sweep_policy_valid(&p));
+  // the minimum is not reached
+  p.min_outputs = DUST_OUTPUTS + 1;
+  TEST_ASSERT_NULL(sweep_select(r, reservation_ticket(r), &t, &p, color));
+
+  // invalid limits
+  p.max_inputs = SWEEP_MAX_INPUTS + 1;
+  TEST_ASSERT_FALSE(sweep_policy_valid(&p));
+  TEST_ASSERT_NULL(sweep_select(r, reservation_ticket(r), &t, &p, color));
+  p.max_inputs = SWEEP_MAX_INPUTS;
+  p.min_outputs = 1;
+  TEST_ASSERT_FALSE(sweep_policy_valid(&p));
+
+  // only dust below the threshold
+  p.min_outputs = 2;
+  p.dust_value = 5;
+  unspent_outputs_t* sel = sweep_select(r, reservation_ticket(r), &t, &p, color);
+  TEST_ASSERT_EQUAL_UINT32(5, selected_outputs(sel));
+  TEST_ASSERT_EQUAL_UINT64(15, unspent_outputs_balance_with_color(&sel, g_dust));
+  unspent_outputs_free(&sel);
+
+  // spent addresses are skipped
+  p.dust_value = 0;
+  p.min_outputs = 3;
+  for (int i = 0; i < 4; i++) {
+    unspent_outputs_set_spent(&t, addr[i], true);
+  }
+  TEST_ASSERT_NULL(sweep_select(r, reservation_ticket(r), &t, &p, color));
+  for (int i = 0; i < 4; i++) {
+    unspent_outputs_set_spent(&t, addr[i], false);
+  }
+
+  // the rest of dust outputs, then the token is the most fragmented color
+  sel = sweep_select(r, reservation_ticket(r), &t, &p, color);
+  TEST_ASSERT_EQUAL_MEMORY(g_dust, color, BALANCE_COLOR_BYTES);
+  TEST_ASSERT_EQUAL_UINT32(DUST_OUTPUTS - 5, selected_outputs(sel));
+  unspent_outputs_free(&sel);
+  sel = sweep_select(r, reservation_ticket(r), &t, &p, color);
+  TEST_ASSERT_EQUAL_MEMORY(g_token, color, BALANCE_COLOR_BYTES);
+  TEST_ASSERT_EQUAL_UINT32(3, selected_outputs(sel));
+  TEST_ASSERT_EQUAL_UINT64(3000, unspent_outputs_balance_with_color(&sel, g_token));
+  unspent_outputs_free(&sel);
+  TEST_ASSERT_NULL(sweep_select(r, reservation_ticket(r), &t, &p, color));
+  TEST_ASSERT_EQUAL_UINT32(0, sweep_free_outputs(r, &t));
+
+  unspent_outputs_free(&t);
+  reservation_free(r);
+}
+
+// a wallet of addresses 0 and 1 with two dust outputs each, 1 and 2 on address 0, 3 and 4 on address 1
+static wallet_t* dust_wallet(ledger_sim_t* sim, test_gate_t* gate, byte_t const seed[]) {
+  for (uint64_t i = 0; i < 4; i++) {
+    test_fund(sim, seed, i / 2, i + 1);
+  }
+  wallet_t* w = wallet_open("http://ledger.sim/", 0, seed, 1, 0, 1);
+  TEST_ASSERT_NOT_NULL(w);
+  wallet_set_transport(w, &gate->transport);
+  TEST_ASSERT_TRUE(wallet_refresh(w, false));
+  TEST_ASSERT_EQUAL_UINT64(10, wallet_balance_cached(w, NULL));
+
+  sweep_policy_t p;
+  sweep_policy_init(&p);
+  p.min_outputs = 2;
+  p.max_inputs = 2;
+  p.idle_ms = 0;
+  p.max_txs = 2;
+  TEST_ASSERT(wallet_set_sweep_policy(w, &p) == 0);
+  return w;
+}
+
+void test_sweep_after_failed_refresh() {
+  byte_t seed[TANGLE_SEED_BYTES] = {1};
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  test_gate_t g;
+  test_gate_init(&g, sim);
+  wallet_t* w = dust_wallet(sim, &g, seed);
+
+  // the refresher doesn't sweep stale state
+  test_gate_fail(&g, true);
+  TEST_ASSERT_FALSE(wallet_refresh(w, false));
+  TEST_ASSERT(wallet_refresher_start(w, 10, 0) == 0);
+  usleep(100 * 1000);
+  wallet_refresher_stop(w);
+  TEST_ASSERT(test_gate_refreshes(&g) > 3);
+  TEST_ASSERT_EQUAL_UINT32(0, test_gate_sends(&g));
+
+  // it sweeps after a successful refresh
+  test_gate_fail(&g, false);
+  TEST_ASSERT(wallet_refresher_start(w, 10, 0) == 0);
+  usleep(100 * 1000);
+  wallet_refresher_stop(w);
+  TEST_ASSERT(test_gate_sends(&g) > 0);
+
+  wallet_free(w);
+  ledger_sim_free(sim);
+}
+
+void test_wallet_consolidate() {
+  byte_t seed[TANGLE_SEED_BYTES] = {2};
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  test_gate_t g;
+  test_gate_init(&g, sim);
+  wallet_t* w = dust_wallet(sim, &g, seed);
+
+  // the first sweep spends address 0, the second one address 1, each pays to a new address
+  TEST_ASSERT_EQUAL_INT(2, wallet_consolidate(w, 5));
+  TEST_ASSERT_EQUAL_UINT32(2, test_gate_sends(&g));
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  for (uint64_t i = 0; i < 2; i++) {
+    address_get(seed, i, ADDRESS_VER_ED25519, addr);
+    TEST_ASSERT_EQUAL_UINT64(0, ledger_sim_balance(sim, addr, NULL));
+  }
+  address_get(seed, 2, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT_EQUAL_UINT64(3, ledger_sim_balance(sim, addr, NULL));
+  address_get(seed, 3, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT_EQUAL_UINT64(7, ledger_sim_balance(sim, addr, NULL));
+
+  // no funds are lost to spent addresses, a refresh without them finds all of them
+  TEST_ASSERT_EQUAL_UINT64(10, wallet_balance(w));
+  // the outputs of both sweeps are swept into one
+  TEST_ASSERT_EQUAL_INT(1, wallet_consolidate(w, 5));
+  TEST_ASSERT_EQUAL_UINT64(10, wallet_balance(w));
+  TEST_ASSERT_EQUAL_INT(0, wallet_consolidate(w, 5));
+  // no reservation is left behind on the spent addresses
+  TEST_ASSERT_EQUAL_UINT32(0, reservation_count(w->reserved));
+
+  wallet_free(w);
+  ledger_sim_free(sim);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_sweep_select);
+  RUN_TEST(test_sweep_policy);
+  RUN_TEST(test_sweep_after_failed_refresh);
+  RUN_TEST(test_wallet_consolidate);
+
+  return UNITY_END();
+}
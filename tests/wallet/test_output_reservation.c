@@ -0,0 +1,187 @@
+#include <stdio.h>
+
+#include "test_utils.h"
+#include "unity/unity.h"
+#include "wallet/output_reservation.h"
+
+// two addresses with two confirmed outputs of 100 each, and a pending output.
+static unspent_outputs_t* build_table(byte_t addr[][TANGLE_ADDRESS_BYTES], byte_t tx[][TX_ID_BYTES]) {
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  unspent_outputs_t* t = unspent_outputs_init();
+  for (int i = 0; i < 2; i++) {
+    randombytes_buf((void* const)addr[i], TANGLE_ADDRESS_BYTES);
+    test_add_output(&t, addr[i], i, color, 100, true, tx[i * 2]);
+    test_add_output(&t, addr[i], i, color, 100, true, tx[i * 2 + 1]);
+    if (i == 1) {
+      test_add_output(&t, addr[i], i, color, 100, false, tx[4]);
+    }
+  }
+  return t;
+}
+
+static uint64_t selected_balance(unspent_outputs_t* sel) {
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  return unspent_outputs_balance_with_color(&sel, color);
+}
+
+void test_reservation_take_release() {
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  output_reservation_t* r = reservation_new();
+  TEST_ASSERT_NOT_NULL(r);
+
+  uint32_t ticket = reservation_ticket(r);
+  TEST_ASSERT(ticket != 0);
+  TEST_ASSERT(reservation_ticket(r) != ticket);
+
+  TEST_ASSERT_FALSE(reservation_is_reserved(r, addr, tx_id));
+  TEST_ASSERT(reservation_take(r, ticket, addr, tx_id) == 0);
+  TEST_ASSERT_TRUE(reservation_is_reserved(r, addr, tx_id));
+  // can't reserve twice
+  TEST_ASSERT(reservation_take(r, ticket + 1, addr, tx_id) == -1);
+
+  reservation_release(r, ticket);
+  TEST_ASSERT_FALSE(reservation_is_reserved(r, addr, tx_id));
+  TEST_ASSERT_EQUAL_UINT32(0, reservation_count(r));
+
+  reservation_free(r);
+}
+
+void test_reservation_select() {
+  byte_t addr[2][TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx[5][TX_ID_BYTES] = {};
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  unspent_outputs_t* t = build_table(addr, tx);
+  output_reservation_t* r = reservation_new();
+
+  // back to back selections don't share inputs
+  uint32_t a = reservation_ticket(r);
+  unspent_outputs_t* sel_a = reservation_select(r, a, &t, 150, color);
+  TEST_ASSERT_EQUAL_UINT64(200, selected_balance(sel_a));
+  uint32_t b = reservation_ticket(r);
+  unspent_outputs_t* sel_b = reservation_select(r, b, &t, 150, color);
+  TEST_ASSERT_EQUAL_UINT64(200, selected_balance(sel_b));
+  TEST_ASSERT_EQUAL_UINT32(4, reservation_count(r));
+
+  // pending outputs are not selectable
+  uint32_t c = reservation_ticket(r);
+  unspent_outputs_t* sel_c = reservation_select(r, c, &t, 1, color);
+  TEST_ASSERT_NULL(sel_c);
+
+  // a released ticket frees its outputs
+  reservation_release(r, a);
+  TEST_ASSERT_EQUAL_UINT32(2, reservation_count(r));
+  sel_c = reservation_select(r, c, &t, 200, color);
+  TEST_ASSERT_EQUAL_UINT64(200, selected_balance(sel_c));
+  unspent_outputs_free(&sel_c);
+
+  // committed outputs stay reserved until the node consumed them
+  reservation_commit(r, b);
+  reservation_release(r, c);
+  unspent_outputs_t *elm, *tmp;
+  HASH_ITER(hh, sel_b, elm, tmp) {
+    unspent_outputs_t* entry = unspent_outputs_find(&t, elm->addr);
+    output_ids_t *id, *id_tmp;
+    HASH_ITER(hh, elm->ids, id, id_tmp) { output_ids_remove(&entry->ids, id->id); }
+  }
+  reservation_prune(r, &t);
+  TEST_ASSERT_EQUAL_UINT32(0, reservation_count(r));
+
+  unspent_outputs_free(&sel_a);
+  unspent_outputs_free(&sel_b);
+  unspent_outputs_free(&t);
+  reservation_free(r);
+}
+
+void test_reservation_select_colors() {
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  byte_t iota[BALANCE_COLOR_BYTES] = {};
+  byte_t color_a[BALANCE_COLOR_BYTES] = {};
+  byte_t color_b[BALANCE_COLOR_BYTES] = {};
+  inclusion_state_t st = {.confirmed = true};
+  balance_color_random(color_a);
+  balance_color_random(color_b);
+
+  // an iota output, a color_a output, and an output with both color_a and color_b
+  unspent_outputs_t* t = unspent_outputs_init();
+  output_ids_t* ids = output_ids_init();
+  balance_ht_t* bals = balance_ht_init();
+  balance_ht_add(&bals, iota, 100);
+  randombytes_buf((void* const)tx_id, TX_ID_BYTES);
+  output_ids_add(&ids, tx_id, bals, &st);
+  balance_ht_free(&bals);
+  balance_ht_add(&bals, color_a, 10);
+  randombytes_buf((void* const)tx_id, TX_ID_BYTES);
+  output_ids_add(&ids, tx_id, bals, &st);
+  balance_ht_add(&bals, color_b, 5);
+  randombytes_buf((void* const)tx_id, TX_ID_BYTES);
+  output_ids_add(&ids, tx_id, bals, &st);
+  balance_ht_free(&bals);
+  randombytes_buf((void* const)addr, TANGLE_ADDRESS_BYTES);
+  unspent_outputs_add(&t, addr, 0, ids);
+  output_ids_free(&ids);
+
+  output_reservation_t* r = reservation_new();
+  balance_ht_t* required = balance_ht_init();
+  balance_ht_add(&required, iota, 50);
+  balance_ht_add(&required, color_b, 5);
+
+  // one selection covers both colors
+  uint32_t ticket = reservation_ticket(r);
+  unspent_outputs_t* sel = reservation_select_colors(r, ticket, &t, &required);
+  TEST_ASSERT_NOT_NULL(sel);
+  TEST_ASSERT_EQUAL_UINT64(100, unspent_outputs_balance_with_color(&sel, iota));
+  TEST_ASSERT_EQUAL_UINT64(5, unspent_outputs_balance_with_color(&sel, color_b));
+  // color_a comes along with color_b, the color_a only output is not selected
+  TEST_ASSERT_EQUAL_UINT64(10, unspent_outputs_balance_with_color(&sel, color_a));
+  TEST_ASSERT_EQUAL_UINT32(2, reservation_count(r));
+
+  // the required table is not changed
+  TEST_ASSERT_EQUAL_INT64(50, balance_ht_find(&required, iota)->value);
+
+  unspent_outputs_free(&sel);
+  balance_ht_free(&required);
+  unspent_outputs_free(&t);
+  reservation_free(r);
+}
+
+void test_reservation_addr_exhausted() {
+  byte_t addr[2][TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx[5][TX_ID_BYTES] = {};
+  unspent_outputs_t* t = build_table(addr, tx);
+  output_reservation_t* r = reservation_new();
+
+  unspent_outputs_t* elm = unspent_outputs_find(&t, addr[0]);
+  uint32_t ticket = reservation_ticket(r);
+  reservation_take(r, ticket, addr[0], tx[0]);
+  TEST_ASSERT_FALSE(reservation_addr_exhausted(r, elm));
+  reservation_take(r, ticket, addr[0], tx[1]);
+  TEST_ASSERT_TRUE(reservation_addr_exhausted(r, elm));
+
+  // uncommitted outputs are kept after a refresh
+  reservation_prune(r, &t);
+  TEST_ASSERT_EQUAL_UINT32(2, reservation_count(r));
+
+  // committed outputs of a spent address are dropped though the address still lists them
+  reservation_commit(r, ticket);
+  reservation_prune(r, &t);
+  TEST_ASSERT_EQUAL_UINT32(2, reservation_count(r));
+  unspent_outputs_set_spent(&t, addr[0], true);
+  reservation_prune(r, &t);
+  TEST_ASSERT_EQUAL_UINT32(0, reservation_count(r));
+
+  unspent_outputs_free(&t);
+  reservation_free(r);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_reservation_take_release);
+  RUN_TEST(test_reservation_select);
+  RUN_TEST(test_reservation_select_colors);
+  RUN_TEST(test_reservation_addr_exhausted);
+
+  return UNITY_END();
+}
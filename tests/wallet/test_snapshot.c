@@ -0,0 +1,169 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+#include "unity/unity.h"
+#include "wallet/wallet.h"
+
+#define READERS 4
+#define PUBLISHES 2000
+
+typedef struct {
+  snapshot_rcu_t* rcu;
+  bool volatile* stop;
+  uint64_t reads;
+  uint64_t errors;
+} reader_ctx_t;
+
+// readers check that a pinned snapshot is consistent and versions never go backwards.
+static void* reader_fn(void* arg) {
+  reader_ctx_t* ctx = (reader_ctx_t*)arg;
+  uint64_t last_version = 0;
+  while (!__atomic_load_n(ctx->stop, __ATOMIC_SEQ_CST)) {
+    snapshot_read_t r;
+    wallet_snapshot_t const* snap = snapshot_read_begin(ctx->rcu, &r);
+    if (snap->version < last_version ||
+        snap->balance != utxo_store_balance(snap->store, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT) ||
+        utxo_store_len(snap->store) != snap->version % 16) {
+      ctx->errors++;
+    }
+    last_version = snap->version;
+    snapshot_read_end(ctx->rcu, &r);
+    __atomic_add_fetch(&ctx->reads, 1, __ATOMIC_SEQ_CST);
+  }
+  return NULL;
+}
+
+void test_snapshot_publish() {
+  snapshot_rcu_t rcu;
+  TEST_ASSERT(snapshot_rcu_init(&rcu) == 0);
+
+  snapshot_read_t r;
+  wallet_snapshot_t const* snap = snapshot_read_begin(&rcu, &r);
+  TEST_ASSERT_EQUAL_UINT64(0, snap->version);
+  snapshot_read_end(&rcu, &r);
+
+  wallet_snapshot_t* next = snapshot_writable(&rcu);
+  TEST_ASSERT_NOT_NULL(next);
+  next->balance = 10;
+  snapshot_publish(&rcu, next);
+
+  snap = snapshot_read_begin(&rcu, &r);
+  TEST_ASSERT_EQUAL_UINT64(1, snap->version);
+  TEST_ASSERT_EQUAL_UINT64(10, snap->balance);
+  snapshot_read_end(&rcu, &r);
+
+  // the replaced snapshot is reused by the next writer
+  wallet_snapshot_t* spare = rcu.spare;
+  TEST_ASSERT_NOT_NULL(spare);
+  TEST_ASSERT_EQUAL_PTR(spare, snapshot_writable(&rcu));
+  snapshot_discard(&rcu, spare);
+
+  snapshot_rcu_destroy(&rcu);
+}
+
+void test_snapshot_stress() {
+  byte_t addr[TANGLE_ADDRESS_BYTES] = {};
+  byte_t tx_id[TX_ID_BYTES] = {};
+  byte_t color[BALANCE_COLOR_BYTES] = {};
+  snapshot_rcu_t rcu;
+  TEST_ASSERT(snapshot_rcu_init(&rcu) == 0);
+
+  bool volatile stop = false;
+  pthread_t tid[READERS];
+  reader_ctx_t ctx[READERS] = {};
+  for (int i = 0; i < READERS; i++) {
+    ctx[i].rcu = &rcu;
+    ctx[i].stop = &stop;
+    TEST_ASSERT(pthread_create(&tid[i], NULL, reader_fn, &ctx[i]) == 0);
+  }
+
+  // the writer publishes snapshots with (version % 16) rows
+  for (uint64_t v = 1; v <= PUBLISHES; v++) {
+    wallet_snapshot_t* next = snapshot_writable(&rcu);
+    utxo_store_clear(next->store);
+    uint32_t slot = 0;
+    utxo_store_add_slot(next->store, addr, 0, &slot);
+    for (uint64_t i = 0; i < v % 16; i++) {
+      utxo_store_add(next->store, slot, tx_id, color, (int64_t)(v + i), i % 3 ? INCLUSION_CONFIRMED : 0);
+    }
+    next->balance = utxo_store_balance(next->store, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT);
+    snapshot_publish(&rcu, next);
+  }
+
+  // readers may not be scheduled yet on a single core
+  for (int i = 0; i < READERS; i++) {
+    while (__atomic_load_n(&ctx[i].reads, __ATOMIC_SEQ_CST) == 0) {
+      sched_yield();
+    }
+  }
+  __atomic_store_n(&stop, true, __ATOMIC_SEQ_CST);
+  uint64_t reads = 0;
+  for (int i = 0; i < READERS; i++) {
+    pthread_join(tid[i], NULL);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx[i].errors);
+    reads += ctx[i].reads;
+  }
+  TEST_ASSERT(reads > 0);
+  TEST_ASSERT_EQUAL_UINT64(PUBLISHES, rcu.current->version);
+
+  snapshot_rcu_destroy(&rcu);
+}
+
+static uint64_t g_wallet_read_errors = 0;
+
+static void* wallet_reader_fn(void* arg) {
+  wallet_t* w = (wallet_t*)arg;
+  for (int i = 0; i < 2000; i++) {
+    snapshot_read_t r;
+    wallet_snapshot_t const* snap = wallet_snapshot_acquire(w, &r);
+    if (snap->balance != utxo_store_balance(snap->store, INCLUSION_CONFIRMED, UTXO_LOCAL_SPENT)) {
+      __atomic_fetch_add(&g_wallet_read_errors, 1, __ATOMIC_SEQ_CST);
+    }
+    wallet_snapshot_release(w, &r);
+    wallet_balance_cached(w, NULL);
+  }
+  return NULL;
+}
+
+static void* wallet_writer_fn(void* arg) {
+  wallet_t* w = (wallet_t*)arg;
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  for (int i = 0; i < 20; i++) {
+    wallet_new_receive_address(w, addr);
+    addr_list_free(wallet_unspent_addresses(w));
+  }
+  return NULL;
+}
+
+void test_wallet_concurrent_access() {
+  byte_t seed[TANGLE_SEED_BYTES] = {};
+  // a closed local port, refreshing fails without leaving the host
+  wallet_t* w = wallet_init("http://127.0.0.1:1/", 0, seed, 3, 0, 3);
+  TEST_ASSERT_NOT_NULL(w);
+
+  pthread_t tid[4];
+  pthread_create(&tid[0], NULL, wallet_reader_fn, w);
+  pthread_create(&tid[1], NULL, wallet_reader_fn, w);
+  pthread_create(&tid[2], NULL, wallet_writer_fn, w);
+  pthread_create(&tid[3], NULL, wallet_writer_fn, w);
+  for (int i = 0; i < 4; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  TEST_ASSERT_EQUAL_UINT64(0, g_wallet_read_errors);
+  // all new addresses are tracked
+  TEST_ASSERT_EQUAL_UINT64(43, w->addr_manager->last_addr_index);
+  TEST_ASSERT_EQUAL_UINT32(44, unspent_outputs_count(&w->unspent));
+
+  wallet_free(w);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_snapshot_publish);
+  RUN_TEST(test_snapshot_stress);
+  RUN_TEST(test_wallet_concurrent_access);
+
+  return UNITY_END();
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+
+#include "unity/unity.h"
+#include "wallet/unsigned_tx.h"
+
+static byte_t g_seed[TANGLE_SEED_BYTES];
+
+// two inputs on each of two addresses, one output with two colors.
+static wallet_utx_t* build_utx() {
+  wallet_utx_t* utx = utx_new();
+  TEST_ASSERT_NOT_NULL(utx);
+  utx->ticket = 42;
+
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  byte_t output_id[TX_OUTPUT_ID_BYTES];
+  for (uint64_t i = 1; i <= 2; i++) {
+    address_get(g_seed, i, ADDRESS_VER_ED25519, addr);
+    utx_add_signer(utx, addr, i);
+    for (int j = 0; j < 2; j++) {
+      memcpy(output_id, addr, TANGLE_ADDRESS_BYTES);
+      tx_id_random(output_id + TANGLE_ADDRESS_BYTES);
+      tx_inputs_push(utx->tx.inputs, output_id);
+    }
+  }
+
+  tx_output_t out = {};
+  address_get(g_seed, 3, ADDRESS_VER_ED25519, out.address);
+  out.addr_index = 3;
+  out.balances = balance_list_new();
+  balance_t bal = {};
+  bal.value = 1000;
+  balance_list_push(out.balances, &bal);
+  memset(bal.color, 0xAB, BALANCE_COLOR_BYTES);
+  bal.value = 7;
+  balance_list_push(out.balances, &bal);
+  tx_outputs_push(utx->tx.outputs, &out);
+  balance_list_free(out.balances);
+  return utx;
+}
+
+static void assert_same_essence(wallet_utx_t* a, wallet_utx_t* b) {
+  byte_buf_t* ea = tx_essence(&a->tx);
+  byte_buf_t* eb = tx_essence(&b->tx);
+  TEST_ASSERT_EQUAL_UINT32(ea->len, eb->len);
+  TEST_ASSERT_EQUAL_MEMORY(ea->data, eb->data, ea->len);
+  byte_buf_free(ea);
+  byte_buf_free(eb);
+}
+
+void test_utx_stages() {
+  wallet_utx_t* utx = build_utx();
+  TEST_ASSERT_FALSE(utx_is_signed(utx));
+
+  // the builder hands an unsigned transaction to a signer
+  byte_buf_t* buf = byte_buf_new();
+  TEST_ASSERT(utx_serialize(utx, buf) == 0);
+  TEST_ASSERT_EQUAL_MEMORY("GSUT", buf->data, 4);
+  wallet_utx_t* unsigned_tx = utx_deserialize(buf->data, buf->len);
+  TEST_ASSERT_NOT_NULL(unsigned_tx);
+  TEST_ASSERT_EQUAL_UINT32(42, unsigned_tx->ticket);
+  TEST_ASSERT_EQUAL_UINT32(2, utx_signers_len(unsigned_tx));
+  TEST_ASSERT_EQUAL_UINT32(4, tx_inputs_len(unsigned_tx->tx.inputs));
+  assert_same_essence(utx, unsigned_tx);
+
+  // the signer hands a signed transaction to a submitter
+  TEST_ASSERT(utx_sign(unsigned_tx, g_seed) == 0);
+  TEST_ASSERT_TRUE(utx_is_signed(unsigned_tx));
+  TEST_ASSERT_TRUE(tx_signautres_valid(&unsigned_tx->tx));
+  byte_buf_free(buf);
+  buf = byte_buf_new();
+  TEST_ASSERT(utx_serialize(unsigned_tx, buf) == 0);
+  wallet_utx_t* signed_tx = utx_deserialize(buf->data, buf->len);
+  TEST_ASSERT_NOT_NULL(signed_tx);
+  TEST_ASSERT_TRUE(utx_is_signed(signed_tx));
+  TEST_ASSERT_TRUE(tx_signautres_valid(&signed_tx->tx));
+  assert_same_essence(utx, signed_tx);
+
+  // signing again replaces signatures
+  TEST_ASSERT(utx_sign(signed_tx, g_seed) == 0);
+  TEST_ASSERT_EQUAL_UINT32(2, ed_signatures_count(&signed_tx->tx.signatures));
+
+  // an unsigned transaction is not submitted
+  tangle_client_conf_t conf = {.url = "http://localhost/", .port = 0};
+  TEST_ASSERT(utx_submit(&conf, utx, NULL) == -1);
+
+  utx_free(utx);
+  utx_free(unsigned_tx);
+  utx_free(signed_tx);
+  byte_buf_free(buf);
+}
+
+void test_utx_invalid() {
+  wallet_utx_t* utx = build_utx();
+  byte_buf_t* buf = byte_buf_new();
+  TEST_ASSERT(utx_serialize(utx, buf) == 0);
+
+  // truncated data or trailing bytes
+  for (size_t len = 0; len < buf->len; len += 7) {
+    TEST_ASSERT_NULL(utx_deserialize(buf->data, len));
+  }
+  byte_t zero = 0;
+  byte_buf_append(buf, &zero, 1);
+  TEST_ASSERT_NULL(utx_deserialize(buf->data, buf->len));
+  buf->len--;
+
+  // unknown version
+  buf->data[4] = UTX_FORMAT_VERSION + 1;
+  TEST_ASSERT_NULL(utx_deserialize(buf->data, buf->len));
+  buf->data[4] = UTX_FORMAT_VERSION;
+  wallet_utx_t* n = utx_deserialize(buf->data, buf->len);
+  TEST_ASSERT_NOT_NULL(n);
+
+  // nothing to sign
+  wallet_utx_t* empty = utx_new();
+  TEST_ASSERT(utx_sign(empty, g_seed) == -1);
+
+  utx_free(empty);
+  utx_free(n);
+  utx_free(utx);
+  byte_buf_free(buf);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  randombytes_buf(g_seed, TANGLE_SEED_BYTES);
+  RUN_TEST(test_utx_stages);
+  RUN_TEST(test_utx_invalid);
+
+  return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#ifndef __WALLET_TEST_UTILS_H__
+#define __WALLET_TEST_UTILS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client/ledger_sim.h"
+#include "unity/unity.h"
+#include "wallet/wallet.h"
+
+// forwards requests to a ledger simulator, unspent output requests are counted and can be failed, sent transactions
+// are counted. The test and the wallet threads share it atomically.
+typedef struct {
+  http_transport_t transport;  // the transport given to wallets
+  http_transport_t const* sim;
+  bool fail_refresh;
+  uint32_t refreshes;
+  uint32_t sends;
+} test_gate_t;
+
+static inline int test_gate_perform(http_transport_t const* t, http_client_config_t const* config,
+                                    byte_buf_t const* request, http_write_fn write_fn, void* ctx) {
+  test_gate_t* g = (test_gate_t*)t->ctx;
+  if (strstr(config->url, "value/unspentOutputs")) {
+    __atomic_fetch_add(&g->refreshes, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g->fail_refresh, __ATOMIC_SEQ_CST)) {
+      return -1;
+    }
+  }
+  if (strstr(config->url, "value/sendTransaction")) {
+    __atomic_fetch_add(&g->sends, 1, __ATOMIC_SEQ_CST);
+  }
+  return g->sim->perform(g->sim, config, request, write_fn, ctx);
+}
+
+/**
+ * @brief Sets up a gate in front of a ledger simulator
+ *
+ * @param[out] g The gate
+ * @param[in] sim The ledger simulator
+ */
+static inline void test_gate_init(test_gate_t* g, ledger_sim_t* sim) {
+  memset(g, 0, sizeof(test_gate_t));
+  g->sim = ledger_sim_transport(sim);
+  g->transport = (http_transport_t){.name = "gate", .perform = test_gate_perform, .ctx = g};
+}
+
+/**
+ * @brief Fails or passes the unspent output requests
+ *
+ * @param[in] g The gate
+ * @param[in] fail true to fail them
+ */
+static inline void test_gate_fail(test_gate_t* g, bool fail) {
+  __atomic_store_n(&g->fail_refresh, fail, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Gets the number of unspent output requests
+ *
+ * @param[in] g The gate
+ * @return uint32_t
+ */
+static inline uint32_t test_gate_refreshes(test_gate_t* g) { return __atomic_load_n(&g->refreshes, __ATOMIC_SEQ_CST); }
+
+/**
+ * @brief Gets the number of sent transactions
+ *
+ * @param[in] g The gate
+ * @return uint32_t
+ */
+static inline uint32_t test_gate_sends(test_gate_t* g) { return __atomic_load_n(&g->sends, __ATOMIC_SEQ_CST); }
+
+/**
+ * @brief Waits up to 2 seconds until a number of unspent output requests went through the gate
+ *
+ * @param[in] g The gate
+ * @param[in] n The number of requests
+ */
+static inline void test_gate_wait_refreshes(test_gate_t* g, uint32_t n) {
+  for (int i = 0; i < 200 && test_gate_refreshes(g) < n; i++) {
+    usleep(10 * 1000);
+  }
+  TEST_ASSERT(test_gate_refreshes(g) >= n);
+}
+
+/**
+ * @brief Waits up to 2 seconds until a background refresh published a balance
+ *
+ * @param[in] w A wallet
+ * @param[in] balance The expected balance
+ * @return uint64_t The timestamp of the balance
+ */
+static inline uint64_t test_wait_balance(wallet_t* w, uint64_t balance) {
+  uint64_t ts = 0;
+  for (int i = 0; i < 200 && wallet_balance_cached(w, &ts) != balance; i++) {
+    usleep(10 * 1000);
+  }
+  TEST_ASSERT_EQUAL_UINT64(balance, wallet_balance_cached(w, &ts));
+  return ts;
+}
+
+/**
+ * @brief Funds an address of a seed on the ledger simulator
+ *
+ * @param[in] sim The ledger simulator
+ * @param[in] seed The seed
+ * @param[in] index The index of the address
+ * @param[in] amount The amount of the faucet output
+ */
+static inline void test_fund(ledger_sim_t* sim, byte_t const seed[], uint64_t index, uint64_t amount) {
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(seed, index, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT(ledger_sim_fund(sim, addr, amount) == 0);
+}
+
+/**
+ * @brief Adds an output of a random transaction to an address of an unspent output table
+ *
+ * @param[in] t An unspent output table
+ * @param[in] addr The address, it's added if it's not in the table
+ * @param[in] addr_index The index of the address
+ * @param[in] color The color of the output
+ * @param[in] amount The amount of the output
+ * @param[in] confirmed Whether the output is confirmed or pending
+ * @param[out] tx_id The id of the transaction, NULL if not needed
+ */
+static inline void test_add_output(unspent_outputs_t** t, byte_t const addr[], uint64_t addr_index,
+                                   byte_t const color[], uint64_t amount, bool confirmed, byte_t tx_id[]) {
+  inclusion_state_t state = confirmed ? (inclusion_state_t){.confirmed = true} : (inclusion_state_t){.solid = true};
+  byte_t id[TX_ID_BYTES];
+  randombytes_buf((void* const)id, TX_ID_BYTES);
+  if (tx_id) {
+    memcpy(tx_id, id, TX_ID_BYTES);
+  }
+  unspent_outputs_t* elm = unspent_outputs_find(t, addr);
+  if (elm == NULL) {
+    output_ids_t* ids = output_ids_init();
+    TEST_ASSERT(unspent_outputs_add(t, addr, addr_index, ids) == 0);
+    output_ids_free(&ids);
+    elm = unspent_outputs_find(t, addr);
+  }
+  balance_ht_t* bals = balance_ht_init();
+  TEST_ASSERT(balance_ht_add(&bals, color, (int64_t)amount) == 0);
+  TEST_ASSERT(output_ids_add(&elm->ids, id, bals, &state) == 0);
+  balance_ht_free(&bals);
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>  // sleep
 
+#include "client/ledger_sim.h"
+#include "test_utils.h"
 #include "unity/unity.h"
 #include "wallet/wallet.h"
 
@@ -79,6 +82,129 @@ void test_wallet_address_manager() {
   addr_list = NULL;
 
   am_free(am);
+
+  // large wallets keep spent addresses in a compressed bitmask
+  bitmask_t *spent = bitmask_new();
+  TEST_ASSERT(bitmask_range_op(spent, 0, 100, BITMASK_SET) == 0);
+  am = am_new(g_seed, AM_COMPRESSED_MIN_ADDRS, spent);
+  bitmask_free(spent);
+  TEST_ASSERT_NOT_NULL(am);
+  TEST_ASSERT_TRUE(bitmask_is_compressed(am->spent_addr));
+  TEST_ASSERT_TRUE(am_is_spent_address(am, 99));
+  TEST_ASSERT_FALSE(am_is_spent_address(am, 100));
+  am_free(am);
+}
+
+void test_wallet_derive_addresses() {
+  byte_t tmp[TANGLE_ADDRESS_BYTES];
+  uint64_t count = AM_DERIVE_MIN_PER_THREAD * 4 + 3;
+  address_t *addrs = malloc(sizeof(address_t) * count);
+  TEST_ASSERT_NOT_NULL(addrs);
+
+  wallet_am_t *am = am_new(g_seed, 0, NULL);
+  TEST_ASSERT(am_derive_addresses(am, 5, count, addrs) == 0);
+  // same as sequential derivation
+  for (uint64_t i = 0; i < count; i++) {
+    address_get(g_seed, i + 5, ADDRESS_VER_ED25519, tmp);
+    TEST_ASSERT_EQUAL_MEMORY(tmp, addrs[i].addr, TANGLE_ADDRESS_BYTES);
+    TEST_ASSERT_EQUAL_UINT64(i + 5, addrs[i].index);
+  }
+  // the address manager status is not changed
+  TEST_ASSERT_EQUAL_INT64(0, am->last_addr_index);
+
+  am_free(am);
+  free(addrs);
+}
+
+void test_wallet_refresher() {
+  ledger_sim_t *sim = ledger_sim_new(NULL);
+  test_gate_t g;
+  test_gate_init(&g, sim);
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 2, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT(ledger_sim_fund(sim, addr, 50) == 0);
+
+  wallet_t *w = wallet_init("http://ledger.sim/", 0, g_seed, 3, 0, 3);
+  TEST_ASSERT_NOT_NULL(w);
+  wallet_set_transport(w, &g.transport);
+
+  uint64_t ts = 1;
+  TEST_ASSERT_EQUAL_UINT64(0, wallet_balance_cached(w, &ts));
+  TEST_ASSERT_EQUAL_UINT64(0, ts);
+
+  TEST_ASSERT(wallet_refresher_start(w, 0, 0) == -1);
+  TEST_ASSERT(wallet_refresher_start(w, 10, 20) == -1);
+  TEST_ASSERT(wallet_refresher_start(w, 20, 5) == 0);
+  TEST_ASSERT(wallet_refresher_start(w, 20, 5) == -1);
+
+  // the balance and its timestamp are published after a period
+  uint64_t synced = test_wait_balance(w, 50);
+  TEST_ASSERT(synced > 0);
+
+  // failed refreshes keep the last balance and timestamp
+  test_gate_fail(&g, true);
+  TEST_ASSERT(ledger_sim_fund(sim, addr, 10) == 0);
+  test_gate_wait_refreshes(&g, test_gate_refreshes(&g) + 3);
+  TEST_ASSERT_EQUAL_UINT64(50, wallet_balance_cached(w, &ts));
+  TEST_ASSERT_EQUAL_UINT64(synced, ts);
+
+  // and it catches up once the node answers again
+  test_gate_fail(&g, false);
+  TEST_ASSERT(test_wait_balance(w, 60) > synced);
+
+  wallet_refresher_stop(w);
+  // stopping twice is fine
+  wallet_refresher_stop(w);
+
+  // restarts and leaves it running, wallet_free stops it
+  TEST_ASSERT(wallet_refresher_start(w, 1000, 0) == 0);
+  wallet_free(w);
+  ledger_sim_free(sim);
+}
+
+void test_wallet_send_batch_colors() {
+  ledger_sim_t *sim = ledger_sim_new(NULL);
+  byte_t addr[TANGLE_ADDRESS_BYTES];
+  address_get(g_seed, 0, ADDRESS_VER_ED25519, addr);
+  TEST_ASSERT(ledger_sim_fund(sim, addr, 100) == 0);
+  wallet_t *w = wallet_init("http://ledger.sim/", 0, g_seed, 0, 0, 0);
+  TEST_ASSERT_NOT_NULL(w);
+  wallet_set_transport(w, ledger_sim_transport(sim));
+
+  // a payment in a color the wallet doesn't hold fails without sending anything
+  wallet_payment_t payments[2] = {{.amount = 10}, {.amount = 5, .color = {0xC0, 0x10}}};
+  randombytes_buf(payments[0].receiver, TANGLE_ADDRESS_BYTES);
+  memcpy(payments[1].receiver, payments[0].receiver, TANGLE_ADDRESS_BYTES);
+  send_batch_op_t op = {.payments = payments, .count = 2};
+  TEST_ASSERT(wallet_send_batch(w, &op) == -1);
+  ledger_sim_stats_t stats;
+  ledger_sim_stats(sim, &stats);
+  TEST_ASSERT_EQUAL_UINT64(0, stats.accepted);
+  TEST_ASSERT_EQUAL_UINT64(100, wallet_balance(w));
+
+  // amounts of 0 or above INT64_MAX are rejected, and so are amounts adding up above it, even if they wrap around
+  wallet_payment_t invalid[3] = {{.amount = 0}, {.amount = INT64_MAX}, {.amount = INT64_MAX}};
+  for (size_t i = 0; i < 3; i++) {
+    memcpy(invalid[i].receiver, payments[0].receiver, TANGLE_ADDRESS_BYTES);
+  }
+  send_batch_op_t invalid_op = {.payments = invalid, .count = 3, .skip_refresh = true};
+  wallet_utx_t *utx = NULL;
+  TEST_ASSERT(wallet_build_batch(w, &invalid_op, &utx) == -1);
+  invalid[0].amount = (uint64_t)INT64_MAX + 2;
+  invalid_op.count = 2;
+  TEST_ASSERT(wallet_build_batch(w, &invalid_op, &utx) == -1);
+  invalid[0].amount = 2;
+  invalid_op.count = 3;
+  TEST_ASSERT(wallet_build_batch(w, &invalid_op, &utx) == -1);
+  TEST_ASSERT_NULL(utx);
+
+  // the inputs are released for the next payment
+  op.count = 1;
+  TEST_ASSERT(wallet_send_batch(w, &op) == 0);
+  TEST_ASSERT_EQUAL_UINT64(10, ledger_sim_balance(sim, payments[0].receiver, NULL));
+
+  wallet_free(w);
+  ledger_sim_free(sim);
 }
 
 void test_wallet_balance() {
@@ -135,6 +261,9 @@ int main() {
   seed_from_base58("332Db2RL4NHggDX4utnn5sCwTVTqUQJ3vC42TGZFC8hK", g_seed);
 
   RUN_TEST(test_wallet_address_manager);
+  RUN_TEST(test_wallet_derive_addresses);
+  RUN_TEST(test_wallet_refresher);
+  RUN_TEST(test_wallet_send_batch_colors);
   // RUN_TEST(test_wallet_balance);
   // RUN_TEST(test_wallet_request_funds);
   // RUN_TEST(test_wallet_send_funds);
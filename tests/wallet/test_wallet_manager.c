@@ -0,0 +1,173 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "client/endpoint_pool.h"
+#include "client/ledger_sim.h"
+#include "test_utils.h"
+#include "unity/unity.h"
+#include "wallet/wallet_manager.h"
+
+static char const* const g_endpoint = "http://ledger.sim/";
+
+static byte_t g_seed_a[TANGLE_SEED_BYTES] = {1};
+static byte_t g_seed_b[TANGLE_SEED_BYTES] = {2};
+
+void test_wallet_manager() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  test_gate_t g;
+  test_gate_init(&g, sim);
+  test_fund(sim, g_seed_a, 0, 100);
+  test_fund(sim, g_seed_a, 1, 20);
+  test_fund(sim, g_seed_b, 0, 5);
+  test_fund(sim, g_seed_b, 2, 7);
+
+  wallet_manager_t* m = wallet_manager_new(g_endpoint, 0);
+  TEST_ASSERT_NOT_NULL(m);
+  m->endpoint.transport = &g.transport;
+  TEST_ASSERT_EQUAL_UINT32(0, wallet_manager_count(m));
+
+  // 2, 3, and 1 addresses, the last wallet shares its address with the first one
+  wallet_t* a = wallet_manager_add(m, g_seed_a, 1, 0, 1);
+  wallet_t* b = wallet_manager_add(m, g_seed_b, 2, 0, 2);
+  wallet_t* shared = wallet_manager_add(m, g_seed_a, 0, 0, 0);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_NOT_NULL(shared);
+  TEST_ASSERT_EQUAL_UINT32(3, wallet_manager_count(m));
+
+  // wallets are not synced until a refresh round
+  uint64_t ts = 1;
+  TEST_ASSERT_EQUAL_UINT64(0, wallet_balance_cached(a, &ts));
+  TEST_ASSERT_EQUAL_UINT64(0, ts);
+
+  // one request for all wallets, outputs are routed to the wallets holding their address
+  TEST_ASSERT(wallet_manager_refresh(m) == 0);
+  TEST_ASSERT_EQUAL_UINT32(1, test_gate_refreshes(&g));
+  TEST_ASSERT_EQUAL_UINT64(120, wallet_balance_cached(a, &ts));
+  TEST_ASSERT(ts > 0);
+  TEST_ASSERT_EQUAL_UINT64(12, wallet_balance_cached(b, &ts));
+  TEST_ASSERT(ts > 0);
+  TEST_ASSERT_EQUAL_UINT64(100, wallet_balance_cached(shared, &ts));
+  TEST_ASSERT(ts > 0);
+
+  // a wallet is never split, 2 + 3 and 3 + 1 addresses exceed the batch size
+  m->batch_addrs = 3;
+  test_fund(sim, g_seed_b, 1, 1);
+  TEST_ASSERT(wallet_manager_refresh(m) == 0);
+  TEST_ASSERT_EQUAL_UINT32(4, test_gate_refreshes(&g));
+  TEST_ASSERT_EQUAL_UINT64(120, wallet_balance_cached(a, NULL));
+  TEST_ASSERT_EQUAL_UINT64(13, wallet_balance_cached(b, NULL));
+  TEST_ASSERT_EQUAL_UINT64(100, wallet_balance_cached(shared, NULL));
+
+  // a failed round keeps the cached balances, the other batches are still sent
+  uint64_t before = 0;
+  wallet_balance_cached(a, &before);
+  test_fund(sim, g_seed_a, 0, 1);
+  test_gate_fail(&g, true);
+  TEST_ASSERT(wallet_manager_refresh(m) == -1);
+  TEST_ASSERT_EQUAL_UINT32(7, test_gate_refreshes(&g));
+  TEST_ASSERT_EQUAL_UINT64(120, wallet_balance_cached(a, &ts));
+  TEST_ASSERT_EQUAL_UINT64(before, ts);
+  test_gate_fail(&g, false);
+
+  TEST_ASSERT(wallet_manager_remove(m, a) == 0);
+  TEST_ASSERT(wallet_manager_remove(m, a) == -1);
+  TEST_ASSERT_EQUAL_UINT32(2, wallet_manager_count(m));
+  m->batch_addrs = 100;
+  TEST_ASSERT(wallet_manager_refresh(m) == 0);
+  TEST_ASSERT_EQUAL_UINT32(8, test_gate_refreshes(&g));
+  TEST_ASSERT_EQUAL_UINT64(101, wallet_balance_cached(shared, NULL));
+
+  wallet_manager_free(m);
+  ledger_sim_free(sim);
+}
+
+static void* refresh_fn(void* arg) {
+  wallet_manager_refresh((wallet_manager_t*)arg);
+  return NULL;
+}
+
+void test_wallet_manager_slow_round() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  ledger_sim_conf_t conf;
+  ledger_sim_conf_default(&conf);
+  conf.latency_ms = 300;
+  ledger_sim_set_conf(sim, &conf);
+  test_fund(sim, g_seed_a, 0, 100);
+
+  wallet_manager_t* m = wallet_manager_new(g_endpoint, 0);
+  TEST_ASSERT_NOT_NULL(m);
+  m->endpoint.transport = ledger_sim_transport(sim);
+  wallet_t* a = wallet_manager_add(m, g_seed_a, 0, 0, 0);
+  wallet_t* b = wallet_manager_add(m, g_seed_a, 0, 0, 0);
+
+  pthread_t tid;
+  pthread_create(&tid, NULL, refresh_fn, m);
+  usleep(50 * 1000);
+
+  // the wallet list is not locked while the request is sent, a removed wallet is skipped
+  uint64_t start = endpoint_now_us();
+  TEST_ASSERT_NOT_NULL(wallet_manager_add(m, g_seed_b, 0, 0, 0));
+  TEST_ASSERT(wallet_manager_remove(m, a) == 0);
+  TEST_ASSERT_EQUAL_UINT32(2, wallet_manager_count(m));
+  TEST_ASSERT(endpoint_now_us() - start < 150 * 1000);
+
+  pthread_join(tid, NULL);
+  TEST_ASSERT_EQUAL_UINT64(100, wallet_balance_cached(b, NULL));
+
+  wallet_manager_free(m);
+  ledger_sim_free(sim);
+}
+
+void test_wallet_manager_scheduler() {
+  ledger_sim_t* sim = ledger_sim_new(NULL);
+  test_gate_t g;
+  test_gate_init(&g, sim);
+  test_fund(sim, g_seed_a, 0, 100);
+  test_fund(sim, g_seed_b, 0, 5);
+
+  wallet_manager_t* m = wallet_manager_new(g_endpoint, 0);
+  TEST_ASSERT_NOT_NULL(m);
+  m->endpoint.transport = &g.transport;
+
+  TEST_ASSERT(wallet_manager_start(m, 0, 0) == -1);
+  TEST_ASSERT(wallet_manager_start(m, 10, 20) == -1);
+  TEST_ASSERT(wallet_manager_start(m, 20, 5) == 0);
+  TEST_ASSERT(wallet_manager_start(m, 20, 5) == -1);
+
+  // wallets are added while the scheduler is running and refreshed without a call
+  wallet_t* a = wallet_manager_add(m, g_seed_a, 0, 0, 0);
+  wallet_t* b = wallet_manager_add(m, g_seed_b, 0, 0, 0);
+  uint64_t ts = test_wait_balance(a, 100);
+  TEST_ASSERT(ts > 0);
+  TEST_ASSERT(test_wait_balance(b, 5) > 0);
+
+  // and again after an interval
+  test_fund(sim, g_seed_a, 0, 10);
+  TEST_ASSERT(test_wait_balance(a, 110) > ts);
+
+  wallet_manager_stop(m);
+  // stopping twice is fine
+  wallet_manager_stop(m);
+  // nothing is refreshed once stopped
+  uint32_t sent = test_gate_refreshes(&g);
+  usleep(60 * 1000);
+  TEST_ASSERT_EQUAL_UINT32(sent, test_gate_refreshes(&g));
+
+  // restarts and leaves it running, wallet_manager_free stops it
+  TEST_ASSERT(wallet_manager_start(m, 1000, 0) == 0);
+  wallet_manager_free(m);
+  ledger_sim_free(sim);
+}
+
+int main() {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_wallet_manager);
+  RUN_TEST(test_wallet_manager_slow_round);
+  RUN_TEST(test_wallet_manager_scheduler);
+
+  return UNITY_END();
+}